@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+# writes a safetensors file with tensors in the sparse-bitmask compression
+# of compressed-tensors, cf.
+# https://github.com/neuralmagic/compressed-tensors
+# (compressors/sparse_compressors/sparse_bitmask.py): for a tensor "name",
+# "name.shape" holds the dense shape, "name.compressed" the non-zero values
+# in row-major order, "name.bitmask" one bit per element, packed with
+# numpy.packbits(..., axis=-1, bitorder="little"), and "name.row_offsets"
+# the index of the first value of each row
+import json
+import struct
+
+formats = {"F64": "d", "F32": "f", "I64": "q", "I32": "i", "U8": "B"}
+sizes = {"F64": 8, "F32": 4, "I64": 8, "I32": 4, "U8": 1}
+
+
+def compress(name, dtype, shape, values, shape_dtype="I64"):
+    num_columns = shape[-1]
+    rows = [values[r:r + num_columns] for r in range(0, len(values), num_columns)]
+    bitmask, compressed, row_offsets = [], [], []
+    for row in rows:
+        row_offsets.append(len(compressed))
+        compressed += [v for v in row if v != 0]
+        for byte in range(0, num_columns, 8):
+            bits = row[byte:byte + 8]
+            bitmask.append(sum(1 << b for b, v in enumerate(bits) if v != 0))
+    return {name + ".shape": (shape_dtype, [len(shape)], list(shape)),
+            name + ".compressed": (dtype, [len(compressed)], compressed),
+            name + ".bitmask": ("U8", [len(rows), (num_columns + 7) // 8], bitmask),
+            name + ".row_offsets": ("I64", [len(rows)], row_offsets)}
+
+
+def safetensors(tensors):
+    # no holes are allowed, so place the tensors by decreasing element size
+    header = {"__metadata__": {"format": "compressed"}}
+    payload = b""
+    for name, (dtype, shape, values) in sorted(tensors.items(),
+                                               key=lambda t: -sizes[t[1][0]]):
+        data = struct.pack("<%d%s" % (len(values), formats[dtype]), *values)
+        header[name] = {"dtype": dtype, "shape": shape,
+                        "data_offsets": [len(payload), len(payload) + len(data)]}
+        payload += data
+    header = json.dumps(header, separators=(",", ":")).encode()
+    header += b" " * ((8 - len(header) % 8) % 8)
+    return struct.pack("<Q", len(header)) + header + payload
+
+
+# fc.weight[i, j] = 10 * i + j + 1 where (10 * i + j) % 3 == 0, row 2 empty
+fc_weight = [float(10 * i + j + 1) if (10 * i + j) % 3 == 0 and i != 2 else 0.
+             for i in range(4) for j in range(10)]
+# conv.weight[a, b, c] = a + b + c / 100 where (a + b + c) % 5 == 1, with
+# rows of 70 columns, i.e. longer than a 64-bit word
+conv_weight = [a + b + c / 100. if (a + b + c) % 5 == 1 else 0.
+               for a in range(2) for b in range(2) for c in range(70)]
+
+tensors = {}
+tensors.update(compress("fc.weight", "F32", (4, 10), fc_weight))
+tensors.update(compress("conv.weight", "F64", (2, 2, 70), conv_weight, "I32"))
+tensors["fc.bias"] = ("F32", [4], [1., 2., 3., 4.])
+
+with open("model-bitmask.safetensors", "wb") as f:
+    f.write(safetensors(tensors))
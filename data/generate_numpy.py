@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# writes .npy / .npz files for testing dalotia's NumpyFile;
+# the format is simple enough to write without numpy, cf.
+# https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+# (np.save / np.savez / np.savez_compressed produce the same layout)
+import struct
+import zipfile
+
+
+def npy(descr, shape, fortran_order, values):
+    shape_str = "(" + "".join("%d, " % s for s in shape).rstrip(" ")
+    shape_str = shape_str.rstrip(",") + ("," if len(shape) == 1 else "") + ")"
+    header = "{'descr': '%s', 'fortran_order': %s, 'shape': %s, }" % (
+        descr, "True" if fortran_order else "False", shape_str)
+    # pad with spaces so that the payload is 64-byte aligned
+    padding = 64 - (10 + len(header) + 1) % 64
+    header = header + " " * padding + "\n"
+    pack_format = "<%d%s" % (len(values), {"<f8": "d", "<f4": "f", "<i8": "q"}[descr])
+    return (b"\x93NUMPY\x01\x00" + struct.pack("<H", len(header)) +
+            header.encode("latin1") + struct.pack(pack_format, *values))
+
+
+# embedding[i, j, k] = 20 * i + 5 * j + k
+embedding = npy("<f8", (3, 4, 5), False, list(range(60)))
+embedding_fortran = npy("<f8", (3, 4, 5), True,
+                        [20 * i + 5 * j + k for k in range(5) for j in range(4) for i in range(3)])
+fc_weight = npy("<f4", (2, 3), False, [0.5 * i for i in range(6)])
+step = npy("<i8", (), False, [1000])
+
+with open("embedding.npy", "wb") as f:
+    f.write(embedding)
+with open("embedding_fortran.npy", "wb") as f:
+    f.write(embedding_fortran)
+
+members = {"embedding.npy": embedding, "embedding_fortran.npy": embedding_fortran,
+           "fc.weight.npy": fc_weight, "step.npy": step}
+for filename, compression in [("model.npz", zipfile.ZIP_STORED),
+                              ("model-compressed.npz", zipfile.ZIP_DEFLATED)]:
+    with zipfile.ZipFile(filename, "w", compression=compression) as archive:
+        for name, payload in members.items():
+            # np.savez forces ZIP64 headers, too
+            with archive.open(name, "w", force_zip64=True) as member:
+                member.write(payload)
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# writes a small ONNX model for testing dalotia's OnnxFile;
+# the protobuf is encoded by hand so that neither onnx nor numpy is needed
+# cf. https://github.com/onnx/onnx/blob/main/onnx/onnx.proto
+import struct
+
+
+def varint(value):
+    value &= (1 << 64) - 1  # negative int32 are sign-extended to 64 bits
+    out = b""
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out += bytes([byte | 0x80])
+        else:
+            return out + bytes([byte])
+
+
+def field(number, wire_type, payload):
+    tag = varint((number << 3) | wire_type)
+    if wire_type == 2:
+        return tag + varint(len(payload)) + payload
+    return tag + payload
+
+
+def packed_varints(values):
+    return b"".join(varint(v) for v in values)
+
+
+def tensor(name, data_type, dims, **data):
+    message = field(1, 2, packed_varints(dims))
+    message += field(2, 0, varint(data_type))
+    message += field(8, 2, name.encode())
+    if "raw_data" in data:
+        message += field(9, 2, data["raw_data"])
+    if "float_data" in data:
+        message += field(4, 2, struct.pack("<%df" % len(data["float_data"]), *data["float_data"]))
+    if "int32_data" in data:
+        message += field(5, 2, packed_varints(data["int32_data"]))
+    if "external_data" in data:
+        for key, value in data["external_data"].items():
+            entry = field(1, 2, key.encode()) + field(2, 2, value.encode())
+            message += field(13, 2, entry)
+        message += field(14, 0, varint(1))  # data_location = EXTERNAL
+    return message
+
+
+FLOAT, INT8, INT64, DOUBLE = 1, 3, 7, 11
+
+embedding = struct.pack("<60d", *range(60))
+fc_weight = [0.5 * i for i in range(6)]
+fc_bias = struct.pack("<3f", 1.0, 2.0, 3.0)
+with open("model.onnx.data", "wb") as f:
+    f.write(fc_bias)
+
+node = field(1, 2, b"x") + field(1, 2, b"fc.weight") + field(2, 2, b"y")
+node += field(4, 2, b"MatMul")
+graph = field(1, 2, node)  # node before the initializers, to be skipped
+graph += field(2, 2, b"dalotia_test_graph")
+graph += field(5, 2, tensor("embedding", DOUBLE, [3, 4, 5], raw_data=embedding))
+graph += field(5, 2, tensor("fc.weight", FLOAT, [2, 3], float_data=fc_weight))
+graph += field(5, 2, tensor("fc.bias", FLOAT, [3], external_data={
+    "location": "model.onnx.data", "offset": "0", "length": str(len(fc_bias))}))
+graph += field(5, 2, tensor("quantized", INT8, [4], int32_data=[-2, -1, 1, 2]))
+graph += field(5, 2, tensor("reshape.shape", INT64, [2], int32_data=[]))
+
+opset = field(1, 2, b"") + field(2, 0, varint(17))
+model = field(1, 0, varint(8))  # ir_version
+model += field(2, 2, b"dalotia")  # producer_name
+model += field(8, 2, opset)
+model += field(7, 2, graph)
+with open("model.onnx", "wb") as f:
+    f.write(model)
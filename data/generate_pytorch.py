@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# writes torch.save-style checkpoints for testing dalotia's PytorchFile,
+# without needing torch: the tensors are pickled through stand-ins for the
+# torch globals, and the archive has the layout of
+# torch.serialization._save (data.pkl, byteorder, data/<key>, version),
+# with the storages stored uncompressed and 64-byte aligned
+import collections
+import io
+import pickle
+import struct
+import sys
+import types
+import zipfile
+
+torch = types.ModuleType("torch")
+torch_utils = types.ModuleType("torch._utils")
+torch._utils = torch_utils
+sys.modules["torch"] = torch
+sys.modules["torch._utils"] = torch_utils
+
+
+def torch_global(module, name, value):
+    value.__module__ = module.__name__
+    value.__qualname__ = name
+    setattr(module, name, value)
+    return value
+
+
+for storage_name in ["DoubleStorage", "FloatStorage", "LongStorage"]:
+    torch_global(torch, storage_name, type(storage_name, (), {}))
+_rebuild_tensor_v2 = torch_global(torch_utils, "_rebuild_tensor_v2", lambda *args: None)
+_rebuild_parameter = torch_global(torch_utils, "_rebuild_parameter", lambda *args: None)
+
+
+class Storage:
+    def __init__(self, storage_type, key, pack_format, values):
+        self.storage_type = getattr(torch, storage_type)
+        self.key = key
+        self.values = values
+        self.payload = struct.pack("<%d%s" % (len(values), pack_format), *values)
+
+
+class Tensor:
+    def __init__(self, storage, offset, size, stride):
+        self.arguments = (storage, offset, size, stride)
+
+    def __reduce__(self):
+        return (_rebuild_tensor_v2,
+                self.arguments + (False, collections.OrderedDict()))
+
+
+class Parameter:
+    def __init__(self, tensor):
+        self.tensor = tensor
+
+    def __reduce__(self):
+        return (_rebuild_parameter, (self.tensor, True, collections.OrderedDict()))
+
+
+class Pickler(pickle.Pickler):
+    def persistent_id(self, obj):
+        if isinstance(obj, Storage):
+            return ("storage", obj.storage_type, obj.key, "cpu", len(obj.values))
+        return None
+
+
+def save(obj, storages, filename):
+    with zipfile.ZipFile(filename, "w", compression=zipfile.ZIP_STORED) as archive:
+        def write(name, payload):
+            info = zipfile.ZipInfo("archive/" + name)
+            # pad the local header with an extra field, like torch does
+            data_offset = archive.fp.tell() + 30 + len(info.filename) + 4
+            padding = -data_offset % 64
+            info.extra = b"FB" + struct.pack("<H", padding) + b"Z" * padding
+            archive.writestr(info, payload)
+
+        pickled = io.BytesIO()
+        Pickler(pickled, protocol=2).dump(obj)
+        write("data.pkl", pickled.getvalue())
+        write("byteorder", b"little")
+        for storage in storages:
+            write("data/" + storage.key, storage.payload)
+        write("version", b"3\n")
+
+
+# embedding[i, j, k] = 20 * i + 5 * j + k
+embedding = Storage("DoubleStorage", "0", "d", list(range(60)))
+fc = Storage("FloatStorage", "1", "f", [0.5 * i for i in range(6)])
+bias = Storage("FloatStorage", "2", "f", list(range(8)))
+step = Storage("LongStorage", "3", "q", [1000])
+
+state_dict = collections.OrderedDict()
+state_dict["embedding"] = Tensor(embedding, 0, (3, 4, 5), (20, 5, 1))
+state_dict["fc.weight"] = Tensor(fc, 0, (2, 3), (3, 1))
+# a saved transposed view of the same storage
+state_dict["fc.weight_t"] = Tensor(fc, 0, (3, 2), (1, 3))
+# a slice with gaps: bias[2:8:2]
+state_dict["fc.bias"] = Tensor(bias, 2, (3,), (2,))
+state_dict["num_batches_tracked"] = Tensor(step, 0, (), ())
+# nn.Module.state_dict attaches the version metadata as attribute
+state_dict._metadata = collections.OrderedDict([("", {"version": 1})])
+save(state_dict, [embedding, fc, bias, step], "pytorch_model.bin")
+
+checkpoint = {"model": collections.OrderedDict(
+                  [("fc.weight", Parameter(Tensor(fc, 0, (2, 3), (3, 1))))]),
+              "epoch": 3, "optimizer": {"lr": 0.1}}
+save(checkpoint, [fc], "checkpoint.pt")
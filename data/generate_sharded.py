@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# writes a sharded safetensors checkpoint for testing dalotia's
+# ShardedTensorFile, laid out like the ones from transformers'
+# save_pretrained(max_shard_size=...): numbered shards plus
+# model.safetensors.index.json, cf.
+# https://huggingface.co/docs/safetensors/index#format
+import json
+import os
+import struct
+
+
+def safetensors(tensors):
+    header = {"__metadata__": {"format": "pt"}}
+    payload = b""
+    for name, (dtype, shape, values) in tensors.items():
+        data = struct.pack("<%d%s" % (len(values), {"F64": "d", "F32": "f"}[dtype]), *values)
+        header[name] = {"dtype": dtype, "shape": list(shape),
+                        "data_offsets": [len(payload), len(payload) + len(data)]}
+        payload += data
+    header = json.dumps(header, separators=(",", ":")).encode()
+    header += b" " * ((8 - len(header) % 8) % 8)
+    return struct.pack("<Q", len(header)) + header + payload, len(payload)
+
+
+shards = [
+    {"embed.weight": ("F32", (4, 3), [float(i) for i in range(12)]),
+     "layers.0.weight": ("F64", (2, 3, 2), [0.5 * i for i in range(12)])},
+    {"layers.0.bias": ("F32", (3,), [1., 2., 3.]),
+     "lm_head.weight": ("F32", (3, 4), [100. + i for i in range(12)])},
+]
+
+os.makedirs("sharded", exist_ok=True)
+weight_map = {}
+total_size = 0
+for s, tensors in enumerate(shards):
+    filename = "model-%05d-of-%05d.safetensors" % (s + 1, len(shards))
+    data, size = safetensors(tensors)
+    total_size += size
+    with open(os.path.join("sharded", filename), "wb") as f:
+        f.write(data)
+    for name in tensors:
+        weight_map[name] = filename
+
+with open(os.path.join("sharded", "model.safetensors.index.json"), "w") as f:
+    json.dump({"metadata": {"total_size": total_size},
+               "weight_map": dict(sorted(weight_map.items()))}, f, indent=2)
@@ -22,15 +22,18 @@ class Dalotia(CMakePackage):
 
     variant("cpp_pmr", default=True, description="use polymorphic memory resources (pmr) C++17 feature for dalotia")
     variant("openmp", default=True, description="Build with OpenMP support")
-    variant("safetensorscpp", default=True, description="use safetensors-cpp for tensor I/O")
     variant("fortran", default=True, description="Build Fortran interface")
     variant("tensorflow", default=False, description="Build with TensorFlow support")
+    variant("onnx", default=True, description="Build the built-in ONNX initializer reader")
+    variant("numpy", default=True, description="Build the built-in NumPy .npy/.npz reader")
+    variant("pytorch", default=True, description="Build the built-in PyTorch checkpoint reader")
+    variant("pack", default=True, description="Build the dalotia pack format and the dalotia-pack converter")
 
     depends_on("cxx", type="build")
     depends_on("c", type="build")
     depends_on("fortran", type="build", when="+fortran")
     depends_on("cmake@3.24:", type="build")
-    depends_on("safetensors-cpp+cxxexceptions", when="+safetensorscpp")
+    depends_on("zlib-api", when="+numpy")
 
 
     def cmake_args(self):
@@ -38,12 +41,13 @@ class Dalotia(CMakePackage):
             self.define("DALOTIA_CPP_BUILD_EXAMPLES", True),
             self.define_from_variant("DALOTIA_WITH_CPP_PMR", "cpp_pmr"),
             self.define_from_variant("DALOTIA_WITH_OPENMP", "openmp"),
-            self.define_from_variant("DALOTIA_WITH_SAFETENSORS_CPP", "safetensorscpp"),
             self.define_from_variant("DALOTIA_WITH_TENSORFLOW", "tensorflow"),
+            self.define_from_variant("DALOTIA_WITH_ONNX", "onnx"),
+            self.define_from_variant("DALOTIA_WITH_NUMPY", "numpy"),
+            self.define_from_variant("DALOTIA_WITH_PYTORCH", "pytorch"),
+            self.define_from_variant("DALOTIA_WITH_PACK", "pack"),
             self.define_from_variant("DALOTIA_WITH_FORTRAN", "fortran"),
         ]
-        if self.spec.satisfies("+safetensorscpp"):
-            args.append(self.define("safetensors-cpp_DIR", "find"))
         return args
 
     def setup_dependent_build_environment(self, env, dependent_spec):
@@ -30,6 +30,7 @@ bool file_exists(const std::string &name) {
 }
 }  // namespace dalotia
 #endif  // __cpp_lib_filesystem
+#include <cstdint>
 #include <iostream>
 
 #include "dalotia.h"
@@ -52,30 +53,161 @@ TensorFile *make_tensor_file(const std::string &filename) {
 
     // select the file implementation
     if (extension == "safetensors") {
-#ifdef DALOTIA_WITH_SAFETENSORS_CPP
         return new SafetensorsFile(filename);
-#else   // DALOTIA_WITH_SAFETENSORS_CPP
-        throw std::runtime_error("Safetensors support not enabled");
-#endif  // DALOTIA_WITH_SAFETENSORS_CPP
     } else if (extension == "keras" || extension == "pb" || is_directory(filename.c_str())) {
 #ifdef DALOTIA_WITH_TENSORFLOW
         return new TensorflowSavedModel(filename);
+#elif defined(DALOTIA_WITH_TF_BUNDLE)
+        // without the TF runtime, read the variables of the SavedModel
+        if (extension != "keras") {
+            return new TensorflowBundleFile(filename);
+        }
+        throw std::runtime_error("Tensorflow support not enabled");
 #else   // DALOTIA_WITH_TENSORFLOW
         throw std::runtime_error("Tensorflow support not enabled");
 #endif  // DALOTIA_WITH_TENSORFLOW
+    } else if (extension == "index") {
+#ifdef DALOTIA_WITH_TF_BUNDLE
+        return new TensorflowBundleFile(filename);
+#else   // DALOTIA_WITH_TF_BUNDLE
+        throw std::runtime_error("TensorFlow checkpoint support not enabled");
+#endif  // DALOTIA_WITH_TF_BUNDLE
+    } else if (extension == "onnx") {
+#ifdef DALOTIA_WITH_ONNX
+        return new OnnxFile(filename);
+#else   // DALOTIA_WITH_ONNX
+        throw std::runtime_error("ONNX support not enabled");
+#endif  // DALOTIA_WITH_ONNX
+    } else if (extension == "npy" || extension == "npz") {
+#ifdef DALOTIA_WITH_NUMPY
+        return new NumpyFile(filename);
+#else   // DALOTIA_WITH_NUMPY
+        throw std::runtime_error("NumPy support not enabled");
+#endif  // DALOTIA_WITH_NUMPY
+    } else if (extension == "pt" || extension == "pth" || extension == "bin") {
+#ifdef DALOTIA_WITH_PYTORCH
+        return new PytorchFile(filename);
+#else   // DALOTIA_WITH_PYTORCH
+        throw std::runtime_error("PyTorch support not enabled");
+#endif  // DALOTIA_WITH_PYTORCH
+    } else if (extension == "json") {
+        // index of a sharded checkpoint, e.g. model.safetensors.index.json
+        return new ShardedTensorFile(filename);
+    } else if (extension == "dalotia") {
+#ifdef DALOTIA_WITH_PACK
+        return new PackFile(filename);
+#else   // DALOTIA_WITH_PACK
+        throw std::runtime_error("dalotia pack support not enabled");
+#endif  // DALOTIA_WITH_PACK
     } else {
         throw std::runtime_error("Unsupported file extension: ." + extension);
     }
     return nullptr;
 }
 
+TensorFileWriter *make_tensor_file_writer(const std::string &filename) {
+    std::string extension = filename.substr(filename.find_last_of(".") + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   ::tolower);
+    if (extension == "safetensors") {
+        return new SafetensorsFileWriter(filename);
+    } else if (extension == "dalotia") {
+#ifdef DALOTIA_WITH_PACK
+        return new PackFileWriter(filename);
+#else   // DALOTIA_WITH_PACK
+        throw std::runtime_error("dalotia pack support not enabled");
+#endif  // DALOTIA_WITH_PACK
+    } else {
+        throw std::runtime_error("Unsupported file extension for writing: ." +
+                                 extension);
+    }
+}
+
 }  // namespace dalotia
 
+namespace {
+
+bool dlpack_data_type(dalotia_WeightFormat format, DLDataType &data_type) {
+    data_type.lanes = 1;
+    data_type.bits = static_cast<uint8_t>(
+        8 * dalotia::sizeof_weight_format(format));
+    switch (format) {
+        case dalotia_float_64:
+        case dalotia_float_32:
+        case dalotia_float_16:
+            data_type.code = kDLFloat;
+            return true;
+        case dalotia_bfloat_16:
+            data_type.code = kDLBfloat;
+            return true;
+        case dalotia_uint_32:
+        case dalotia_uint_16:
+        case dalotia_uint_8:
+            data_type.code = kDLUInt;
+            return true;
+        case dalotia_int_32:
+        case dalotia_int_16:
+        case dalotia_int_8:
+            data_type.code = kDLInt;
+            return true;
+        default:  // packed sub-byte formats have no DLPack equivalent
+            return false;
+    }
+}
+
+// owns the shape and strides of an exported DLManagedTensor
+struct DLPackContext {
+    DLManagedTensor managed_tensor{};
+    std::vector<int64_t> shape;
+    std::vector<int64_t> strides;
+};
+
+void delete_dlpack_context(DLManagedTensor *self) {
+    delete static_cast<DLPackContext *>(self->manager_ctx);
+}
+
+dalotia::StatsOptions stats_options(int axis, int num_bins,
+                                    double histogram_min, double histogram_max,
+                                    const long long *histogram) {
+    dalotia::StatsOptions options;
+    options.axis = axis;
+    if (histogram != nullptr && num_bins > 0) {
+        options.num_bins = static_cast<size_t>(num_bins);
+        options.histogram_min = histogram_min;
+        options.histogram_max = histogram_max;
+    }
+    return options;
+}
+
+void copy_statistics(const dalotia::TensorStatistics &statistics,
+                     dalotia_TensorStats *stats, long long *histogram) {
+    std::copy(statistics.channels.begin(), statistics.channels.end(), stats);
+    if (histogram != nullptr) {
+        std::copy(statistics.histogram.begin(), statistics.histogram.end(),
+                  histogram);
+    }
+}
+
+}  // namespace
+
 DalotiaTensorFile *dalotia_open_file(const char *filename) {
     return reinterpret_cast<DalotiaTensorFile *>(
         dalotia::make_tensor_file(std::string(filename)));
 }
 
+DalotiaTensorFile *dalotia_open_file_with_adapter(const char *filename,
+                                                  const char *adapter_filename,
+                                                  double scale) {
+    try {
+        return reinterpret_cast<DalotiaTensorFile *>(
+            new dalotia::LoraTensorFile(filename, adapter_filename, scale));
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_open_file_with_adapter: " << e.what()
+                  << std::endl;
+        return nullptr;
+    }
+}
+
 void dalotia_close_file(DalotiaTensorFile *file) {
     delete reinterpret_cast<dalotia::TensorFile *>(file);
 }
@@ -96,9 +228,9 @@ int dalotia_get_num_tensors(DalotiaTensorFile *file) {
 }
 
 int dalotia_get_tensor_name(DalotiaTensorFile *file, int index, char *name) {
-    auto tensor_names =
-        reinterpret_cast<dalotia::TensorFile *>(file)->get_tensor_names();
-    const std::string &tensor_name = tensor_names.at(index);
+    const std::string &tensor_name =
+        reinterpret_cast<dalotia::TensorFile *>(file)->get_tensor_names().at(
+            index);
     std::copy(tensor_name.begin(), tensor_name.end(), name);
     name[tensor_name.size()] = '\0';  // zero-terminate
     // return the length of the string
@@ -121,7 +253,69 @@ int dalotia_get_num_tensor_elements(DalotiaTensorFile *file,
 }
 
 int dalotia_get_nnz(DalotiaTensorFile *file, const char *tensor_name) {
-    return reinterpret_cast<dalotia::TensorFile *>(file)->get_nnz(tensor_name);
+    try {
+        return static_cast<int>(
+            reinterpret_cast<dalotia::TensorFile *>(file)->get_nnz(tensor_name));
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_nnz: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+void dalotia_set_prune_threshold(DalotiaTensorFile *file, double threshold) {
+    reinterpret_cast<dalotia::TensorFile *>(file)->set_prune_threshold(threshold);
+}
+
+void dalotia_set_bsr_block_shape(DalotiaTensorFile *file, int block_rows,
+                                 int block_columns) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    auto layout = dalotia_file->get_sparse_layout();
+    layout.block_rows = block_rows;
+    layout.block_columns = block_columns;
+    dalotia_file->set_sparse_layout(layout);
+}
+
+void dalotia_set_sell_parameters(DalotiaTensorFile *file, int chunk_size,
+                                 int sorting_scope) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    auto layout = dalotia_file->get_sparse_layout();
+    layout.chunk_size = chunk_size;
+    layout.sorting_scope = sorting_scope;
+    dalotia_file->set_sparse_layout(layout);
+}
+
+void dalotia_set_hicoo_block_bits(DalotiaTensorFile *file, int block_bits) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    auto layout = dalotia_file->get_sparse_layout();
+    layout.hicoo_block_bits = block_bits;
+    dalotia_file->set_sparse_layout(layout);
+}
+
+void dalotia_set_rcm_reordering(DalotiaTensorFile *file, bool reorder) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    auto layout = dalotia_file->get_sparse_layout();
+    layout.reorder_rcm = reorder;
+    dalotia_file->set_sparse_layout(layout);
+}
+
+int dalotia_get_sparse_permutation(DalotiaTensorFile *file,
+                                   const char *tensor_name,
+                                   int *row_permutation,
+                                   int *column_permutation) {
+    try {
+        const auto permutation =
+            reinterpret_cast<dalotia::TensorFile *>(file)->get_sparse_permutation(
+                tensor_name);
+        std::copy(permutation.rows.begin(), permutation.rows.end(),
+                  row_permutation);
+        std::copy(permutation.columns.begin(), permutation.columns.end(),
+                  column_permutation);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_sparse_permutation: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+    return 0;
 }
 
 int dalotia_get_tensor_extents(DalotiaTensorFile *file, const char *tensor_name,
@@ -136,18 +330,17 @@ int dalotia_get_sparse_tensor_extents(DalotiaTensorFile *file,
                                       const char *tensor_name, int *extents,
                                       dalotia_SparseFormat format) {
     auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
-    int num_dimensions = dalotia_file->get_num_dimensions(tensor_name);
-    if (format == dalotia_SparseFormat::dalotia_CSR) {
-        auto read_extents = dalotia_file->get_sparse_tensor_extents(
-                tensor_name, dalotia_SparseFormat::dalotia_CSR);
-        assert(static_cast<size_t>(read_extents[0]) ==
-               dalotia_file->get_nnz(tensor_name));
+    try {
+        int num_dimensions = dalotia_file->get_num_dimensions(tensor_name);
+        auto read_extents =
+            dalotia_file->get_sparse_tensor_extents(tensor_name, format);
         std::copy(read_extents.begin(), read_extents.end(), extents);
-    } else {
-        assert(false);
+        return num_dimensions;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_sparse_tensor_extents: " << e.what()
+                  << std::endl;
         return -1;
     }
-    return num_dimensions;
 }
 
 int dalotia_load_tensor_dense(DalotiaTensorFile *file, const char *tensor_name,
@@ -188,6 +381,292 @@ int dalotia_load_tensor_dense_with_permutation(DalotiaTensorFile *file,
     }
 }
 
+int dalotia_load_tensor_folded(DalotiaTensorFile *file,
+                               const char *weight_name, const char *bias_name,
+                               const char *gamma_name, const char *beta_name,
+                               const char *mean_name,
+                               const char *variance_name, double epsilon,
+                               char *weight, char *bias,
+                               dalotia_WeightFormat format,
+                               dalotia_Ordering ordering,
+                               const int *permutation) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    const auto name_or_empty = [](const char *name) {
+        return name == nullptr ? std::string() : std::string(name);
+    };
+    try {
+        std::vector<int> permutation_vector;
+        if (permutation != nullptr) {
+            permutation_vector.assign(
+                permutation,
+                permutation + dalotia_file->get_num_dimensions(weight_name));
+        }
+        const dalotia::BatchNormNames norm{
+            name_or_empty(gamma_name), name_or_empty(beta_name),
+            name_or_empty(mean_name), name_or_empty(variance_name), epsilon};
+        dalotia::load_folded(*dalotia_file, weight_name,
+                             name_or_empty(bias_name), norm, format, ordering,
+                             reinterpret_cast<dalotia_byte *>(weight),
+                             reinterpret_cast<dalotia_byte *>(bias),
+                             permutation_vector);
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_load_tensor_folded: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_load_tensor_dense_with_stats(
+    DalotiaTensorFile *file, const char *tensor_name, char *tensor,
+    dalotia_WeightFormat format, dalotia_Ordering ordering,
+    const int *permutation, int axis, dalotia_TensorStats *stats,
+    int num_bins, double histogram_min, double histogram_max,
+    long long *histogram) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    if (stats == nullptr) {
+        return -1;
+    }
+    try {
+        std::vector<int> permutation_vector;
+        if (permutation != nullptr) {
+            permutation_vector.assign(
+                permutation,
+                permutation + dalotia_file->get_num_dimensions(tensor_name));
+        }
+        copy_statistics(
+            dalotia::load_tensor_dense_with_stats(
+                *dalotia_file, tensor_name, format, ordering,
+                reinterpret_cast<dalotia_byte *>(tensor),
+                stats_options(axis, num_bins, histogram_min, histogram_max,
+                              histogram),
+                permutation_vector),
+            stats, histogram);
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_load_tensor_dense_with_stats: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_tensor_stats(DalotiaTensorFile *file, const char *tensor_name,
+                             int axis, dalotia_TensorStats *stats,
+                             int num_bins, double histogram_min,
+                             double histogram_max, long long *histogram) {
+    if (stats == nullptr) {
+        return -1;
+    }
+    try {
+        copy_statistics(
+            dalotia::compute_tensor_stats(
+                *reinterpret_cast<dalotia::TensorFile *>(file), tensor_name,
+                stats_options(axis, num_bins, histogram_min, histogram_max,
+                              histogram)),
+            stats, histogram);
+        return 0;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_tensor_stats: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_load_tensors_dense(DalotiaTensorFile *file, int num_tensors,
+                               const char *const *tensor_names, char **tensors,
+                               dalotia_WeightFormat format,
+                               dalotia_Ordering ordering) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        std::vector<std::string> names(tensor_names, tensor_names + num_tensors);
+        std::vector<dalotia_byte *> byte_tensors(num_tensors);
+        for (int i = 0; i < num_tensors; ++i) {
+            byte_tensors[i] = reinterpret_cast<dalotia_byte *>(tensors[i]);
+        }
+        dalotia_file->load_tensors_dense(names, format, ordering, byte_tensors);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_load_tensors_dense: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_get_tensor_handle(DalotiaTensorFile *file,
+                              const char *tensor_name) {
+    try {
+        return reinterpret_cast<dalotia::TensorFile *>(file)->get_tensor_index(
+            tensor_name);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_tensor_handle: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_num_dimensions_by_handle(DalotiaTensorFile *file, int handle) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        return static_cast<int>(
+            dalotia_file->get_tensor_extents_by_index(handle).size());
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_num_dimensions_by_handle: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_num_tensor_elements_by_handle(DalotiaTensorFile *file,
+                                              int handle) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        const auto extents = dalotia_file->get_tensor_extents_by_index(handle);
+        return std::accumulate(extents.begin(), extents.end(), 1,
+                               std::multiplies<int>());
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_num_tensor_elements_by_handle: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_tensor_extents_by_handle(DalotiaTensorFile *file, int handle,
+                                         int *extents) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        const auto extents_vector =
+            dalotia_file->get_tensor_extents_by_index(handle);
+        std::copy(extents_vector.begin(), extents_vector.end(), extents);
+        return static_cast<int>(extents_vector.size());
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_tensor_extents_by_handle: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_weight_format_by_handle(DalotiaTensorFile *file, int handle) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        return dalotia_file->get_weight_format_by_index(handle);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_weight_format_by_handle: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_load_tensor_dense_by_handle(DalotiaTensorFile *file, int handle,
+                                        char *tensor,
+                                        dalotia_WeightFormat format,
+                                        dalotia_Ordering ordering,
+                                        const int *permutation) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    auto byte_tensor = reinterpret_cast<dalotia_byte *>(tensor);
+    try {
+        std::vector<int> permutation_vector;
+        if (permutation != nullptr) {
+            permutation_vector.assign(
+                permutation,
+                permutation +
+                    dalotia_file->get_tensor_extents_by_index(handle).size());
+        }
+        dalotia_file->load_tensor_dense_by_index(handle, format, ordering,
+                                                 byte_tensor, permutation_vector);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_load_tensor_dense_by_handle: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_describe_tensors(DalotiaTensorFile *file, int *num_dimensions,
+                             int *extents,
+                             dalotia_WeightFormat *weight_formats,
+                             int *num_elements) {
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    try {
+        const int num_tensors =
+            static_cast<int>(dalotia_file->get_tensor_names().size());
+        int num_extents = 0;
+        for (int i = 0; i < num_tensors; ++i) {
+            const auto tensor_extents =
+                dalotia_file->get_tensor_extents_by_index(i);
+            if (num_dimensions != nullptr) {
+                num_dimensions[i] = static_cast<int>(tensor_extents.size());
+            }
+            if (extents != nullptr) {
+                std::copy(tensor_extents.begin(), tensor_extents.end(),
+                          extents + num_extents);
+            }
+            num_extents += static_cast<int>(tensor_extents.size());
+            if (weight_formats != nullptr) {
+                weight_formats[i] = dalotia_file->get_weight_format_by_index(i);
+            }
+            if (num_elements != nullptr) {
+                num_elements[i] = std::accumulate(
+                    tensor_extents.begin(), tensor_extents.end(), 1,
+                    std::multiplies<int>());
+            }
+        }
+        return num_extents;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_describe_tensors: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+int dalotia_get_tensor_view(DalotiaTensorFile *file, const char *tensor_name,
+                            const char **data, dalotia_WeightFormat *format,
+                            int *extents, long long *strides) {
+    try {
+        const auto view =
+            reinterpret_cast<dalotia::TensorFile *>(file)->get_tensor_view(
+                tensor_name);
+        if (view.data == nullptr) {
+            return -1;
+        }
+        *data = reinterpret_cast<const char *>(view.data);
+        *format = view.weight_format;
+        std::copy(view.extents.begin(), view.extents.end(), extents);
+        std::copy(view.strides.begin(), view.strides.end(), strides);
+        return static_cast<int>(view.extents.size());
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_get_tensor_view: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+DLManagedTensor *dalotia_export_dlpack(DalotiaTensorFile *file,
+                                       const char *tensor_name) {
+    try {
+        const auto view =
+            reinterpret_cast<dalotia::TensorFile *>(file)->get_tensor_view(
+                tensor_name);
+        DLDataType data_type;
+        if (view.data == nullptr ||
+            !dlpack_data_type(view.weight_format, data_type)) {
+            return nullptr;
+        }
+        auto *context = new DLPackContext;
+        context->shape.assign(view.extents.begin(), view.extents.end());
+        context->strides.assign(view.strides.begin(), view.strides.end());
+        DLTensor &dl_tensor = context->managed_tensor.dl_tensor;
+        // DLPack has no read-only tensors before version 1.0
+        dl_tensor.data =
+            const_cast<void *>(static_cast<const void *>(view.data));
+        dl_tensor.device = {kDLCPU, 0};
+        dl_tensor.ndim = static_cast<int32_t>(context->shape.size());
+        dl_tensor.dtype = data_type;
+        dl_tensor.shape = context->shape.data();
+        dl_tensor.strides = context->strides.data();
+        dl_tensor.byte_offset = 0;
+        context->managed_tensor.manager_ctx = context;
+        context->managed_tensor.deleter = delete_dlpack_context;
+        return &context->managed_tensor;
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_export_dlpack: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
 // TODO with named tensors?
 
 int dalotia_load_tensor_sparse(DalotiaTensorFile *file, const char *tensor_name,
@@ -197,18 +676,10 @@ int dalotia_load_tensor_sparse(DalotiaTensorFile *file, const char *tensor_name,
                                dalotia_Ordering ordering) {
     auto byte_tensor = reinterpret_cast<dalotia_byte *>(values);
     try {
-        if (format == dalotia_SparseFormat::dalotia_CSR &&
-            weightFormat == dalotia_WeightFormat::dalotia_float_32 &&
-            ordering == dalotia_Ordering::dalotia_C_ordering) {
-            reinterpret_cast<dalotia::TensorFile *>(file)->load_tensor_sparse(
-                tensor_name, dalotia_SparseFormat::dalotia_CSR,
-                dalotia_WeightFormat::dalotia_float_32,
-                dalotia_Ordering::dalotia_C_ordering, byte_tensor,
-                first_indices, second_indices);
-        } else {
-            throw std::runtime_error(
-                "dalotia_load_tensor_sparse: unsupported format combination");
-        }
+        // the backend throws for combinations it does not support
+        reinterpret_cast<dalotia::TensorFile *>(file)->load_tensor_sparse(
+            tensor_name, format, weightFormat, ordering, byte_tensor,
+            first_indices, second_indices);
     } catch (const std::exception &e) {
         std::cerr << "dalotia_load_tensor_sparse: " << e.what() << std::endl;
         return -1;
@@ -216,3 +687,135 @@ int dalotia_load_tensor_sparse(DalotiaTensorFile *file, const char *tensor_name,
     return 0;
 }
 // TODO ...also with permutation and named tensors...
+
+void dalotia_set_instrumentation(DalotiaTensorFile *file, bool enabled) {
+    reinterpret_cast<dalotia::TensorFile *>(file)
+        ->get_instrumentation()
+        .set_enabled(enabled);
+}
+
+int dalotia_get_load_stats(DalotiaTensorFile *file, dalotia_LoadStats *stats) {
+    if (stats == nullptr) {
+        return -1;
+    }
+    *stats = reinterpret_cast<dalotia::TensorFile *>(file)
+                 ->get_instrumentation()
+                 .get_stats();
+    return 0;
+}
+
+void dalotia_reset_load_stats(DalotiaTensorFile *file) {
+    reinterpret_cast<dalotia::TensorFile *>(file)->get_instrumentation().reset();
+}
+
+int dalotia_set_trace_file(DalotiaTensorFile *file,
+                           const char *trace_filename) {
+    if (trace_filename == nullptr) {
+        return -1;
+    }
+    reinterpret_cast<dalotia::TensorFile *>(file)
+        ->get_instrumentation()
+        .set_trace_file(trace_filename);
+    return 0;
+}
+
+int dalotia_write_trace(DalotiaTensorFile *file) {
+    try {
+        reinterpret_cast<dalotia::TensorFile *>(file)
+            ->get_instrumentation()
+            .write_trace();
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_write_trace: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+void dalotia_set_load_hooks(DalotiaTensorFile *file, dalotia_LoadHook begin,
+                            dalotia_LoadHook end, void *user_data) {
+    reinterpret_cast<dalotia::TensorFile *>(file)
+        ->get_instrumentation()
+        .set_hooks(begin, end, user_data);
+}
+
+const char *dalotia_load_phase_name(dalotia_LoadPhase phase) {
+    return dalotia::load_phase_name(phase);
+}
+
+DalotiaTensorFileWriter *dalotia_open_file_writer(const char *filename) {
+    return reinterpret_cast<DalotiaTensorFileWriter *>(
+        dalotia::make_tensor_file_writer(std::string(filename)));
+}
+
+void dalotia_close_file_writer(DalotiaTensorFileWriter *writer) {
+    delete reinterpret_cast<dalotia::TensorFileWriter *>(writer);
+}
+
+int dalotia_add_tensor_dense(DalotiaTensorFileWriter *writer,
+                             const char *tensor_name, const char *tensor,
+                             int num_dimensions, const int *extents,
+                             dalotia_WeightFormat input_format,
+                             dalotia_Ordering ordering,
+                             dalotia_WeightFormat output_format) {
+    auto dalotia_writer = reinterpret_cast<dalotia::TensorFileWriter *>(writer);
+    try {
+        dalotia_writer->add_tensor_dense(
+            tensor_name, input_format, ordering,
+            std::vector<int>(extents, extents + num_dimensions),
+            reinterpret_cast<const dalotia_byte *>(tensor), output_format);
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_add_tensor_dense: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_add_tensor_dense_with_permutation(
+    DalotiaTensorFileWriter *writer, const char *tensor_name,
+    const char *tensor, int num_dimensions, const int *extents,
+    dalotia_WeightFormat input_format, dalotia_Ordering ordering,
+    dalotia_WeightFormat output_format, const int *permutation) {
+    auto dalotia_writer = reinterpret_cast<dalotia::TensorFileWriter *>(writer);
+    try {
+        dalotia_writer->add_tensor_dense(
+            tensor_name, input_format, ordering,
+            std::vector<int>(extents, extents + num_dimensions),
+            reinterpret_cast<const dalotia_byte *>(tensor), output_format,
+            std::vector<int>(permutation, permutation + num_dimensions));
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_add_tensor_dense_with_permutation: " << e.what()
+                  << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_write_file(DalotiaTensorFileWriter *writer) {
+    try {
+        reinterpret_cast<dalotia::TensorFileWriter *>(writer)->write();
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_write_file: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_write_file_async(DalotiaTensorFileWriter *writer) {
+    try {
+        reinterpret_cast<dalotia::TensorFileWriter *>(writer)->write_async();
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_write_file_async: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int dalotia_wait_for_write(DalotiaTensorFileWriter *writer) {
+    try {
+        reinterpret_cast<dalotia::TensorFileWriter *>(writer)->wait();
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia_wait_for_write: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
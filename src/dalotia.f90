@@ -12,20 +12,68 @@ module dalotia_c_interface
 
   ! TODO which is the best C-enum syntax?
     enum, bind(C)
+        ! has to match dalotia_WeightFormat in dalotia_formats.h
         enumerator dalotia_float_64  , &
                    dalotia_float_32  , &
                    dalotia_float_16  , &
-                   dalotia_float_8   , &
                    dalotia_bfloat_16 , &
+                   dalotia_uint_32   , &
+                   dalotia_uint_16   , &
+                   dalotia_uint_8    , &
+                   dalotia_int_32    , &
+                   dalotia_int_16    , &
                    dalotia_int_8     , &
-                   dalotia_int_2 
-    end enum 
+                   dalotia_int_2
+    end enum
 
     enum, bind(C)
         enumerator dalotia_C_ordering, &
                    dalotia_F_ordering
     end enum
 
+    enum, bind(C)
+        ! has to match dalotia_SparseFormat in dalotia_formats.h
+        enumerator dalotia_CSR, &
+                   dalotia_COO, &
+                   dalotia_BSR, &
+                   dalotia_SELL, &
+                   dalotia_COO_ND, &
+                   dalotia_ALTO, &
+                   dalotia_HiCOO
+    end enum
+
+    enum, bind(C)
+        ! has to match dalotia_LoadPhase in dalotia_instrumentation.h
+        enumerator dalotia_lookup_phase, &
+                   dalotia_io_phase, &
+                   dalotia_convert_phase, &
+                   dalotia_permute_phase
+    end enum
+
+    ! has to match dalotia_LoadStats in dalotia_instrumentation.h
+    type, bind(C) :: dalotia_LoadStats
+        integer(C_long_long) :: num_loads
+        real(C_double) :: seconds(4) ! indexed by phase + 1
+        integer(C_long_long) :: bytes_read
+        integer(C_long_long) :: bytes_written
+        integer(C_long_long) :: minor_faults
+        integer(C_long_long) :: major_faults
+        integer(C_long_long) :: bytes_mapped
+        integer(C_long_long) :: bytes_resident
+        integer(C_int) :: max_threads
+    end type dalotia_LoadStats
+
+    ! has to match dalotia_TensorStats in dalotia_stats.h
+    type, bind(C) :: dalotia_TensorStats
+        integer(C_long_long) :: num_elements
+        integer(C_long_long) :: num_nan
+        integer(C_long_long) :: num_inf
+        real(C_double) :: min ! of the finite values
+        real(C_double) :: max
+        real(C_double) :: absmax
+        real(C_double) :: l2_norm
+    end type dalotia_TensorStats
+
   interface
     type(C_ptr) function dalotia_open_file_c(file_name) bind(C,name="dalotia_open_file")
         use, intrinsic::ISO_C_BINDING, only: C_ptr, C_char
@@ -33,6 +81,15 @@ module dalotia_c_interface
         character(kind=C_char), dimension(*), intent(in):: file_name
     end function dalotia_open_file_c
 
+    type(C_ptr) function dalotia_open_file_with_adapter_c(file_name, adapter_file_name, scale) &
+      bind(C,name="dalotia_open_file_with_adapter")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_char, C_double
+        implicit none
+        character(kind=C_char), dimension(*), intent(in):: file_name
+        character(kind=C_char), dimension(*), intent(in):: adapter_file_name
+        real(C_double), intent(in), value:: scale
+    end function dalotia_open_file_with_adapter_c
+
     subroutine dalotia_close_file(dalotia_file_pointer) bind(C,name="dalotia_close_file")
         use, intrinsic::ISO_C_BINDING, only: C_ptr
         implicit none
@@ -82,6 +139,166 @@ module dalotia_c_interface
         character(kind=C_char), dimension(*), intent(in):: tensor_name
     end function dalotia_get_num_tensor_elements_c
 
+    integer function dalotia_get_nnz_c(dalotia_file_pointer, tensor_name) bind(C,name="dalotia_get_nnz")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+    end function dalotia_get_nnz_c
+
+    subroutine dalotia_set_prune_threshold(dalotia_file_pointer, threshold) bind(C,name="dalotia_set_prune_threshold")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_double
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        real(C_double), intent(in), value:: threshold
+    end subroutine dalotia_set_prune_threshold
+
+    subroutine dalotia_set_bsr_block_shape(dalotia_file_pointer, block_rows, block_columns) &
+           bind(C,name="dalotia_set_bsr_block_shape")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: block_rows, block_columns
+    end subroutine dalotia_set_bsr_block_shape
+
+    subroutine dalotia_set_sell_parameters(dalotia_file_pointer, chunk_size, sorting_scope) &
+           bind(C,name="dalotia_set_sell_parameters")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: chunk_size, sorting_scope
+    end subroutine dalotia_set_sell_parameters
+
+    subroutine dalotia_set_hicoo_block_bits(dalotia_file_pointer, block_bits) &
+           bind(C,name="dalotia_set_hicoo_block_bits")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: block_bits
+    end subroutine dalotia_set_hicoo_block_bits
+
+    subroutine dalotia_set_rcm_reordering(dalotia_file_pointer, reorder) &
+           bind(C,name="dalotia_set_rcm_reordering")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_bool
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        logical(C_bool), intent(in), value:: reorder
+    end subroutine dalotia_set_rcm_reordering
+
+    subroutine dalotia_set_instrumentation(dalotia_file_pointer, enabled) &
+           bind(C,name="dalotia_set_instrumentation")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_bool
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        logical(C_bool), intent(in), value:: enabled
+    end subroutine dalotia_set_instrumentation
+
+    integer(C_int) function dalotia_get_load_stats_c(dalotia_file_pointer, stats) &
+           bind(C,name="dalotia_get_load_stats")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        import :: dalotia_LoadStats
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        type(dalotia_LoadStats), intent(out):: stats
+    end function dalotia_get_load_stats_c
+
+    integer(C_int) function dalotia_load_tensor_dense_with_stats_c(dalotia_file_pointer, tensor_name, &
+           tensor, dalotia_weight_format, dalotia_ordering, permutation, axis, stats, num_bins, &
+           histogram_min, histogram_max, histogram) bind(C,name="dalotia_load_tensor_dense_with_stats")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int, C_double, C_long_long
+        import :: dalotia_TensorStats
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        type(C_ptr), intent(in), value:: tensor
+        integer(C_int), intent(in), value:: dalotia_weight_format
+        integer(C_int), intent(in), value:: dalotia_ordering
+        integer(C_int), dimension(*), optional, intent(in):: permutation ! NULL if absent
+        integer(C_int), intent(in), value:: axis
+        type(dalotia_TensorStats), dimension(*), intent(out):: stats
+        integer(C_int), intent(in), value:: num_bins
+        real(C_double), intent(in), value:: histogram_min, histogram_max
+        integer(C_long_long), dimension(*), optional, intent(out):: histogram ! NULL if absent
+    end function dalotia_load_tensor_dense_with_stats_c
+
+    integer(C_int) function dalotia_get_tensor_stats_c(dalotia_file_pointer, tensor_name, axis, stats, &
+           num_bins, histogram_min, histogram_max, histogram) bind(C,name="dalotia_get_tensor_stats")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int, C_double, C_long_long
+        import :: dalotia_TensorStats
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        integer(C_int), intent(in), value:: axis
+        type(dalotia_TensorStats), dimension(*), intent(out):: stats
+        integer(C_int), intent(in), value:: num_bins
+        real(C_double), intent(in), value:: histogram_min, histogram_max
+        integer(C_long_long), dimension(*), optional, intent(out):: histogram ! NULL if absent
+    end function dalotia_get_tensor_stats_c
+
+    subroutine dalotia_reset_load_stats(dalotia_file_pointer) bind(C,name="dalotia_reset_load_stats")
+        use, intrinsic::ISO_C_binding, only: C_ptr
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+    end subroutine dalotia_reset_load_stats
+
+    integer(C_int) function dalotia_set_trace_file_c(dalotia_file_pointer, trace_file_name) &
+           bind(C,name="dalotia_set_trace_file")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: trace_file_name
+    end function dalotia_set_trace_file_c
+
+    integer(C_int) function dalotia_write_trace_c(dalotia_file_pointer) bind(C,name="dalotia_write_trace")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+    end function dalotia_write_trace_c
+
+    subroutine dalotia_set_load_hooks(dalotia_file_pointer, begin_hook, end_hook, user_data) &
+           bind(C,name="dalotia_set_load_hooks")
+        ! the hooks are bind(C) subroutines (tensor_name, phase, user_data),
+        ! passed with C_funloc, or C_NULL_funptr
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_funptr
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        type(C_funptr), intent(in), value:: begin_hook, end_hook
+        type(C_ptr), intent(in), value:: user_data
+    end subroutine dalotia_set_load_hooks
+
+    integer(C_int) function dalotia_get_sparse_permutation_c(dalotia_file_pointer, tensor_name, &
+           row_permutation, column_permutation) bind(C,name="dalotia_get_sparse_permutation")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        integer(C_int), dimension(*), intent(inout):: row_permutation, column_permutation
+    end function dalotia_get_sparse_permutation_c
+
+    integer function dalotia_get_sparse_tensor_extents_c(dalotia_file_pointer, &
+            tensor_name, sparse_extents, sparse_format) bind(C,name="dalotia_get_sparse_tensor_extents")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        integer(C_int), dimension(*), intent(inout):: sparse_extents
+        integer(C_int), intent(in), value:: sparse_format
+    end function dalotia_get_sparse_tensor_extents_c
+
+    integer(C_int) function dalotia_load_tensor_sparse_c(dalotia_file_pointer, tensor_name, &
+           values, first_indices, second_indices, sparse_format, dalotia_weight_format, &
+           dalotia_ordering) bind(C,name="dalotia_load_tensor_sparse")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        type(C_ptr), intent(in), value:: values
+        integer(C_int), dimension(*), intent(inout):: first_indices, second_indices
+        integer(C_int), intent(in), value:: sparse_format
+        integer(C_int), intent(in), value:: dalotia_weight_format
+        integer(C_int), intent(in), value:: dalotia_ordering
+    end function dalotia_load_tensor_sparse_c
+
     integer function dalotia_get_tensor_extents_c(dalotia_file_pointer, &
             tensor_name, tensor_extents) bind(C,name="dalotia_get_tensor_extents")
         use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
@@ -114,6 +331,144 @@ module dalotia_c_interface
         integer(C_int), intent(in), value:: dalotia_ordering
         integer(C_int), dimension(*), intent(in):: permutation
     end subroutine dalotia_load_tensor_dense_with_permutation_c
+
+    integer(C_int) function dalotia_get_tensor_handle_c(dalotia_file_pointer, tensor_name) &
+           bind(C,name="dalotia_get_tensor_handle")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+    end function dalotia_get_tensor_handle_c
+
+    integer(C_int) function dalotia_get_tensor_extents_by_handle_c(dalotia_file_pointer, handle, &
+           tensor_extents) bind(C,name="dalotia_get_tensor_extents_by_handle")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: handle
+        integer(C_int), dimension(*), intent(inout):: tensor_extents
+    end function dalotia_get_tensor_extents_by_handle_c
+
+    integer(C_int) function dalotia_get_num_dimensions_by_handle_c(dalotia_file_pointer, handle) &
+           bind(C,name="dalotia_get_num_dimensions_by_handle")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: handle
+    end function dalotia_get_num_dimensions_by_handle_c
+
+    integer(C_int) function dalotia_get_num_tensor_elements_by_handle_c(dalotia_file_pointer, handle) &
+           bind(C,name="dalotia_get_num_tensor_elements_by_handle")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: handle
+    end function dalotia_get_num_tensor_elements_by_handle_c
+
+    integer(C_int) function dalotia_load_tensor_dense_by_handle_c(dalotia_file_pointer, handle, &
+           tensor, dalotia_weight_format, dalotia_ordering, permutation) &
+           bind(C,name="dalotia_load_tensor_dense_by_handle")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), intent(in), value:: handle
+        type(C_ptr), intent(in), value:: tensor
+        integer(C_int), intent(in), value:: dalotia_weight_format
+        integer(C_int), intent(in), value:: dalotia_ordering
+        integer(C_int), dimension(*), optional, intent(in):: permutation ! NULL if absent
+    end function dalotia_load_tensor_dense_by_handle_c
+
+    integer(C_int) function dalotia_describe_tensors_c(dalotia_file_pointer, num_dimensions, &
+           tensor_extents, weight_formats, num_elements) bind(C,name="dalotia_describe_tensors")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), dimension(*), optional, intent(inout):: num_dimensions
+        integer(C_int), dimension(*), optional, intent(inout):: tensor_extents
+        integer(C_int), dimension(*), optional, intent(inout):: weight_formats
+        integer(C_int), dimension(*), optional, intent(inout):: num_elements
+    end function dalotia_describe_tensors_c
+
+    integer(C_int) function dalotia_get_tensor_view_c(dalotia_file_pointer, tensor_name, data, &
+           weight_format, tensor_extents, tensor_strides) bind(C,name="dalotia_get_tensor_view")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char, C_int, C_long_long
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        type(C_ptr), intent(out):: data
+        integer(C_int), intent(out):: weight_format
+        integer(C_int), dimension(*), intent(inout):: tensor_extents
+        integer(C_long_long), dimension(*), intent(inout):: tensor_strides
+    end function dalotia_get_tensor_view_c
+
+    type(C_ptr) function dalotia_export_dlpack_c(dalotia_file_pointer, tensor_name) &
+           bind(C,name="dalotia_export_dlpack")
+        use, intrinsic::ISO_C_binding, only: C_ptr, C_char
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+    end function dalotia_export_dlpack_c
+
+    type(C_ptr) function dalotia_open_file_writer_c(file_name) bind(C,name="dalotia_open_file_writer")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_char
+        implicit none
+        character(kind=C_char), dimension(*), intent(in):: file_name
+    end function dalotia_open_file_writer_c
+
+    subroutine dalotia_close_file_writer(dalotia_writer_pointer) bind(C,name="dalotia_close_file_writer")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+    end subroutine dalotia_close_file_writer
+
+    integer(C_int) function dalotia_add_tensor_dense_c(dalotia_writer_pointer, tensor_name, tensor, &
+      num_dimensions, tensor_extents, input_weight_format, dalotia_ordering, output_weight_format) &
+      bind(C,name="dalotia_add_tensor_dense")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        type(C_ptr), intent(in), value:: tensor
+        integer(C_int), intent(in), value:: num_dimensions
+        integer(C_int), dimension(*), intent(in):: tensor_extents
+        integer(C_int), intent(in), value:: input_weight_format
+        integer(C_int), intent(in), value:: dalotia_ordering
+        integer(C_int), intent(in), value:: output_weight_format
+    end function dalotia_add_tensor_dense_c
+
+    integer(C_int) function dalotia_add_tensor_dense_with_permutation_c(dalotia_writer_pointer, tensor_name, &
+      tensor, num_dimensions, tensor_extents, input_weight_format, dalotia_ordering, output_weight_format, &
+      permutation) bind(C,name="dalotia_add_tensor_dense_with_permutation")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_char, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        character(kind=C_char), dimension(*), intent(in):: tensor_name
+        type(C_ptr), intent(in), value:: tensor
+        integer(C_int), intent(in), value:: num_dimensions
+        integer(C_int), dimension(*), intent(in):: tensor_extents
+        integer(C_int), intent(in), value:: input_weight_format
+        integer(C_int), intent(in), value:: dalotia_ordering
+        integer(C_int), intent(in), value:: output_weight_format
+        integer(C_int), dimension(*), intent(in):: permutation
+    end function dalotia_add_tensor_dense_with_permutation_c
+
+    integer(C_int) function dalotia_write_file_c(dalotia_writer_pointer) bind(C,name="dalotia_write_file")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+    end function dalotia_write_file_c
+
+    integer(C_int) function dalotia_write_file_async_c(dalotia_writer_pointer) bind(C,name="dalotia_write_file_async")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+    end function dalotia_write_file_async_c
+
+    integer(C_int) function dalotia_wait_for_write_c(dalotia_writer_pointer) bind(C,name="dalotia_wait_for_write")
+        use, intrinsic::ISO_C_BINDING, only: C_ptr, C_int
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+    end function dalotia_wait_for_write_c
   end interface
 
   interface dalotia_load_tensor_dense !TODO how many do we want in this interface? Codegen?
@@ -135,6 +490,33 @@ module dalotia_c_interface
     module procedure dalotia_load_rank_4_fixed_dim_tensor_dense
     module procedure dalotia_load_rank_5_fixed_dim_tensor_dense
   end interface
+  interface dalotia_add_tensor_dense
+    module procedure dalotia_add_float_tensor_dense
+    module procedure dalotia_add_double_tensor_dense
+  end interface
+  interface dalotia_get_tensor_pointer
+    ! read-only pointer arrays into the memory-mapped file, valid until it is
+    ! closed; not associated if the tensor is not stored there in C order
+    ! and in the requested kind (then load it)
+    module procedure dalotia_get_rank_1_float_tensor_pointer
+    module procedure dalotia_get_rank_1_double_tensor_pointer
+    module procedure dalotia_get_rank_2_float_tensor_pointer
+    module procedure dalotia_get_rank_2_double_tensor_pointer
+    module procedure dalotia_get_rank_3_float_tensor_pointer
+    module procedure dalotia_get_rank_3_double_tensor_pointer
+    module procedure dalotia_get_rank_4_float_tensor_pointer
+    module procedure dalotia_get_rank_4_double_tensor_pointer
+    module procedure dalotia_get_rank_5_float_tensor_pointer
+    module procedure dalotia_get_rank_5_double_tensor_pointer
+  end interface
+  interface dalotia_load_tensor_by_handle
+    module procedure dalotia_load_float_tensor_by_handle
+    module procedure dalotia_load_double_tensor_by_handle
+  end interface
+  interface dalotia_load_tensor_with_stats
+    module procedure dalotia_load_float_tensor_with_stats
+    module procedure dalotia_load_double_tensor_with_stats
+  end interface
   
   contains
     subroutine assert_expected_rank(tensor_rank, expected_rank)
@@ -167,6 +549,16 @@ module dalotia_c_interface
         dalotia_open_file = dalotia_open_file_c(trim(file_name) // NUL)
     end function dalotia_open_file
 
+    type(C_ptr) function dalotia_open_file_with_adapter(file_name, adapter_file_name, scale)
+        ! delegate to C function with trimmed names; C_null_ptr on error
+        implicit none
+        character(kind=C_char, len=*), intent(in):: file_name
+        character(kind=C_char, len=*), intent(in):: adapter_file_name
+        real(C_double), intent(in):: scale
+        dalotia_open_file_with_adapter = dalotia_open_file_with_adapter_c( &
+            trim(file_name) // NUL, trim(adapter_file_name) // NUL, scale)
+    end function dalotia_open_file_with_adapter
+
     pure logical(C_bool) function dalotia_is_sparse(dalotia_file_pointer, tensor_name)
         ! delegate to C function with trimmed name
         implicit none
@@ -199,6 +591,59 @@ module dalotia_c_interface
         dalotia_get_tensor_name = tensor_name_length
     end function dalotia_get_tensor_name
 
+    integer function dalotia_get_nnz(dalotia_file_pointer, tensor_name)
+        ! delegate to C function with trimmed name
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char,len=*), intent(in) :: tensor_name
+        dalotia_get_nnz = dalotia_get_nnz_c(dalotia_file_pointer, trim(tensor_name) // NUL)
+    end function dalotia_get_nnz
+
+    subroutine dalotia_get_sparse_tensor_extents(dalotia_file_pointer, tensor_name, &
+                                                 sparse_format, sparse_extents)
+        ! the lengths of the values, first and second indices
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char,len=*), intent(in) :: tensor_name
+        integer(C_int), intent(in):: sparse_format
+        integer(C_int), dimension(3), intent(out):: sparse_extents
+        if (dalotia_get_sparse_tensor_extents_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                                                sparse_extents, sparse_format) < 0) then
+            error stop "dalotia: could not get the sparse tensor extents"
+        end if
+    end subroutine dalotia_get_sparse_tensor_extents
+
+    subroutine dalotia_load_tensor_sparse(dalotia_file_pointer, tensor_name, values, &
+                                          first_indices, second_indices, sparse_format)
+        ! values in single precision, with C-ordered (row-major) structure
+        ! and 0-based indices, as used by the C/C++ sparse libraries
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char,len=*), intent(in) :: tensor_name
+        real(C_float), dimension(*), target, intent(inout):: values
+        integer(C_int), dimension(*), intent(inout):: first_indices, second_indices
+        integer(C_int), intent(in):: sparse_format
+        if (dalotia_load_tensor_sparse_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                                         c_loc(values), first_indices, second_indices, &
+                                         sparse_format, dalotia_float_32, dalotia_C_ordering) /= 0) then
+            error stop "dalotia: could not load the sparse tensor"
+        end if
+    end subroutine dalotia_load_tensor_sparse
+
+    subroutine dalotia_get_sparse_permutation(dalotia_file_pointer, tensor_name, &
+                                              row_permutation, column_permutation)
+        ! the 0-based original row (column) of every row (column) that the
+        ! sparse loads return
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char,len=*), intent(in) :: tensor_name
+        integer(C_int), dimension(*), intent(inout):: row_permutation, column_permutation
+        if (dalotia_get_sparse_permutation_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                                             row_permutation, column_permutation) /= 0) then
+            error stop "dalotia: could not get the sparse permutation"
+        end if
+    end subroutine dalotia_get_sparse_permutation
+
     pure integer function dalotia_get_num_dimensions(dalotia_file_pointer, tensor_name)
         ! delegate to C function with trimmed name
         implicit none
@@ -604,4 +1049,558 @@ module dalotia_c_interface
         end select
     end subroutine dalotia_load_rank_5_fixed_dim_tensor_dense
 
+
+    type(C_ptr) function dalotia_open_file_writer(file_name)
+        ! delegate to C function with trimmed name
+        implicit none
+        character(kind=C_char, len=*), intent(in):: file_name
+        dalotia_open_file_writer = dalotia_open_file_writer_c(trim(file_name) // NUL)
+    end function dalotia_open_file_writer
+
+    subroutine dalotia_add_tensor_dense_bytes(dalotia_writer_pointer, tensor_name, tensor, &
+      tensor_extents, input_weight_format, permutation, weight_format)
+        ! mirrors the loading functions: without permutation, the column-major
+        ! array is stored as is, as the C-ordered tensor of reversed shape;
+        ! with permutation, loading with the same permutation gives it back
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        type(C_ptr), intent(in), value:: tensor
+        integer(C_int), dimension(:), intent(in):: tensor_extents
+        integer(C_int), intent(in):: input_weight_format
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+        integer(C_int), optional, intent(in):: weight_format
+        integer(C_int) :: output_weight_format, status
+
+        output_weight_format = input_weight_format
+        if (present(weight_format)) then
+            output_weight_format = weight_format
+        end if
+        if (present(permutation)) then
+            status = dalotia_add_tensor_dense_with_permutation_c(dalotia_writer_pointer, trim(tensor_name) // NUL, &
+                tensor, size(tensor_extents), tensor_extents, input_weight_format, dalotia_F_ordering, &
+                output_weight_format, permutation)
+        else
+            status = dalotia_add_tensor_dense_c(dalotia_writer_pointer, trim(tensor_name) // NUL, &
+                tensor, size(tensor_extents), tensor_extents(size(tensor_extents):1:-1), input_weight_format, &
+                dalotia_C_ordering, output_weight_format)
+        end if
+        if (status /= 0) then
+            error stop "dalotia fortran interface: could not add tensor"
+        end if
+    end subroutine dalotia_add_tensor_dense_bytes
+
+    subroutine dalotia_add_float_tensor_dense(dalotia_writer_pointer, tensor_name, tensor, permutation, weight_format)
+        ! the tensor is only read when writing, so it has to stay allocated until then
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(..), contiguous, target, intent(in):: tensor
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+        integer(C_int), optional, intent(in):: weight_format
+
+        call dalotia_add_tensor_dense_bytes(dalotia_writer_pointer, tensor_name, C_loc(tensor), &
+            int(shape(tensor), C_int), dalotia_float_32, permutation, weight_format)
+    end subroutine dalotia_add_float_tensor_dense
+
+    subroutine dalotia_add_double_tensor_dense(dalotia_writer_pointer, tensor_name, tensor, permutation, weight_format)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(..), contiguous, target, intent(in):: tensor
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+        integer(C_int), optional, intent(in):: weight_format
+
+        call dalotia_add_tensor_dense_bytes(dalotia_writer_pointer, tensor_name, C_loc(tensor), &
+            int(shape(tensor), C_int), dalotia_float_64, permutation, weight_format)
+    end subroutine dalotia_add_double_tensor_dense
+
+    integer function dalotia_get_tensor_handle(dalotia_file_pointer, tensor_name)
+        ! the tensor's index as in dalotia_get_tensor_name (1-based), or 0
+        ! if there is no such tensor; resolve once, then query and load by
+        ! handle without passing the name again
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        dalotia_get_tensor_handle = dalotia_get_tensor_handle_c(dalotia_file_pointer, trim(tensor_name) // NUL) + 1
+    end function dalotia_get_tensor_handle
+
+    subroutine dalotia_get_tensor_extents_by_handle(dalotia_file_pointer, handle, tensor_extents)
+        ! in Fortran order, i.e. reversed
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer, intent(in):: handle
+        integer(C_int), allocatable, intent(out):: tensor_extents(:)
+        integer(C_int) :: tensor_rank
+
+        tensor_rank = dalotia_get_num_dimensions_by_handle_c(dalotia_file_pointer, handle - 1)
+        if (tensor_rank < 0) then
+            error stop "dalotia fortran interface: invalid tensor handle"
+        end if
+        allocate(tensor_extents(tensor_rank))
+        tensor_rank = dalotia_get_tensor_extents_by_handle_c(dalotia_file_pointer, handle - 1, tensor_extents)
+        tensor_extents = tensor_extents(tensor_rank:1:-1)
+    end subroutine dalotia_get_tensor_extents_by_handle
+
+    subroutine dalotia_load_tensor_bytes_by_handle(dalotia_file_pointer, handle, tensor, &
+            num_tensor_elements, weight_format, permutation)
+        ! directly into the caller's array, without copy or reshape
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer, intent(in):: handle
+        type(C_ptr), intent(in):: tensor
+        integer, intent(in):: num_tensor_elements
+        integer(C_int), intent(in):: weight_format
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+        integer(C_int) :: status
+
+        if (dalotia_get_num_tensor_elements_by_handle_c(dalotia_file_pointer, handle - 1) &
+                /= num_tensor_elements) then
+            error stop "dalotia fortran interface: tensor size does not match"
+        end if
+        if (present(permutation)) then
+            status = dalotia_load_tensor_dense_by_handle_c(dalotia_file_pointer, handle - 1, tensor, &
+                weight_format, dalotia_F_ordering, permutation)
+        else
+            status = dalotia_load_tensor_dense_by_handle_c(dalotia_file_pointer, handle - 1, tensor, &
+                weight_format, dalotia_C_ordering)
+        end if
+        if (status /= 0) then
+            error stop "dalotia fortran interface: could not load the tensor"
+        end if
+    end subroutine dalotia_load_tensor_bytes_by_handle
+
+    subroutine dalotia_load_float_tensor_by_handle(dalotia_file_pointer, handle, tensor, permutation)
+        ! tensor has to be allocated with the extents of the tensor (as
+        ! returned by dalotia_get_tensor_extents_by_handle), any rank
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer, intent(in):: handle
+        real(C_float), dimension(..), contiguous, target, intent(inout):: tensor
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+
+        call dalotia_load_tensor_bytes_by_handle(dalotia_file_pointer, handle, C_loc(tensor), &
+            size(tensor), dalotia_float_32, permutation)
+    end subroutine dalotia_load_float_tensor_by_handle
+
+    subroutine dalotia_load_double_tensor_by_handle(dalotia_file_pointer, handle, tensor, permutation)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer, intent(in):: handle
+        real(C_double), dimension(..), contiguous, target, intent(inout):: tensor
+        integer(C_int), dimension(:), optional, intent(in):: permutation
+
+        call dalotia_load_tensor_bytes_by_handle(dalotia_file_pointer, handle, C_loc(tensor), &
+            size(tensor), dalotia_float_64, permutation)
+    end subroutine dalotia_load_double_tensor_by_handle
+
+    subroutine dalotia_describe_tensors(dalotia_file_pointer, num_dimensions, tensor_extents, &
+            weight_formats, num_elements)
+        ! the metadata of all tensors in one call, indexed by handle;
+        ! tensor_extents(:, handle) holds the extents in Fortran order,
+        ! padded with zeros up to the highest rank
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        integer(C_int), allocatable, intent(out):: num_dimensions(:)
+        integer(C_int), allocatable, intent(out):: tensor_extents(:,:)
+        integer(C_int), allocatable, intent(out):: weight_formats(:)
+        integer(C_int), allocatable, intent(out):: num_elements(:)
+        integer(C_int), allocatable :: all_extents(:)
+        integer :: num_tensors, t, offset
+
+        num_tensors = dalotia_get_num_tensors(dalotia_file_pointer)
+        allocate(num_dimensions(num_tensors), weight_formats(num_tensors), num_elements(num_tensors))
+        allocate(all_extents(max(1, dalotia_describe_tensors_c(dalotia_file_pointer, num_dimensions))))
+        if (dalotia_describe_tensors_c(dalotia_file_pointer, num_dimensions, all_extents, &
+                                       weight_formats, num_elements) < 0) then
+            error stop "dalotia fortran interface: could not describe the tensors"
+        end if
+        allocate(tensor_extents(max(0, maxval(num_dimensions)), num_tensors), source=0_C_int)
+        offset = 0
+        do t = 1, num_tensors
+            tensor_extents(1:num_dimensions(t), t) = all_extents(offset + num_dimensions(t):offset + 1:-1)
+            offset = offset + num_dimensions(t)
+        end do
+    end subroutine dalotia_describe_tensors
+
+    subroutine dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, tensor_rank, &
+                                                weight_format, data, tensor_extents)
+        ! the data of a tensor stored in place in C order and in the given
+        ! format, with its extents in Fortran order; C_NULL_ptr otherwise
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        integer, intent(in):: tensor_rank
+        integer(C_int), intent(in):: weight_format
+        type(C_ptr), intent(out):: data
+        integer(C_int), intent(out):: tensor_extents(tensor_rank)
+        character(kind=C_char, len=:), allocatable :: tensor_name_c
+        integer(C_int) :: stored_format, view_rank
+        integer(C_int), allocatable :: view_extents(:)
+        integer(C_long_long), allocatable :: view_strides(:)
+        integer(C_long_long) :: expected_stride
+        integer :: d
+
+        data = C_NULL_ptr
+        tensor_extents = 0
+        tensor_name_c = trim(tensor_name) // NUL
+        view_rank = dalotia_get_num_dimensions_c(dalotia_file_pointer, tensor_name_c)
+        call assert_expected_rank(view_rank, tensor_rank)
+        allocate(view_extents(view_rank), view_strides(view_rank))
+        if (dalotia_get_tensor_view_c(dalotia_file_pointer, tensor_name_c, data, stored_format, &
+                                      view_extents, view_strides) < 0) then
+            data = C_NULL_ptr
+            return
+        end if
+        ! only C-ordered data maps to a Fortran array with reversed extents
+        expected_stride = 1
+        do d = view_rank, 1, -1
+            if (view_extents(d) > 1 .and. view_strides(d) /= expected_stride) then
+                data = C_NULL_ptr
+            end if
+            expected_stride = expected_stride * view_extents(d)
+        end do
+        if (stored_format /= weight_format) then
+            data = C_NULL_ptr
+        end if
+        tensor_extents = view_extents(view_rank:1:-1)
+    end subroutine dalotia_get_tensor_view_in_place
+
+    subroutine dalotia_get_rank_1_float_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(1)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 1, dalotia_float_32, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_1_float_tensor_pointer
+
+    subroutine dalotia_get_rank_1_double_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(1)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 1, dalotia_float_64, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_1_double_tensor_pointer
+
+    subroutine dalotia_get_rank_2_float_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(2)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 2, dalotia_float_32, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_2_float_tensor_pointer
+
+    subroutine dalotia_get_rank_2_double_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(2)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 2, dalotia_float_64, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_2_double_tensor_pointer
+
+    subroutine dalotia_get_rank_3_float_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(3)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 3, dalotia_float_32, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_3_float_tensor_pointer
+
+    subroutine dalotia_get_rank_3_double_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(3)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 3, dalotia_float_64, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_3_double_tensor_pointer
+
+    subroutine dalotia_get_rank_4_float_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(:,:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(4)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 4, dalotia_float_32, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_4_float_tensor_pointer
+
+    subroutine dalotia_get_rank_4_double_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(:,:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(4)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 4, dalotia_float_64, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_4_double_tensor_pointer
+
+    subroutine dalotia_get_rank_5_float_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(:,:,:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(5)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 5, dalotia_float_32, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_5_float_tensor_pointer
+
+    subroutine dalotia_get_rank_5_double_tensor_pointer(dalotia_file_pointer, tensor_name, tensor)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(:,:,:,:,:), pointer, intent(out):: tensor
+        type(C_ptr) :: data
+        integer(C_int) :: tensor_extents(5)
+
+        call dalotia_get_tensor_view_in_place(dalotia_file_pointer, tensor_name, 5, dalotia_float_64, &
+                                              data, tensor_extents)
+        nullify(tensor)
+        if (c_associated(data)) then
+            call c_f_pointer(data, tensor, tensor_extents)
+        end if
+    end subroutine dalotia_get_rank_5_double_tensor_pointer
+
+    type(C_ptr) function dalotia_export_dlpack(dalotia_file_pointer, tensor_name)
+        ! a DLManagedTensor*, or C_NULL_ptr; cf. dalotia.h
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        dalotia_export_dlpack = dalotia_export_dlpack_c(dalotia_file_pointer, trim(tensor_name) // NUL)
+    end function dalotia_export_dlpack
+
+    subroutine dalotia_get_load_stats(dalotia_file_pointer, stats)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        type(dalotia_LoadStats), intent(out):: stats
+        if (dalotia_get_load_stats_c(dalotia_file_pointer, stats) /= 0) then
+            error stop "dalotia fortran interface: could not get the load stats"
+        end if
+    end subroutine dalotia_get_load_stats
+
+    subroutine dalotia_tensor_stats_bytes(dalotia_file_pointer, tensor_name, tensor, &
+            num_tensor_elements, weight_format, stats, dim, num_bins, histogram_range, histogram)
+        ! loads the tensor, unless tensor is C_NULL_ptr, with its stats: one
+        ! entry of stats per tensor, or per channel along the dimension dim
+        ! (in Fortran order); histogram(:, channel) has num_bins equal bins
+        ! over histogram_range
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        type(C_ptr), intent(in):: tensor
+        integer, intent(in):: num_tensor_elements
+        integer(C_int), intent(in):: weight_format
+        type(dalotia_TensorStats), allocatable, intent(out):: stats(:)
+        integer, optional, intent(in):: dim
+        integer, optional, intent(in):: num_bins
+        real(C_double), dimension(2), optional, intent(in):: histogram_range
+        integer(C_long_long), allocatable, optional, intent(out):: histogram(:,:)
+        integer(C_int), allocatable :: tensor_extents(:)
+        integer(C_int) :: axis, status, bins
+        real(C_double) :: range(2)
+
+        call dalotia_get_tensor_extents(dalotia_file_pointer, tensor_name, tensor_extents)
+        axis = -1
+        if (present(dim)) then
+            if (dim < 1 .or. dim > size(tensor_extents)) then
+                error stop "dalotia fortran interface: no such dimension for the stats"
+            end if
+            axis = size(tensor_extents) - dim
+            allocate(stats(tensor_extents(dim)))
+        else
+            allocate(stats(1))
+        end if
+        bins = 0
+        range = 0.0d0
+        if (present(histogram)) then
+            if (.not. (present(num_bins) .and. present(histogram_range))) then
+                error stop "dalotia fortran interface: a histogram needs num_bins and histogram_range"
+            end if
+            bins = num_bins
+            range = histogram_range
+            allocate(histogram(bins, size(stats)))
+        end if
+
+        if (.not. C_associated(tensor)) then
+            if (present(histogram)) then
+                status = dalotia_get_tensor_stats_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                    axis, stats, bins, range(1), range(2), histogram)
+            else
+                status = dalotia_get_tensor_stats_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                    axis, stats, bins, range(1), range(2))
+            end if
+        else
+            if (dalotia_get_num_tensor_elements(dalotia_file_pointer, tensor_name) /= num_tensor_elements) then
+                error stop "dalotia fortran interface: tensor size does not match"
+            end if
+            if (present(histogram)) then
+                status = dalotia_load_tensor_dense_with_stats_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                    tensor, weight_format, dalotia_C_ordering, axis=axis, stats=stats, num_bins=bins, &
+                    histogram_min=range(1), histogram_max=range(2), histogram=histogram)
+            else
+                status = dalotia_load_tensor_dense_with_stats_c(dalotia_file_pointer, trim(tensor_name) // NUL, &
+                    tensor, weight_format, dalotia_C_ordering, axis=axis, stats=stats, num_bins=bins, &
+                    histogram_min=range(1), histogram_max=range(2))
+            end if
+        end if
+        if (status /= 0) then
+            error stop "dalotia fortran interface: could not compute the tensor stats"
+        end if
+    end subroutine dalotia_tensor_stats_bytes
+
+    subroutine dalotia_get_tensor_stats(dalotia_file_pointer, tensor_name, stats, dim, &
+            num_bins, histogram_range, histogram)
+        ! the stats only, straight from the mapped file
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        type(dalotia_TensorStats), allocatable, intent(out):: stats(:)
+        integer, optional, intent(in):: dim
+        integer, optional, intent(in):: num_bins
+        real(C_double), dimension(2), optional, intent(in):: histogram_range
+        integer(C_long_long), allocatable, optional, intent(out):: histogram(:,:)
+
+        call dalotia_tensor_stats_bytes(dalotia_file_pointer, tensor_name, C_NULL_ptr, 0, &
+            dalotia_float_32, stats, dim, num_bins, histogram_range, histogram)
+    end subroutine dalotia_get_tensor_stats
+
+    subroutine dalotia_load_float_tensor_with_stats(dalotia_file_pointer, tensor_name, tensor, stats, &
+            dim, num_bins, histogram_range, histogram)
+        ! tensor has to be allocated with the extents of the tensor, any rank
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_float), dimension(..), contiguous, target, intent(inout):: tensor
+        type(dalotia_TensorStats), allocatable, intent(out):: stats(:)
+        integer, optional, intent(in):: dim
+        integer, optional, intent(in):: num_bins
+        real(C_double), dimension(2), optional, intent(in):: histogram_range
+        integer(C_long_long), allocatable, optional, intent(out):: histogram(:,:)
+
+        call dalotia_tensor_stats_bytes(dalotia_file_pointer, tensor_name, C_loc(tensor), size(tensor), &
+            dalotia_float_32, stats, dim, num_bins, histogram_range, histogram)
+    end subroutine dalotia_load_float_tensor_with_stats
+
+    subroutine dalotia_load_double_tensor_with_stats(dalotia_file_pointer, tensor_name, tensor, stats, &
+            dim, num_bins, histogram_range, histogram)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: tensor_name
+        real(C_double), dimension(..), contiguous, target, intent(inout):: tensor
+        type(dalotia_TensorStats), allocatable, intent(out):: stats(:)
+        integer, optional, intent(in):: dim
+        integer, optional, intent(in):: num_bins
+        real(C_double), dimension(2), optional, intent(in):: histogram_range
+        integer(C_long_long), allocatable, optional, intent(out):: histogram(:,:)
+
+        call dalotia_tensor_stats_bytes(dalotia_file_pointer, tensor_name, C_loc(tensor), size(tensor), &
+            dalotia_float_64, stats, dim, num_bins, histogram_range, histogram)
+    end subroutine dalotia_load_double_tensor_with_stats
+
+    subroutine dalotia_set_trace_file(dalotia_file_pointer, trace_file_name)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        character(kind=C_char, len=*), intent(in):: trace_file_name
+        if (dalotia_set_trace_file_c(dalotia_file_pointer, trim(trace_file_name) // NUL) /= 0) then
+            error stop "dalotia fortran interface: could not set the trace file"
+        end if
+    end subroutine dalotia_set_trace_file
+
+    subroutine dalotia_write_trace(dalotia_file_pointer)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_file_pointer
+        if (dalotia_write_trace_c(dalotia_file_pointer) /= 0) then
+            error stop "dalotia fortran interface: could not write the trace"
+        end if
+    end subroutine dalotia_write_trace
+
+    subroutine dalotia_write_file(dalotia_writer_pointer)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        if (dalotia_write_file_c(dalotia_writer_pointer) /= 0) then
+            error stop "dalotia fortran interface: could not write file"
+        end if
+    end subroutine dalotia_write_file
+
+    subroutine dalotia_write_file_async(dalotia_writer_pointer)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        if (dalotia_write_file_async_c(dalotia_writer_pointer) /= 0) then
+            error stop "dalotia fortran interface: could not start writing file"
+        end if
+    end subroutine dalotia_write_file_async
+
+    subroutine dalotia_wait_for_write(dalotia_writer_pointer)
+        implicit none
+        type(C_ptr), intent(in), value:: dalotia_writer_pointer
+        if (dalotia_wait_for_write_c(dalotia_writer_pointer) /= 0) then
+            error stop "dalotia fortran interface: could not write file"
+        end if
+    end subroutine dalotia_wait_for_write
+
 end module dalotia_c_interface
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
+#include "dalotia_dlpack.h"
 #include "dalotia_formats.h"
+#include "dalotia_instrumentation.h"
+#include "dalotia_stats.h"
 
 #ifdef __cplusplus
 #define EXTERNC extern "C"
@@ -17,6 +20,12 @@ typedef struct DalotiaTensorFile DalotiaTensorFile;
 
 EXTERNC DalotiaTensorFile *dalotia_open_file(const char *filename);
 
+// a base model with a LoRA adapter (lora_A / lora_B factors as saved by
+// PEFT) merged on load: the adapted weights load as W + scale * B * A, in
+// float or double; NULL if the files do not match
+EXTERNC DalotiaTensorFile *dalotia_open_file_with_adapter(
+    const char *filename, const char *adapter_filename, double scale);
+
 EXTERNC void dalotia_close_file(DalotiaTensorFile *file);
 
 EXTERNC int dalotia_sizeof_weight_format(dalotia_WeightFormat format);
@@ -37,9 +46,40 @@ EXTERNC int dalotia_get_num_tensor_elements(DalotiaTensorFile *file,
 
 EXTERNC int dalotia_get_nnz(DalotiaTensorFile *file, const char *tensor_name);
 
+// dense-stored tensors loaded sparse drop all values of at most this
+// magnitude; 0 (the default) drops exact zeros only
+EXTERNC void dalotia_set_prune_threshold(DalotiaTensorFile *file,
+                                         double threshold);
+
+// block shape for dalotia_BSR (default 4 x 4)
+EXTERNC void dalotia_set_bsr_block_shape(DalotiaTensorFile *file,
+                                         int block_rows, int block_columns);
+
+// C and sigma for dalotia_SELL (default 8 and 1, i.e. no sorting)
+EXTERNC void dalotia_set_sell_parameters(DalotiaTensorFile *file,
+                                         int chunk_size, int sorting_scope);
+
+// HiCOO blocks of 2^block_bits per mode for dalotia_HiCOO (default 7)
+EXTERNC void dalotia_set_hicoo_block_bits(DalotiaTensorFile *file,
+                                          int block_bits);
+
+// reverse Cuthill-McKee reordering of all sparse loads (default off)
+EXTERNC void dalotia_set_rcm_reordering(DalotiaTensorFile *file, bool reorder);
+
+// the reordering that sparse loads apply: row i of the loaded matrix is row
+// row_permutation[i] (num_rows entries), column j is column
+// column_permutation[j] (num_columns entries)
+EXTERNC int dalotia_get_sparse_permutation(DalotiaTensorFile *file,
+                                           const char *tensor_name,
+                                           int *row_permutation,
+                                           int *column_permutation);
+
 EXTERNC int dalotia_get_tensor_extents(DalotiaTensorFile *file,
                                        const char *tensor_name, int *extents);
 
+// for CSR: the number of values, row pointers and column indices;
+// for COO: the number of values, row indices and column indices;
+// for BSR and SELL: cf. dalotia_SparseFormat
 EXTERNC int dalotia_get_sparse_tensor_extents(DalotiaTensorFile *file,
                                               const char *tensor_name,
                                               int *extents,
@@ -55,6 +95,67 @@ EXTERNC int dalotia_load_tensor_dense_with_permutation(
     dalotia_WeightFormat format, dalotia_Ordering ordering,
     const int *permutation);
 
+// loads several tensors at once, each into its own buffer; for sharded
+// checkpoints, the shards are read concurrently
+EXTERNC int dalotia_load_tensors_dense(DalotiaTensorFile *file,
+                                       int num_tensors,
+                                       const char *const *tensor_names,
+                                       char **tensors,
+                                       dalotia_WeightFormat format,
+                                       dalotia_Ordering ordering);
+
+// tensor handles: a tensor's index in the order of dalotia_get_tensor_name,
+// resolved once by name (-1 if there is no such tensor); the queries and
+// loads by handle skip converting the name, and for NumPy, ONNX, PyTorch,
+// TensorFlow checkpoint and .dalotia files also looking it up again
+EXTERNC int dalotia_get_tensor_handle(DalotiaTensorFile *file,
+                                      const char *tensor_name);
+
+EXTERNC int dalotia_get_num_dimensions_by_handle(DalotiaTensorFile *file,
+                                                 int handle);
+
+EXTERNC int dalotia_get_num_tensor_elements_by_handle(DalotiaTensorFile *file,
+                                                      int handle);
+
+EXTERNC int dalotia_get_tensor_extents_by_handle(DalotiaTensorFile *file,
+                                                 int handle, int *extents);
+
+// the stored format, as a dalotia_WeightFormat, or -1
+EXTERNC int dalotia_get_weight_format_by_handle(DalotiaTensorFile *file,
+                                                int handle);
+
+// permutation may be NULL
+EXTERNC int dalotia_load_tensor_dense_by_handle(
+    DalotiaTensorFile *file, int handle, char *tensor,
+    dalotia_WeightFormat format, dalotia_Ordering ordering,
+    const int *permutation);
+
+// the metadata of all tensors in handle order, each array with one entry per
+// tensor, except for extents, which holds the extents of all tensors one
+// after the other; any array may be NULL; returns the length of extents
+// (i.e. the sum of num_dimensions), or -1
+EXTERNC int dalotia_describe_tensors(DalotiaTensorFile *file,
+                                     int *num_dimensions, int *extents,
+                                     dalotia_WeightFormat *weight_formats,
+                                     int *num_elements);
+
+// zero-copy access to a dense tensor stored uncompressed in a memory-mapped
+// file: its data where it lies in the file, read-only and valid until the
+// file is closed, its format, and its extents and strides (in elements)
+// with num_dimensions entries each; returns the number of dimensions, or
+// -1 if the tensor is not available in place (then it has to be loaded)
+EXTERNC int dalotia_get_tensor_view(DalotiaTensorFile *file,
+                                    const char *tensor_name, const char **data,
+                                    dalotia_WeightFormat *format, int *extents,
+                                    long long *strides);
+
+// the same view as a DLPack tensor on the CPU, to hand to other frameworks
+// in the process without a copy; NULL if the tensor is not available in
+// place or has no DLPack dtype; the data must not be written to, the
+// tensor must not outlive the file, and its deleter has to be called
+EXTERNC DLManagedTensor *dalotia_export_dlpack(DalotiaTensorFile *file,
+                                               const char *tensor_name);
+
 EXTERNC int dalotia_load_tensor_sparse(DalotiaTensorFile *file,
                                        const char *tensor_name, char *values,
                                        int *first_indices, int *second_indices,
@@ -62,4 +163,99 @@ EXTERNC int dalotia_load_tensor_sparse(DalotiaTensorFile *file,
                                        dalotia_WeightFormat weightFormat,
                                        dalotia_Ordering ordering);
 
+// loads weight and bias (e.g. of a convolution) with the batch norm that
+// follows them folded in, in one pass over the weight: weight[o, ...] *
+// gamma[o] / sqrt(variance[o] + epsilon), and (bias[o] - mean[o]) * that
+// factor + beta[o]; any of the bias and norm names may be NULL (no bias,
+// gamma 1, beta 0, mean 0, no division), bias may be NULL if it is not
+// needed, and so may permutation; format is dalotia_float_32 or _64
+EXTERNC int dalotia_load_tensor_folded(
+    DalotiaTensorFile *file, const char *weight_name, const char *bias_name,
+    const char *gamma_name, const char *beta_name, const char *mean_name,
+    const char *variance_name, double epsilon, char *weight, char *bias,
+    dalotia_WeightFormat format, dalotia_Ordering ordering,
+    const int *permutation);
+
+// loads the tensor (as dalotia_float_32 or _64, permutation may be NULL) and
+// computes its statistics in the same pass: for axis -1 into stats[0], else
+// per channel along that axis of the tensor as stored (in C order, before
+// the permutation) into extents[axis] entries of stats; if num_bins > 0 and
+// histogram is not NULL, also num_bins counts per channel, one channel after
+// the other, of equal bins over [histogram_min, histogram_max], where finite
+// values outside of the range count in the first or last bin
+EXTERNC int dalotia_load_tensor_dense_with_stats(
+    DalotiaTensorFile *file, const char *tensor_name, char *tensor,
+    dalotia_WeightFormat format, dalotia_Ordering ordering,
+    const int *permutation, int axis, dalotia_TensorStats *stats,
+    int num_bins, double histogram_min, double histogram_max,
+    long long *histogram);
+
+// the same statistics without loading, straight from the mapped file
+EXTERNC int dalotia_get_tensor_stats(DalotiaTensorFile *file,
+                                     const char *tensor_name, int axis,
+                                     dalotia_TensorStats *stats, int num_bins,
+                                     double histogram_min,
+                                     double histogram_max,
+                                     long long *histogram);
+
+// load instrumentation, off by default: every load is timed by phase and
+// counts the bytes it moved; cf. dalotia_instrumentation.h
+EXTERNC void dalotia_set_instrumentation(DalotiaTensorFile *file,
+                                         bool enabled);
+
+EXTERNC int dalotia_get_load_stats(DalotiaTensorFile *file,
+                                   dalotia_LoadStats *stats);
+
+EXTERNC void dalotia_reset_load_stats(DalotiaTensorFile *file);
+
+// enables the instrumentation and writes a Chrome / Perfetto trace of the
+// loads to the given file when the file is closed (or on
+// dalotia_write_trace)
+EXTERNC int dalotia_set_trace_file(DalotiaTensorFile *file,
+                                   const char *trace_filename);
+
+EXTERNC int dalotia_write_trace(DalotiaTensorFile *file);
+
+// enables the instrumentation and calls begin and end (either may be NULL)
+// around every phase of every load
+EXTERNC void dalotia_set_load_hooks(DalotiaTensorFile *file,
+                                    dalotia_LoadHook begin,
+                                    dalotia_LoadHook end, void *user_data);
+
+// "lookup", "io", "convert" or "permute"
+EXTERNC const char *dalotia_load_phase_name(dalotia_LoadPhase phase);
+
+// writing
+
+typedef struct DalotiaTensorFileWriter DalotiaTensorFileWriter;
+
+EXTERNC DalotiaTensorFileWriter *dalotia_open_file_writer(const char *filename);
+
+// waits for a pending asynchronous write
+EXTERNC void dalotia_close_file_writer(DalotiaTensorFileWriter *writer);
+
+// the tensor is only read by dalotia_write_file(_async), so it has to stay
+// valid until then; ordering and permutation mean the same as for loading
+EXTERNC int dalotia_add_tensor_dense(DalotiaTensorFileWriter *writer,
+                                     const char *tensor_name,
+                                     const char *tensor, int num_dimensions,
+                                     const int *extents,
+                                     dalotia_WeightFormat input_format,
+                                     dalotia_Ordering ordering,
+                                     dalotia_WeightFormat output_format);
+
+EXTERNC int dalotia_add_tensor_dense_with_permutation(
+    DalotiaTensorFileWriter *writer, const char *tensor_name,
+    const char *tensor, int num_dimensions, const int *extents,
+    dalotia_WeightFormat input_format, dalotia_Ordering ordering,
+    dalotia_WeightFormat output_format, const int *permutation);
+
+EXTERNC int dalotia_write_file(DalotiaTensorFileWriter *writer);
+
+// returns right away; the tensors must not be modified before
+// dalotia_wait_for_write returned
+EXTERNC int dalotia_write_file_async(DalotiaTensorFileWriter *writer);
+
+EXTERNC int dalotia_wait_for_write(DalotiaTensorFileWriter *writer);
+
 #undef EXTERNC
\ No newline at end of file
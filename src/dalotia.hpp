@@ -11,21 +11,46 @@
 #include <string>
 
 #include "dalotia_assignment.hpp"
+#include "dalotia_folding.hpp"
 #include "dalotia_formats.hpp"
+#include "dalotia_lora_file.hpp"
+#include "dalotia_reloader.hpp"
+#include "dalotia_safetensors_writer.hpp"
+#include "dalotia_sharded_file.hpp"
+#include "dalotia_stats.hpp"
 #include "dalotia_tensor_file.hpp"
+#include "dalotia_tensor_file_writer.hpp"
 
-#ifdef DALOTIA_WITH_SAFETENSORS_CPP
 #include "dalotia_safetensors_file.hpp"
-#endif
 #ifdef DALOTIA_WITH_TENSORFLOW
 #include "dalotia_tensorflow_file.hpp"
 #endif
+#ifdef DALOTIA_WITH_TF_BUNDLE
+#include "dalotia_tensorflow_bundle_file.hpp"
+#endif
+#ifdef DALOTIA_WITH_ONNX
+#include "dalotia_onnx_file.hpp"
+#endif
+#ifdef DALOTIA_WITH_NUMPY
+#include "dalotia_numpy_file.hpp"
+#endif
+#ifdef DALOTIA_WITH_PYTORCH
+#include "dalotia_pytorch_file.hpp"
+#endif
+#ifdef DALOTIA_WITH_PACK
+#include "dalotia_pack_file.hpp"
+#include "dalotia_pack_writer.hpp"
+#endif
 
 namespace dalotia {
 // factory function for the file, selected by file extension and
 // available implementations
 [[nodiscard]] TensorFile *make_tensor_file(const std::string & filename);
 
+// factory function for a writer to a new file, selected by file extension
+[[nodiscard]] TensorFileWriter *make_tensor_file_writer(
+    const std::string &filename);
+
 // C++17 version -> will not compile on Fugaku...
 // -- pmr vector types can accept different allocators
 //? more memory interface than that? detect if CUDA device pointer through
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstring>
 #include <functional>
 #include <numeric>
 #include <stdexcept>
@@ -184,6 +185,20 @@ void assign_linearly(dalotia_byte *__restrict__ dest,
         dalotia::sizeof_weight_format(weight_input_format);
     const size_t store_item_bytes =
         dalotia::sizeof_weight_format(weight_output_format);
+    if (weight_input_format == weight_output_format) {
+        // plain copy, in blocks such that each thread first-touches
+        // its part of the destination
+        const size_t num_bytes = num_items * load_item_bytes;
+        constexpr size_t block_bytes = size_t(1) << 16;
+        const size_t num_blocks = (num_bytes + block_bytes - 1) / block_bytes;
+#pragma omp parallel for schedule(static)
+        for (size_t b = 0; b < num_blocks; ++b) {
+            const size_t begin = b * block_bytes;
+            std::memcpy(dest + begin, tensor_start + begin,
+                        std::min(block_bytes, num_bytes - begin));
+        }
+        return;
+    }
     auto assign_function =
         get_assignment_function(weight_output_format, weight_input_format);
 #pragma omp parallel for schedule(static)
@@ -194,6 +209,49 @@ void assign_linearly(dalotia_byte *__restrict__ dest,
     }
 }
 
+void assign_strided(dalotia_byte *__restrict__ dest,
+                    dalotia_WeightFormat weight_output_format,
+                    const std::vector<int> &extents,
+                    const dalotia_byte *__restrict__ tensor_start,
+                    dalotia_WeightFormat weight_input_format,
+                    const std::vector<size_t> &strides) {
+    const size_t num_dimensions = extents.size();
+    const size_t load_item_bytes = sizeof_weight_format(weight_input_format);
+    const size_t store_item_bytes = sizeof_weight_format(weight_output_format);
+    const size_t num_columns = num_dimensions == 0 ? 1 : extents.back();
+    const size_t column_stride = num_dimensions == 0 ? 1 : strides.back();
+    const size_t num_rows =
+        num_dimensions == 0
+            ? 1
+            : std::accumulate(extents.begin(), extents.end() - 1, size_t(1),
+                              std::multiplies<size_t>());
+    const bool is_converted = weight_input_format != weight_output_format;
+    const auto assign_function =
+        get_assignment_function(weight_output_format, weight_input_format);
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        // the row index enumerates all but the last dimension in C order
+        size_t offset = 0;
+        size_t rest = r;
+        for (size_t d = num_dimensions; d > 1; --d) {
+            offset += (rest % extents[d - 2]) * strides[d - 2];
+            rest /= extents[d - 2];
+        }
+        const dalotia_byte *input_row = tensor_start + offset * load_item_bytes;
+        dalotia_byte *output_row = dest + r * num_columns * store_item_bytes;
+        for (size_t j = 0; j < num_columns; ++j) {
+            const dalotia_byte *input =
+                input_row + j * column_stride * load_item_bytes;
+            if (is_converted) {
+                assign_function(output_row + j * store_item_bytes, input);
+            } else {
+                std::memcpy(output_row + j * store_item_bytes, input,
+                            load_item_bytes);
+            }
+        }
+    }
+}
+
 /** @brief Get the new strides to permute and total size of the permuted tensor
  *
  * local helper function
@@ -259,9 +317,9 @@ void assign_permuted<2>(dalotia_byte *__restrict__ dest,
     auto assign_function =
         get_assignment_function(weight_output_format, weight_input_format);
     size_t load_index = 0;
-    for (int i = 0; i < input_shape[1]; ++i) {
-        for (int j = 0; j < input_shape[0]; ++j) {
-            auto store_index = j * input_shape[1] + i;
+    for (int i = 0; i < input_shape[0]; ++i) {
+        for (int j = 0; j < input_shape[1]; ++j) {
+            auto store_index = j * input_shape[0] + i;
             auto input_pointer = tensor_start + load_index * load_item_bytes;
             auto output_pointer = dest + store_index * store_item_bytes;
             assign_function(output_pointer, input_pointer);
@@ -1,9 +1,11 @@
 #pragma once
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <functional>
 #include <numeric>
 #include <stdexcept>
+#include <vector>
 
 #ifdef DALOTIA_WITH_CPP_PMR
 #include <memory_resource>
@@ -13,7 +15,6 @@ template <typename T>
 using vector = std::pmr::vector<T>;
 }  // namespace dalotia
 #else
-#include <vector>
 // define dalotia::vector as std::vector
 namespace dalotia {
 template <typename T>
@@ -60,6 +61,15 @@ void assign_linearly(dalotia_byte *__restrict__ dest,
                      const dalotia_byte *const __restrict__ tensor_start,
                      dalotia_WeightFormat weight_input_format);
 
+// dest in C order, from a tensor with arbitrary element strides per
+// dimension (e.g. a slice with gaps); in parallel over the rows
+void assign_strided(dalotia_byte *__restrict__ dest,
+                    dalotia_WeightFormat weight_output_format,
+                    const std::vector<int> &extents,
+                    const dalotia_byte *__restrict__ tensor_start,
+                    dalotia_WeightFormat weight_input_format,
+                    const std::vector<size_t> &strides);
+
 template <uint8_t num_dimensions>
 void assign_permuted(dalotia_byte *__restrict__ /*dest*/,
                      dalotia_WeightFormat /*weight_output_format*/,
@@ -122,6 +132,84 @@ void assign_permuted<5>(dalotia_byte *__restrict__ dest,
 // https://github.com/JuliaLang/julia/blob/master/base/multidimensional.jl#L1685
 // https://stackoverflow.com/questions/77130743/boost-preprocessor-boost-pp-local-iterate-nested-loops
 
+// converts the C-ordered num_rows x num_columns matrix to value_type in
+// tiles, in parallel, and stores it C-ordered or transposed; while a tile
+// is in cache, update(row, column_begin, values, num_values) may modify
+// each of its row segments, e.g. to fuse a scaling or a low-rank update
+// into the load, or inspect it if dest is nullptr; 32 x 256 floats are 32 KiB
+template <typename value_type, typename Update>
+void assign_rows_tiled(value_type *__restrict__ dest, size_t num_rows,
+                       size_t num_columns,
+                       const dalotia_byte *__restrict__ tensor_start,
+                       dalotia_WeightFormat weight_input_format,
+                       bool transposed, const Update &update) {
+    constexpr size_t tile_rows = 32;
+    constexpr size_t tile_columns = 256;
+    const size_t load_item_bytes = sizeof_weight_format(weight_input_format);
+    const bool is_converted =
+        weight_input_format != weight_format_of<value_type>();
+    const auto assign_function = get_assignment_function(
+        weight_format_of<value_type>(), weight_input_format);
+    const size_t num_column_tiles =
+        (num_columns + tile_columns - 1) / tile_columns;
+    const auto num_tiles = static_cast<long>(
+        (num_rows + tile_rows - 1) / tile_rows * num_column_tiles);
+    // guarded, as this header is included by translation units that are
+    // not compiled with OpenMP
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        std::vector<value_type> tile(tile_rows * tile_columns);
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+        for (long t = 0; t < num_tiles; ++t) {
+            const size_t row_begin = t / num_column_tiles * tile_rows;
+            const size_t column_begin = t % num_column_tiles * tile_columns;
+            const size_t rows = std::min(tile_rows, num_rows - row_begin);
+            const size_t columns =
+                std::min(tile_columns, num_columns - column_begin);
+            for (size_t i = 0; i < rows; ++i) {
+                value_type *tile_row = tile.data() + i * tile_columns;
+                const dalotia_byte *input_row =
+                    tensor_start +
+                    ((row_begin + i) * num_columns + column_begin) *
+                        load_item_bytes;
+                if (is_converted) {
+                    for (size_t j = 0; j < columns; ++j) {
+                        assign_function(
+                            reinterpret_cast<dalotia_byte *>(tile_row + j),
+                            input_row + j * load_item_bytes);
+                    }
+                } else {
+                    std::memcpy(tile_row, input_row,
+                                columns * sizeof(value_type));
+                }
+                update(row_begin + i, column_begin, tile_row, columns);
+            }
+            if (dest == nullptr) {
+                continue;
+            } else if (transposed) {
+                for (size_t j = 0; j < columns; ++j) {
+                    value_type *dest_row =
+                        dest + (column_begin + j) * num_rows + row_begin;
+                    for (size_t i = 0; i < rows; ++i) {
+                        dest_row[i] = tile[i * tile_columns + j];
+                    }
+                }
+            } else {
+                for (size_t i = 0; i < rows; ++i) {
+                    std::memcpy(
+                        dest + (row_begin + i) * num_columns + column_begin,
+                        tile.data() + i * tile_columns,
+                        columns * sizeof(value_type));
+                }
+            }
+        }
+    }
+}
+
 template <typename... Args>
 void assign_permuted(uint8_t num_dimensions, Args &&...args) {
     if (num_dimensions == 1) {
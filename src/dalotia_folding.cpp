@@ -0,0 +1,179 @@
+#include "dalotia_folding.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "dalotia_assignment.hpp"
+#include "dalotia_instrumentation.hpp"
+#include "dalotia_sparse.hpp"
+
+namespace dalotia {
+
+namespace {
+// the channel vector of the normalization, or the default if unnamed
+std::vector<double> load_channel_vector(TensorFile &file,
+                                        const std::string &tensor_name,
+                                        size_t num_channels,
+                                        double default_value) {
+    std::vector<double> values(num_channels, default_value);
+    if (tensor_name.empty()) {
+        return values;
+    }
+    if (file.get_num_tensor_elements(tensor_name) != num_channels) {
+        throw std::runtime_error("dalotia: " + tensor_name + " has " +
+                                 std::to_string(file.get_num_tensor_elements(
+                                     tensor_name)) +
+                                 " elements, expected one per channel (" +
+                                 std::to_string(num_channels) + ")");
+    }
+    file.load_tensor_dense(
+        tensor_name, dalotia_float_64, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()));
+    return values;
+}
+
+template <typename value_type>
+void load_scaled(TensorFile &file, const std::string &weight_name,
+                 const std::string &bias_name,
+                 const std::vector<double> &scale,
+                 const std::vector<double> &shift,
+                 dalotia_WeightFormat weight_format, dalotia_Ordering ordering,
+                 dalotia_byte *weight, dalotia_byte *bias,
+                 const std::vector<int> &permutation) {
+    const auto extents = file.get_tensor_extents(weight_name);
+    const size_t num_elements = file.get_num_tensor_elements(weight_name);
+    const size_t num_channels = extents.empty() ? 1 : extents.front();
+    const size_t num_columns =
+        num_channels == 0 ? 0 : num_elements / num_channels;
+    if (scale.size() != num_channels || shift.size() != num_channels) {
+        throw std::runtime_error(
+            "dalotia load_scaled_by_channel: " + weight_name + " has " +
+            std::to_string(num_channels) + " output channels, but there are " +
+            std::to_string(scale.size()) + " scales and " +
+            std::to_string(shift.size()) + " shifts");
+    }
+    if (bias != nullptr) {
+        const auto stored_bias =
+            load_channel_vector(file, bias_name, num_channels, 0.);
+        auto *bias_values = reinterpret_cast<value_type *>(bias);
+        for (size_t o = 0; o < num_channels; ++o) {
+            bias_values[o] =
+                static_cast<value_type>(scale[o] * stored_bias[o] + shift[o]);
+        }
+    }
+
+    LoadTimer timer(file.get_instrumentation(), weight_name);
+    const auto final_permutation_in_c_order =
+        final_c_permutation_from_permutation_and_order(permutation, ordering,
+                                                       extents.size());
+    const std::vector<value_type> channel_scale(scale.begin(), scale.end());
+    // W straight from the mapping if it is C-ordered there, else loaded
+    TensorView view = file.get_tensor_view(weight_name);
+    std::vector<value_type> loaded_weight;
+    if (view.data == nullptr || view.strides != dense_strides(view.extents)) {
+        timer.phase(dalotia_io_phase);
+        loaded_weight.resize(num_elements);
+        file.load_tensor_dense(
+            weight_name, weight_format, dalotia_C_ordering,
+            reinterpret_cast<dalotia_byte *>(loaded_weight.data()));
+        view.data = reinterpret_cast<const dalotia_byte *>(loaded_weight.data());
+        view.weight_format = weight_format;
+    } else {
+        timer.fault_in(view.data,
+                       num_elements * sizeof_weight_format(view.weight_format));
+    }
+    timer.add_bytes(num_elements * sizeof_weight_format(view.weight_format),
+                    num_elements * sizeof(value_type));
+
+    const auto scale_row = [&](size_t row, size_t /*column_begin*/,
+                               value_type *__restrict__ values,
+                               size_t num_values) {
+        const value_type row_scale = channel_scale[row];
+        for (size_t j = 0; j < num_values; ++j) {
+            values[j] *= row_scale;
+        }
+    };
+    const bool transposed =
+        extents.size() == 2 && !final_permutation_in_c_order.empty();
+    if (final_permutation_in_c_order.empty() || transposed) {
+        timer.phase(transposed ? dalotia_permute_phase : dalotia_convert_phase);
+        assign_rows_tiled(reinterpret_cast<value_type *>(weight), num_channels,
+                          num_columns, view.data, view.weight_format,
+                          transposed, scale_row);
+        return;
+    }
+    timer.phase(dalotia_convert_phase);
+    std::vector<value_type> scaled(num_elements);
+    assign_rows_tiled(scaled.data(), num_channels, num_columns, view.data,
+                      view.weight_format, false, scale_row);
+    timer.phase(dalotia_permute_phase);
+    assign_permuted(static_cast<uint8_t>(extents.size()), weight,
+                    weight_format, extents.data(),
+                    reinterpret_cast<const dalotia_byte *>(scaled.data()),
+                    weight_format, final_permutation_in_c_order.data());
+}
+}  // namespace
+
+void load_scaled_by_channel(TensorFile &file, const std::string &weight_name,
+                            const std::string &bias_name,
+                            const std::vector<double> &scale,
+                            const std::vector<double> &shift,
+                            dalotia_WeightFormat weight_format,
+                            dalotia_Ordering ordering, dalotia_byte *weight,
+                            dalotia_byte *bias,
+                            const std::vector<int> &permutation) {
+    if (weight_format == dalotia_float_32) {
+        load_scaled<float>(file, weight_name, bias_name, scale, shift,
+                           weight_format, ordering, weight, bias, permutation);
+    } else if (weight_format == dalotia_float_64) {
+        load_scaled<double>(file, weight_name, bias_name, scale, shift,
+                            weight_format, ordering, weight, bias, permutation);
+    } else {
+        throw std::runtime_error(
+            "dalotia load_scaled_by_channel: scaled weights are loaded as "
+            "float or double, " + weight_name +
+            " was requested in another format");
+    }
+}
+
+BatchNormNames batch_norm_names(const std::string &prefix, double epsilon) {
+    return {prefix + "weight", prefix + "bias", prefix + "running_mean",
+            prefix + "running_var", epsilon};
+}
+
+void batch_norm_scale_and_shift(TensorFile &file,
+                                const BatchNormNames &norm,
+                                size_t num_channels, std::vector<double> &scale,
+                                std::vector<double> &shift) {
+    scale = load_channel_vector(file, norm.gamma, num_channels, 1.);
+    shift = load_channel_vector(file, norm.beta, num_channels, 0.);
+    const auto mean = load_channel_vector(file, norm.mean, num_channels, 0.);
+    if (!norm.variance.empty()) {
+        const auto variance =
+            load_channel_vector(file, norm.variance, num_channels, 1.);
+        for (size_t o = 0; o < num_channels; ++o) {
+            scale[o] /= std::sqrt(variance[o] + norm.epsilon);
+        }
+    }
+    // beta + (b - mean) * scale = scale * b + (beta - mean * scale)
+    for (size_t o = 0; o < num_channels; ++o) {
+        shift[o] -= mean[o] * scale[o];
+    }
+}
+
+void load_folded(TensorFile &file, const std::string &weight_name,
+                 const std::string &bias_name, const BatchNormNames &norm,
+                 dalotia_WeightFormat weight_format, dalotia_Ordering ordering,
+                 dalotia_byte *weight, dalotia_byte *bias,
+                 const std::vector<int> &permutation) {
+    const auto extents = file.get_tensor_extents(weight_name);
+    std::vector<double> scale;
+    std::vector<double> shift;
+    batch_norm_scale_and_shift(file, norm,
+                               extents.empty() ? 1 : extents.front(), scale,
+                               shift);
+    load_scaled_by_channel(file, weight_name, bias_name, scale, shift,
+                           weight_format, ordering, weight, bias, permutation);
+}
+
+}  // namespace dalotia
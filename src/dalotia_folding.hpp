@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// loads a weight W (out x ..., e.g. out x in or out x in x kh x kw) scaled
+// by output channel and its bias shifted, W'[o, ...] = scale[o] * W[o, ...]
+// and b'[o] = scale[o] * b[o] + shift[o], in one parallel pass that reads
+// W from the mapping, scales it in cache and stores it in the requested
+// format (float or double), ordering and permutation; bias_name may be
+// empty (then b = 0), and bias may be nullptr if only W is needed; W is
+// loaded into a temporary first if it is not mapped in C order, and so are
+// permuted tensors of more than two dimensions
+void load_scaled_by_channel(TensorFile &file, const std::string &weight_name,
+                            const std::string &bias_name,
+                            const std::vector<double> &scale,
+                            const std::vector<double> &shift,
+                            dalotia_WeightFormat weight_format,
+                            dalotia_Ordering ordering, dalotia_byte *weight,
+                            dalotia_byte *bias,
+                            const std::vector<int> &permutation = {});
+
+// the tensors of a normalization over the output channels that follows a
+// convolution or linear layer, y = (x - mean) / sqrt(variance + epsilon)
+// * gamma + beta, as in PyTorch's BatchNorm in eval mode; each name may be
+// empty: without gamma, beta or mean they are 1, 0 and 0, without variance
+// there is no division, e.g. for a plain per-channel affine transform
+struct BatchNormNames {
+    std::string gamma;
+    std::string beta;
+    std::string mean;
+    std::string variance;
+    double epsilon = 1e-5;
+};
+
+// PyTorch's names, e.g. for the prefix "bn1.": bn1.weight, bn1.bias,
+// bn1.running_mean and bn1.running_var
+BatchNormNames batch_norm_names(const std::string &prefix,
+                                double epsilon = 1e-5);
+
+// the per-channel scale and shift that the normalization folds into
+void batch_norm_scale_and_shift(TensorFile &file,
+                                const BatchNormNames &norm,
+                                size_t num_channels, std::vector<double> &scale,
+                                std::vector<double> &shift);
+
+// loads weight and bias with the normalization that follows them folded
+// in, cf. load_scaled_by_channel; replaces loading the five tensors and
+// folding them in a second pass over W
+void load_folded(TensorFile &file, const std::string &weight_name,
+                 const std::string &bias_name, const BatchNormNames &norm,
+                 dalotia_WeightFormat weight_format, dalotia_Ordering ordering,
+                 dalotia_byte *weight, dalotia_byte *bias,
+                 const std::vector<int> &permutation = {});
+
+}  // namespace dalotia
@@ -3,14 +3,39 @@
 typedef enum  // cannot be scoped to allow for C interface
 {
     dalotia_CSR,
-    dalotia_COO
+    dalotia_COO,
+    // block CSR: blocks of block_rows x block_columns (row-major inside,
+    // zero-padded at the edges); first indices are the block row pointers,
+    // second indices the block column indices
+    dalotia_BSR,
+    // SELL-C-sigma: chunks of C rows, each padded to its longest row and
+    // stored column-major, rows sorted by length within windows of sigma
+    // rows; first indices are the chunk offsets (num_chunks + 1) followed
+    // by the original row of every stored row (num_rows), second indices
+    // the column index of every (padded) value
+    dalotia_SELL,
+    // the formats below keep all N dimensions instead of a matrix view;
+    // N-d COO: first indices are the N coordinates of every value, in C
+    // order of the coordinates; no second indices
+    dalotia_COO_ND,
+    // ALTO: values sorted by their linearized index, which interleaves the
+    // coordinate bits of all modes; first indices are one uint64_t index
+    // per value, second indices one uint64_t bit mask per mode (pass
+    // uint64_t buffers; the extents count ints)
+    dalotia_ALTO,
+    // HiCOO: blocks of 2^block_bits per mode in Z-order; first indices are
+    // the block offsets (num_blocks + 1) followed by the N block
+    // coordinates of every block, second indices the N coordinates of
+    // every value inside its block
+    dalotia_HiCOO
 } dalotia_SparseFormat;  //? compressed formats for d > 2? -> NO common ones
 //  pytorch uses M+K, but M is always 2, K is dense
 //  onnx also has only 2d sparse tensors, same for tensorflow
 //  compressed-tensors (recent, based on safetensors): only bitmask compression,
 //  but for arbitrary dimensions
 //  ALTO https://github.com/IntelLabs/ALTO /
-//  https://dl.acm.org/doi/abs/10.1145/3447818.3461703 could be interesting
+//  https://dl.acm.org/doi/abs/10.1145/3447818.3461703 -> dalotia_ALTO
+//  HiCOO https://doi.org/10.1109/SC.2018.00022 -> dalotia_HiCOO
 
 typedef enum {
     dalotia_float_64,
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <limits>
 #include <map>
+#include <type_traits>
 
 #include "dalotia_formats.h"
 
@@ -54,6 +55,19 @@ constexpr int8_t sizeof_weight_format() {
 // runtime version
 int8_t sizeof_weight_format(dalotia_WeightFormat format);
 
+// the weight format a value type is loaded in
+template <typename value_type>
+constexpr dalotia_WeightFormat weight_format_of() {
+    if constexpr (std::is_same_v<value_type, float>) {
+        return dalotia_float_32;
+    } else if constexpr (std::is_same_v<value_type, double>) {
+        return dalotia_float_64;
+    } else {
+        static_assert(sizeof(value_type) == 0,
+                      "no weight format for this value type, pass it explicitly");
+    }
+}
+
 const std::map<dalotia_WeightFormat, dalotia_WeightFormat>
     bfloat_compatible_float{
         //   {dalotia_bfloat_8, dalotia_float_16},
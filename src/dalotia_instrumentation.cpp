@@ -0,0 +1,269 @@
+#include "dalotia_instrumentation.hpp"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "dalotia_json.hpp"
+
+namespace dalotia {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// shared by all files, so that their traces line up
+const Clock::time_point origin = Clock::now();
+
+double seconds_since_origin(Clock::time_point time) {
+    return std::chrono::duration<double>(time - origin).count();
+}
+
+int thread_number() {
+    static std::atomic<int> next_thread_number{0};
+    thread_local const int number = next_thread_number++;
+    return number;
+}
+
+// the sink that keeps the page touching from being optimized away
+volatile dalotia_byte touched_byte;
+
+const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+// minor and major page faults of the process so far
+std::pair<long, long> page_faults() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return {0, 0};
+    }
+    return {usage.ru_minflt, usage.ru_majflt};
+}
+
+// how many of the bytes are in the page cache, at page granularity
+size_t resident_bytes(const dalotia_byte *data, size_t num_bytes) {
+    if (num_bytes == 0) {
+        return 0;
+    }
+    const auto address = reinterpret_cast<uintptr_t>(data);
+    const uintptr_t first_page = address - address % page_size;
+    const uintptr_t end = address + num_bytes;
+    std::vector<unsigned char> pages((end - first_page + page_size - 1) /
+                                     page_size);
+    if (mincore(reinterpret_cast<void *>(first_page), end - first_page,
+                pages.data()) != 0) {
+        return 0;
+    }
+    size_t num_resident = 0;
+    for (size_t p = 0; p < pages.size(); ++p) {
+        if (pages[p] & 1) {
+            const uintptr_t page_start = first_page + p * page_size;
+            num_resident += std::min(end, page_start + page_size) -
+                            std::max(address, page_start);
+        }
+    }
+    return num_resident;
+}
+}  // namespace
+
+const char *load_phase_name(dalotia_LoadPhase phase) {
+    switch (phase) {
+        case dalotia_lookup_phase: return "lookup";
+        case dalotia_io_phase: return "io";
+        case dalotia_convert_phase: return "convert";
+        case dalotia_permute_phase: return "permute";
+    }
+    return "unknown";
+}
+
+LoadInstrumentation::~LoadInstrumentation() {
+    if (!trace_file_.empty()) {
+        try {
+            this->write_trace();
+        } catch (const std::exception &) {
+            // not worth terminating for
+        }
+    }
+}
+
+void LoadInstrumentation::set_hooks(dalotia_LoadHook begin,
+                                    dalotia_LoadHook end, void *user_data) {
+    begin_hook_ = begin;
+    end_hook_ = end;
+    hook_data_ = user_data;
+    enabled_ = true;
+}
+
+void LoadInstrumentation::set_trace_file(const std::string &filename) {
+    trace_file_ = filename;
+    enabled_ = true;
+}
+
+// cf. the Trace Event Format: one complete event per load, with its phases
+// nested below, in microseconds
+void LoadInstrumentation::write_trace() const {
+    if (trace_file_.empty()) {
+        throw std::runtime_error("dalotia: no trace file set");
+    }
+    std::ofstream trace(trace_file_);
+    if (!trace) {
+        throw std::runtime_error("dalotia: could not open trace file " +
+                                 trace_file_);
+    }
+    const auto process = static_cast<long long>(getpid());
+    trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto event = [&](const std::string &name, const char *category,
+                     double start, double seconds, int thread) {
+        trace << (first ? "\n" : ",\n") << "{\"name\":" << json_string(name)
+              << ",\"cat\":\"" << category << "\",\"ph\":\"X\",\"ts\":"
+              << start * 1e6 << ",\"dur\":" << seconds * 1e6
+              << ",\"pid\":" << process << ",\"tid\":" << thread;
+        first = false;
+    };
+    std::lock_guard<std::mutex> lock(records_mutex_);
+    for (const auto &record : records_) {
+        event(record.tensor_name, "load", record.start, record.seconds,
+              record.thread);
+        trace << ",\"args\":{\"bytes_read\":" << record.bytes_read
+              << ",\"bytes_written\":" << record.bytes_written
+              << ",\"bytes_mapped\":" << record.bytes_mapped
+              << ",\"bytes_resident\":" << record.bytes_resident
+              << ",\"minor_faults\":" << record.minor_faults
+              << ",\"major_faults\":" << record.major_faults
+              << ",\"threads\":" << record.num_threads << "}}";
+        for (const auto &span : record.spans) {
+            event(load_phase_name(span.phase), "phase", span.start,
+                  span.seconds, record.thread);
+            trace << ",\"args\":{\"tensor\":" << json_string(record.tensor_name)
+                  << "}}";
+        }
+    }
+    trace << "\n]}\n";
+    if (!trace) {
+        throw std::runtime_error("dalotia: could not write trace file " +
+                                 trace_file_);
+    }
+}
+
+dalotia_LoadStats LoadInstrumentation::get_stats() const {
+    dalotia_LoadStats stats{};
+    std::lock_guard<std::mutex> lock(records_mutex_);
+    for (const auto &record : records_) {
+        ++stats.num_loads;
+        for (const auto &span : record.spans) {
+            stats.seconds[span.phase] += span.seconds;
+        }
+        stats.bytes_read += static_cast<long long>(record.bytes_read);
+        stats.bytes_written += static_cast<long long>(record.bytes_written);
+        stats.minor_faults += record.minor_faults;
+        stats.major_faults += record.major_faults;
+        stats.bytes_mapped += static_cast<long long>(record.bytes_mapped);
+        stats.bytes_resident += static_cast<long long>(record.bytes_resident);
+        stats.max_threads = std::max(stats.max_threads, record.num_threads);
+    }
+    return stats;
+}
+
+std::vector<LoadRecord> LoadInstrumentation::get_records() const {
+    std::lock_guard<std::mutex> lock(records_mutex_);
+    return records_;
+}
+
+void LoadInstrumentation::reset() {
+    std::lock_guard<std::mutex> lock(records_mutex_);
+    records_.clear();
+}
+
+void LoadInstrumentation::add_record(LoadRecord record) {
+    std::lock_guard<std::mutex> lock(records_mutex_);
+    records_.push_back(std::move(record));
+}
+
+void LoadTimer::start(const std::string &tensor_name) {
+    uncaught_exceptions_ = std::uncaught_exceptions();
+    record_.tensor_name = tensor_name;
+    record_.thread = thread_number();
+#ifdef _OPENMP
+    record_.num_threads = omp_get_max_threads();
+#endif
+    std::tie(minor_faults_at_start_, major_faults_at_start_) = page_faults();
+    this->switch_phase(dalotia_lookup_phase);
+}
+
+void LoadTimer::end_phase(Clock::time_point now) {
+    if (!in_phase_) {
+        return;
+    }
+    record_.spans.push_back({phase_, seconds_since_origin(phase_start_),
+                             std::chrono::duration<double>(now - phase_start_)
+                                 .count()});
+    if (instrumentation_->end_hook_ != nullptr) {
+        instrumentation_->end_hook_(record_.tensor_name.c_str(), phase_,
+                                    instrumentation_->hook_data_);
+    }
+    in_phase_ = false;
+}
+
+void LoadTimer::switch_phase(dalotia_LoadPhase phase) {
+    if (in_phase_ && phase == phase_) {
+        return;
+    }
+    this->end_phase(Clock::now());
+    if (instrumentation_->begin_hook_ != nullptr) {
+        instrumentation_->begin_hook_(record_.tensor_name.c_str(), phase,
+                                      instrumentation_->hook_data_);
+    }
+    phase_ = phase;
+    in_phase_ = true;
+    phase_start_ = Clock::now();
+    if (record_.spans.empty()) {
+        record_.start = seconds_since_origin(phase_start_);
+    }
+}
+
+void LoadTimer::finish() {
+    const auto now = Clock::now();
+    this->end_phase(now);
+    if (std::uncaught_exceptions() > uncaught_exceptions_) {
+        return;
+    }
+    record_.seconds = seconds_since_origin(now) - record_.start;
+    const auto [minor_faults, major_faults] = page_faults();
+    record_.minor_faults = minor_faults - minor_faults_at_start_;
+    record_.major_faults = major_faults - major_faults_at_start_;
+    instrumentation_->add_record(std::move(record_));
+}
+
+void LoadTimer::touch_pages(const dalotia_byte *data, size_t num_bytes) {
+    this->switch_phase(dalotia_io_phase);
+    record_.bytes_mapped += num_bytes;
+    record_.bytes_resident += resident_bytes(data, num_bytes);
+    // from the first byte of the data, then at each page boundary
+    const auto address = reinterpret_cast<uintptr_t>(data);
+    const size_t first_boundary = (page_size - address % page_size) % page_size;
+    const auto num_pages =
+        static_cast<long>(num_bytes > first_boundary
+                              ? (num_bytes - first_boundary + page_size - 1) /
+                                    page_size
+                              : 0);
+    unsigned sum = num_bytes > 0 ? data[0] : 0;
+#pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (long p = 0; p < num_pages; ++p) {
+        sum += data[first_boundary + p * page_size];
+    }
+    touched_byte = static_cast<dalotia_byte>(sum);
+}
+
+}  // namespace dalotia
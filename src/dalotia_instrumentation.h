@@ -0,0 +1,30 @@
+#pragma once
+
+// the phases a load is timed in, in the order they usually run
+typedef enum {
+    dalotia_lookup_phase,   // finding the tensor and its metadata
+    dalotia_io_phase,       // reading, fetching or faulting in the data
+    dalotia_convert_phase,  // copying or converting to the output format
+    dalotia_permute_phase,  // permuted copy
+} dalotia_LoadPhase;
+
+#define DALOTIA_NUM_LOAD_PHASES 4
+
+// aggregate of all loads recorded since the instrumentation was enabled
+// or reset
+typedef struct {
+    long long num_loads;
+    double seconds[DALOTIA_NUM_LOAD_PHASES];  // indexed by dalotia_LoadPhase
+    long long bytes_read;      // from the file, in its stored format
+    long long bytes_written;   // to the caller's buffers
+    long long minor_faults;    // page faults served from memory
+    long long major_faults;    // page faults that waited for the disk
+    long long bytes_mapped;    // of bytes_read, memory-mapped
+    long long bytes_resident;  // of bytes_mapped, cached before the load
+    int max_threads;           // the most threads any load could use
+} dalotia_LoadStats;
+
+// called at the begin and at the end of every phase of every load, e.g. to
+// open and close LIKWID or Score-P regions; may be called concurrently
+typedef void (*dalotia_LoadHook)(const char *tensor_name,
+                                 dalotia_LoadPhase phase, void *user_data);
@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_instrumentation.h"
+
+namespace dalotia {
+
+const char *load_phase_name(dalotia_LoadPhase phase);
+
+// one load: its phases in the order they ran, with start times in seconds
+// since the first instrumented load of the process (so that the traces of
+// several files line up), the bytes moved, the page faults taken and the
+// threads it could use; faults are counted for the whole process (as
+// getrusage does), so they include those of concurrent loads
+struct LoadRecord {
+    struct Span {
+        dalotia_LoadPhase phase;
+        double start;
+        double seconds;
+    };
+
+    std::string tensor_name;
+    double start = 0.;
+    double seconds = 0.;
+    std::vector<Span> spans;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
+    long minor_faults = 0;
+    long major_faults = 0;
+    size_t bytes_mapped = 0;
+    size_t bytes_resident = 0;  // of bytes_mapped, before the load (mincore)
+    int num_threads = 1;
+    int thread = 0;  // numbered in the order the threads first loaded
+};
+
+// records the loads of a file (and of its shards), off by default: then a
+// load costs a branch per phase and nothing is recorded; when enabled,
+// every load is recorded with its phases, the hooks are called around each
+// phase, and the records can be written as a Chrome / Perfetto trace
+// (chrome://tracing, https://ui.perfetto.dev); recording is safe from
+// concurrent loads, configuring it is not (cf. TensorFile)
+class LoadInstrumentation {
+   public:
+    LoadInstrumentation() = default;
+
+    LoadInstrumentation(const LoadInstrumentation &) = delete;
+    LoadInstrumentation &operator=(const LoadInstrumentation &) = delete;
+
+    // writes the trace, if there is a trace file
+    ~LoadInstrumentation();
+
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+
+    [[nodiscard]] bool enabled() const { return enabled_; }
+
+    // enables the instrumentation; either hook may be nullptr
+    void set_hooks(dalotia_LoadHook begin, dalotia_LoadHook end,
+                   void *user_data);
+
+    // enables the instrumentation; the trace is written by write_trace and
+    // when the file is closed
+    void set_trace_file(const std::string &filename);
+
+    void write_trace() const;
+
+    [[nodiscard]] dalotia_LoadStats get_stats() const;
+
+    [[nodiscard]] std::vector<LoadRecord> get_records() const;
+
+    void reset();
+
+   private:
+    friend class LoadTimer;
+
+    void add_record(LoadRecord record);
+
+    bool enabled_ = false;
+    dalotia_LoadHook begin_hook_ = nullptr;
+    dalotia_LoadHook end_hook_ = nullptr;
+    void *hook_data_ = nullptr;
+    std::string trace_file_;
+    mutable std::mutex records_mutex_;
+    std::vector<LoadRecord> records_;
+};
+
+// times one load in consecutive phases, from construction to destruction
+// (loads that throw are not recorded); does nothing if the instrumentation
+// is off
+class LoadTimer {
+   public:
+    LoadTimer(LoadInstrumentation &instrumentation,
+              const std::string &tensor_name)
+        : instrumentation_(instrumentation.enabled() ? &instrumentation
+                                                     : nullptr) {
+        if (instrumentation_ != nullptr) {
+            this->start(tensor_name);
+        }
+    }
+
+    LoadTimer(const LoadTimer &) = delete;
+    LoadTimer &operator=(const LoadTimer &) = delete;
+
+    ~LoadTimer() {
+        if (instrumentation_ != nullptr) {
+            this->finish();
+        }
+    }
+
+    // ends the running phase and starts the next one
+    void phase(dalotia_LoadPhase phase) {
+        if (instrumentation_ != nullptr) {
+            this->switch_phase(phase);
+        }
+    }
+
+    void add_bytes(size_t bytes_read, size_t bytes_written) {
+        if (instrumentation_ != nullptr) {
+            record_.bytes_read += bytes_read;
+            record_.bytes_written += bytes_written;
+        }
+    }
+
+    // if enabled, counts how much of the mapped data is in the page cache
+    // and touches every page of it in the io phase, such that page faults
+    // are timed as io instead of as the conversion that would otherwise
+    // take them
+    void fault_in(const dalotia_byte *data, size_t num_bytes) {
+        if (instrumentation_ != nullptr) {
+            this->touch_pages(data, num_bytes);
+        }
+    }
+
+   private:
+    void start(const std::string &tensor_name);
+
+    void finish();
+
+    void switch_phase(dalotia_LoadPhase phase);
+
+    void end_phase(std::chrono::steady_clock::time_point now);
+
+    void touch_pages(const dalotia_byte *data, size_t num_bytes);
+
+    LoadInstrumentation *instrumentation_;
+    LoadRecord record_;
+    int uncaught_exceptions_ = 0;
+    long minor_faults_at_start_ = 0;
+    long major_faults_at_start_ = 0;
+    bool in_phase_ = false;
+    dalotia_LoadPhase phase_ = dalotia_lookup_phase;
+    std::chrono::steady_clock::time_point phase_start_;
+};
+
+}  // namespace dalotia
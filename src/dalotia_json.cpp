@@ -0,0 +1,223 @@
+#include "dalotia_json.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace dalotia {
+
+namespace {
+void append_utf8(uint32_t code_point, std::string &string) {
+    if (code_point < 0x80) {
+        string += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        string += static_cast<char>(0xC0 | (code_point >> 6));
+        string += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        string += static_cast<char>(0xE0 | (code_point >> 12));
+        string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        string += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        string += static_cast<char>(0xF0 | (code_point >> 18));
+        string += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        string += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        string += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+// the four whitespace characters of JSON; cheaper than std::isspace
+bool is_whitespace(char character) {
+    return character == ' ' || character == '\n' || character == '\r' ||
+           character == '\t';
+}
+
+bool ends_scalar(char character) {
+    return character == ',' || character == '}' || character == ']' ||
+           is_whitespace(character);
+}
+}  // namespace
+
+void JsonReader::fail(const std::string &message) const {
+    throw std::runtime_error(std::string(context_) + ": " + message +
+                             " at position " + std::to_string(position_));
+}
+
+void JsonReader::skip_whitespace() {
+    while (position_ < json_.size() && is_whitespace(json_[position_])) {
+        ++position_;
+    }
+}
+
+void JsonReader::expect(char character) {
+    skip_whitespace();
+    if (position_ >= json_.size() || json_[position_] != character) {
+        fail(std::string("expected '") + character + "'");
+    }
+    ++position_;
+}
+
+bool JsonReader::next_is(char character) {
+    skip_whitespace();
+    if (position_ < json_.size() && json_[position_] == character) {
+        ++position_;
+        return true;
+    }
+    return false;
+}
+
+std::string_view JsonReader::read_string(std::string &unescaped) {
+    expect('"');
+    const size_t start = position_;
+    // the common case: no escapes, no copy; memchr is vectorized
+    const char *begin = json_.data() + start;
+    const auto *quote = static_cast<const char *>(
+        std::memchr(begin, '"', json_.size() - start));
+    if (quote == nullptr) {
+        fail("unterminated string");
+    }
+    const auto *backslash =
+        static_cast<const char *>(std::memchr(begin, '\\', quote - begin));
+    if (backslash == nullptr) {
+        position_ = quote - json_.data() + 1;
+        return json_.substr(start, quote - begin);
+    }
+    position_ = backslash - json_.data();
+    unescaped.assign(json_.substr(start, position_ - start));
+    while (position_ < json_.size() && json_[position_] != '"') {
+        char character = json_[position_++];
+        if (character != '\\') {
+            unescaped += character;
+            continue;
+        }
+        if (position_ >= json_.size()) {
+            break;
+        }
+        character = json_[position_++];
+        switch (character) {
+            case 'b': unescaped += '\b'; break;
+            case 'f': unescaped += '\f'; break;
+            case 'n': unescaped += '\n'; break;
+            case 'r': unescaped += '\r'; break;
+            case 't': unescaped += '\t'; break;
+            case 'u': append_utf8(read_code_point(), unescaped); break;
+            default: unescaped += character;  // '"', '\\', '/'
+        }
+    }
+    expect('"');
+    return unescaped;
+}
+
+std::string JsonReader::read_string() {
+    std::string unescaped;
+    const std::string_view string = read_string(unescaped);
+    if (string.data() == unescaped.data()) {
+        return unescaped;
+    }
+    return std::string(string);
+}
+
+uint32_t JsonReader::read_code_point() {
+    auto read_hex = [this]() {
+        if (position_ + 4 > json_.size()) {
+            fail("truncated escape");
+        }
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            const char digit = json_[position_++];
+            value <<= 4;
+            if (digit >= '0' && digit <= '9') {
+                value |= digit - '0';
+            } else if (digit >= 'a' && digit <= 'f') {
+                value |= digit - 'a' + 10;
+            } else if (digit >= 'A' && digit <= 'F') {
+                value |= digit - 'A' + 10;
+            } else {
+                fail("invalid escape");
+            }
+        }
+        return value;
+    };
+    uint32_t code_point = read_hex();
+    // surrogate pair
+    if (code_point >= 0xD800 && code_point < 0xDC00 &&
+        json_.substr(position_, 2) == "\\u") {
+        position_ += 2;
+        const uint32_t low = read_hex();
+        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+    }
+    return code_point;
+}
+
+uint64_t JsonReader::read_unsigned() {
+    skip_whitespace();
+    const size_t start = position_;
+    uint64_t value = 0;
+    while (position_ < json_.size() && json_[position_] >= '0' &&
+           json_[position_] <= '9') {
+        const uint64_t digit = json_[position_++] - '0';
+        if (value > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+            fail("integer out of range");
+        }
+        value = 10 * value + digit;
+    }
+    if (position_ == start) {
+        fail("expected a non-negative integer");
+    }
+    return value;
+}
+
+std::string_view JsonReader::skip_value() {
+    skip_whitespace();
+    if (position_ >= json_.size()) {
+        fail("truncated input");
+    }
+    const size_t start = position_;
+    const char character = json_[position_];
+    std::string unescaped;
+    if (character == '"') {
+        read_string(unescaped);
+    } else if (character == '{') {
+        ++position_;
+        if (!next_is('}')) {
+            do {
+                read_string(unescaped);
+                expect(':');
+                skip_value();
+            } while (next_is(','));
+            expect('}');
+        }
+    } else if (character == '[') {
+        ++position_;
+        if (!next_is(']')) {
+            do {
+                skip_value();
+            } while (next_is(','));
+            expect(']');
+        }
+    } else {  // number, true, false, null
+        while (position_ < json_.size() && !ends_scalar(json_[position_])) {
+            ++position_;
+        }
+    }
+    return json_.substr(start, position_ - start);
+}
+
+std::string json_string(std::string_view string) {
+    std::string quoted = "\"";
+    for (const char character : string) {
+        if (character == '"' || character == '\\') {
+            quoted += '\\';
+            quoted += character;
+        } else if (static_cast<unsigned char>(character) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+            quoted += escaped;
+        } else {
+            quoted += character;
+        }
+    }
+    return quoted + "\"";
+}
+
+}  // namespace dalotia
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace dalotia {
+
+// minimal pull reader for JSON, cf. https://www.json.org -- enough to walk
+// objects and arrays key by key in a single pass; strings without escape
+// sequences are returned as views into the input, so reading allocates
+// nothing; errors throw std::runtime_error prefixed with the context
+class JsonReader {
+   public:
+    JsonReader(std::string_view json, const char *context)
+        : json_(json), context_(context) {}
+
+    void expect(char character);
+
+    // consumes the character if it is next
+    bool next_is(char character);
+
+    // a view into the input, or into unescaped if the string has escape
+    // sequences
+    std::string_view read_string(std::string &unescaped);
+
+    std::string read_string();
+
+    // a non-negative integer
+    uint64_t read_unsigned();
+
+    // skips any value and returns its text
+    std::string_view skip_value();
+
+    [[nodiscard]] size_t position() const { return position_; }
+
+   private:
+    void skip_whitespace();
+
+    [[noreturn]] void fail(const std::string &message) const;
+
+    uint32_t read_code_point();
+
+    std::string_view json_;
+    const char *context_;
+    size_t position_ = 0;
+};
+
+// the string as a JSON string literal, quoted and escaped
+std::string json_string(std::string_view string);
+
+}  // namespace dalotia
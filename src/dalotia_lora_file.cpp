@@ -0,0 +1,298 @@
+#include "dalotia_lora_file.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+
+#include "dalotia.hpp"
+#include "dalotia_assignment.hpp"
+#include "dalotia_sparse.hpp"
+
+namespace dalotia {
+
+namespace {
+const std::string lora_a_suffix = ".lora_A.weight";
+const std::string lora_b_suffix = ".lora_B.weight";
+const std::string peft_prefix = "base_model.model.";
+
+// merged = W + scaled_b * a, for W C-ordered (num_rows x num_columns) in its
+// stored format, scaled_b (num_rows x rank) and a (rank x num_columns);
+// merged is C-ordered, or its transpose
+template <typename value_type>
+void merge_low_rank(const dalotia_byte *__restrict__ weight,
+                    dalotia_WeightFormat weight_format, size_t num_rows,
+                    size_t num_columns, size_t rank,
+                    const value_type *__restrict__ scaled_b,
+                    const value_type *__restrict__ a, bool transposed,
+                    value_type *__restrict__ merged) {
+    assign_rows_tiled(
+        merged, num_rows, num_columns, weight, weight_format, transposed,
+        [&](size_t row, size_t column_begin, value_type *__restrict__ values,
+            size_t num_values) {
+            for (size_t k = 0; k < rank; ++k) {
+                const value_type b = scaled_b[row * rank + k];
+                const value_type *a_row = a + k * num_columns + column_begin;
+                for (size_t j = 0; j < num_values; ++j) {
+                    values[j] += b * a_row[j];
+                }
+            }
+        });
+}
+}  // namespace
+
+std::unordered_map<std::string, std::pair<std::string, std::string>>
+find_lora_pairs(const TensorFile &base, const TensorFile &adapter) {
+    std::unordered_map<std::string, std::pair<std::string, std::string>> pairs;
+    for (const auto &a_name : adapter.get_tensor_names()) {
+        if (!ends_with(a_name, lora_a_suffix)) {
+            continue;
+        }
+        const std::string module =
+            a_name.substr(0, a_name.size() - lora_a_suffix.size());
+        std::string b_name = module + lora_b_suffix;
+        if (adapter.get_tensor_index(b_name) < 0) {
+            throw std::runtime_error("dalotia LoraTensorFile: no " + b_name +
+                                     " for " + a_name);
+        }
+        std::string weight_name = module + ".weight";
+        if (base.get_tensor_index(weight_name) < 0 &&
+            weight_name.compare(0, peft_prefix.size(), peft_prefix) == 0) {
+            weight_name = weight_name.substr(peft_prefix.size());
+        }
+        if (base.get_tensor_index(weight_name) < 0) {
+            throw std::runtime_error("dalotia LoraTensorFile: the base has no " +
+                                     weight_name + " for " + a_name);
+        }
+        pairs.emplace(std::move(weight_name),
+                      std::make_pair(a_name, std::move(b_name)));
+    }
+    return pairs;
+}
+
+LoraTensorFile::LoraTensorFile(std::shared_ptr<TensorFile> base,
+                               std::shared_ptr<TensorFile> adapter,
+                               double scale)
+    : TensorFile(""),
+      base_(std::move(base)),
+      adapter_(std::move(adapter)),
+      scale_(scale),
+      lora_pairs_(find_lora_pairs(*base_, *adapter_)) {
+    share_instrumentation(*base_, *this);
+    // check the shapes at open, such that loads do not fail halfway
+    for (const auto &[weight_name, a_and_b] : lora_pairs_) {
+        const auto extents = base_->get_tensor_extents(weight_name);
+        const auto a_extents = adapter_->get_tensor_extents(a_and_b.first);
+        const auto b_extents = adapter_->get_tensor_extents(a_and_b.second);
+        if (extents.size() < 2 || a_extents.size() < 2 ||
+            b_extents.size() < 2) {
+            throw std::runtime_error("dalotia LoraTensorFile: " + weight_name +
+                                     " and its factors need two or more "
+                                     "dimensions");
+        }
+        const size_t num_rows = extents.front();
+        const size_t rank = a_extents.front();
+        const size_t num_columns =
+            num_rows == 0
+                ? 0
+                : base_->get_num_tensor_elements(weight_name) / num_rows;
+        if (static_cast<size_t>(b_extents.front()) != num_rows ||
+            adapter_->get_num_tensor_elements(a_and_b.second) !=
+                num_rows * rank ||
+            adapter_->get_num_tensor_elements(a_and_b.first) !=
+                rank * num_columns) {
+            throw std::runtime_error(
+                "dalotia LoraTensorFile: the shapes of " + a_and_b.first +
+                " (" + to_string(a_extents) + ") and " + a_and_b.second +
+                " (" + to_string(b_extents) + ") do not match " +
+                weight_name + " (" + to_string(extents) + ")");
+        }
+    }
+}
+
+LoraTensorFile::LoraTensorFile(const std::string &base_filename,
+                               const std::string &adapter_filename,
+                               double scale)
+    : LoraTensorFile(std::shared_ptr<TensorFile>(make_tensor_file(base_filename)),
+                     std::shared_ptr<TensorFile>(
+                         make_tensor_file(adapter_filename)),
+                     scale) {}
+
+LoraTensorFile::~LoraTensorFile() = default;
+
+void LoraTensorFile::throw_if_merged(const std::string &tensor_name,
+                                     const char *function) const {
+    if (this->is_merged(tensor_name)) {
+        throw std::runtime_error(std::string(function) +
+                                 " is not available for the merged weight " +
+                                 tensor_name);
+    }
+}
+
+const std::vector<std::string> &LoraTensorFile::get_tensor_names() const {
+    return base_->get_tensor_names();
+}
+
+bool LoraTensorFile::is_sparse(const std::string &tensor_name) const {
+    return !this->is_merged(tensor_name) && base_->is_sparse(tensor_name);
+}
+
+size_t LoraTensorFile::get_num_dimensions(const std::string &tensor_name) const {
+    return base_->get_num_dimensions(tensor_name);
+}
+
+size_t LoraTensorFile::get_num_tensor_elements(
+    const std::string &tensor_name) const {
+    return base_->get_num_tensor_elements(tensor_name);
+}
+
+std::vector<int> LoraTensorFile::get_tensor_extents(
+    const std::string &tensor_name, const std::vector<int> &permutation) const {
+    return base_->get_tensor_extents(tensor_name, permutation);
+}
+
+dalotia_WeightFormat LoraTensorFile::get_weight_format(
+    const std::string &tensor_name) const {
+    return base_->get_weight_format(tensor_name);
+}
+
+size_t LoraTensorFile::get_nnz(const std::string &tensor_name) const {
+    this->throw_if_merged(tensor_name, "get_nnz");
+    return base_->get_nnz(tensor_name);
+}
+
+std::vector<int> LoraTensorFile::get_sparse_tensor_extents(
+    const std::string &tensor_name, dalotia_SparseFormat format) const {
+    this->throw_if_merged(tensor_name, "get_sparse_tensor_extents");
+    return base_->get_sparse_tensor_extents(tensor_name, format);
+}
+
+template <typename value_type>
+void LoraTensorFile::load_merged(
+    const std::string &tensor_name, dalotia_WeightFormat weightFormat,
+    const std::vector<int> &final_permutation_in_c_order,
+    dalotia_byte *__restrict__ tensor) {
+    LoadTimer timer(*instrumentation_, tensor_name);
+    const auto &[a_name, b_name] = lora_pairs_.at(tensor_name);
+    const auto extents = base_->get_tensor_extents(tensor_name);
+    const size_t num_elements = base_->get_num_tensor_elements(tensor_name);
+    const size_t num_rows = extents.front();
+    const size_t num_columns = num_rows == 0 ? 0 : num_elements / num_rows;
+    const size_t rank = adapter_->get_tensor_extents(a_name).front();
+
+    // the factors are small, so they are loaded and B is scaled up front
+    timer.phase(dalotia_io_phase);
+    std::vector<value_type> a(rank * num_columns);
+    std::vector<value_type> scaled_b(num_rows * rank);
+    adapter_->load_tensor_dense(a_name, weightFormat, dalotia_C_ordering,
+                                reinterpret_cast<dalotia_byte *>(a.data()));
+    adapter_->load_tensor_dense(
+        b_name, weightFormat, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(scaled_b.data()));
+    const auto scale = static_cast<value_type>(scale_);
+    for (auto &b : scaled_b) {
+        b *= scale;
+    }
+
+    // W straight from the mapping if it is C-ordered there, else loaded
+    TensorView view = base_->get_tensor_view(tensor_name);
+    std::vector<value_type> loaded_weight;
+    if (view.data == nullptr || view.strides != dense_strides(view.extents)) {
+        loaded_weight.resize(num_elements);
+        base_->load_tensor_dense(
+            tensor_name, weightFormat, dalotia_C_ordering,
+            reinterpret_cast<dalotia_byte *>(loaded_weight.data()));
+        view.data = reinterpret_cast<const dalotia_byte *>(loaded_weight.data());
+        view.weight_format = weightFormat;
+    } else {
+        timer.fault_in(view.data,
+                       num_elements * sizeof_weight_format(view.weight_format));
+    }
+    timer.add_bytes(num_elements * sizeof_weight_format(view.weight_format),
+                    num_elements * sizeof(value_type));
+
+    const bool transposed = extents.size() == 2 &&
+                            !final_permutation_in_c_order.empty();
+    if (final_permutation_in_c_order.empty() || transposed) {
+        timer.phase(transposed ? dalotia_permute_phase : dalotia_convert_phase);
+        merge_low_rank(view.data, view.weight_format, num_rows, num_columns,
+                       rank, scaled_b.data(), a.data(), transposed,
+                       reinterpret_cast<value_type *>(tensor));
+        return;
+    }
+    // other permutations of kernels go through a C-ordered copy
+    timer.phase(dalotia_convert_phase);
+    std::vector<value_type> merged(num_elements);
+    merge_low_rank(view.data, view.weight_format, num_rows, num_columns, rank,
+                   scaled_b.data(), a.data(), false, merged.data());
+    timer.phase(dalotia_permute_phase);
+    assign_permuted(static_cast<uint8_t>(extents.size()), tensor, weightFormat,
+                    extents.data(),
+                    reinterpret_cast<const dalotia_byte *>(merged.data()),
+                    weightFormat, final_permutation_in_c_order.data());
+}
+
+void LoraTensorFile::load_tensor_dense(const std::string &tensor_name,
+                                       dalotia_WeightFormat weightFormat,
+                                       dalotia_Ordering ordering,
+                                       dalotia_byte *__restrict__ tensor,
+                                       const std::vector<int> &permutation) {
+    if (!this->is_merged(tensor_name)) {
+        base_->load_tensor_dense(tensor_name, weightFormat, ordering, tensor,
+                                 permutation);
+        return;
+    }
+    const auto final_permutation_in_c_order =
+        final_c_permutation_from_permutation_and_order(
+            permutation, ordering, base_->get_num_dimensions(tensor_name));
+    if (weightFormat == dalotia_float_32) {
+        this->load_merged<float>(tensor_name, weightFormat,
+                                 final_permutation_in_c_order, tensor);
+    } else if (weightFormat == dalotia_float_64) {
+        this->load_merged<double>(tensor_name, weightFormat,
+                                  final_permutation_in_c_order, tensor);
+    } else {
+        throw std::runtime_error(
+            "dalotia LoraTensorFile: merged weights are loaded as float or "
+            "double, " + tensor_name + " was requested in another format");
+    }
+}
+
+void LoraTensorFile::load_tensor_sparse(const std::string &tensor_name,
+                                        dalotia_SparseFormat sparseFormat,
+                                        dalotia_WeightFormat weightFormat,
+                                        dalotia_Ordering ordering,
+                                        dalotia_byte *__restrict__ values,
+                                        int *__restrict__ first_indices,
+                                        int *__restrict__ second_indices) {
+    this->throw_if_merged(tensor_name, "load_tensor_sparse");
+    base_->load_tensor_sparse(tensor_name, sparseFormat, weightFormat,
+                              ordering, values, first_indices, second_indices);
+}
+
+std::vector<const dalotia_byte *> LoraTensorFile::get_mmap_tensor_pointers(
+    const std::string &tensor_name) const {
+    if (this->is_merged(tensor_name)) {
+        return {};
+    }
+    return base_->get_mmap_tensor_pointers(tensor_name);
+}
+
+TensorView LoraTensorFile::get_tensor_view(const std::string &tensor_name) const {
+    if (this->is_merged(tensor_name)) {
+        return TensorView();
+    }
+    return base_->get_tensor_view(tensor_name);
+}
+
+void LoraTensorFile::set_prune_threshold(double threshold) {
+    TensorFile::set_prune_threshold(threshold);
+    base_->set_prune_threshold(threshold);
+}
+
+void LoraTensorFile::set_sparse_layout(const SparseLayout &layout) {
+    TensorFile::set_sparse_layout(layout);
+    base_->set_sparse_layout(layout);
+}
+
+}  // namespace dalotia
@@ -0,0 +1,111 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// pairs the adapted weights of the base with their low-rank factors in the
+// adapter, following the PEFT naming: "<module>.weight" of the base is
+// adapted by "<module>.lora_A.weight" and "<module>.lora_B.weight", with an
+// optional "base_model.model." prefix in the adapter; returns the base
+// weight name -> (A, B) names
+std::unordered_map<std::string, std::pair<std::string, std::string>>
+find_lora_pairs(const TensorFile &base, const TensorFile &adapter);
+
+// a base model with a low-rank adapter merged on load: the adapted weights
+// W (out x in, or out x in x kernel...) load as W + scale * B * A, with A
+// (r x in...) and B (out x r) from the adapter, and all other tensors load
+// as stored in the base; scale is PEFT's lora_alpha / r. The merge runs in
+// one blocked, parallel pass that converts W from the mapping, adds the
+// product tile by tile and stores to the output, transposed if requested,
+// so there is no temporary copy of W (unless W is not mapped, or a tensor
+// of more than two dimensions is permuted). The base may be shared by
+// several variants; loads are recorded in its instrumentation. Merged loads
+// are dense, in float or double
+class LoraTensorFile : public TensorFile {
+   public:
+    LoraTensorFile(std::shared_ptr<TensorFile> base,
+                   std::shared_ptr<TensorFile> adapter, double scale);
+
+    // opens both with make_tensor_file
+    LoraTensorFile(const std::string &base_filename,
+                   const std::string &adapter_filename, double scale);
+
+    ~LoraTensorFile() override;
+
+    const std::vector<std::string> &get_tensor_names() const override;
+
+    bool is_sparse(const std::string &tensor_name) const override;
+
+    size_t get_num_dimensions(const std::string &tensor_name) const override;
+
+    size_t get_num_tensor_elements(const std::string &tensor_name) const override;
+
+    std::vector<int> get_tensor_extents(
+        const std::string &tensor_name = "",
+        const std::vector<int> &permutation = {}) const override;
+
+    dalotia_WeightFormat get_weight_format(
+        const std::string &tensor_name) const override;
+
+    // sparse queries and loads are not available for merged weights
+    size_t get_nnz(const std::string &tensor_name) const override;
+
+    std::vector<int> get_sparse_tensor_extents(
+        const std::string &tensor_name,
+        dalotia_SparseFormat format) const override;
+
+    void load_tensor_dense(const std::string &tensor_name,
+                           dalotia_WeightFormat weightFormat,
+                           dalotia_Ordering ordering,
+                           dalotia_byte *__restrict__ tensor,
+                           const std::vector<int> &permutation = {}) override;
+
+    void load_tensor_sparse(const std::string &tensor_name,
+                            dalotia_SparseFormat sparseFormat,
+                            dalotia_WeightFormat weightFormat,
+                            dalotia_Ordering ordering,
+                            dalotia_byte *__restrict__ values,
+                            int *__restrict__ first_indices,
+                            int *__restrict__ second_indices) override;
+
+    // empty / no view for merged weights, which are not in any mapping
+    std::vector<const dalotia_byte *> get_mmap_tensor_pointers(
+        const std::string &tensor_name) const override;
+
+    TensorView get_tensor_view(const std::string &tensor_name) const override;
+
+    // these apply to the base, and so to all variants sharing it
+    void set_prune_threshold(double threshold) override;
+
+    void set_sparse_layout(const SparseLayout &layout) override;
+
+    [[nodiscard]] bool is_merged(const std::string &tensor_name) const {
+        return lora_pairs_.count(tensor_name) != 0;
+    }
+
+    [[nodiscard]] double get_scale() const { return scale_; }
+
+   private:
+    template <typename value_type>
+    void load_merged(const std::string &tensor_name,
+                     dalotia_WeightFormat weightFormat,
+                     const std::vector<int> &final_permutation_in_c_order,
+                     dalotia_byte *__restrict__ tensor);
+
+    void throw_if_merged(const std::string &tensor_name,
+                         const char *function) const;
+
+    std::shared_ptr<TensorFile> base_;
+    std::shared_ptr<TensorFile> adapter_;
+    double scale_;
+    std::unordered_map<std::string, std::pair<std::string, std::string>>
+        lora_pairs_;
+};
+
+}  // namespace dalotia
@@ -0,0 +1,347 @@
+#include "dalotia_mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "dalotia_assignment.hpp"
+#include "dalotia_sparse.hpp"
+
+namespace dalotia {
+
+namespace {
+std::vector<size_t> element_strides(const MappedTensor &tensor) {
+    return tensor.strides.empty()
+               ? dense_strides(tensor.extents, tensor.storage_order)
+               : tensor.strides;
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string &filename) : filename_(filename) {
+    int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("dalotia: could not open file " + filename);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0) {
+        close(file_descriptor);
+        throw std::runtime_error("dalotia: could not stat file " + filename);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void *address =
+            mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+        if (address == MAP_FAILED) {
+            close(file_descriptor);
+            throw std::runtime_error("dalotia: could not mmap file " + filename);
+        }
+        data_ = static_cast<const dalotia_byte *>(address);
+    }
+    // the mapping stays valid after closing the descriptor
+    close(file_descriptor);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<dalotia_byte *>(data_), size_);
+    }
+}
+
+MappedTensorFile::MappedTensorFile(const std::string &filename)
+    : TensorFile(filename) {}
+
+MappedTensorFile::~MappedTensorFile() = default;
+
+const MappedFile &MappedTensorFile::map_file(const std::string &filename) {
+    auto it = mapped_files_.find(filename);
+    if (it == mapped_files_.end()) {
+        it = mapped_files_
+                 .emplace(filename, std::make_unique<MappedFile>(filename))
+                 .first;
+    }
+    return *it->second;
+}
+
+dalotia_byte *MappedTensorFile::allocate_owned_buffer(size_t num_bytes) {
+    owned_buffers_.emplace_back(new dalotia_byte[num_bytes]);
+    return owned_buffers_.back().get();
+}
+
+void MappedTensorFile::add_tensor(const std::string &tensor_name,
+                                  MappedTensor tensor) {
+    auto [position, inserted] =
+        tensor_positions_.emplace(tensor_name, tensors_.size());
+    if (!inserted) {
+        throw std::runtime_error("dalotia: duplicate tensor name " +
+                                 tensor_name);
+    }
+    tensor_names_.push_back(tensor_name);
+    tensors_.push_back(std::move(tensor));
+}
+
+const MappedTensor &MappedTensorFile::get_mapped_tensor(
+    const std::string &tensor_name) const {
+    if (tensor_name.empty() && tensors_.size() == 1) {
+        return tensors_.front();
+    }
+    auto it = tensor_positions_.find(tensor_name);
+    if (it == tensor_positions_.end()) {
+        throw std::runtime_error("Tensor " + tensor_name +
+                                 " not found; available: " +
+                                 to_string(tensor_names_));
+    }
+    return tensors_[it->second];
+}
+
+const MappedTensor &MappedTensorFile::get_mapped_tensor_at(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= tensors_.size()) {
+        throw std::runtime_error("dalotia: no tensor at index " +
+                                 std::to_string(index));
+    }
+    return tensors_[index];
+}
+
+int MappedTensorFile::get_tensor_index(const std::string &tensor_name) const {
+    const auto it = tensor_positions_.find(tensor_name);
+    return it == tensor_positions_.end() ? -1 : static_cast<int>(it->second);
+}
+
+std::vector<int> MappedTensorFile::get_tensor_extents_by_index(int index) const {
+    return this->get_mapped_tensor_at(index).extents;
+}
+
+dalotia_WeightFormat MappedTensorFile::get_weight_format_by_index(
+    int index) const {
+    return this->get_mapped_tensor_at(index).weight_format;
+}
+
+const std::vector<std::string> &MappedTensorFile::get_tensor_names() const {
+    return tensor_names_;
+}
+
+bool MappedTensorFile::is_sparse(const std::string & /*tensor_name*/) const {
+    return false;
+}
+
+size_t MappedTensorFile::get_num_dimensions(
+    const std::string &tensor_name) const {
+    return this->get_mapped_tensor(tensor_name).extents.size();
+}
+
+size_t MappedTensorFile::get_num_tensor_elements(
+    const std::string &tensor_name) const {
+    const auto &extents = this->get_mapped_tensor(tensor_name).extents;
+    return std::accumulate(extents.begin(), extents.end(), size_t(1),
+                           std::multiplies<size_t>());
+}
+
+std::vector<int> MappedTensorFile::get_tensor_extents(
+    const std::string &tensor_name, const std::vector<int> &permutation) const {
+    const auto &stored_extents = this->get_mapped_tensor(tensor_name).extents;
+    std::vector<int> extents = stored_extents;
+    if (!permutation.empty()) {
+        auto final_permutation_in_c_order =
+            final_c_permutation_from_permutation_and_order(
+                permutation, dalotia_Ordering::dalotia_C_ordering,
+                extents.size());
+        if (!final_permutation_in_c_order.empty()) {
+            for (size_t i = 0; i < extents.size(); i++) {
+                extents[i] = stored_extents[final_permutation_in_c_order[i]];
+            }
+        }
+    }
+    return extents;
+}
+
+dalotia_WeightFormat MappedTensorFile::get_weight_format(
+    const std::string &tensor_name) const {
+    return this->get_mapped_tensor(tensor_name).weight_format;
+}
+
+size_t MappedTensorFile::get_nnz(const std::string &tensor_name) const {
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor(tensor_name);
+    return dense_nnz(
+        mapped_tensor.data, mapped_tensor.weight_format, mapped_tensor.extents,
+        element_strides(mapped_tensor),
+        prune_threshold_);
+}
+
+std::vector<int> MappedTensorFile::get_sparse_tensor_extents(
+    const std::string &tensor_name, dalotia_SparseFormat format) const {
+    if (is_derived_sparse_format(format)) {
+        return derived_sparse_extents(
+            this->load_reordered_csr_matrix(tensor_name,
+                                            this->get_weight_format(tensor_name)),
+            format, sparse_layout_);
+    }
+    return sparse_extents(
+        format, this->get_nnz(tensor_name),
+        sparse_num_rows(this->get_mapped_tensor(tensor_name).extents));
+}
+
+void MappedTensorFile::load_tensor_dense(const std::string &tensor_name,
+                                         dalotia_WeightFormat weightFormat,
+                                         dalotia_Ordering ordering,
+                                         dalotia_byte *__restrict__ tensor,
+                                         const std::vector<int> &permutation) {
+    this->load_mapped_tensor(tensor_name, this->get_mapped_tensor(tensor_name),
+                             weightFormat, ordering, tensor, permutation);
+}
+
+void MappedTensorFile::load_tensor_dense_by_index(
+    int index, dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+    dalotia_byte *__restrict__ tensor, const std::vector<int> &permutation) {
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor_at(index);
+    this->load_mapped_tensor(tensor_names_[index], mapped_tensor, weightFormat,
+                             ordering, tensor, permutation);
+}
+
+void MappedTensorFile::load_mapped_tensor(const std::string &tensor_name,
+                                          const MappedTensor &mapped_tensor,
+                                          dalotia_WeightFormat weightFormat,
+                                          dalotia_Ordering ordering,
+                                          dalotia_byte *__restrict__ tensor,
+                                          const std::vector<int> &permutation) {
+    LoadTimer timer(*instrumentation_, tensor_name);
+    const auto num_dimensions = mapped_tensor.extents.size();
+    const size_t num_elements =
+        std::accumulate(mapped_tensor.extents.begin(),
+                        mapped_tensor.extents.end(), size_t(1),
+                        std::multiplies<size_t>());
+
+    auto final_permutation_in_c_order =
+        final_c_permutation_from_permutation_and_order(permutation, ordering,
+                                                       num_dimensions);
+    if (!mapped_tensor.strides.empty()) {
+        // a view with gaps, gathered straight from where it lies; permuting
+        // it only permutes its strides
+        std::vector<int> extents = mapped_tensor.extents;
+        std::vector<size_t> strides = mapped_tensor.strides;
+        for (size_t d = 0; d < final_permutation_in_c_order.size(); ++d) {
+            extents[d] = mapped_tensor.extents[final_permutation_in_c_order[d]];
+            strides[d] = mapped_tensor.strides[final_permutation_in_c_order[d]];
+        }
+        timer.add_bytes(
+            num_elements * sizeof_weight_format(mapped_tensor.weight_format),
+            num_elements * sizeof_weight_format(weightFormat));
+        timer.phase(dalotia_permute_phase);
+        assign_strided(tensor, weightFormat, extents, mapped_tensor.data,
+                       mapped_tensor.weight_format, strides);
+        return;
+    }
+    std::vector<int> input_shape = mapped_tensor.extents;
+    if (!mapped_tensor.storage_order.empty()) {
+        // the payload has its dimensions in storage order, so translate the
+        // permutation to refer to those; e.g. F-ordered data loaded in F
+        // order thus ends up as a linear copy
+        std::vector<int> inverse_storage_order(num_dimensions);
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            input_shape[d] = mapped_tensor.extents[mapped_tensor.storage_order[d]];
+            inverse_storage_order[mapped_tensor.storage_order[d]] = d;
+        }
+        if (final_permutation_in_c_order.empty()) {
+            final_permutation_in_c_order.resize(num_dimensions);
+            std::iota(final_permutation_in_c_order.begin(),
+                      final_permutation_in_c_order.end(), 0);
+        }
+        for (auto &dimension : final_permutation_in_c_order) {
+            dimension = inverse_storage_order[dimension];
+        }
+        if (std::is_sorted(final_permutation_in_c_order.begin(),
+                           final_permutation_in_c_order.end())) {
+            final_permutation_in_c_order.clear();
+        }
+    }
+    const size_t num_bytes =
+        num_elements * sizeof_weight_format(mapped_tensor.weight_format);
+    timer.add_bytes(num_bytes,
+                    num_elements * sizeof_weight_format(weightFormat));
+    if (mapped_tensor.is_mapped) {
+        timer.fault_in(mapped_tensor.data, num_bytes);
+    }
+    if (!final_permutation_in_c_order.empty()) {
+        timer.phase(dalotia_permute_phase);
+        assign_permuted(num_dimensions, tensor, weightFormat,
+                        input_shape.data(), mapped_tensor.data,
+                        mapped_tensor.weight_format,
+                        final_permutation_in_c_order.data());
+    } else {
+        timer.phase(dalotia_convert_phase);
+        assign_linearly(tensor, weightFormat, num_elements,
+                        mapped_tensor.data, mapped_tensor.weight_format);
+    }
+}
+
+void MappedTensorFile::load_tensor_sparse(const std::string &tensor_name,
+                                          dalotia_SparseFormat sparseFormat,
+                                          dalotia_WeightFormat weightFormat,
+                                          dalotia_Ordering ordering,
+                                          dalotia_byte *__restrict__ values,
+                                          int *__restrict__ first_indices,
+                                          int *__restrict__ second_indices) {
+    if (ordering != dalotia_C_ordering) {
+        throw std::runtime_error(
+            "load_tensor_sparse: only C ordering is supported for " +
+            tensor_name);
+    }
+    LoadTimer timer(*instrumentation_, tensor_name);
+    if (is_derived_sparse_format(sparseFormat) || sparse_layout_.reorder_rcm) {
+        timer.phase(dalotia_convert_phase);
+        this->load_sparse_from_csr(tensor_name, sparseFormat, weightFormat,
+                                   values, first_indices, second_indices);
+        return;
+    }
+    // read straight from the payload, whatever its storage order
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor(tensor_name);
+    timer.phase(dalotia_convert_phase);
+    dense_to_sparse(
+        mapped_tensor.data, mapped_tensor.weight_format, mapped_tensor.extents,
+        element_strides(mapped_tensor),
+        prune_threshold_, sparseFormat, weightFormat, values, first_indices,
+        second_indices);
+}
+
+CsrMatrix MappedTensorFile::load_csr_matrix(
+    const std::string &tensor_name, dalotia_WeightFormat weightFormat) const {
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor(tensor_name);
+    CsrMatrix csr = allocate_csr_matrix(
+        mapped_tensor.extents, this->get_nnz(tensor_name), weightFormat);
+    dense_to_sparse(
+        mapped_tensor.data, mapped_tensor.weight_format, mapped_tensor.extents,
+        element_strides(mapped_tensor),
+        prune_threshold_, dalotia_CSR, weightFormat, csr.values.data(),
+        csr.row_ptr.data(), csr.col_idx.data());
+    return csr;
+}
+
+std::vector<const dalotia_byte *> MappedTensorFile::get_mmap_tensor_pointers(
+    const std::string &tensor_name) const {
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor(tensor_name);
+    if (!mapped_tensor.is_mapped || !mapped_tensor.strides.empty()) {
+        // not contiguous, only available as a view with its strides
+        return std::vector<const dalotia_byte *>();
+    }
+    return std::vector<const dalotia_byte *>(1, mapped_tensor.data);
+}
+
+TensorView MappedTensorFile::get_tensor_view(
+    const std::string &tensor_name) const {
+    const MappedTensor &mapped_tensor = this->get_mapped_tensor(tensor_name);
+    TensorView view;
+    if (mapped_tensor.is_mapped) {
+        view.data = mapped_tensor.data;
+        view.weight_format = mapped_tensor.weight_format;
+        view.extents = mapped_tensor.extents;
+        view.strides = element_strides(mapped_tensor);
+    }
+    return view;
+}
+
+}  // namespace dalotia
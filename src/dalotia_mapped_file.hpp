@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+   public:
+    explicit MappedFile(const std::string &filename);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator=(MappedFile &&) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] const dalotia_byte *data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+    [[nodiscard]] const std::string &filename() const { return filename_; }
+
+   private:
+    std::string filename_;
+    const dalotia_byte *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// a dense tensor whose payload is laid out contiguously somewhere in memory
+// -- either inside a mapped file or in a buffer owned by the TensorFile
+// (e.g. if the format stores it compressed or in a non-native encoding);
+// extents are always the logical extents; the payload is a C-ordered
+// tensor whose dimension d is the logical dimension storage_order[d]
+// (empty: C order, reversed: F order, other: e.g. a stored transposed view);
+// a view that is not contiguous (e.g. a slice) has its element strides per
+// logical dimension instead, and is gathered on load
+struct MappedTensor {
+    dalotia_WeightFormat weight_format;
+    std::vector<int> extents;
+    const dalotia_byte *data = nullptr;
+    bool is_mapped = true;
+    std::vector<int> storage_order;
+    std::vector<size_t> strides;  // empty unless the view has gaps
+};
+
+// common base for all backends that can resolve every tensor to a
+// MappedTensor at open time; the derived class only has to parse its index
+// and call add_tensor for each entry
+class MappedTensorFile : public TensorFile {
+   public:
+    explicit MappedTensorFile(const std::string &filename);
+
+    ~MappedTensorFile() override;
+
+    const std::vector<std::string> &get_tensor_names() const override;
+
+    bool is_sparse(const std::string &tensor_name) const override;
+
+    size_t get_num_dimensions(const std::string &tensor_name) const override;
+
+    size_t get_num_tensor_elements(const std::string &tensor_name) const override;
+
+    std::vector<int> get_tensor_extents(
+        const std::string &tensor_name = "",
+        const std::vector<int> &permutation = {}) const override;
+
+    dalotia_WeightFormat get_weight_format(
+        const std::string &tensor_name) const override;
+
+    // the tensors are dense, so these prune on load
+    size_t get_nnz(const std::string &tensor_name) const override;
+
+    std::vector<int> get_sparse_tensor_extents(
+        const std::string &tensor_name,
+        dalotia_SparseFormat format) const override;
+
+    void load_tensor_dense(const std::string &tensor_name,
+                           dalotia_WeightFormat weightFormat,
+                           dalotia_Ordering ordering,
+                           dalotia_byte *__restrict__ tensor,
+                           const std::vector<int> &permutation = {}) override;
+
+    void load_tensor_sparse(const std::string &tensor_name,
+                            dalotia_SparseFormat sparseFormat,
+                            dalotia_WeightFormat weightFormat,
+                            dalotia_Ordering ordering,
+                            dalotia_byte *__restrict__ values,
+                            int *__restrict__ first_indices,
+                            int *__restrict__ second_indices) override;
+
+    std::vector<const dalotia_byte *> get_mmap_tensor_pointers(
+        const std::string &tensor_name) const override;
+
+    // with the strides of the storage order
+    TensorView get_tensor_view(const std::string &tensor_name) const override;
+
+    // from the index built by add_tensor, and by index without the name
+    int get_tensor_index(const std::string &tensor_name) const override;
+
+    std::vector<int> get_tensor_extents_by_index(int index) const override;
+
+    dalotia_WeightFormat get_weight_format_by_index(int index) const override;
+
+    void load_tensor_dense_by_index(
+        int index, dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+        dalotia_byte *__restrict__ tensor,
+        const std::vector<int> &permutation = {}) override;
+
+   protected:
+    // maps the file on first use; the mapping lives as long as this object
+    const MappedFile &map_file(const std::string &filename);
+
+    // returns an uninitialized buffer that lives as long as this object
+    dalotia_byte *allocate_owned_buffer(size_t num_bytes);
+
+    void add_tensor(const std::string &tensor_name, MappedTensor tensor);
+
+    const MappedTensor &get_mapped_tensor(const std::string &tensor_name) const;
+
+    const MappedTensor &get_mapped_tensor_at(int index) const;
+
+    // the pruned tensor as CSR, from which BSR and SELL are derived
+    CsrMatrix load_csr_matrix(const std::string &tensor_name,
+                              dalotia_WeightFormat weightFormat) const override;
+
+    std::vector<std::string> tensor_names_;
+    std::vector<MappedTensor> tensors_;
+    std::unordered_map<std::string, size_t> tensor_positions_;
+
+   private:
+    void load_mapped_tensor(const std::string &tensor_name,
+                            const MappedTensor &mapped_tensor,
+                            dalotia_WeightFormat weightFormat,
+                            dalotia_Ordering ordering,
+                            dalotia_byte *__restrict__ tensor,
+                            const std::vector<int> &permutation);
+
+    std::map<std::string, std::unique_ptr<MappedFile>> mapped_files_;
+    std::vector<std::unique_ptr<dalotia_byte[]>> owned_buffers_;
+};
+
+}  // namespace dalotia
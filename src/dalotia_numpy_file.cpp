@@ -0,0 +1,217 @@
+#include "dalotia_numpy_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "dalotia_zip.hpp"
+
+namespace dalotia {
+
+namespace {
+// returns the position just after the colon following the quoted key
+size_t find_dict_value(const std::string &dict, const std::string &key) {
+    auto position = dict.find("'" + key + "'");
+    if (position == std::string::npos) {
+        throw std::runtime_error("dalotia NumpyFile: header has no " + key);
+    }
+    position = dict.find(':', position);
+    if (position == std::string::npos) {
+        throw std::runtime_error("dalotia NumpyFile: malformed header");
+    }
+    return dict.find_first_not_of(' ', position + 1);
+}
+
+// the archive member "name.npy" is the array "name", as in numpy.load
+bool strip_npy_suffix(std::string &name) {
+    const std::string suffix = ".npy";
+    if (name.size() < suffix.size() ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    name.erase(name.size() - suffix.size());
+    return true;
+}
+
+// fills the MappedTensor from the header, returns false if dalotia has no
+// weight format for its dtype
+bool tensor_from_npy(const NpyHeader &header, const dalotia_byte *data,
+                     size_t size, MappedTensor &tensor) {
+    if (header.descr.size() < 2) {
+        return false;
+    }
+    const char byte_order = header.descr[0];
+    auto type_iterator = numpy_type_map.find(header.descr.substr(1));
+    if (type_iterator == numpy_type_map.end()) {
+        return false;
+    }
+    tensor.weight_format = type_iterator->second;
+    if (byte_order == '>' && sizeof_weight_format(tensor.weight_format) > 1) {
+        throw std::runtime_error(
+            "dalotia NumpyFile: big-endian arrays are not supported");
+    }
+    tensor.extents = header.extents;
+    if (header.fortran_order && header.extents.size() > 1) {
+        tensor.storage_order.resize(header.extents.size());
+        std::iota(tensor.storage_order.rbegin(), tensor.storage_order.rend(), 0);
+    }
+    tensor.data = data + header.header_size;
+    const size_t num_bytes =
+        std::accumulate(header.extents.begin(), header.extents.end(),
+                        size_t(1), std::multiplies<size_t>()) *
+        sizeof_weight_format(tensor.weight_format);
+    if (header.header_size + num_bytes > size) {
+        throw std::runtime_error("dalotia NumpyFile: truncated payload");
+    }
+    return true;
+}
+}  // namespace
+
+NpyHeader parse_npy_header(const dalotia_byte *data, size_t size) {
+    const char magic[] = "\x93NUMPY";
+    if (size < 10 || std::memcmp(data, magic, 6) != 0) {
+        throw std::runtime_error("dalotia NumpyFile: not a .npy array");
+    }
+    const int major_version = data[6];
+    size_t dict_start, dict_length;
+    if (major_version == 1) {
+        uint16_t length;
+        std::memcpy(&length, data + 8, 2);
+        dict_start = 10;
+        dict_length = length;
+    } else {
+        if (size < 12) {
+            throw std::runtime_error("dalotia NumpyFile: truncated header");
+        }
+        uint32_t length;
+        std::memcpy(&length, data + 8, 4);
+        dict_start = 12;
+        dict_length = length;
+    }
+    if (dict_start + dict_length > size) {
+        throw std::runtime_error("dalotia NumpyFile: truncated header");
+    }
+    const std::string dict(reinterpret_cast<const char *>(data) + dict_start,
+                           dict_length);
+
+    NpyHeader header;
+    header.header_size = dict_start + dict_length;
+
+    auto position = find_dict_value(dict, "descr");
+    if (dict[position] != '\'') {
+        throw std::runtime_error(
+            "dalotia NumpyFile: structured dtypes are not supported");
+    }
+    const auto descr_end = dict.find('\'', position + 1);
+    header.descr = dict.substr(position + 1, descr_end - position - 1);
+
+    position = find_dict_value(dict, "fortran_order");
+    header.fortran_order = dict.compare(position, 4, "True") == 0;
+
+    position = find_dict_value(dict, "shape");
+    const auto shape_end = dict.find(')', position);
+    if (dict[position] != '(' || shape_end == std::string::npos) {
+        throw std::runtime_error("dalotia NumpyFile: malformed shape");
+    }
+    ++position;
+    while (position < shape_end) {
+        position = dict.find_first_not_of(", ", position);
+        if (position >= shape_end) {
+            break;
+        }
+        size_t parsed_characters;
+        header.extents.push_back(
+            std::stoi(dict.substr(position), &parsed_characters));
+        position += parsed_characters;
+    }
+    return header;
+}
+
+NumpyFile::NumpyFile(const std::string &filename) : MappedTensorFile(filename) {
+    std::string extension = filename.substr(filename.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   ::tolower);
+    if (extension == "npz") {
+        this->open_npz(filename);
+    } else {
+        this->open_npy(filename);
+    }
+}
+
+NumpyFile::~NumpyFile() = default;
+
+void NumpyFile::open_npy(const std::string &filename) {
+    const MappedFile &file = this->map_file(filename);
+    const NpyHeader header = parse_npy_header(file.data(), file.size());
+    MappedTensor tensor;
+    if (!tensor_from_npy(header, file.data(), file.size(), tensor)) {
+        throw std::runtime_error("dalotia NumpyFile: unsupported dtype " +
+                                 header.descr + " in " + filename);
+    }
+    // name the array after the file, like numpy.savez names its members
+    auto name_start = filename.find_last_of('/');
+    name_start = name_start == std::string::npos ? 0 : name_start + 1;
+    std::string tensor_name = filename.substr(name_start);
+    tensor_name.erase(tensor_name.find_last_of('.'));
+    this->add_tensor(tensor_name, std::move(tensor));
+}
+
+void NumpyFile::open_npz(const std::string &filename) {
+    const MappedFile &file = this->map_file(filename);
+    const ZipArchive archive(file.data(), file.size());
+
+    std::vector<const ZipArchive::Entry *> members;
+    std::vector<const dalotia_byte *> member_data;
+    std::vector<std::pair<const ZipArchive::Entry *, dalotia_byte *>> to_inflate;
+    for (const auto &entry : archive.entries()) {
+        std::string name = entry.name;
+        if (!strip_npy_suffix(name)) {
+            continue;
+        }
+        members.push_back(&entry);
+        if (entry.compression_method == ZipArchive::stored) {
+            member_data.push_back(entry.data);
+        } else {
+            dalotia_byte *buffer =
+                this->allocate_owned_buffer(entry.uncompressed_size);
+            member_data.push_back(buffer);
+            to_inflate.emplace_back(&entry, buffer);
+        }
+    }
+
+    // the members are independent deflate streams, so decompress them in
+    // parallel, each straight into its final buffer
+    std::string error;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < to_inflate.size(); ++i) {
+        try {
+            inflate_zip_entry(*to_inflate[i].first, to_inflate[i].second);
+        } catch (const std::exception &e) {
+#pragma omp critical
+            error = e.what();
+        }
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+
+    for (size_t i = 0; i < members.size(); ++i) {
+        const auto &entry = *members[i];
+        const NpyHeader header =
+            parse_npy_header(member_data[i], entry.uncompressed_size);
+        MappedTensor tensor;
+        if (!tensor_from_npy(header, member_data[i], entry.uncompressed_size,
+                             tensor)) {
+            // arrays of types dalotia cannot represent (e.g. int64 step
+            // counters) are not listed
+            continue;
+        }
+        tensor.is_mapped = entry.compression_method == ZipArchive::stored;
+        std::string tensor_name = entry.name;
+        strip_npy_suffix(tensor_name);
+        this->add_tensor(tensor_name, std::move(tensor));
+    }
+}
+
+}  // namespace dalotia
@@ -0,0 +1,56 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+
+namespace dalotia {
+
+// array-protocol type strings without the byte order character, cf.
+// https://numpy.org/doc/stable/reference/arrays.interface.html
+const std::map<std::string, dalotia_WeightFormat> numpy_type_map{
+    {"f8", dalotia_WeightFormat::dalotia_float_64},
+    {"f4", dalotia_WeightFormat::dalotia_float_32},
+    {"f2", dalotia_WeightFormat::dalotia_float_16},
+    {"u4", dalotia_WeightFormat::dalotia_uint_32},
+    {"u2", dalotia_WeightFormat::dalotia_uint_16},
+    {"u1", dalotia_WeightFormat::dalotia_uint_8},
+    {"i4", dalotia_WeightFormat::dalotia_int_32},
+    {"i2", dalotia_WeightFormat::dalotia_int_16},
+    {"i1", dalotia_WeightFormat::dalotia_int_8},
+    // {"i8", dalotia_WeightFormat::dalotia_int_64},
+    // {"u8", dalotia_WeightFormat::dalotia_uint_64},
+    // {"b1", dalotia_WeightFormat::dalotia_bool},
+};
+
+// the parsed header of a .npy file, cf.
+// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+struct NpyHeader {
+    std::string descr;  // e.g. "<f4"
+    bool fortran_order;
+    std::vector<int> extents;
+    size_t header_size;  // offset of the payload
+};
+
+NpyHeader parse_npy_header(const dalotia_byte *data, size_t size);
+
+// reads .npy files (one tensor, named after the file) and .npz archives
+// (one tensor per member); the payload of .npy files and of stored .npz
+// members is used in place, deflated .npz members are decompressed in
+// parallel at open time; fortran_order arrays are loaded through the
+// permutation machinery, such that F-ordered data loaded in F order is a
+// plain linear copy
+class NumpyFile : public MappedTensorFile {
+   public:
+    explicit NumpyFile(const std::string &filename);
+
+    ~NumpyFile() override;
+
+   private:
+    void open_npy(const std::string &filename);
+    void open_npz(const std::string &filename);
+};
+
+}  // namespace dalotia
@@ -0,0 +1,246 @@
+#include "dalotia_onnx_file.hpp"
+
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_protobuf.hpp"
+
+namespace dalotia {
+
+// field numbers, cf. https://github.com/onnx/onnx/blob/main/onnx/onnx.proto
+namespace onnx_field {
+constexpr uint32_t model_graph = 7;
+constexpr uint32_t graph_initializer = 5;
+constexpr uint32_t tensor_dims = 1;
+constexpr uint32_t tensor_data_type = 2;
+constexpr uint32_t tensor_float_data = 4;
+constexpr uint32_t tensor_int32_data = 5;
+constexpr uint32_t tensor_name = 8;
+constexpr uint32_t tensor_raw_data = 9;
+constexpr uint32_t tensor_double_data = 10;
+constexpr uint32_t tensor_uint64_data = 11;
+constexpr uint32_t tensor_external_data = 13;
+constexpr uint32_t tensor_data_location = 14;
+constexpr uint32_t string_entry_key = 1;
+constexpr uint32_t string_entry_value = 2;
+constexpr uint64_t data_location_external = 1;
+}  // namespace onnx_field
+
+OnnxFile::OnnxFile(const std::string &filename) : MappedTensorFile(filename) {
+    // external data locations are relative to the model file
+    const auto last_slash = filename.find_last_of('/');
+    const std::string model_directory =
+        last_slash == std::string::npos ? "." : filename.substr(0, last_slash);
+
+    const MappedFile &model = this->map_file(filename);
+    ProtobufReader model_reader(model.data(), model.data() + model.size());
+    while (model_reader.next_field()) {
+        if (model_reader.field_number() == onnx_field::model_graph &&
+            model_reader.wire_type() == ProtobufReader::length_delimited) {
+            this->parse_graph(model_directory,
+                              model_reader.read_length_delimited());
+        } else {
+            model_reader.skip_field();
+        }
+    }
+}
+
+OnnxFile::~OnnxFile() = default;
+
+void OnnxFile::parse_graph(const std::string &model_directory,
+                           ProtobufReader graph_reader) {
+    // nodes, inputs, outputs etc. are skipped by their length prefix,
+    // so the cost here depends on the number of initializers, not on the
+    // size of the graph
+    while (graph_reader.next_field()) {
+        if (graph_reader.field_number() == onnx_field::graph_initializer &&
+            graph_reader.wire_type() == ProtobufReader::length_delimited) {
+            this->parse_initializer(model_directory,
+                                    graph_reader.read_length_delimited());
+        } else {
+            graph_reader.skip_field();
+        }
+    }
+}
+
+void OnnxFile::parse_initializer(const std::string &model_directory,
+                                 ProtobufReader tensor_reader) {
+    std::string tensor_name;
+    int data_type = 0;
+    std::vector<int> extents;
+    bool has_raw_data = false;
+    ProtobufReader raw_data(nullptr, nullptr);
+    std::vector<ProtobufReader> packed_fixed_data;  // float_data, double_data
+    std::vector<dalotia_byte> unpacked_fixed_data;
+    std::vector<uint64_t> varint_data;  // int32_data, uint64_data
+    std::map<std::string, std::string> external_data;
+    bool is_external = false;
+
+    while (tensor_reader.next_field()) {
+        const auto wire_type = tensor_reader.wire_type();
+        switch (tensor_reader.field_number()) {
+            case onnx_field::tensor_dims:
+                if (wire_type == ProtobufReader::length_delimited) {
+                    auto packed = tensor_reader.read_length_delimited();
+                    while (!packed.at_end()) {
+                        extents.push_back(static_cast<int>(packed.read_varint()));
+                    }
+                } else {
+                    extents.push_back(static_cast<int>(tensor_reader.read_varint()));
+                }
+                break;
+            case onnx_field::tensor_data_type:
+                data_type = static_cast<int>(tensor_reader.read_varint());
+                break;
+            case onnx_field::tensor_name:
+                tensor_name = tensor_reader.read_string();
+                break;
+            case onnx_field::tensor_raw_data:
+                raw_data = tensor_reader.read_length_delimited();
+                has_raw_data = true;
+                break;
+            case onnx_field::tensor_float_data:
+            case onnx_field::tensor_double_data:
+                if (wire_type == ProtobufReader::length_delimited) {
+                    packed_fixed_data.push_back(
+                        tensor_reader.read_length_delimited());
+                } else if (wire_type == ProtobufReader::fixed32) {
+                    const uint32_t value = tensor_reader.read_fixed32();
+                    const auto *bytes = reinterpret_cast<const dalotia_byte *>(&value);
+                    unpacked_fixed_data.insert(unpacked_fixed_data.end(), bytes, bytes + 4);
+                } else {
+                    const uint64_t value = tensor_reader.read_fixed64();
+                    const auto *bytes = reinterpret_cast<const dalotia_byte *>(&value);
+                    unpacked_fixed_data.insert(unpacked_fixed_data.end(), bytes, bytes + 8);
+                }
+                break;
+            case onnx_field::tensor_int32_data:
+            case onnx_field::tensor_uint64_data:
+                if (wire_type == ProtobufReader::length_delimited) {
+                    auto packed = tensor_reader.read_length_delimited();
+                    while (!packed.at_end()) {
+                        varint_data.push_back(packed.read_varint());
+                    }
+                } else {
+                    varint_data.push_back(tensor_reader.read_varint());
+                }
+                break;
+            case onnx_field::tensor_external_data: {
+                auto entry = tensor_reader.read_length_delimited();
+                std::string key, value;
+                while (entry.next_field()) {
+                    if (entry.field_number() == onnx_field::string_entry_key) {
+                        key = entry.read_string();
+                    } else if (entry.field_number() ==
+                               onnx_field::string_entry_value) {
+                        value = entry.read_string();
+                    } else {
+                        entry.skip_field();
+                    }
+                }
+                external_data[key] = value;
+                break;
+            }
+            case onnx_field::tensor_data_location:
+                is_external = tensor_reader.read_varint() ==
+                              onnx_field::data_location_external;
+                break;
+            default:
+                tensor_reader.skip_field();
+        }
+    }
+
+    auto type_iterator = onnx_type_map.find(data_type);
+    if (type_iterator == onnx_type_map.end()) {
+        // initializers of types dalotia cannot represent (mostly int64
+        // shape constants for Reshape and the like) are not listed
+        return;
+    }
+    MappedTensor tensor;
+    tensor.weight_format = type_iterator->second;
+    tensor.extents = extents;
+    const size_t num_elements = std::accumulate(
+        extents.begin(), extents.end(), size_t(1), std::multiplies<size_t>());
+    const size_t item_bytes = sizeof_weight_format(tensor.weight_format);
+    const size_t num_bytes = num_elements * item_bytes;
+
+    if (is_external || !external_data.empty()) {
+        auto location = external_data.find("location");
+        if (location == external_data.end()) {
+            throw std::runtime_error("dalotia OnnxFile: tensor " + tensor_name +
+                                     " has external data without location");
+        }
+        size_t offset = 0;
+        if (auto it = external_data.find("offset"); it != external_data.end()) {
+            offset = std::stoull(it->second);
+        }
+        if (auto it = external_data.find("length"); it != external_data.end()) {
+            if (std::stoull(it->second) < num_bytes) {
+                throw std::runtime_error("dalotia OnnxFile: external data of " +
+                                         tensor_name + " is too short");
+            }
+        }
+        const MappedFile &data_file =
+            this->map_file(model_directory + "/" + location->second);
+        if (offset + num_bytes > data_file.size()) {
+            throw std::runtime_error("dalotia OnnxFile: external data of " +
+                                     tensor_name + " exceeds " +
+                                     data_file.filename());
+        }
+        tensor.data = data_file.data() + offset;
+    } else if (has_raw_data) {
+        if (raw_data.size() != num_bytes) {
+            throw std::runtime_error("dalotia OnnxFile: raw_data of " +
+                                     tensor_name + " has unexpected size");
+        }
+        tensor.data = raw_data.begin();
+    } else if (packed_fixed_data.size() == 1 && unpacked_fixed_data.empty()) {
+        if (packed_fixed_data.front().size() != num_bytes) {
+            throw std::runtime_error("dalotia OnnxFile: typed data of " +
+                                     tensor_name + " has unexpected size");
+        }
+        tensor.data = packed_fixed_data.front().begin();
+    } else if (!packed_fixed_data.empty() || !unpacked_fixed_data.empty()) {
+        // fragmented typed data, gather it once
+        dalotia_byte *buffer = this->allocate_owned_buffer(num_bytes);
+        size_t position = 0;
+        for (const auto &chunk : packed_fixed_data) {
+            if (position + chunk.size() > num_bytes) {
+                throw std::runtime_error("dalotia OnnxFile: typed data of " +
+                                         tensor_name + " has unexpected size");
+            }
+            std::memcpy(buffer + position, chunk.begin(), chunk.size());
+            position += chunk.size();
+        }
+        if (position + unpacked_fixed_data.size() != num_bytes) {
+            throw std::runtime_error("dalotia OnnxFile: typed data of " +
+                                     tensor_name + " has unexpected size");
+        }
+        std::memcpy(buffer + position, unpacked_fixed_data.data(),
+                    unpacked_fixed_data.size());
+        tensor.data = buffer;
+        tensor.is_mapped = false;
+    } else if (!varint_data.empty()) {
+        if (varint_data.size() != num_elements) {
+            throw std::runtime_error("dalotia OnnxFile: int32_data of " +
+                                     tensor_name + " has unexpected size");
+        }
+        // narrower types (incl. the bits of float16 / bfloat16) are stored
+        // in the low bytes of each varint
+        dalotia_byte *buffer = this->allocate_owned_buffer(num_bytes);
+        for (size_t i = 0; i < num_elements; ++i) {
+            std::memcpy(buffer + i * item_bytes, &varint_data[i], item_bytes);
+        }
+        tensor.data = buffer;
+        tensor.is_mapped = false;
+    } else if (num_elements != 0) {
+        throw std::runtime_error("dalotia OnnxFile: tensor " + tensor_name +
+                                 " has no data");
+    }
+    this->add_tensor(tensor_name, std::move(tensor));
+}
+
+}  // namespace dalotia
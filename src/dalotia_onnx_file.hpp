@@ -0,0 +1,47 @@
+#pragma once
+#include <map>
+#include <string>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+#include "dalotia_protobuf.hpp"
+
+namespace dalotia {
+
+// TensorProto.DataType, cf.
+// https://github.com/onnx/onnx/blob/main/onnx/onnx.proto
+const std::map<int, dalotia_WeightFormat> onnx_type_map{
+    {1, dalotia_WeightFormat::dalotia_float_32},    // FLOAT
+    {2, dalotia_WeightFormat::dalotia_uint_8},      // UINT8
+    {3, dalotia_WeightFormat::dalotia_int_8},       // INT8
+    {4, dalotia_WeightFormat::dalotia_uint_16},     // UINT16
+    {5, dalotia_WeightFormat::dalotia_int_16},      // INT16
+    {6, dalotia_WeightFormat::dalotia_int_32},      // INT32
+    // {7, dalotia_WeightFormat::dalotia_int_64},   // INT64
+    // {9, dalotia_WeightFormat::dalotia_bool},     // BOOL
+    {10, dalotia_WeightFormat::dalotia_float_16},   // FLOAT16
+    {11, dalotia_WeightFormat::dalotia_float_64},   // DOUBLE
+    {12, dalotia_WeightFormat::dalotia_uint_32},    // UINT32
+    // {13, dalotia_WeightFormat::dalotia_uint_64}, // UINT64
+    {16, dalotia_WeightFormat::dalotia_bfloat_16},  // BFLOAT16
+};
+
+// reads the initializers (= the trained weights) of an ONNX model with a
+// built-in protobuf parser, no ONNX runtime needed;
+// raw_data, packed float_data / double_data and external data are served
+// zero-copy from the mapped files, only the varint-encoded int32_data is
+// decoded into owned buffers at open time
+class OnnxFile : public MappedTensorFile {
+   public:
+    explicit OnnxFile(const std::string &filename);
+
+    ~OnnxFile() override;
+
+   private:
+    void parse_graph(const std::string &model_directory,
+                     ProtobufReader graph_reader);
+    void parse_initializer(const std::string &model_directory,
+                           ProtobufReader tensor_reader);
+};
+
+}  // namespace dalotia
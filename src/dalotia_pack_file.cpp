@@ -0,0 +1,103 @@
+#include "dalotia_pack_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace dalotia {
+
+namespace {
+template <typename T>
+T read_value(const dalotia_byte *data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));  // little endian
+    return value;
+}
+}  // namespace
+
+PackFile::PackFile(const std::string &filename) : MappedTensorFile(filename) {
+    const MappedFile &file = this->map_file(filename);
+    const dalotia_byte *data = file.data();
+    if (file.size() < pack_header_size ||
+        std::memcmp(data, pack_magic, sizeof(pack_magic)) != 0) {
+        throw std::runtime_error("dalotia PackFile: " + filename +
+                                 " is not a dalotia pack file");
+    }
+    const auto version = read_value<uint32_t>(data + 8);
+    if (version != pack_version) {
+        throw std::runtime_error("dalotia PackFile: unsupported version " +
+                                 std::to_string(version) + " of " + filename);
+    }
+    const auto num_tensors = read_value<uint32_t>(data + 12);
+    alignment_ = read_value<uint64_t>(data + 16);
+    const auto index_size = read_value<uint64_t>(data + 24);
+    if (index_size > file.size() - pack_header_size) {
+        throw std::runtime_error("dalotia PackFile: truncated index in " +
+                                 filename);
+    }
+
+    const dalotia_byte *entry = data + pack_header_size;
+    const dalotia_byte *const index_end = entry + index_size;
+    for (uint32_t t = 0; t < num_tensors; ++t) {
+        if (index_end - entry < static_cast<ptrdiff_t>(pack_index_entry_size)) {
+            throw std::runtime_error("dalotia PackFile: truncated index in " +
+                                     filename);
+        }
+        const auto offset = read_value<uint64_t>(entry);
+        const auto num_bytes = read_value<uint64_t>(entry + 8);
+        MappedTensor tensor;
+        tensor.weight_format = static_cast<dalotia_WeightFormat>(entry[16]);
+        const size_t num_dimensions = entry[17];
+        const auto name_length = read_value<uint16_t>(entry + 18);
+        entry += pack_index_entry_size;
+        if (static_cast<size_t>(index_end - entry) <
+            num_dimensions * 5 + name_length) {
+            throw std::runtime_error("dalotia PackFile: truncated index in " +
+                                     filename);
+        }
+        tensor.extents.resize(num_dimensions);
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            tensor.extents[d] = read_value<int32_t>(entry + 4 * d);
+            if (tensor.extents[d] < 0) {
+                throw std::runtime_error(
+                    "dalotia PackFile: negative extent in " + filename);
+            }
+        }
+        entry += 4 * num_dimensions;
+        tensor.storage_order.assign(entry, entry + num_dimensions);
+        entry += num_dimensions;
+        const std::string name(reinterpret_cast<const char *>(entry),
+                               name_length);
+        entry += name_length;
+
+        // the storage order has to be a permutation; C order is stored as
+        // the identity but kept empty
+        std::vector<int> sorted_order = tensor.storage_order;
+        std::sort(sorted_order.begin(), sorted_order.end());
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            if (sorted_order[d] != static_cast<int>(d)) {
+                throw std::runtime_error(
+                    "dalotia PackFile: invalid storage order for " + name);
+            }
+        }
+        if (std::is_sorted(tensor.storage_order.begin(),
+                           tensor.storage_order.end())) {
+            tensor.storage_order.clear();
+        }
+        const size_t num_elements =
+            std::accumulate(tensor.extents.begin(), tensor.extents.end(),
+                            size_t(1), std::multiplies<size_t>());
+        if (num_bytes != num_elements * sizeof_weight_format(tensor.weight_format) ||
+            offset > file.size() || num_bytes > file.size() - offset) {
+            throw std::runtime_error("dalotia PackFile: invalid payload for " +
+                                     name + " in " + filename);
+        }
+        tensor.data = data + offset;
+        this->add_tensor(name, std::move(tensor));
+    }
+}
+
+PackFile::~PackFile() = default;
+
+}  // namespace dalotia
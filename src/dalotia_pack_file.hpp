@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+
+namespace dalotia {
+
+// the dalotia pack format (.dalotia), little endian:
+//   header:  char magic[8] = "DALOTIA", uint32 version, uint32 num_tensors,
+//            uint64 alignment, uint64 index_size
+//   index:   per tensor, in payload order: uint64 offset, uint64 num_bytes,
+//            uint8 weight_format, uint8 num_dimensions, uint16 name_length,
+//            int32 extents[num_dimensions] (logical),
+//            uint8 storage_order[num_dimensions], char name[name_length]
+//   payload: each tensor starts at a multiple of the alignment, as a
+//            C-ordered tensor whose dimension d is the logical dimension
+//            storage_order[d] (cf. MappedTensor)
+constexpr char pack_magic[8] = {'D', 'A', 'L', 'O', 'T', 'I', 'A', '\0'};
+constexpr uint32_t pack_version = 1;
+constexpr size_t pack_header_size = 32;
+constexpr size_t pack_index_entry_size = 20;  // without extents and name
+
+// reads files written by PackFileWriter; every tensor is used in place, so
+// loading in the weight format, ordering and permutation it was packed with
+// is a plain memcpy, and get_mmap_tensor_pointers gives it zero-copy
+class PackFile : public MappedTensorFile {
+   public:
+    explicit PackFile(const std::string &filename);
+
+    ~PackFile() override;
+
+    // the alignment of the payloads in the file
+    [[nodiscard]] size_t get_alignment() const { return alignment_; }
+
+   private:
+    size_t alignment_ = 0;
+};
+
+}  // namespace dalotia
@@ -0,0 +1,108 @@
+#include "dalotia_pack_writer.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "dalotia_pack_file.hpp"
+
+namespace dalotia {
+
+namespace {
+template <typename T>
+void append_value(std::vector<dalotia_byte> &buffer, T value) {
+    const size_t position = buffer.size();
+    buffer.resize(position + sizeof(T));
+    std::memcpy(buffer.data() + position, &value, sizeof(T));  // little endian
+}
+
+size_t align_up(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+PackFileWriter::PackFileWriter(const std::string &filename, size_t alignment)
+    : TensorFileWriter(filename), alignment_(alignment) {
+    if (alignment_ < 64 || (alignment_ & (alignment_ - 1)) != 0) {
+        throw std::runtime_error(
+            "dalotia PackFileWriter: the alignment has to be a power of two "
+            "and at least 64");
+    }
+}
+
+PackFileWriter::~PackFileWriter() = default;
+
+std::vector<dalotia_byte> PackFileWriter::lay_out() {
+    // tensors added since the last write are written as they are in memory:
+    // the stored tensor is transposed by the permutation, so record the
+    // inverse as the storage order instead of applying it
+    for (size_t t = storage_orders_.size(); t < tensors_.size(); ++t) {
+        auto &tensor = tensors_[t];
+        std::vector<int> storage_order;
+        if (!tensor.permutation.empty()) {
+            storage_order.resize(tensor.permutation.size());
+            for (size_t d = 0; d < tensor.permutation.size(); ++d) {
+                storage_order[tensor.permutation[d]] = d;
+            }
+            tensor.permutation.clear();
+        }
+        logical_extents_.push_back(tensor.extents);
+        tensor.extents = tensor.input_shape;
+        storage_orders_.push_back(std::move(storage_order));
+    }
+    if (tensors_.size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("dalotia PackFileWriter: too many tensors");
+    }
+
+    std::vector<dalotia_byte> index;
+    std::vector<size_t> offset_positions(tensors_.size());
+    for (size_t t = 0; t < tensors_.size(); ++t) {
+        const auto &tensor = tensors_[t];
+        const auto &extents = logical_extents_[t];
+        if (extents.size() > std::numeric_limits<uint8_t>::max() ||
+            tensor.name.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::runtime_error(
+                "dalotia PackFileWriter: too many dimensions or too long name "
+                "for " + tensor.name);
+        }
+        offset_positions[t] = index.size();
+        append_value<uint64_t>(index, 0);  // filled in below
+        append_value<uint64_t>(index, tensor.num_elements *
+                                          sizeof_weight_format(tensor.output_format));
+        append_value<uint8_t>(index, tensor.output_format);
+        append_value<uint8_t>(index, extents.size());
+        append_value<uint16_t>(index, tensor.name.size());
+        for (const int extent : extents) {
+            append_value<int32_t>(index, extent);
+        }
+        for (size_t d = 0; d < extents.size(); ++d) {
+            append_value<uint8_t>(index, storage_orders_[t].empty()
+                                             ? d
+                                             : storage_orders_[t][d]);
+        }
+        index.insert(index.end(), tensor.name.begin(), tensor.name.end());
+    }
+
+    std::vector<dalotia_byte> header(pack_magic, pack_magic + sizeof(pack_magic));
+    append_value<uint32_t>(header, pack_version);
+    append_value<uint32_t>(header, tensors_.size());
+    append_value<uint64_t>(header, alignment_);
+    append_value<uint64_t>(header, index.size());
+
+    // payloads in the order the tensors were added, each one aligned
+    size_t offset = align_up(pack_header_size + index.size(), alignment_);
+    for (size_t t = 0; t < tensors_.size(); ++t) {
+        tensors_[t].offset = offset;
+        const uint64_t file_offset = offset;
+        std::memcpy(index.data() + offset_positions[t], &file_offset,
+                    sizeof(file_offset));
+        offset = align_up(offset + tensors_[t].num_elements *
+                                       sizeof_weight_format(tensors_[t].output_format),
+                          alignment_);
+    }
+    header.insert(header.end(), index.begin(), index.end());
+    return header;
+}
+
+}  // namespace dalotia
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file_writer.hpp"
+
+namespace dalotia {
+
+// writes the dalotia pack format (cf. dalotia_pack_file.hpp); unlike the
+// safetensors writer, a tensor added with an ordering or permutation is not
+// transposed back but written exactly as it is in memory, together with its
+// storage order -- loading it again with the same weight format, ordering
+// and permutation is then a memcpy (or zero-copy); the payloads are aligned
+// to `alignment` (e.g. 4 KiB pages or 2 MiB huge pages) and placed in the
+// order the tensors were added, which should be the order they are read in
+class PackFileWriter : public TensorFileWriter {
+   public:
+    static constexpr size_t default_alignment = size_t(4) << 10;
+    static constexpr size_t huge_page_alignment = size_t(2) << 20;
+
+    explicit PackFileWriter(const std::string &filename,
+                            size_t alignment = default_alignment);
+
+    ~PackFileWriter() override;
+
+   protected:
+    std::vector<dalotia_byte> lay_out() override;
+
+   private:
+    size_t alignment_;
+    std::vector<std::vector<int>> storage_orders_;  // per laid out tensor
+    std::vector<std::vector<int>> logical_extents_;
+};
+
+}  // namespace dalotia
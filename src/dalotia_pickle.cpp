@@ -0,0 +1,350 @@
+#include "dalotia_pickle.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace dalotia {
+
+bool PickleObject::is_call_to(const std::string &global_name) const {
+    return kind == call && items.size() == 2 &&
+           items[0]->kind == global && items[0]->string_value == global_name;
+}
+
+namespace {
+class Unpickler {
+   public:
+    Unpickler(const dalotia_byte *data, size_t size)
+        : position_(data), end_(data + size) {}
+
+    PickleValue run();
+
+   private:
+    template <typename T>
+    T read() {
+        this->check_available(sizeof(T));
+        T value;
+        std::memcpy(&value, position_, sizeof(T));  // little endian
+        position_ += sizeof(T);
+        return value;
+    }
+
+    std::string read_bytes(uint64_t num_bytes) {
+        this->check_available(num_bytes);
+        std::string bytes(reinterpret_cast<const char *>(position_), num_bytes);
+        position_ += num_bytes;
+        return bytes;
+    }
+
+    std::string read_line() {
+        const auto *newline = static_cast<const dalotia_byte *>(
+            std::memchr(position_, '\n', end_ - position_));
+        if (newline == nullptr) {
+            throw std::runtime_error("dalotia pickle: truncated line");
+        }
+        std::string line(reinterpret_cast<const char *>(position_),
+                         newline - position_);
+        position_ = newline + 1;
+        return line;
+    }
+
+    void check_available(uint64_t num_bytes) const {
+        if (num_bytes > static_cast<uint64_t>(end_ - position_)) {
+            throw std::runtime_error("dalotia pickle: truncated data");
+        }
+    }
+
+    PickleValue pop() {
+        if (stack_.empty()) {
+            throw std::runtime_error("dalotia pickle: stack underflow");
+        }
+        PickleValue value = std::move(stack_.back());
+        stack_.pop_back();
+        return value;
+    }
+
+    PickleValue &top() {
+        if (stack_.empty()) {
+            throw std::runtime_error("dalotia pickle: stack underflow");
+        }
+        return stack_.back();
+    }
+
+    // pops everything down to the topmost mark
+    std::vector<PickleValue> pop_to_mark() {
+        if (marks_.empty()) {
+            throw std::runtime_error("dalotia pickle: missing mark");
+        }
+        const size_t mark = marks_.back();
+        marks_.pop_back();
+        std::vector<PickleValue> items(
+            std::make_move_iterator(stack_.begin() + mark),
+            std::make_move_iterator(stack_.end()));
+        stack_.resize(mark);
+        return items;
+    }
+
+    void push(PickleObject::Kind kind, std::vector<PickleValue> items = {}) {
+        auto value = std::make_shared<PickleObject>();
+        value->kind = kind;
+        value->items = std::move(items);
+        stack_.push_back(std::move(value));
+    }
+
+    void push_integer(int64_t integer) {
+        auto value = std::make_shared<PickleObject>();
+        value->kind = PickleObject::integer;
+        value->integer_value = integer;
+        stack_.push_back(std::move(value));
+    }
+
+    void push_string(std::string string) {
+        auto value = std::make_shared<PickleObject>();
+        value->kind = PickleObject::string;
+        value->string_value = std::move(string);
+        stack_.push_back(std::move(value));
+    }
+
+    void push_global(const std::string &module, const std::string &name) {
+        auto value = std::make_shared<PickleObject>();
+        value->kind = PickleObject::global;
+        value->string_value = module + "." + name;
+        stack_.push_back(std::move(value));
+    }
+
+    // two's complement little endian, as written by LONG1 / LONG4
+    void push_long(uint64_t num_bytes) {
+        if (num_bytes > 8) {
+            throw std::runtime_error("dalotia pickle: integer too large");
+        }
+        const std::string bytes = this->read_bytes(num_bytes);
+        uint64_t value = 0;
+        for (size_t i = 0; i < num_bytes; ++i) {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[i]))
+                     << (8 * i);
+        }
+        if (num_bytes > 0 && num_bytes < 8 && (bytes.back() & 0x80)) {
+            value |= ~uint64_t(0) << (8 * num_bytes);
+        }
+        this->push_integer(static_cast<int64_t>(value));
+    }
+
+    static void check_kind(const PickleValue &value, PickleObject::Kind kind,
+                           const char *opcode_name) {
+        if (value->kind != kind) {
+            throw std::runtime_error(std::string("dalotia pickle: invalid ") +
+                                     opcode_name);
+        }
+    }
+
+    const dalotia_byte *position_;
+    const dalotia_byte *end_;
+    std::vector<PickleValue> stack_;
+    std::vector<size_t> marks_;
+    std::unordered_map<uint32_t, PickleValue> memo_;
+};
+
+PickleValue Unpickler::run() {
+    while (true) {
+        const auto opcode = this->read<uint8_t>();
+        switch (opcode) {
+            case 0x80:  // PROTO
+                this->read<uint8_t>();
+                break;
+            case 0x95:  // FRAME
+                this->read<uint64_t>();
+                break;
+            case '.':  // STOP
+                return this->pop();
+            case '(':  // MARK
+                marks_.push_back(stack_.size());
+                break;
+            case '0':  // POP
+                this->pop();
+                break;
+            case '1':  // POP_MARK
+                this->pop_to_mark();
+                break;
+            case '2':  // DUP
+                stack_.push_back(this->top());
+                break;
+            case 'N':  // NONE
+                this->push(PickleObject::none);
+                break;
+            case 0x88:  // NEWTRUE
+            case 0x89:  // NEWFALSE
+                this->push(PickleObject::boolean);
+                stack_.back()->integer_value = opcode == 0x88;
+                break;
+            case 'K':  // BININT1
+                this->push_integer(this->read<uint8_t>());
+                break;
+            case 'M':  // BININT2
+                this->push_integer(this->read<uint16_t>());
+                break;
+            case 'J':  // BININT
+                this->push_integer(this->read<int32_t>());
+                break;
+            case 0x8a:  // LONG1
+                this->push_long(this->read<uint8_t>());
+                break;
+            case 0x8b:  // LONG4
+                this->push_long(this->read<uint32_t>());
+                break;
+            case 'G': {  // BINFLOAT, big endian
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; ++i) {
+                    bits = (bits << 8) | this->read<uint8_t>();
+                }
+                this->push(PickleObject::floating);
+                std::memcpy(&stack_.back()->float_value, &bits, 8);
+                break;
+            }
+            case 'X':  // BINUNICODE
+            case 'T':  // BINSTRING
+            case 'B':  // BINBYTES
+                this->push_string(this->read_bytes(this->read<uint32_t>()));
+                break;
+            case 0x8c:  // SHORT_BINUNICODE
+            case 'U':   // SHORT_BINSTRING
+            case 'C':   // SHORT_BINBYTES
+                this->push_string(this->read_bytes(this->read<uint8_t>()));
+                break;
+            case 0x8d:  // BINUNICODE8
+            case 0x8e:  // BINBYTES8
+                this->push_string(this->read_bytes(this->read<uint64_t>()));
+                break;
+            case ')':  // EMPTY_TUPLE
+                this->push(PickleObject::tuple);
+                break;
+            case 't':  // TUPLE
+                this->push(PickleObject::tuple, this->pop_to_mark());
+                break;
+            case 0x85:  // TUPLE1
+            case 0x86:  // TUPLE2
+            case 0x87: {  // TUPLE3
+                const size_t num_items = opcode - 0x85 + 1;
+                if (stack_.size() < num_items) {
+                    throw std::runtime_error("dalotia pickle: stack underflow");
+                }
+                std::vector<PickleValue> items(
+                    std::make_move_iterator(stack_.end() - num_items),
+                    std::make_move_iterator(stack_.end()));
+                stack_.resize(stack_.size() - num_items);
+                this->push(PickleObject::tuple, std::move(items));
+                break;
+            }
+            case ']':   // EMPTY_LIST
+            case 0x8f:  // EMPTY_SET
+                this->push(PickleObject::list);
+                break;
+            case 'l':   // LIST
+            case 0x91:  // FROZENSET
+                this->push(PickleObject::list, this->pop_to_mark());
+                break;
+            case 'a': {  // APPEND
+                auto item = this->pop();
+                check_kind(this->top(), PickleObject::list, "APPEND");
+                this->top()->items.push_back(std::move(item));
+                break;
+            }
+            case 'e':     // APPENDS
+            case 0x90: {  // ADDITEMS
+                auto items = this->pop_to_mark();
+                check_kind(this->top(), PickleObject::list, "APPENDS");
+                auto &list = this->top()->items;
+                list.insert(list.end(), std::make_move_iterator(items.begin()),
+                            std::make_move_iterator(items.end()));
+                break;
+            }
+            case '}':  // EMPTY_DICT
+                this->push(PickleObject::dict);
+                break;
+            case 'd':  // DICT
+                this->push(PickleObject::dict, this->pop_to_mark());
+                break;
+            case 's': {  // SETITEM
+                auto value = this->pop();
+                auto key = this->pop();
+                check_kind(this->top(), PickleObject::dict, "SETITEM");
+                this->top()->items.push_back(std::move(key));
+                this->top()->items.push_back(std::move(value));
+                break;
+            }
+            case 'u': {  // SETITEMS
+                auto items = this->pop_to_mark();
+                check_kind(this->top(), PickleObject::dict, "SETITEMS");
+                if (items.size() % 2 != 0) {
+                    throw std::runtime_error("dalotia pickle: invalid SETITEMS");
+                }
+                auto &dict = this->top()->items;
+                dict.insert(dict.end(), std::make_move_iterator(items.begin()),
+                            std::make_move_iterator(items.end()));
+                break;
+            }
+            case 'c': {  // GLOBAL
+                const std::string module = this->read_line();
+                this->push_global(module, this->read_line());
+                break;
+            }
+            case 0x93: {  // STACK_GLOBAL
+                auto name = this->pop();
+                auto module = this->pop();
+                check_kind(name, PickleObject::string, "STACK_GLOBAL");
+                check_kind(module, PickleObject::string, "STACK_GLOBAL");
+                this->push_global(module->string_value, name->string_value);
+                break;
+            }
+            case 'R':     // REDUCE
+            case 0x81: {  // NEWOBJ
+                auto arguments = this->pop();
+                auto callable = this->pop();
+                check_kind(arguments, PickleObject::tuple, "REDUCE");
+                if (callable->kind == PickleObject::global &&
+                    callable->string_value == "collections.OrderedDict") {
+                    this->push(PickleObject::dict);
+                } else {
+                    this->push(PickleObject::call,
+                               {std::move(callable), std::move(arguments)});
+                }
+                break;
+            }
+            case 'b':  // BUILD: the state is not needed for tensors
+                this->pop();
+                break;
+            case 'Q':  // BINPERSID
+                this->push(PickleObject::persistent_id, {this->pop()});
+                break;
+            case 'q':  // BINPUT
+                memo_[this->read<uint8_t>()] = this->top();
+                break;
+            case 'r':  // LONG_BINPUT
+                memo_[this->read<uint32_t>()] = this->top();
+                break;
+            case 0x94:  // MEMOIZE
+                memo_[static_cast<uint32_t>(memo_.size())] = this->top();
+                break;
+            case 'h':  // BINGET
+            case 'j': {  // LONG_BINGET
+                const uint32_t index = opcode == 'h' ? this->read<uint8_t>()
+                                                     : this->read<uint32_t>();
+                auto iterator = memo_.find(index);
+                if (iterator == memo_.end()) {
+                    throw std::runtime_error("dalotia pickle: invalid memo index");
+                }
+                stack_.push_back(iterator->second);
+                break;
+            }
+            default:
+                throw std::runtime_error("dalotia pickle: unsupported opcode " +
+                                         std::to_string(opcode));
+        }
+    }
+}
+}  // namespace
+
+PickleValue unpickle(const dalotia_byte *data, size_t size) {
+    return Unpickler(data, size).run();
+}
+
+}  // namespace dalotia
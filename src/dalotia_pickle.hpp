@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+struct PickleObject;
+using PickleValue = std::shared_ptr<PickleObject>;
+
+// the value of an unpickled object; nothing is imported or called, a
+// REDUCE just records the callable and its arguments
+struct PickleObject {
+    enum Kind {
+        none,
+        boolean,
+        integer,
+        floating,
+        string,  // also bytes
+        tuple,
+        list,
+        dict,  // items are key, value, key, value, ...
+        global,  // string_value is "module.name"
+        call,  // items are callable, argument tuple
+        persistent_id,  // items[0] is the id
+    };
+
+    Kind kind = none;
+    int64_t integer_value = 0;
+    double float_value = 0.;
+    std::string string_value;
+    std::vector<PickleValue> items;
+
+    [[nodiscard]] bool is_call_to(const std::string &global_name) const;
+};
+
+// evaluates the subset of the pickle protocol (up to protocol 5) that is
+// used by torch.save for (nested) dicts of tensors, cf.
+// https://github.com/python/cpython/blob/main/Lib/pickletools.py
+// -- no Python needed; collections.OrderedDict() becomes an empty dict, all
+// other calls stay unevaluated PickleObject::call values
+PickleValue unpickle(const dalotia_byte *data, size_t size);
+
+}  // namespace dalotia
@@ -0,0 +1,92 @@
+#include "dalotia_protobuf.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace dalotia {
+
+bool ProtobufReader::next_field() {
+    if (this->at_end()) {
+        return false;
+    }
+    const uint64_t tag = this->read_varint();
+    field_number_ = static_cast<uint32_t>(tag >> 3);
+    wire_type_ = static_cast<WireType>(tag & 0x7);
+    return true;
+}
+
+uint64_t ProtobufReader::read_varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position_ >= end_) {
+            throw std::runtime_error("dalotia protobuf: truncated varint");
+        }
+        const dalotia_byte byte = *position_++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("dalotia protobuf: malformed varint");
+}
+
+uint32_t ProtobufReader::read_fixed32() {
+    if (this->size() < 4) {
+        throw std::runtime_error("dalotia protobuf: truncated fixed32");
+    }
+    uint32_t value;
+    std::memcpy(&value, position_, 4);  // wire format is little endian
+    position_ += 4;
+    return value;
+}
+
+uint64_t ProtobufReader::read_fixed64() {
+    if (this->size() < 8) {
+        throw std::runtime_error("dalotia protobuf: truncated fixed64");
+    }
+    uint64_t value;
+    std::memcpy(&value, position_, 8);
+    position_ += 8;
+    return value;
+}
+
+ProtobufReader ProtobufReader::read_length_delimited() {
+    const uint64_t length = this->read_varint();
+    if (length > this->size()) {
+        throw std::runtime_error(
+            "dalotia protobuf: length-delimited field exceeds message");
+    }
+    ProtobufReader payload(position_, position_ + length);
+    position_ += length;
+    return payload;
+}
+
+std::string ProtobufReader::read_string() {
+    auto payload = this->read_length_delimited();
+    return std::string(reinterpret_cast<const char *>(payload.begin()),
+                       payload.size());
+}
+
+void ProtobufReader::skip_field() {
+    switch (wire_type_) {
+        case varint:
+            this->read_varint();
+            break;
+        case fixed64:
+            this->read_fixed64();
+            break;
+        case length_delimited:
+            // only reads the length, so nested messages are skipped in O(1)
+            this->read_length_delimited();
+            break;
+        case fixed32:
+            this->read_fixed32();
+            break;
+        default:
+            throw std::runtime_error(
+                "dalotia protobuf: unsupported wire type " +
+                std::to_string(static_cast<int>(wire_type_)));
+    }
+}
+
+}  // namespace dalotia
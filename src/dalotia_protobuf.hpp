@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+// minimal reader for the protobuf wire format, cf.
+// https://protobuf.dev/programming-guides/encoding/
+// -- enough to walk messages field by field and extract scalars and
+// (zero-copy) byte ranges, without any generated code or libprotobuf
+class ProtobufReader {
+   public:
+    enum WireType : uint8_t {
+        varint = 0,
+        fixed64 = 1,
+        length_delimited = 2,
+        fixed32 = 5,
+    };
+
+    ProtobufReader(const dalotia_byte *begin, const dalotia_byte *end)
+        : position_(begin), end_(end) {}
+
+    // advances to the next field tag; returns false at the end of the message
+    bool next_field();
+
+    [[nodiscard]] uint32_t field_number() const { return field_number_; }
+    [[nodiscard]] WireType wire_type() const { return wire_type_; }
+
+    uint64_t read_varint();
+    uint32_t read_fixed32();
+    uint64_t read_fixed64();
+    // returns a reader over the payload of a length-delimited field
+    ProtobufReader read_length_delimited();
+    std::string read_string();
+    void skip_field();
+
+    [[nodiscard]] const dalotia_byte *begin() const { return position_; }
+    [[nodiscard]] const dalotia_byte *end() const { return end_; }
+    [[nodiscard]] size_t size() const {
+        return static_cast<size_t>(end_ - position_);
+    }
+    [[nodiscard]] bool at_end() const { return position_ >= end_; }
+
+   private:
+    const dalotia_byte *position_;
+    const dalotia_byte *end_;
+    uint32_t field_number_ = 0;
+    WireType wire_type_ = varint;
+};
+
+}  // namespace dalotia
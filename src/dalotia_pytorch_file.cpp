@@ -0,0 +1,238 @@
+#include "dalotia_pytorch_file.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace dalotia {
+
+namespace {
+const PickleObject &get_item(const PickleObject &tuple, size_t index,
+                             PickleObject::Kind kind) {
+    if (tuple.kind != PickleObject::tuple || index >= tuple.items.size() ||
+        tuple.items[index]->kind != kind) {
+        throw std::runtime_error(
+            "dalotia PytorchFile: unexpected arguments to _rebuild_tensor_v2");
+    }
+    return *tuple.items[index];
+}
+
+std::vector<int64_t> get_integers(const PickleObject &tuple) {
+    std::vector<int64_t> integers;
+    for (const auto &item : tuple.items) {
+        if (item->kind != PickleObject::integer) {
+            throw std::runtime_error(
+                "dalotia PytorchFile: non-integer tensor size or stride");
+        }
+        integers.push_back(item->integer_value);
+    }
+    return integers;
+}
+}  // namespace
+
+PytorchFile::PytorchFile(const std::string &filename)
+    : MappedTensorFile(filename), archive_(this->open_archive(filename)) {
+    const ZipArchive::Entry *pickle_entry = nullptr;
+    const std::string pickle_name = "data.pkl";
+    for (const auto &entry : archive_.entries()) {
+        entries_[entry.name] = &entry;
+        const auto &name = entry.name;
+        if (name.size() >= pickle_name.size() &&
+            name.compare(name.size() - pickle_name.size(), pickle_name.size(),
+                         pickle_name) == 0 &&
+            (name.size() == pickle_name.size() ||
+             name[name.size() - pickle_name.size() - 1] == '/')) {
+            pickle_entry = &entry;
+            archive_prefix_ = name.substr(0, name.size() - pickle_name.size());
+        }
+    }
+    if (pickle_entry == nullptr) {
+        throw std::runtime_error("dalotia PytorchFile: no data.pkl in " +
+                                 filename);
+    }
+    auto byteorder = entries_.find(archive_prefix_ + "byteorder");
+    if (byteorder != entries_.end() &&
+        byteorder->second->compression_method == ZipArchive::stored &&
+        std::string(reinterpret_cast<const char *>(byteorder->second->data),
+                    byteorder->second->uncompressed_size) == "big") {
+        throw std::runtime_error(
+            "dalotia PytorchFile: big-endian checkpoints are not supported");
+    }
+
+    const dalotia_byte *pickle_data = pickle_entry->data;
+    if (pickle_entry->compression_method != ZipArchive::stored) {
+        dalotia_byte *buffer =
+            this->allocate_owned_buffer(pickle_entry->uncompressed_size);
+        inflate_zip_entry(*pickle_entry, buffer);
+        pickle_data = buffer;
+    }
+    const PickleValue root =
+        unpickle(pickle_data, pickle_entry->uncompressed_size);
+    this->collect_tensors(root, "");
+
+    // the lookup tables are only needed while parsing
+    entries_.clear();
+    storages_.clear();
+}
+
+PytorchFile::~PytorchFile() = default;
+
+ZipArchive PytorchFile::open_archive(const std::string &filename) {
+    const MappedFile &file = this->map_file(filename);
+    if (file.size() < 2 || file.data()[0] != 'P' || file.data()[1] != 'K') {
+        throw std::runtime_error(
+            "dalotia PytorchFile: " + filename +
+            " is not a zip archive; only the torch.save format of "
+            "PyTorch >= 1.6 is supported");
+    }
+    return ZipArchive(file.data(), file.size());
+}
+
+void PytorchFile::collect_tensors(const PickleValue &value,
+                                  const std::string &name) {
+    if (value->kind == PickleObject::dict) {
+        // nested dicts (e.g. {"model": state_dict, "epoch": 3}) give
+        // dot-joined names, like in the state_dict itself
+        for (size_t i = 0; i + 1 < value->items.size(); i += 2) {
+            const auto &key = value->items[i];
+            if (key->kind != PickleObject::string) {
+                continue;
+            }
+            this->collect_tensors(value->items[i + 1],
+                                  name.empty() ? key->string_value
+                                               : name + "." + key->string_value);
+        }
+    } else if (value->is_call_to("torch._utils._rebuild_parameter")) {
+        const auto &arguments = *value->items[1];
+        if (!arguments.items.empty()) {
+            this->collect_tensors(arguments.items[0], name);
+        }
+    } else if (value->is_call_to("torch._utils._rebuild_tensor_v2")) {
+        this->add_rebuilt_tensor(name, *value->items[1]);
+    }
+    // everything else (optimizer settings, epoch counters, ...) is ignored
+}
+
+// _rebuild_tensor_v2(storage, storage_offset, size, stride, ...), where
+// storage is the persistent id
+// ("storage", storage_type, key, location, numel)
+void PytorchFile::add_rebuilt_tensor(const std::string &tensor_name,
+                                     const PickleObject &arguments) {
+    const auto &persistent_id =
+        get_item(arguments, 0, PickleObject::persistent_id);
+    const auto &storage_id = *persistent_id.items[0];
+    const auto &storage_type = get_item(storage_id, 1, PickleObject::global);
+    const auto &storage_key = get_item(storage_id, 2, PickleObject::string);
+    const auto storage_offset =
+        get_item(arguments, 1, PickleObject::integer).integer_value;
+    const auto sizes = get_integers(get_item(arguments, 2, PickleObject::tuple));
+    const auto strides =
+        get_integers(get_item(arguments, 3, PickleObject::tuple));
+    if (sizes.size() != strides.size()) {
+        throw std::runtime_error("dalotia PytorchFile: size and stride of " +
+                                 tensor_name + " do not match");
+    }
+
+    auto type_iterator = pytorch_storage_type_map.find(storage_type.string_value);
+    if (type_iterator == pytorch_storage_type_map.end()) {
+        // tensors of types dalotia cannot represent (e.g. int64
+        // num_batches_tracked) are not listed
+        return;
+    }
+    MappedTensor tensor;
+    tensor.weight_format = type_iterator->second;
+    const size_t element_size = sizeof_weight_format(tensor.weight_format);
+    const size_t num_dimensions = sizes.size();
+    tensor.extents.assign(sizes.begin(), sizes.end());
+    const size_t num_elements =
+        std::accumulate(sizes.begin(), sizes.end(), size_t(1),
+                        std::multiplies<size_t>());
+
+    const Storage &storage = this->get_storage(storage_key.string_value);
+    size_t last_element = storage_offset;
+    for (size_t d = 0; d < num_dimensions; ++d) {
+        if (sizes[d] < 0 || strides[d] < 0) {
+            throw std::runtime_error("dalotia PytorchFile: invalid layout of " +
+                                     tensor_name);
+        }
+        if (sizes[d] > 0) {
+            last_element += (sizes[d] - 1) * strides[d];
+        }
+    }
+    if (num_elements > 0 && (last_element + 1) * element_size > storage.num_bytes) {
+        throw std::runtime_error("dalotia PytorchFile: " + tensor_name +
+                                 " exceeds its storage");
+    }
+    const dalotia_byte *tensor_start =
+        storage.data + storage_offset * element_size;
+
+    // order the dimensions by decreasing stride; the view is dense if the
+    // strides then are those of a C-ordered tensor
+    std::vector<int> storage_order;
+    for (size_t d = 0; d < num_dimensions; ++d) {
+        if (sizes[d] == 1) {
+            storage_order.push_back(d);  // any stride, put them first
+        }
+    }
+    const size_t num_unit_dimensions = storage_order.size();
+    for (size_t d = 0; d < num_dimensions; ++d) {
+        if (sizes[d] != 1) {
+            storage_order.push_back(d);
+        }
+    }
+    std::stable_sort(storage_order.begin() + num_unit_dimensions,
+                     storage_order.end(), [&strides](int a, int b) {
+                         return strides[a] > strides[b];
+                     });
+    bool is_dense = true;
+    int64_t expected_stride = 1;
+    for (size_t i = num_dimensions; i > num_unit_dimensions; --i) {
+        const int d = storage_order[i - 1];
+        is_dense &= strides[d] == expected_stride;
+        expected_stride *= sizes[d];
+    }
+
+    if (is_dense || num_elements == 0) {
+        // unit dimensions in front do not change a C-ordered layout
+        if (!std::is_sorted(storage_order.begin() + num_unit_dimensions,
+                            storage_order.end())) {
+            tensor.storage_order = std::move(storage_order);
+        }
+        tensor.data = tensor_start;
+        tensor.is_mapped = storage.is_mapped;
+    } else {
+        // e.g. a slice with gaps: kept in place with its strides, and
+        // gathered when it is loaded
+        tensor.strides.assign(strides.begin(), strides.end());
+        tensor.data = tensor_start;
+        tensor.is_mapped = storage.is_mapped;
+    }
+    this->add_tensor(tensor_name, std::move(tensor));
+}
+
+const PytorchFile::Storage &PytorchFile::get_storage(const std::string &key) {
+    // several tensors may share a storage (tied weights, views)
+    auto storage_iterator = storages_.find(key);
+    if (storage_iterator != storages_.end()) {
+        return storage_iterator->second;
+    }
+    auto entry_iterator = entries_.find(archive_prefix_ + "data/" + key);
+    if (entry_iterator == entries_.end()) {
+        throw std::runtime_error("dalotia PytorchFile: storage " + key +
+                                 " not found in archive");
+    }
+    const ZipArchive::Entry &entry = *entry_iterator->second;
+    Storage storage{entry.data, entry.uncompressed_size, true};
+    if (entry.compression_method != ZipArchive::stored) {
+        // torch.save writes storages uncompressed, but re-zipped archives
+        // may not be
+        dalotia_byte *buffer =
+            this->allocate_owned_buffer(entry.uncompressed_size);
+        inflate_zip_entry(entry, buffer);
+        storage.data = buffer;
+        storage.is_mapped = false;
+    }
+    return storages_.emplace(key, storage).first->second;
+}
+
+}  // namespace dalotia
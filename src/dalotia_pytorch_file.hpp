@@ -0,0 +1,60 @@
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+#include "dalotia_pickle.hpp"
+#include "dalotia_zip.hpp"
+
+namespace dalotia {
+
+// the typed storage classes referenced by torch.save, cf.
+// https://pytorch.org/docs/stable/storage.html
+const std::map<std::string, dalotia_WeightFormat> pytorch_storage_type_map{
+    {"torch.DoubleStorage", dalotia_WeightFormat::dalotia_float_64},
+    {"torch.FloatStorage", dalotia_WeightFormat::dalotia_float_32},
+    {"torch.HalfStorage", dalotia_WeightFormat::dalotia_float_16},
+    {"torch.BFloat16Storage", dalotia_WeightFormat::dalotia_bfloat_16},
+    {"torch.IntStorage", dalotia_WeightFormat::dalotia_int_32},
+    {"torch.ShortStorage", dalotia_WeightFormat::dalotia_int_16},
+    {"torch.CharStorage", dalotia_WeightFormat::dalotia_int_8},
+    {"torch.ByteStorage", dalotia_WeightFormat::dalotia_uint_8},
+    // {"torch.LongStorage", dalotia_WeightFormat::dalotia_int_64},
+    // {"torch.BoolStorage", dalotia_WeightFormat::dalotia_bool},
+};
+
+// reads the tensors of a torch.save zip archive (.pt / .pth / .bin) without
+// Python: data.pkl is evaluated by a minimal unpickler, every
+// _rebuild_tensor_v2 call found in (nested) dicts becomes a tensor named by
+// its dot-joined keys; storages are used in place from the mapped archive,
+// and strided views are served through the permutation machinery if they
+// are dense (e.g. a saved transposed weight), or kept with their strides
+// and gathered on load if not (e.g. a slice)
+class PytorchFile : public MappedTensorFile {
+   public:
+    explicit PytorchFile(const std::string &filename);
+
+    ~PytorchFile() override;
+
+   private:
+    struct Storage {
+        const dalotia_byte *data;
+        size_t num_bytes;
+        bool is_mapped;
+    };
+
+    ZipArchive open_archive(const std::string &filename);
+    void collect_tensors(const PickleValue &value, const std::string &name);
+    void add_rebuilt_tensor(const std::string &tensor_name,
+                            const PickleObject &arguments);
+    const Storage &get_storage(const std::string &key);
+
+    ZipArchive archive_;
+    std::string archive_prefix_;  // torch.save puts everything in one folder
+    std::unordered_map<std::string, const ZipArchive::Entry *> entries_;
+    std::unordered_map<std::string, Storage> storages_;
+};
+
+}  // namespace dalotia
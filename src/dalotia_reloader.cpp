@@ -0,0 +1,177 @@
+#include "dalotia_reloader.hpp"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "dalotia.hpp"
+
+namespace dalotia {
+
+namespace {
+constexpr size_t hash_chunk_size = size_t(1) << 20;
+constexpr uint64_t hash_prime = 0x100000001b3ULL;  // of FNV-1a
+constexpr uint64_t hash_basis = 0xcbf29ce484222325ULL;
+
+// FNV-1a over 8-byte words, with a final avalanche
+uint64_t hash_chunk(const dalotia_byte *data, size_t num_bytes) {
+    uint64_t hash = hash_basis ^ num_bytes;
+    size_t i = 0;
+    for (; i + 8 <= num_bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * hash_prime;
+    }
+    for (; i < num_bytes; ++i) {
+        hash = (hash ^ data[i]) * hash_prime;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+}  // namespace
+
+FileVersion get_file_version(const std::string &filename) {
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) != 0) {
+        throw std::runtime_error("dalotia: could not stat file " + filename);
+    }
+    FileVersion version;
+    version.device = static_cast<uint64_t>(file_stat.st_dev);
+    version.inode = static_cast<uint64_t>(file_stat.st_ino);
+    version.size = static_cast<uint64_t>(file_stat.st_size);
+    version.modified_ns =
+        static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1000000000 +
+        file_stat.st_mtim.tv_nsec;
+    return version;
+}
+
+uint64_t hash_bytes(const dalotia_byte *data, size_t num_bytes) {
+    const auto num_chunks = static_cast<long>(
+        (num_bytes + hash_chunk_size - 1) / hash_chunk_size);
+    std::vector<uint64_t> chunk_hashes(num_chunks);
+#pragma omp parallel for schedule(static)
+    for (long c = 0; c < num_chunks; ++c) {
+        const size_t begin = c * hash_chunk_size;
+        chunk_hashes[c] = hash_chunk(
+            data + begin, std::min(hash_chunk_size, num_bytes - begin));
+    }
+    uint64_t hash = hash_basis ^ num_bytes;
+    for (const uint64_t chunk_hash : chunk_hashes) {
+        hash = (hash ^ chunk_hash) * hash_prime;
+    }
+    return hash;
+}
+
+TensorFileReloader::TensorFileReloader(const std::string &filename,
+                                       bool compare_contents)
+    : filename_(filename),
+      compare_contents_(compare_contents),
+      // before opening: if the file changes meanwhile, the next reload
+      // sees a new version
+      version_(get_file_version(filename)),
+      file_(make_tensor_file(filename)) {}
+
+TensorFileReloader::~TensorFileReloader() = default;
+
+std::shared_ptr<TensorFile> TensorFileReloader::get_file() const {
+    std::lock_guard<std::mutex> lock(file_mutex_);
+    return file_;
+}
+
+void TensorFileReloader::hash_stored(const TensorFile &file,
+                                     WatchedTensor &tensor) const {
+    tensor.hashed = false;
+    if (!compare_contents_) {
+        return;
+    }
+    const TensorView view = file.get_tensor_view(tensor.name);
+    if (view.data == nullptr) {
+        return;
+    }
+    // the bytes of the tensor are contiguous unless the view has gaps
+    const size_t num_elements = file.get_num_tensor_elements(tensor.name);
+    if (num_elements > 0) {
+        size_t span = 1;
+        for (size_t d = 0; d < view.extents.size(); ++d) {
+            span += (view.extents[d] - 1) * view.strides[d];
+        }
+        if (span != num_elements) {
+            return;
+        }
+    }
+    tensor.hash = hash_bytes(
+        view.data, num_elements * sizeof_weight_format(view.weight_format));
+    tensor.hashed = true;
+}
+
+void TensorFileReloader::add_tensor(const std::string &tensor_name,
+                                    dalotia_WeightFormat weight_format,
+                                    dalotia_byte *tensor,
+                                    dalotia_Ordering ordering,
+                                    const std::vector<int> &permutation) {
+    const auto file = this->get_file();
+    WatchedTensor watched{tensor_name,
+                          weight_format,
+                          tensor,
+                          ordering,
+                          permutation,
+                          file->get_tensor_extents(tensor_name),
+                          file->get_weight_format(tensor_name)};
+    file->load_tensor_dense(tensor_name, weight_format, ordering, tensor,
+                            permutation);
+    this->hash_stored(*file, watched);
+    tensors_.push_back(std::move(watched));
+}
+
+bool TensorFileReloader::has_changed() const {
+    return get_file_version(filename_) != version_;
+}
+
+std::vector<std::string> TensorFileReloader::reload() {
+    const FileVersion version = get_file_version(filename_);
+    if (version == version_) {
+        return {};
+    }
+    std::shared_ptr<TensorFile> file(make_tensor_file(filename_));
+
+    // check everything before touching the buffers
+    std::vector<WatchedTensor> reloaded = tensors_;
+    for (auto &tensor : reloaded) {
+        if (file->get_tensor_extents(tensor.name) != tensor.extents) {
+            throw std::runtime_error("dalotia reload: the extents of " +
+                                     tensor.name + " changed in " +
+                                     filename_);
+        }
+        tensor.stored_format = file->get_weight_format(tensor.name);
+        this->hash_stored(*file, tensor);
+    }
+
+    std::vector<std::string> changed;
+    for (size_t i = 0; i < reloaded.size(); ++i) {
+        auto &tensor = reloaded[i];
+        if (tensor.hashed && tensors_[i].hashed &&
+            tensor.stored_format == tensors_[i].stored_format &&
+            tensor.hash == tensors_[i].hash) {
+            continue;
+        }
+        file->load_tensor_dense(tensor.name, tensor.weight_format,
+                                tensor.ordering, tensor.buffer,
+                                tensor.permutation);
+        changed.push_back(tensor.name);
+    }
+
+    tensors_ = std::move(reloaded);
+    version_ = version;
+    {
+        std::lock_guard<std::mutex> lock(file_mutex_);
+        file_.swap(file);
+    }
+    // the old version is unmapped here, unless a reader still holds it
+    return changed;
+}
+
+}  // namespace dalotia
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// identifies a version of a file on disk: rewriting the file or replacing
+// it by a rename gives a new one
+struct FileVersion {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t size = 0;
+    int64_t modified_ns = 0;
+
+    bool operator==(const FileVersion &other) const {
+        return device == other.device && inode == other.inode &&
+               size == other.size && modified_ns == other.modified_ns;
+    }
+    bool operator!=(const FileVersion &other) const { return !(*this == other); }
+};
+
+// stat of the file; throws if it does not exist
+FileVersion get_file_version(const std::string &filename);
+
+// 64-bit hash of the bytes, hashed in chunks in parallel; the result does
+// not depend on the number of threads
+uint64_t hash_bytes(const dalotia_byte *data, size_t num_bytes);
+
+// keeps a checkpoint that is rewritten periodically (e.g. by a coupled
+// training run) loaded into the caller's buffers: the tensors are added
+// once with their buffer, and reload() checks if the file has a new
+// version (by stat) and, if so, opens it and loads only those tensors
+// whose stored bytes changed into their buffers -- with compare_contents,
+// by a hash of the stored bytes of the mapped tensor, without (or if the
+// backend does not map the tensor) every added tensor is reloaded.
+// The files are shared: a reader that got a file from get_file() keeps it,
+// and with it its mapping and zero-copy views, valid until it lets go.
+// The new version is checked completely before any buffer is written, so
+// a failed reload leaves the buffers and the current file as they were.
+// Writers have to write a new file and rename it over the old one, as
+// dalotia's TensorFileWriter does; a file rewritten in place may be read
+// half-written or invalidate the old mapping; for a sharded checkpoint,
+// the version is the one of the index file.
+// get_file() may be called concurrently, add_tensor and reload not, and
+// the buffers must not be read while reload() writes them
+class TensorFileReloader {
+   public:
+    explicit TensorFileReloader(const std::string &filename,
+                                bool compare_contents = true);
+
+    TensorFileReloader(const TensorFileReloader &) = delete;
+    TensorFileReloader &operator=(const TensorFileReloader &) = delete;
+
+    ~TensorFileReloader();
+
+    // the current version
+    [[nodiscard]] std::shared_ptr<TensorFile> get_file() const;
+
+    // loads the tensor into the buffer, and again whenever it changes; the
+    // buffer has to stay valid as long as this object
+    void add_tensor(const std::string &tensor_name,
+                    dalotia_WeightFormat weight_format, dalotia_byte *tensor,
+                    dalotia_Ordering ordering = dalotia_C_ordering,
+                    const std::vector<int> &permutation = {});
+
+    // for contiguous ranges of float or double, as TensorFile::load_into
+    template <typename Range>
+    void add_tensor(const std::string &tensor_name, Range &tensor,
+                    dalotia_Ordering ordering = dalotia_C_ordering,
+                    const std::vector<int> &permutation = {}) {
+        using value_type = std::remove_cv_t<
+            std::remove_reference_t<decltype(*std::data(tensor))>>;
+        if (std::size(tensor) !=
+            this->get_file()->get_num_tensor_elements(tensor_name)) {
+            throw std::runtime_error("add_tensor: the buffer for " +
+                                     tensor_name +
+                                     " does not fit the tensor");
+        }
+        this->add_tensor(tensor_name, weight_format_of<value_type>(),
+                         reinterpret_cast<dalotia_byte *>(std::data(tensor)),
+                         ordering, permutation);
+    }
+
+    // true if the file on disk is not the version loaded
+    [[nodiscard]] bool has_changed() const;
+
+    // the names of the tensors that were reloaded; empty if the file did
+    // not change
+    std::vector<std::string> reload();
+
+   private:
+    struct WatchedTensor {
+        std::string name;
+        dalotia_WeightFormat weight_format;
+        dalotia_byte *buffer;
+        dalotia_Ordering ordering;
+        std::vector<int> permutation;
+        std::vector<int> extents;  // as stored
+        dalotia_WeightFormat stored_format;
+        bool hashed = false;  // false if the tensor is not mapped
+        uint64_t hash = 0;
+    };
+
+    // hashes the stored bytes of the tensor, if they are mapped
+    void hash_stored(const TensorFile &file, WatchedTensor &tensor) const;
+
+    std::string filename_;
+    bool compare_contents_;
+    FileVersion version_;
+    mutable std::mutex file_mutex_;
+    std::shared_ptr<TensorFile> file_;
+    std::vector<WatchedTensor> tensors_;
+};
+
+}  // namespace dalotia
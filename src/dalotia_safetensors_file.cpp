@@ -2,99 +2,206 @@
 
 #include <algorithm>
 #include <cassert>
-#include <iostream>
+#include <cstring>
+#include <set>
 
 #include "dalotia_assignment.hpp"
 #include "dalotia_formats.hpp"
-#include "safetensors.hh"
+#include "dalotia_sparse.hpp"
 
 namespace dalotia {
 
-safetensors::tensor_t get_only_tensor(const safetensors::safetensors_t &st) {
-    safetensors::tensor_t tensor;
-    assert(st.tensors.size() == 1);
-    st.tensors.at(0, &tensor);
-    return tensor;
-}
+namespace {
+const std::vector<std::string> bitmask_suffixes{".shape", ".compressed",
+                                                ".bitmask", ".row_offsets"};
+}  // namespace
 
-safetensors::tensor_t get_tensor_from_name(
-    const std::string &tensor_name, const safetensors::safetensors_t &st) {
-    if (tensor_name.empty()) {
-        return get_only_tensor(st);
-    }
-    for (size_t i = 0; i < st.tensors.size(); i++) {
-        std::string key = st.tensors.keys()[i];
-        if (key == tensor_name) {
-            safetensors::tensor_t tensor;
-            st.tensors.at(i, &tensor);
-            return tensor;
+SafetensorsFile::SafetensorsFile(const std::string &filename)
+    : TensorFile(filename),
+      file_(filename),
+      header_json_(SafetensorsHeader::header_of(file_.data(), file_.size())),
+      header_(header_json_) {
+    // as far as I can tell, safetensors are saved in C order
+    const size_t header_end = sizeof(uint64_t) + header_json_.size();
+    data_ = file_.data() + header_end;
+    data_size_ = file_.size() - header_end;
+    // the offsets are checked right away, the shapes on use
+    for (const auto &entry : header_.entries()) {
+        if (entry.end > data_size_) {
+            throw std::runtime_error("Invalid safetensors file " + filename +
+                                     ": data_offsets of " +
+                                     std::string(entry.name) +
+                                     " beyond the end of the file");
         }
     }
 
-    const std::string joined_keys =
-            std::accumulate(st.tensors.keys().begin(),
-                            st.tensors.keys().end(),
-                            std::string(),
-                            [](const std::string& a, const std::string& b)
-                                    -> std::string {
-                                    return a + (a.length() > 0 ? "," : "") + b;
-                                }
-                            );
-
-    throw std::runtime_error("Tensor " + tensor_name + " not found; available: " +
-                             joined_keys);
+    // find the bitmask-compressed tensors
+    for (const auto &entry : header_.entries()) {
+        if (!ends_with(entry.name, ".bitmask")) {
+            continue;
+        }
+        const std::string name(entry.name.substr(0, entry.name.size() - 8));
+        const auto *values = header_.find(name + ".compressed");
+        const auto *shape = header_.find(name + ".shape");
+        if (values == nullptr || shape == nullptr) {
+            continue;
+        }
+        if ((shape->dtype != "I64" && shape->dtype != "I32") ||
+            safetensors_dtype_map.count(values->dtype) == 0) {
+            throw std::runtime_error("dalotia SafetensorsFile: unsupported dtype "
+                                     "in the bitmask compression of " + name);
+        }
+        BitmaskTensor bitmask_tensor;
+        bitmask_tensor.bitmask = this->get_stored_tensor(entry);
+        bitmask_tensor.values = this->get_stored_tensor(*values);
+        // the shape is an integer tensor dalotia does not load otherwise
+        const size_t shape_bytes = shape->dtype == "I64" ? 8 : 4;
+        const auto shape_extents = SafetensorsHeader::parse_shape(*shape);
+        const size_t num_dimensions =
+            shape_extents.empty() ? 1 : shape_extents.front();
+        if (shape_extents.size() > 1 ||
+            shape->end - shape->begin != num_dimensions * shape_bytes) {
+            throw std::runtime_error(
+                "dalotia SafetensorsFile: invalid shape tensor of " + name);
+        }
+        const dalotia_byte *shape_data = data_ + shape->begin;
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            int64_t extent = 0;
+            if (shape_bytes == 8) {
+                std::memcpy(&extent, shape_data + 8 * d, 8);
+            } else {
+                int32_t extent_32;
+                std::memcpy(&extent_32, shape_data + 4 * d, 4);
+                extent = extent_32;
+            }
+            bitmask_tensor.extents.push_back(static_cast<int>(extent));
+        }
+        if (bitmask_tensor.extents.empty()) {
+            throw std::runtime_error(
+                "dalotia SafetensorsFile: empty shape of " + name);
+        }
+        bitmask_tensor.num_columns = bitmask_tensor.extents.back();
+        bitmask_tensor.num_rows =
+            std::accumulate(bitmask_tensor.extents.begin(),
+                            bitmask_tensor.extents.end() - 1, size_t(1),
+                            std::multiplies<size_t>());
+        if (bitmask_tensor.bitmask.num_elements *
+                sizeof_weight_format(bitmask_tensor.bitmask.weight_format) !=
+            bitmask_tensor.num_rows *
+                bitmask_row_bytes(bitmask_tensor.num_columns)) {
+            throw std::runtime_error(
+                "dalotia SafetensorsFile: bitmask size does not match the "
+                "shape of " + name);
+        }
+        bitmask_tensors_.emplace(name, std::move(bitmask_tensor));
+    }
 }
 
+SafetensorsFile::~SafetensorsFile() = default;
+
 const std::vector<std::string> &SafetensorsFile::get_tensor_names() const {
-    return st_.tensors.keys();
+    std::call_once(tensor_names_listed_, [this]() {
+        // the bitmask-compressed tensors replace their components
+        std::set<std::string_view> listed_names;
+        tensor_names_.reserve(header_.entries().size());
+        for (const auto &entry : header_.entries()) {
+            std::string_view name = entry.name;
+            if (!bitmask_tensors_.empty()) {
+                for (const auto &suffix : bitmask_suffixes) {
+                    if (ends_with(name, suffix) &&
+                        bitmask_tensors_.count(std::string(
+                            name.substr(0, name.size() - suffix.size())))) {
+                        name = name.substr(0, name.size() - suffix.size());
+                        break;
+                    }
+                }
+                if (!listed_names.insert(name).second) {
+                    continue;
+                }
+            }
+            tensor_names_.emplace_back(name);
+        }
+    });
+    return tensor_names_;
 }
 
-SafetensorsFile::SafetensorsFile(const std::string &filename) : TensorFile(filename) {
-    // as far as I can tell, safetensors are saved in C order
-    std::string warn, err;
-    bool ret = safetensors::mmap_from_file(filename, &st_, &warn, &err);
-    if (warn.size() > 0) {
-        std::cout << "safetensors-cpp WARN: " << warn << "\n";
+const SafetensorsFile::BitmaskTensor *SafetensorsFile::find_bitmask_tensor(
+    const std::string &tensor_name) const {
+    if (bitmask_tensors_.empty()) {
+        return nullptr;
+    }
+    auto it = bitmask_tensors_.find(tensor_name);
+    if (tensor_name.empty() && this->get_tensor_names().size() == 1) {
+        it = bitmask_tensors_.find(this->get_tensor_names().front());
     }
-    if (ret == false) {
-        std::cerr << "Failed to load: " << filename << "\n";
-        std::cerr << "  ERR: " << err << "\n";
-        throw std::runtime_error("Could not open file " + filename);
+    return it == bitmask_tensors_.end() ? nullptr : &it->second;
+}
+
+const SafetensorsHeader::Entry &SafetensorsFile::get_entry(
+    const std::string &tensor_name) const {
+    if (tensor_name.empty() && header_.entries().size() == 1) {
+        return header_.entries().front();
     }
-#ifndef NDEBUG
-    // Check if data_offsets are valid
-    if (!safetensors::validate_data_offsets(st_, err)) {
-        std::cerr << "Invalid data_offsets\n";
-        std::cerr << err << "\n";
-        throw std::runtime_error("Invalid safetensors file " + filename);
+    const auto *entry = header_.find(tensor_name);
+    if (entry == nullptr) {
+        throw std::runtime_error("Tensor " + tensor_name +
+                                 " not found; available: " +
+                                 to_string(this->get_tensor_names()));
     }
-#endif // NDEBUG
+    return *entry;
 }
 
-SafetensorsFile::~SafetensorsFile() {
-    if (st_.st_file != nullptr) {
-        // delete st_.st_file;
+SafetensorsFile::StoredTensor SafetensorsFile::get_stored_tensor(
+    const SafetensorsHeader::Entry &entry) const {
+    auto dtype = safetensors_dtype_map.find(entry.dtype);
+    if (dtype == safetensors_dtype_map.end()) {
+        throw std::runtime_error("dalotia SafetensorsFile: unsupported dtype " +
+                                 std::string(entry.dtype) + " of " +
+                                 std::string(entry.name));
+    }
+    StoredTensor tensor;
+    tensor.weight_format = dtype->second;
+    tensor.extents = SafetensorsHeader::parse_shape(entry);
+    tensor.num_elements =
+        std::accumulate(tensor.extents.begin(), tensor.extents.end(),
+                        size_t(1), std::multiplies<size_t>());
+    if (entry.end - entry.begin !=
+        tensor.num_elements * sizeof_weight_format(tensor.weight_format)) {
+        throw std::runtime_error(
+            "dalotia SafetensorsFile: data_offsets of " +
+            std::string(entry.name) + " do not match its shape and dtype");
     }
+    tensor.data = data_ + entry.begin;
+    return tensor;
 }
 
-bool SafetensorsFile::is_sparse(const std::string &/*tensor_name*/) const {
-    return false;
+bool SafetensorsFile::is_sparse(const std::string &tensor_name) const {
+    return this->find_bitmask_tensor(tensor_name) != nullptr;
 }
 
 size_t SafetensorsFile::get_num_dimensions(const std::string &tensor_name) const {
-    safetensors::tensor_t safetensor = get_tensor_from_name(tensor_name, st_);
-    return safetensor.shape.size();
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        return bitmask_tensor->extents.size();
+    }
+    return SafetensorsHeader::parse_shape(this->get_entry(tensor_name)).size();
 }
 
 size_t SafetensorsFile::get_num_tensor_elements(const std::string &tensor_name) const {
-    safetensors::tensor_t safetensor = get_tensor_from_name(tensor_name, st_);
-    return safetensors::get_shape_size(safetensor);
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        return bitmask_tensor->num_rows * bitmask_tensor->num_columns;
+    }
+    return this->get_stored_tensor(tensor_name).num_elements;
 }
 
 std::vector<int> SafetensorsFile::get_tensor_extents(
     const std::string &tensor_name, const std::vector<int> &permutation) const {
-    safetensors::tensor_t safetensor = get_tensor_from_name(tensor_name, st_);
-    std::vector<int> extents(safetensor.shape.begin(), safetensor.shape.end());
+    std::vector<int> shape;
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        shape = bitmask_tensor->extents;
+    } else {
+        shape = SafetensorsHeader::parse_shape(this->get_entry(tensor_name));
+    }
+    std::vector<int> extents = shape;
     if (!permutation.empty()) {
         auto final_permutation_in_c_order =
             final_c_permutation_from_permutation_and_order(
@@ -102,51 +209,202 @@ std::vector<int> SafetensorsFile::get_tensor_extents(
                 extents.size());
         if (!final_permutation_in_c_order.empty()) {
             for (size_t i = 0; i < extents.size(); i++) {
-                extents[i] = safetensor.shape[final_permutation_in_c_order[i]];
+                extents[i] = shape[final_permutation_in_c_order[i]];
             }
         }
     }
     return extents;
 }
 
+dalotia_WeightFormat SafetensorsFile::get_weight_format(
+    const std::string &tensor_name) const {
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        return bitmask_tensor->values.weight_format;
+    }
+    const auto &entry = this->get_entry(tensor_name);
+    auto dtype = safetensors_dtype_map.find(entry.dtype);
+    if (dtype == safetensors_dtype_map.end()) {
+        throw std::runtime_error("dalotia SafetensorsFile: unsupported dtype " +
+                                 std::string(entry.dtype) + " of " + tensor_name);
+    }
+    return dtype->second;
+}
+
+size_t SafetensorsFile::get_nnz(const std::string &tensor_name) const {
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        return bitmask_popcount(bitmask_tensor->bitmask.data,
+                                bitmask_tensor->num_rows,
+                                bitmask_tensor->num_columns);
+    }
+    const StoredTensor tensor = this->get_stored_tensor(tensor_name);
+    return dense_nnz(tensor.data, tensor.weight_format, tensor.extents,
+                     dense_strides(tensor.extents), prune_threshold_);
+}
+
+std::vector<int> SafetensorsFile::get_sparse_tensor_extents(
+    const std::string &tensor_name, dalotia_SparseFormat format) const {
+    if (is_derived_sparse_format(format)) {
+        return derived_sparse_extents(
+            this->load_reordered_csr_matrix(tensor_name,
+                                            this->get_weight_format(tensor_name)),
+            format, sparse_layout_);
+    }
+    return sparse_extents(format, this->get_nnz(tensor_name),
+                          sparse_num_rows(this->get_tensor_extents(tensor_name)));
+}
+
 void SafetensorsFile::load_tensor_dense(const std::string &tensor_name,
                                         dalotia_WeightFormat weightFormat,
                                         dalotia_Ordering ordering,
                                         dalotia_byte *__restrict__ tensor,
                                         const std::vector<int> &permutation) {
-    safetensors::tensor_t safetensor = get_tensor_from_name(tensor_name, st_);
-    const auto num_dimensions = safetensor.shape.size();
+    LoadTimer timer(*instrumentation_, tensor_name);
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        // decompress, in C order right away or into a buffer to permute
+        const auto num_dimensions = bitmask_tensor->extents.size();
+        auto final_permutation_in_c_order =
+            final_c_permutation_from_permutation_and_order(
+                permutation, ordering, num_dimensions);
+        std::vector<dalotia_byte> buffer;
+        dalotia_byte *dense = tensor;
+        if (!final_permutation_in_c_order.empty()) {
+            buffer.resize(this->get_num_tensor_elements(tensor_name) *
+                          sizeof_weight_format(weightFormat));
+            dense = buffer.data();
+        }
+        const auto &values = bitmask_tensor->values;
+        const auto &bitmask = bitmask_tensor->bitmask;
+        const size_t values_bytes =
+            values.num_elements * sizeof_weight_format(values.weight_format);
+        const size_t bitmask_bytes =
+            bitmask.num_elements * sizeof_weight_format(bitmask.weight_format);
+        timer.add_bytes(values_bytes + bitmask_bytes,
+                        this->get_num_tensor_elements(tensor_name) *
+                            sizeof_weight_format(weightFormat));
+        timer.fault_in(values.data, values_bytes);
+        timer.fault_in(bitmask.data, bitmask_bytes);
+        timer.phase(dalotia_convert_phase);
+        bitmask_to_dense(bitmask_tensor->bitmask.data,
+                         bitmask_tensor->num_rows, bitmask_tensor->num_columns,
+                         bitmask_tensor->values.data,
+                         bitmask_tensor->values.weight_format,
+                         dense, weightFormat);
+        if (!final_permutation_in_c_order.empty()) {
+            timer.phase(dalotia_permute_phase);
+            assign_permuted(num_dimensions, tensor, weightFormat,
+                            bitmask_tensor->extents.data(), dense, weightFormat,
+                            final_permutation_in_c_order.data());
+        }
+        return;
+    }
+    const StoredTensor stored = this->get_stored_tensor(tensor_name);
+    const auto num_dimensions = stored.extents.size();
 
     auto final_permutation_in_c_order =
         final_c_permutation_from_permutation_and_order(permutation, ordering,
                                                        num_dimensions);
-
-    const uint8_t *databuffer = st_.databuffer_addr;
-    const dalotia_WeightFormat input_weight_format =
-        safetensors_type_map.at(safetensor.dtype);
-    auto *tensor_start =
-        reinterpret_cast<const dalotia_byte *__restrict__>(databuffer) +
-        safetensor.data_offsets[0];
+    const size_t num_bytes =
+        stored.num_elements * sizeof_weight_format(stored.weight_format);
+    timer.add_bytes(num_bytes,
+                    stored.num_elements * sizeof_weight_format(weightFormat));
+    timer.fault_in(stored.data, num_bytes);
     if (!final_permutation_in_c_order.empty()) {
-        std::vector<int> input_shape(
-            safetensor.shape.begin(), safetensor.shape.end());
+        timer.phase(dalotia_permute_phase);
         assign_permuted(num_dimensions, tensor, weightFormat,
-                        input_shape.data(), tensor_start,
-                        input_weight_format,
+                        stored.extents.data(), stored.data,
+                        stored.weight_format,
                         final_permutation_in_c_order.data());
     } else {
-        const size_t nitems = safetensors::get_shape_size(safetensor);
-        assign_linearly(tensor, weightFormat, nitems, tensor_start,
-                        input_weight_format);
+        timer.phase(dalotia_convert_phase);
+        assign_linearly(tensor, weightFormat, stored.num_elements, stored.data,
+                        stored.weight_format);
     }
 }
 
+void SafetensorsFile::load_tensor_sparse(const std::string &tensor_name,
+                                         dalotia_SparseFormat sparseFormat,
+                                         dalotia_WeightFormat weightFormat,
+                                         dalotia_Ordering ordering,
+                                         dalotia_byte *__restrict__ values,
+                                         int *__restrict__ first_indices,
+                                         int *__restrict__ second_indices) {
+    if (ordering != dalotia_C_ordering) {
+        throw std::runtime_error(
+            "load_tensor_sparse: only C ordering is supported for " +
+            tensor_name);
+    }
+    LoadTimer timer(*instrumentation_, tensor_name);
+    timer.phase(dalotia_convert_phase);
+    if (is_derived_sparse_format(sparseFormat) || sparse_layout_.reorder_rcm) {
+        this->load_sparse_from_csr(tensor_name, sparseFormat, weightFormat,
+                                   values, first_indices, second_indices);
+    } else {
+        this->load_csr_or_coo(tensor_name, sparseFormat, weightFormat, values,
+                              first_indices, second_indices);
+    }
+}
+
+void SafetensorsFile::load_csr_or_coo(const std::string &tensor_name,
+                                      dalotia_SparseFormat sparseFormat,
+                                      dalotia_WeightFormat weightFormat,
+                                      dalotia_byte *__restrict__ values,
+                                      int *__restrict__ first_indices,
+                                      int *__restrict__ second_indices) const {
+    const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name);
+    if (bitmask_tensor == nullptr) {
+        // prune the dense tensor on load
+        const StoredTensor tensor = this->get_stored_tensor(tensor_name);
+        dense_to_sparse(tensor.data, tensor.weight_format, tensor.extents,
+                        dense_strides(tensor.extents), prune_threshold_, sparseFormat,
+                        weightFormat, values, first_indices, second_indices);
+        return;
+    }
+    const size_t num_rows = bitmask_tensor->num_rows;
+    std::vector<int> row_ptr;
+    if (sparseFormat == dalotia_COO) {
+        row_ptr.resize(num_rows + 1);
+    } else if (sparseFormat != dalotia_CSR) {
+        throw std::runtime_error("load_tensor_sparse: unknown sparse format");
+    }
+    int *csr_row_ptr = sparseFormat == dalotia_CSR ? first_indices : row_ptr.data();
+    bitmask_to_csr(bitmask_tensor->bitmask.data, num_rows,
+                   bitmask_tensor->num_columns, csr_row_ptr, second_indices);
+    if (sparseFormat == dalotia_COO) {
+#pragma omp parallel for schedule(static)
+        for (size_t r = 0; r < num_rows; ++r) {
+            std::fill(first_indices + csr_row_ptr[r],
+                      first_indices + csr_row_ptr[r + 1], static_cast<int>(r));
+        }
+    }
+    // the values are stored row by row already
+    const size_t nnz = csr_row_ptr[num_rows];
+    if (nnz != bitmask_tensor->values.num_elements) {
+        throw std::runtime_error("load_tensor_sparse: the bitmask of " +
+                                 tensor_name +
+                                 " does not match its number of values");
+    }
+    assign_linearly(values, weightFormat, nnz,
+                    bitmask_tensor->values.data,
+                    bitmask_tensor->values.weight_format);
+}
+
+CsrMatrix SafetensorsFile::load_csr_matrix(
+    const std::string &tensor_name, dalotia_WeightFormat weightFormat) const {
+    CsrMatrix csr =
+        allocate_csr_matrix(this->get_tensor_extents(tensor_name),
+                            this->get_nnz(tensor_name), weightFormat);
+    this->load_csr_or_coo(tensor_name, dalotia_CSR, weightFormat,
+                          csr.values.data(), csr.row_ptr.data(),
+                          csr.col_idx.data());
+    return csr;
+}
+
 std::vector<const dalotia_byte*> SafetensorsFile::get_mmap_tensor_pointers(
     const std::string &tensor_name) const {
-    safetensors::tensor_t safetensor = get_tensor_from_name(tensor_name, st_);
-    auto *tensor_start =
-        reinterpret_cast<const dalotia_byte *__restrict__>(st_.databuffer_addr) +
-        safetensor.data_offsets[0];
-    return std::vector<const dalotia_byte*>(1, tensor_start);
+    if (const auto *bitmask_tensor = this->find_bitmask_tensor(tensor_name)) {
+        return {bitmask_tensor->values.data, bitmask_tensor->bitmask.data};
+    }
+    return std::vector<const dalotia_byte*>(
+        1, this->get_stored_tensor(tensor_name).data);
 }
-}  // namespace dalotia
\ No newline at end of file
+}  // namespace dalotia
@@ -1,32 +1,24 @@
 #pragma once
-#include <array>
 #include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+#include "dalotia_safetensors_header.hpp"
 #include "dalotia_tensor_file.hpp"
-#include "safetensors.hh"
 
 namespace dalotia {
 
-const std::map<safetensors::dtype,  dalotia_WeightFormat> safetensors_type_map{
-    {safetensors::dtype::kFLOAT64,  dalotia_WeightFormat::dalotia_float_64},
-    {safetensors::dtype::kFLOAT32,  dalotia_WeightFormat::dalotia_float_32},
-    {safetensors::dtype::kFLOAT16,  dalotia_WeightFormat::dalotia_float_16},
-    {safetensors::dtype::kBFLOAT16, dalotia_WeightFormat::dalotia_bfloat_16},
-    // {kBOOL, dalotia_bool},
-    {safetensors::dtype::kUINT8,    dalotia_WeightFormat::dalotia_uint_8},
-    {safetensors::dtype::kINT8,     dalotia_WeightFormat::dalotia_int_8},
-    {safetensors::dtype::kUINT16,   dalotia_WeightFormat::dalotia_uint_16},
-    {safetensors::dtype::kINT32,    dalotia_WeightFormat::dalotia_int_32},
-    {safetensors::dtype::kUINT32,   dalotia_WeightFormat::dalotia_uint_32},
-    // {safetensors::dtype::kINT64,    dalotia_WeightFormat::dalotia_int_64},
-    // {safetensors::dtype::kUINT64,   dalotia_WeightFormat::dalotia_uint_64},
-    // {dalotia_float_8},
-    // {dalotia_int_2},
-};
-
+// besides dense tensors, this reads the sparse-bitmask compression of
+// compressed-tensors: a tensor "name" is then stored as "name.shape",
+// "name.compressed" (the non-zero values), "name.bitmask" and optionally
+// "name.row_offsets", and shows up as the single sparse tensor "name";
+// dense tensors can be loaded sparse, too, pruned by the prune threshold;
+// the file is mapped and its header indexed in one pass at open, the
+// shapes are parsed on use and the list of names is built on first request
 class SafetensorsFile : public TensorFile {
    public:
     explicit SafetensorsFile(const std::string &filename);
@@ -45,16 +37,88 @@ class SafetensorsFile : public TensorFile {
         const std::string &tensor_name = "",
         const std::vector<int>& permutation = {}) const override;
 
+    dalotia_WeightFormat get_weight_format(
+        const std::string &tensor_name) const override;
+
+    size_t get_nnz(const std::string &tensor_name) const override;
+
+    std::vector<int> get_sparse_tensor_extents(
+        const std::string &tensor_name,
+        dalotia_SparseFormat format) const override;
+
     void load_tensor_dense(const std::string &tensor_name,
                            dalotia_WeightFormat weightFormat,
                            dalotia_Ordering ordering,
                            dalotia_byte *__restrict__ tensor,
                            const std::vector<int>& permutation = {}) override;
+
+    // CSR: values (nnz), first_indices = row_ptr (rows + 1), second_indices
+    // = col_idx (nnz); the rows of a tensor with more than two dimensions
+    // are all but its last dimension
+    void load_tensor_sparse(const std::string &tensor_name,
+                            dalotia_SparseFormat sparseFormat,
+                            dalotia_WeightFormat weightFormat,
+                            dalotia_Ordering ordering,
+                            dalotia_byte *__restrict__ values,
+                            int *__restrict__ first_indices,
+                            int *__restrict__ second_indices) override;
+
+    // for bitmask-compressed tensors: the values and the bitmask
     std::vector<const dalotia_byte*> get_mmap_tensor_pointers(
         const std::string &tensor_name) const override;
-    
-    // cf. https://github.com/syoyo/safetensors-cpp/blob/main/safetensors.hh
-    safetensors::safetensors_t st_;
+
+    [[nodiscard]] const SafetensorsHeader &get_header() const { return header_; }
+
+   private:
+    // a tensor of the header, with its shape parsed and its size checked
+    struct StoredTensor {
+        dalotia_WeightFormat weight_format;
+        std::vector<int> extents;
+        size_t num_elements;
+        const dalotia_byte *data;
+    };
+
+    struct BitmaskTensor {
+        std::vector<int> extents;
+        size_t num_rows;
+        size_t num_columns;
+        StoredTensor values;
+        StoredTensor bitmask;
+    };
+
+    // nullptr for dense tensors
+    const BitmaskTensor *find_bitmask_tensor(const std::string &tensor_name) const;
+
+    // the empty name stands for the only tensor of the file
+    const SafetensorsHeader::Entry &get_entry(const std::string &tensor_name) const;
+
+    // throws if the dtype is not supported or the size does not match
+    StoredTensor get_stored_tensor(const SafetensorsHeader::Entry &entry) const;
+
+    StoredTensor get_stored_tensor(const std::string &tensor_name) const {
+        return this->get_stored_tensor(this->get_entry(tensor_name));
+    }
+
+    // CSR or COO, from the bitmask or by pruning the dense tensor
+    void load_csr_or_coo(const std::string &tensor_name,
+                         dalotia_SparseFormat sparseFormat,
+                         dalotia_WeightFormat weightFormat,
+                         dalotia_byte *__restrict__ values,
+                         int *__restrict__ first_indices,
+                         int *__restrict__ second_indices) const;
+
+    // the CSR from which BSR and SELL are derived
+    CsrMatrix load_csr_matrix(const std::string &tensor_name,
+                              dalotia_WeightFormat weightFormat) const override;
+
+    MappedFile file_;
+    std::string_view header_json_;  // in the mapping, after the length
+    SafetensorsHeader header_;
+    const dalotia_byte *data_ = nullptr;  // the byte buffer after the header
+    size_t data_size_ = 0;
+    mutable std::once_flag tensor_names_listed_;
+    mutable std::vector<std::string> tensor_names_;
+    std::map<std::string, BitmaskTensor> bitmask_tensors_;
 };
 
 }  // namespace dalotia
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "dalotia_safetensors_header.hpp"
+
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#include "dalotia_json.hpp"
+
+namespace dalotia {
+
+namespace {
+const char *const context = "dalotia SafetensorsFile";
+}  // namespace
+
+SafetensorsHeader::SafetensorsHeader(std::string_view json) {
+    JsonReader reader(json, context);
+    // views into unescaped strings have to point to their own copy
+    auto keep = [this](std::string_view string, std::string &unescaped) {
+        if (string.data() != unescaped.data()) {
+            return string;
+        }
+        return std::string_view(unescaped_.emplace_back(std::move(unescaped)));
+    };
+    // a guess at the number of entries to save most of the rehashing: one
+    // per 64 bytes, about a short key and a one- or two-dimensional entry
+    // (the smallest possible, {"dtype":"F32","shape":[],"data_offsets":
+    // [0,0]}, is 47 bytes, so very small entries can still rehash)
+    entries_.reserve(json.size() / 64);
+    index_.reserve(json.size() / 64);
+    reader.expect('{');
+    if (reader.next_is('}')) {
+        return;
+    }
+    do {
+        std::string unescaped_name;
+        const std::string_view name =
+            keep(reader.read_string(unescaped_name), unescaped_name);
+        reader.expect(':');
+        if (name == "__metadata__") {
+            metadata_ = reader.skip_value();
+            continue;
+        }
+        Entry entry;
+        entry.name = name;
+        bool has_offsets = false;
+        reader.expect('{');
+        if (!reader.next_is('}')) {
+            do {
+                std::string unescaped;
+                const std::string_view field = reader.read_string(unescaped);
+                reader.expect(':');
+                if (field == "dtype") {
+                    entry.dtype = keep(reader.read_string(unescaped), unescaped);
+                } else if (field == "shape") {
+                    entry.shape = reader.skip_value();
+                } else if (field == "data_offsets") {
+                    reader.expect('[');
+                    entry.begin = reader.read_unsigned();
+                    reader.expect(',');
+                    entry.end = reader.read_unsigned();
+                    reader.expect(']');
+                    has_offsets = true;
+                } else {
+                    reader.skip_value();
+                }
+            } while (reader.next_is(','));
+            reader.expect('}');
+        }
+        if (entry.dtype.empty() || entry.shape.empty() || !has_offsets ||
+            entry.begin > entry.end) {
+            throw std::runtime_error(std::string(context) +
+                                     ": incomplete header entry of " +
+                                     std::string(name));
+        }
+        if (!index_.emplace(entry.name, entries_.size()).second) {
+            throw std::runtime_error(std::string(context) +
+                                     ": duplicate tensor name " +
+                                     std::string(name));
+        }
+        entries_.push_back(entry);
+    } while (reader.next_is(','));
+    reader.expect('}');
+}
+
+std::string_view SafetensorsHeader::header_of(const dalotia_byte *file,
+                                              size_t file_size) {
+    uint64_t header_size = 0;
+    if (file_size < sizeof(header_size)) {
+        throw std::runtime_error(std::string(context) + ": file too small");
+    }
+    std::memcpy(&header_size, file, sizeof(header_size));  // little endian
+    if (header_size > file_size - sizeof(header_size)) {
+        throw std::runtime_error(std::string(context) +
+                                 ": header larger than the file");
+    }
+    return std::string_view(
+        reinterpret_cast<const char *>(file) + sizeof(header_size),
+        header_size);
+}
+
+const SafetensorsHeader::Entry *SafetensorsHeader::find(
+    std::string_view name) const {
+    auto it = index_.find(name);
+    return it == index_.end() ? nullptr : &entries_[it->second];
+}
+
+std::vector<int> SafetensorsHeader::parse_shape(const Entry &entry) {
+    JsonReader reader(entry.shape, context);
+    std::vector<int> extents;
+    reader.expect('[');
+    if (reader.next_is(']')) {
+        return extents;
+    }
+    do {
+        const uint64_t extent = reader.read_unsigned();
+        if (extent > INT_MAX) {
+            throw std::runtime_error(std::string(context) +
+                                     ": extent out of range in the shape of " +
+                                     std::string(entry.name));
+        }
+        extents.push_back(static_cast<int>(extent));
+    } while (reader.next_is(','));
+    reader.expect(']');
+    return extents;
+}
+
+}  // namespace dalotia
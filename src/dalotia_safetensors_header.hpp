@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+// the dtypes of the safetensors header that dalotia can represent, cf.
+// https://huggingface.co/docs/safetensors/index#format
+const std::map<std::string, dalotia_WeightFormat, std::less<>>
+    safetensors_dtype_map{
+        {"F64", dalotia_WeightFormat::dalotia_float_64},
+        {"F32", dalotia_WeightFormat::dalotia_float_32},
+        {"F16", dalotia_WeightFormat::dalotia_float_16},
+        {"BF16", dalotia_WeightFormat::dalotia_bfloat_16},
+        {"U32", dalotia_WeightFormat::dalotia_uint_32},
+        {"U16", dalotia_WeightFormat::dalotia_uint_16},
+        {"U8", dalotia_WeightFormat::dalotia_uint_8},
+        {"I32", dalotia_WeightFormat::dalotia_int_32},
+        {"I16", dalotia_WeightFormat::dalotia_int_16},
+        {"I8", dalotia_WeightFormat::dalotia_int_8},
+        // {"I64", dalotia_int_64}, {"U64", dalotia_uint_64},
+        // {"BOOL", dalotia_bool},
+    };
+
+// the JSON header of a safetensors file, read in a single pass: names,
+// dtypes and the text of the shapes are views into the header (which has
+// to outlive this, e.g. as part of a mapped file), the data offsets are
+// read on the way and the entries are indexed by name as they come; the
+// shapes are only parsed when asked for, so opening a file with many
+// tensors allocates little more than the entries and the index
+class SafetensorsHeader {
+   public:
+    struct Entry {
+        std::string_view name;
+        std::string_view dtype;
+        std::string_view shape;  // the JSON array, unparsed
+        uint64_t begin = 0;      // data_offsets, relative to the byte buffer
+        uint64_t end = 0;
+    };
+
+    SafetensorsHeader() = default;
+
+    explicit SafetensorsHeader(std::string_view json);
+
+    // the header of a mapped safetensors file: its length (little-endian
+    // uint64) and the JSON, checked against the file size
+    static std::string_view header_of(const dalotia_byte *file,
+                                      size_t file_size);
+
+    [[nodiscard]] const std::vector<Entry> &entries() const { return entries_; }
+
+    // nullptr if there is no such tensor
+    [[nodiscard]] const Entry *find(std::string_view name) const;
+
+    // the raw __metadata__ object, empty if there is none
+    [[nodiscard]] std::string_view metadata() const { return metadata_; }
+
+    static std::vector<int> parse_shape(const Entry &entry);
+
+   private:
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string_view, size_t> index_;
+    std::string_view metadata_;
+    // the few strings that had escape sequences, decoded
+    std::deque<std::string> unescaped_;
+};
+
+}  // namespace dalotia
@@ -0,0 +1,69 @@
+#include "dalotia_safetensors_writer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include "dalotia_json.hpp"
+
+namespace dalotia {
+
+SafetensorsFileWriter::SafetensorsFileWriter(const std::string &filename)
+    : TensorFileWriter(filename) {}
+
+SafetensorsFileWriter::~SafetensorsFileWriter() = default;
+
+std::vector<dalotia_byte> SafetensorsFileWriter::lay_out() {
+    std::vector<size_t> placement_order(tensors_.size());
+    std::iota(placement_order.begin(), placement_order.end(), 0);
+    std::stable_sort(placement_order.begin(), placement_order.end(),
+                     [this](size_t a, size_t b) {
+                         return sizeof_weight_format(tensors_[a].output_format) >
+                                sizeof_weight_format(tensors_[b].output_format);
+                     });
+    std::vector<size_t> data_offsets(tensors_.size() + 1);
+    size_t data_offset = 0;
+    for (const size_t t : placement_order) {
+        data_offsets[t] = data_offset;
+        data_offset += tensors_[t].num_elements *
+                       sizeof_weight_format(tensors_[t].output_format);
+    }
+
+    std::string json = "{\"__metadata__\":{\"format\":\"pt\"}";
+    for (size_t t = 0; t < tensors_.size(); ++t) {
+        const auto &tensor = tensors_[t];
+        auto dtype = safetensors_dtype_names.find(tensor.output_format);
+        if (dtype == safetensors_dtype_names.end()) {
+            throw std::runtime_error(
+                "dalotia SafetensorsFileWriter: no safetensors dtype for the "
+                "output format of " + tensor.name);
+        }
+        json += "," + json_string(tensor.name) + ":{\"dtype\":\"" +
+                dtype->second + "\",\"shape\":[";
+        for (size_t d = 0; d < tensor.extents.size(); ++d) {
+            json += (d > 0 ? "," : "") + std::to_string(tensor.extents[d]);
+        }
+        const size_t end = data_offsets[t] + tensor.num_elements *
+                                                 sizeof_weight_format(tensor.output_format);
+        json += "],\"data_offsets\":[" + std::to_string(data_offsets[t]) + "," +
+                std::to_string(end) + "]}";
+    }
+    json += "}";
+    // trailing spaces are allowed in the header
+    const size_t padding =
+        (data_alignment - (8 + json.size()) % data_alignment) % data_alignment;
+    json.append(padding, ' ');
+
+    const uint64_t header_size = json.size();
+    std::vector<dalotia_byte> header(8 + json.size());
+    std::memcpy(header.data(), &header_size, 8);  // little endian
+    std::memcpy(header.data() + 8, json.data(), json.size());
+    for (size_t t = 0; t < tensors_.size(); ++t) {
+        tensors_[t].offset = header.size() + data_offsets[t];
+    }
+    return header;
+}
+
+}  // namespace dalotia
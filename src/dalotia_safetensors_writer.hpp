@@ -0,0 +1,43 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file_writer.hpp"
+
+namespace dalotia {
+
+// dtype strings of the safetensors header, cf.
+// https://huggingface.co/docs/safetensors/index#format
+const std::map<dalotia_WeightFormat, std::string> safetensors_dtype_names{
+    {dalotia_WeightFormat::dalotia_float_64, "F64"},
+    {dalotia_WeightFormat::dalotia_float_32, "F32"},
+    {dalotia_WeightFormat::dalotia_float_16, "F16"},
+    {dalotia_WeightFormat::dalotia_bfloat_16, "BF16"},
+    {dalotia_WeightFormat::dalotia_uint_32, "U32"},
+    {dalotia_WeightFormat::dalotia_uint_16, "U16"},
+    {dalotia_WeightFormat::dalotia_uint_8, "U8"},
+    {dalotia_WeightFormat::dalotia_int_32, "I32"},
+    {dalotia_WeightFormat::dalotia_int_16, "I16"},
+    {dalotia_WeightFormat::dalotia_int_8, "I8"},
+};
+
+// writes .safetensors files without safetensors-cpp; the byte buffer may
+// not have holes, so the tensors are placed by decreasing element size
+// after a header padded to a cache line, which keeps every tensor aligned
+// to its element size; the header lists the tensors in the order they
+// were added
+class SafetensorsFileWriter : public TensorFileWriter {
+   public:
+    static constexpr size_t data_alignment = 64;
+
+    explicit SafetensorsFileWriter(const std::string &filename);
+
+    ~SafetensorsFileWriter() override;
+
+   protected:
+    std::vector<dalotia_byte> lay_out() override;
+};
+
+}  // namespace dalotia
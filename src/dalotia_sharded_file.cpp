@@ -0,0 +1,297 @@
+#include "dalotia_sharded_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "dalotia.hpp"
+#include "dalotia_json.hpp"
+
+namespace dalotia {
+
+namespace {
+// runs function(0) ... function(num_items - 1) on up to one thread per
+// core; this is about overlapping I/O on different files, so it uses
+// threads even without OpenMP; rethrows the first error
+void run_concurrently(size_t num_items,
+                      const std::function<void(size_t)> &function) {
+    const size_t num_threads = std::min<size_t>(
+        num_items, std::max(std::thread::hardware_concurrency(), 1u));
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < num_items; ++i) {
+            function(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next_item{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto work = [&]() {
+        for (size_t i = next_item++; i < num_items; i = next_item++) {
+            try {
+                function(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < num_threads; ++t) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+}  // namespace
+
+std::vector<std::pair<std::string, std::string>> parse_shard_index(
+    const std::string &json) {
+    // just enough JSON to read the weight map, other values are skipped
+    JsonReader parser(json, "dalotia ShardedTensorFile");
+    std::vector<std::pair<std::string, std::string>> weight_map;
+    bool found_weight_map = false;
+    parser.expect('{');
+    if (!parser.next_is('}')) {
+        do {
+            const std::string key = parser.read_string();
+            parser.expect(':');
+            if (key != "weight_map") {
+                parser.skip_value();
+                continue;
+            }
+            found_weight_map = true;
+            parser.expect('{');
+            if (parser.next_is('}')) {
+                continue;
+            }
+            do {
+                std::string tensor_name = parser.read_string();
+                parser.expect(':');
+                weight_map.emplace_back(std::move(tensor_name),
+                                        parser.read_string());
+            } while (parser.next_is(','));
+            parser.expect('}');
+        } while (parser.next_is(','));
+        parser.expect('}');
+    }
+    if (!found_weight_map) {
+        throw std::runtime_error(
+            "dalotia ShardedTensorFile: the index has no weight_map");
+    }
+    return weight_map;
+}
+
+ShardedTensorFile::ShardedTensorFile(const std::string &filename)
+    : TensorFile(filename) {
+    std::ifstream index_file(filename);
+    if (!index_file) {
+        throw std::runtime_error("dalotia ShardedTensorFile: could not open " +
+                                 filename);
+    }
+    std::stringstream json;
+    json << index_file.rdbuf();
+
+    // shard files are relative to the index
+    const auto slash = filename.find_last_of('/');
+    const std::string directory =
+        slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+    std::map<std::string, size_t> shard_indices;
+    for (auto &[tensor_name, shard_filename] : parse_shard_index(json.str())) {
+        auto [shard, inserted] =
+            shard_indices.emplace(shard_filename, shards_.size());
+        if (inserted) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->filename = directory + shard_filename;
+        }
+        if (!shard_of_tensor_.emplace(tensor_name, shard->second).second) {
+            throw std::runtime_error(
+                "dalotia ShardedTensorFile: duplicate tensor name " +
+                tensor_name);
+        }
+        tensor_names_.push_back(std::move(tensor_name));
+    }
+}
+
+ShardedTensorFile::~ShardedTensorFile() = default;
+
+TensorFile &ShardedTensorFile::open_shard(size_t shard_index) const {
+    Shard &shard = *shards_[shard_index];
+    // if opening throws, the next call tries again
+    std::call_once(shard.opened, [this, &shard]() {
+        shard.file.reset(make_tensor_file(shard.filename));
+        shard.file->set_prune_threshold(prune_threshold_);
+        shard.file->set_sparse_layout(sparse_layout_);
+        share_instrumentation(*this, *shard.file);
+    });
+    return *shard.file;
+}
+
+TensorFile &ShardedTensorFile::get_shard_file(
+    const std::string &tensor_name) const {
+    if (tensor_name.empty() && tensor_names_.size() == 1) {
+        return this->open_shard(shard_of_tensor_.at(tensor_names_.front()));
+    }
+    auto it = shard_of_tensor_.find(tensor_name);
+    if (it == shard_of_tensor_.end()) {
+        throw std::runtime_error("Tensor " + tensor_name +
+                                 " not found; available: " +
+                                 to_string(tensor_names_));
+    }
+    return this->open_shard(it->second);
+}
+
+void ShardedTensorFile::open_all_shards() const {
+    run_concurrently(shards_.size(),
+                     [this](size_t shard_index) { this->open_shard(shard_index); });
+}
+
+void ShardedTensorFile::set_prune_threshold(double threshold) {
+    prune_threshold_ = threshold;
+    for (auto &shard : shards_) {
+        if (shard->file) {
+            shard->file->set_prune_threshold(threshold);
+        }
+    }
+}
+
+void ShardedTensorFile::set_sparse_layout(const SparseLayout &layout) {
+    sparse_layout_ = layout;
+    for (auto &shard : shards_) {
+        if (shard->file) {
+            shard->file->set_sparse_layout(layout);
+        }
+    }
+}
+
+const std::vector<std::string> &ShardedTensorFile::get_tensor_names() const {
+    return tensor_names_;
+}
+
+bool ShardedTensorFile::is_sparse(const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).is_sparse(tensor_name);
+}
+
+size_t ShardedTensorFile::get_num_dimensions(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_num_dimensions(tensor_name);
+}
+
+size_t ShardedTensorFile::get_num_tensor_elements(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_num_tensor_elements(tensor_name);
+}
+
+std::vector<int> ShardedTensorFile::get_tensor_extents(
+    const std::string &tensor_name, const std::vector<int> &permutation) const {
+    return this->get_shard_file(tensor_name)
+        .get_tensor_extents(tensor_name, permutation);
+}
+
+dalotia_WeightFormat ShardedTensorFile::get_weight_format(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_weight_format(tensor_name);
+}
+
+size_t ShardedTensorFile::get_nnz(const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_nnz(tensor_name);
+}
+
+std::vector<int> ShardedTensorFile::get_sparse_tensor_extents(
+    const std::string &tensor_name, dalotia_SparseFormat format) const {
+    return this->get_shard_file(tensor_name)
+        .get_sparse_tensor_extents(tensor_name, format);
+}
+
+SparsePermutation ShardedTensorFile::get_sparse_permutation(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_sparse_permutation(tensor_name);
+}
+
+void ShardedTensorFile::load_tensor_dense(const std::string &tensor_name,
+                                          dalotia_WeightFormat weightFormat,
+                                          dalotia_Ordering ordering,
+                                          dalotia_byte *__restrict__ tensor,
+                                          const std::vector<int> &permutation) {
+    this->get_shard_file(tensor_name)
+        .load_tensor_dense(tensor_name, weightFormat, ordering, tensor,
+                           permutation);
+}
+
+void ShardedTensorFile::load_tensors_dense(
+    const std::vector<std::string> &tensor_names,
+    dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+    const std::vector<dalotia_byte *> &tensors,
+    const std::vector<std::vector<int>> &permutations) {
+    if (tensors.size() != tensor_names.size() ||
+        (!permutations.empty() && permutations.size() != tensor_names.size())) {
+        throw std::runtime_error(
+            "load_tensors_dense: one buffer (and permutation) per tensor");
+    }
+    // one batch per shard, such that every shard is read by one thread
+    std::map<size_t, std::vector<size_t>> batches;
+    for (size_t i = 0; i < tensor_names.size(); ++i) {
+        auto it = shard_of_tensor_.find(tensor_names[i]);
+        if (it == shard_of_tensor_.end()) {
+            throw std::runtime_error("Tensor " + tensor_names[i] +
+                                     " not found; available: " +
+                                     to_string(tensor_names_));
+        }
+        batches[it->second].push_back(i);
+    }
+    std::vector<std::pair<size_t, std::vector<size_t>>> batch_list(
+        batches.begin(), batches.end());
+    run_concurrently(batch_list.size(), [&](size_t b) {
+        const auto &[shard_index, indices] = batch_list[b];
+        std::vector<std::string> shard_tensor_names;
+        std::vector<dalotia_byte *> shard_tensors;
+        std::vector<std::vector<int>> shard_permutations;
+        for (const size_t i : indices) {
+            shard_tensor_names.push_back(tensor_names[i]);
+            shard_tensors.push_back(tensors[i]);
+            if (!permutations.empty()) {
+                shard_permutations.push_back(permutations[i]);
+            }
+        }
+        this->open_shard(shard_index)
+            .load_tensors_dense(shard_tensor_names, weightFormat, ordering,
+                                shard_tensors, shard_permutations);
+    });
+}
+
+void ShardedTensorFile::load_tensor_sparse(const std::string &tensor_name,
+                                           dalotia_SparseFormat sparseFormat,
+                                           dalotia_WeightFormat weightFormat,
+                                           dalotia_Ordering ordering,
+                                           dalotia_byte *__restrict__ values,
+                                           int *__restrict__ first_indices,
+                                           int *__restrict__ second_indices) {
+    this->get_shard_file(tensor_name)
+        .load_tensor_sparse(tensor_name, sparseFormat, weightFormat, ordering,
+                            values, first_indices, second_indices);
+}
+
+std::vector<const dalotia_byte *> ShardedTensorFile::get_mmap_tensor_pointers(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_mmap_tensor_pointers(tensor_name);
+}
+
+TensorView ShardedTensorFile::get_tensor_view(
+    const std::string &tensor_name) const {
+    return this->get_shard_file(tensor_name).get_tensor_view(tensor_name);
+}
+
+}  // namespace dalotia
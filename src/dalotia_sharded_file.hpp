@@ -0,0 +1,107 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// parses the "weight_map" of a sharded checkpoint index, e.g.
+// model.safetensors.index.json, into (tensor name, shard file) pairs in
+// the order they are listed
+std::vector<std::pair<std::string, std::string>> parse_shard_index(
+    const std::string &json);
+
+// a model split into several files (model-00001-of-00042.safetensors,
+// ...) plus an index that maps every tensor to its shard, as written by
+// Hugging Face transformers; the shards are opened with make_tensor_file
+// on first use, so any supported shard format works, and the tensor
+// names are known from the index without opening any shard; batch loads
+// are grouped by shard and the shards are read concurrently
+class ShardedTensorFile : public TensorFile {
+   public:
+    explicit ShardedTensorFile(const std::string &filename);
+
+    ~ShardedTensorFile() override;
+
+    const std::vector<std::string> &get_tensor_names() const override;
+
+    bool is_sparse(const std::string &tensor_name) const override;
+
+    size_t get_num_dimensions(const std::string &tensor_name) const override;
+
+    size_t get_num_tensor_elements(const std::string &tensor_name) const override;
+
+    std::vector<int> get_tensor_extents(
+        const std::string &tensor_name = "",
+        const std::vector<int> &permutation = {}) const override;
+
+    dalotia_WeightFormat get_weight_format(
+        const std::string &tensor_name) const override;
+
+    size_t get_nnz(const std::string &tensor_name) const override;
+
+    std::vector<int> get_sparse_tensor_extents(
+        const std::string &tensor_name,
+        dalotia_SparseFormat format) const override;
+
+    SparsePermutation get_sparse_permutation(
+        const std::string &tensor_name) const override;
+
+    void load_tensor_dense(const std::string &tensor_name,
+                           dalotia_WeightFormat weightFormat,
+                           dalotia_Ordering ordering,
+                           dalotia_byte *__restrict__ tensor,
+                           const std::vector<int> &permutation = {}) override;
+
+    void load_tensors_dense(
+        const std::vector<std::string> &tensor_names,
+        dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+        const std::vector<dalotia_byte *> &tensors,
+        const std::vector<std::vector<int>> &permutations = {}) override;
+
+    void load_tensor_sparse(const std::string &tensor_name,
+                            dalotia_SparseFormat sparseFormat,
+                            dalotia_WeightFormat weightFormat,
+                            dalotia_Ordering ordering,
+                            dalotia_byte *__restrict__ values,
+                            int *__restrict__ first_indices,
+                            int *__restrict__ second_indices) override;
+
+    std::vector<const dalotia_byte *> get_mmap_tensor_pointers(
+        const std::string &tensor_name) const override;
+
+    TensorView get_tensor_view(const std::string &tensor_name) const override;
+
+    // these apply to the open shards and to the ones opened later
+    void set_prune_threshold(double threshold) override;
+
+    void set_sparse_layout(const SparseLayout &layout) override;
+
+    [[nodiscard]] size_t get_num_shards() const { return shards_.size(); }
+
+    // opens all shards that are not open yet, concurrently
+    void open_all_shards() const;
+
+   private:
+    struct Shard {
+        std::string filename;
+        std::once_flag opened;
+        std::unique_ptr<TensorFile> file;
+    };
+
+    // the file of the tensor's shard, opened if needed
+    TensorFile &get_shard_file(const std::string &tensor_name) const;
+
+    TensorFile &open_shard(size_t shard_index) const;
+
+    std::vector<std::string> tensor_names_;
+    std::unordered_map<std::string, size_t> shard_of_tensor_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace dalotia
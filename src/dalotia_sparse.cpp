@@ -0,0 +1,1153 @@
+#include "dalotia_sparse.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "dalotia_assignment.hpp"
+
+namespace dalotia {
+
+namespace {
+// the bits of row bytes [first_byte, first_byte + 8) that belong to columns,
+// as one little-endian word; the popcount of such words compiles to
+// popcnt (or to vpopcntq where the loop is vectorized)
+inline uint64_t bitmask_word(const uint8_t *row, size_t row_bytes,
+                             size_t first_byte, size_t num_columns) {
+    uint64_t word = 0;
+    const size_t num_bytes = std::min<size_t>(8, row_bytes - first_byte);
+    std::memcpy(&word, row + first_byte, num_bytes);  // little endian
+    const size_t valid_bits = num_columns - 8 * first_byte;
+    if (valid_bits < 64) {
+        word &= (uint64_t(1) << valid_bits) - 1;
+    }
+    return word;
+}
+
+inline size_t row_popcount(const uint8_t *row, size_t num_columns) {
+    const size_t row_bytes = bitmask_row_bytes(num_columns);
+    size_t count = 0;
+    for (size_t byte = 0; byte < row_bytes; byte += 8) {
+        count += __builtin_popcountll(
+            bitmask_word(row, row_bytes, byte, num_columns));
+    }
+    return count;
+}
+
+// exclusive prefix sum of the row counts, offsets has num_rows + 1 entries
+void row_offsets(const uint8_t *bitmask, size_t num_rows, size_t num_columns,
+                 size_t *offsets) {
+    const size_t row_bytes = bitmask_row_bytes(num_columns);
+    offsets[0] = 0;
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        offsets[r + 1] = row_popcount(bitmask + r * row_bytes, num_columns);
+    }
+    for (size_t r = 0; r < num_rows; ++r) {
+        offsets[r + 1] += offsets[r];
+    }
+}
+
+// magnitudes of the stored values, for the pruning threshold
+template <typename T>
+struct Magnitude {
+    static double of(const dalotia_byte *element) {
+        T value;
+        std::memcpy(&value, element, sizeof(T));
+        return std::fabs(static_cast<double>(value));
+    }
+};
+
+struct HalfMagnitude {
+    static double of(const dalotia_byte *element) {
+        uint16_t bits;
+        std::memcpy(&bits, element, 2);
+        const int exponent = (bits >> 10) & 0x1f;
+        const int mantissa = bits & 0x3ff;
+        if (exponent == 0x1f) {
+            return mantissa == 0 ? std::numeric_limits<double>::infinity()
+                                 : std::numeric_limits<double>::quiet_NaN();
+        }
+        if (exponent == 0) {  // subnormal
+            return std::ldexp(mantissa, -24);
+        }
+        return std::ldexp(mantissa + 1024, exponent - 25);
+    }
+};
+
+struct BfloatMagnitude {
+    static double of(const dalotia_byte *element) {
+        uint16_t bits;
+        std::memcpy(&bits, element, 2);
+        const uint32_t float_bits = static_cast<uint32_t>(bits) << 16;
+        float value;
+        std::memcpy(&value, &float_bits, 4);
+        return std::fabs(value);
+    }
+};
+
+template <typename Visitor>
+void visit_magnitude(dalotia_WeightFormat format, Visitor &&visitor) {
+    switch (format) {
+        case dalotia_float_64:
+            return visitor(Magnitude<double>());
+        case dalotia_float_32:
+            return visitor(Magnitude<float>());
+        case dalotia_float_16:
+            return visitor(HalfMagnitude());
+        case dalotia_bfloat_16:
+            return visitor(BfloatMagnitude());
+        case dalotia_uint_32:
+            return visitor(Magnitude<uint32_t>());
+        case dalotia_uint_16:
+            return visitor(Magnitude<uint16_t>());
+        case dalotia_uint_8:
+            return visitor(Magnitude<uint8_t>());
+        case dalotia_int_32:
+            return visitor(Magnitude<int32_t>());
+        case dalotia_int_16:
+            return visitor(Magnitude<int16_t>());
+        case dalotia_int_8:
+            return visitor(Magnitude<int8_t>());
+        default:
+            throw std::runtime_error(
+                "dalotia: cannot prune tensors of weight format " +
+                std::to_string(format));
+    }
+}
+
+// the dense tensor as matrix, addressed through the logical strides
+struct StridedMatrix {
+    StridedMatrix(const dalotia_byte *data, dalotia_WeightFormat format,
+                  const std::vector<int> &extents,
+                  const std::vector<size_t> &strides)
+        : data(data),
+          item_bytes(sizeof_weight_format(format)),
+          extents(extents),
+          strides(strides),
+          num_rows(sparse_num_rows(extents)),
+          num_columns(extents.empty() ? 1 : extents.back()),
+          column_stride(strides.empty() ? 1 : strides.back()) {
+        if (strides.size() != extents.size()) {
+            throw std::runtime_error("dalotia: one stride per dimension");
+        }
+    }
+
+    const dalotia_byte *row(size_t r) const {
+        // the row index enumerates all but the last dimension in C order
+        size_t offset = 0;
+        for (size_t d = extents.size(); d > 1; --d) {
+            offset += (r % extents[d - 2]) * strides[d - 2];
+            r /= extents[d - 2];
+        }
+        return data + offset * item_bytes;
+    }
+
+    const dalotia_byte *data;
+    size_t item_bytes;
+    const std::vector<int> &extents;
+    const std::vector<size_t> &strides;
+    size_t num_rows;
+    size_t num_columns;
+    size_t column_stride;
+};
+
+// the comparison keeps NaNs, which have no magnitude
+template <typename Magnitude>
+inline bool survives(const dalotia_byte *element, double threshold) {
+    return !(Magnitude::of(element) <= threshold);
+}
+
+template <typename Magnitude>
+size_t row_nnz(const StridedMatrix &matrix, size_t r, double threshold) {
+    const dalotia_byte *element = matrix.row(r);
+    const size_t step = matrix.column_stride * matrix.item_bytes;
+    size_t count = 0;
+    for (size_t c = 0; c < matrix.num_columns; ++c, element += step) {
+        count += survives<Magnitude>(element, threshold);
+    }
+    return count;
+}
+
+int to_int(size_t value, const char *what) {
+    if (value > static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error(std::string("dalotia: too many ") + what +
+                                 " for int");
+    }
+    return static_cast<int>(value);
+}
+
+void check_layout(const SparseLayout &layout) {
+    if (layout.block_rows <= 0 || layout.block_columns <= 0 ||
+        layout.chunk_size <= 0 || layout.sorting_scope <= 0) {
+        throw std::runtime_error("dalotia: invalid sparse layout");
+    }
+}
+
+inline size_t row_length(const CsrMatrix &csr, size_t r) {
+    return csr.row_ptr[r + 1] - csr.row_ptr[r];
+}
+
+size_t num_block_rows(const CsrMatrix &csr, const SparseLayout &layout) {
+    return (csr.num_rows + layout.block_rows - 1) / layout.block_rows;
+}
+
+// the sorted, distinct block columns that have non-zeros in a block row
+std::vector<int> nonzero_blocks(const CsrMatrix &csr, size_t block_row,
+                                const SparseLayout &layout) {
+    const size_t first_row = block_row * layout.block_rows;
+    const size_t end_row =
+        std::min(first_row + layout.block_rows, csr.num_rows);
+    std::vector<int> blocks;
+    blocks.reserve(csr.row_ptr[end_row] - csr.row_ptr[first_row]);
+    for (int k = csr.row_ptr[first_row]; k < csr.row_ptr[end_row]; ++k) {
+        blocks.push_back(csr.col_idx[k] / layout.block_columns);
+    }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+}
+
+// exclusive prefix sum of the blocks per block row
+std::vector<size_t> block_offsets(const CsrMatrix &csr,
+                                  const SparseLayout &layout) {
+    const size_t num_rows = num_block_rows(csr, layout);
+    std::vector<size_t> offsets(num_rows + 1, 0);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t br = 0; br < num_rows; ++br) {
+        offsets[br + 1] = nonzero_blocks(csr, br, layout).size();
+    }
+    for (size_t br = 0; br < num_rows; ++br) {
+        offsets[br + 1] += offsets[br];
+    }
+    return offsets;
+}
+
+// the original row of every stored row, sorted by decreasing length
+// within each window of sorting_scope rows
+std::vector<int> sell_permutation(const CsrMatrix &csr,
+                                  const SparseLayout &layout) {
+    std::vector<int> permutation(csr.num_rows);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    if (layout.sorting_scope > 1) {
+        const size_t scope = layout.sorting_scope;
+        const size_t num_windows = (csr.num_rows + scope - 1) / scope;
+#pragma omp parallel for schedule(static)
+        for (size_t w = 0; w < num_windows; ++w) {
+            std::stable_sort(
+                permutation.begin() + w * scope,
+                permutation.begin() + std::min((w + 1) * scope, csr.num_rows),
+                [&csr](int a, int b) {
+                    return row_length(csr, a) > row_length(csr, b);
+                });
+        }
+    }
+    return permutation;
+}
+
+// exclusive prefix sum of the padded chunk sizes
+std::vector<size_t> chunk_offsets(const CsrMatrix &csr,
+                                  const SparseLayout &layout,
+                                  const std::vector<int> &permutation) {
+    const size_t chunk_size = layout.chunk_size;
+    const size_t num_chunks = (csr.num_rows + chunk_size - 1) / chunk_size;
+    std::vector<size_t> offsets(num_chunks + 1, 0);
+#pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < num_chunks; ++c) {
+        size_t width = 0;
+        for (size_t p = c * chunk_size;
+             p < std::min((c + 1) * chunk_size, csr.num_rows); ++p) {
+            width = std::max(width, row_length(csr, permutation[p]));
+        }
+        offsets[c + 1] = width * chunk_size;
+    }
+    for (size_t c = 0; c < num_chunks; ++c) {
+        offsets[c + 1] += offsets[c];
+    }
+    return offsets;
+}
+
+void csr_to_bsr(const CsrMatrix &csr, const SparseLayout &layout,
+                dalotia_byte *values, int *block_row_ptr, int *block_col_idx) {
+    const auto offsets = block_offsets(csr, layout);
+    const size_t num_rows = offsets.size() - 1;
+    const size_t block_size =
+        static_cast<size_t>(layout.block_rows) * layout.block_columns;
+    to_int(offsets[num_rows] * block_size, "BSR values");
+    const size_t item_bytes = sizeof_weight_format(csr.weight_format);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (size_t br = 0; br < num_rows; ++br) {
+        const auto blocks = nonzero_blocks(csr, br, layout);
+        block_row_ptr[br] = static_cast<int>(offsets[br]);
+        std::copy(blocks.begin(), blocks.end(), block_col_idx + offsets[br]);
+        dalotia_byte *block_values = values + offsets[br] * block_size * item_bytes;
+        std::memset(block_values, 0, blocks.size() * block_size * item_bytes);
+        const size_t first_row = br * layout.block_rows;
+        const size_t end_row =
+            std::min(first_row + layout.block_rows, csr.num_rows);
+        for (size_t r = first_row; r < end_row; ++r) {
+            for (int k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; ++k) {
+                const int column = csr.col_idx[k];
+                const size_t block =
+                    std::lower_bound(blocks.begin(), blocks.end(),
+                                     column / layout.block_columns) -
+                    blocks.begin();
+                const size_t position =
+                    block * block_size + (r - first_row) * layout.block_columns +
+                    column % layout.block_columns;
+                std::memcpy(block_values + position * item_bytes,
+                            csr.values.data() + k * item_bytes, item_bytes);
+            }
+        }
+    }
+    block_row_ptr[num_rows] = static_cast<int>(offsets[num_rows]);
+}
+
+void csr_to_sell(const CsrMatrix &csr, const SparseLayout &layout,
+                 dalotia_byte *values, int *chunk_ptr_and_rows, int *col_idx) {
+    const auto permutation = sell_permutation(csr, layout);
+    const auto offsets = chunk_offsets(csr, layout, permutation);
+    const size_t num_chunks = offsets.size() - 1;
+    to_int(offsets[num_chunks], "SELL values");
+    const size_t chunk_size = layout.chunk_size;
+    const size_t item_bytes = sizeof_weight_format(csr.weight_format);
+    for (size_t c = 0; c <= num_chunks; ++c) {
+        chunk_ptr_and_rows[c] = static_cast<int>(offsets[c]);
+    }
+    std::copy(permutation.begin(), permutation.end(),
+              chunk_ptr_and_rows + num_chunks + 1);
+#pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < num_chunks; ++c) {
+        // padding: zero values in column 0
+        const size_t chunk_values = offsets[c + 1] - offsets[c];
+        std::memset(values + offsets[c] * item_bytes, 0,
+                    chunk_values * item_bytes);
+        std::fill(col_idx + offsets[c], col_idx + offsets[c + 1], 0);
+        for (size_t i = 0; i < chunk_size && c * chunk_size + i < csr.num_rows;
+             ++i) {
+            const int row = permutation[c * chunk_size + i];
+            for (int k = csr.row_ptr[row]; k < csr.row_ptr[row + 1]; ++k) {
+                const size_t position =
+                    offsets[c] + (k - csr.row_ptr[row]) * chunk_size + i;
+                col_idx[position] = csr.col_idx[k];
+                std::memcpy(values + position * item_bytes,
+                            csr.values.data() + k * item_bytes, item_bytes);
+            }
+        }
+    }
+}
+
+// sorts runs of the (key, value number) pairs in parallel, then merges
+// pairs of runs, also in parallel, until one run is left
+template <typename Key>
+void parallel_sort(std::vector<std::pair<Key, uint32_t>> &items) {
+    const size_t num_items = items.size();
+    const size_t run_length = std::max<size_t>(4096, (num_items + 63) / 64);
+    const size_t num_runs = (num_items + run_length - 1) / run_length;
+    auto begin = items.begin();
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_runs; ++r) {
+        std::sort(begin + r * run_length,
+                  begin + std::min((r + 1) * run_length, num_items));
+    }
+    for (size_t width = run_length; width < num_items; width *= 2) {
+        const size_t num_merges = (num_items + 2 * width - 1) / (2 * width);
+#pragma omp parallel for schedule(static)
+        for (size_t m = 0; m < num_merges; ++m) {
+            const size_t first = m * 2 * width;
+            std::inplace_merge(begin + first,
+                               begin + std::min(first + width, num_items),
+                               begin + std::min(first + 2 * width, num_items));
+        }
+    }
+}
+
+// the sort keys of all values of an N-d COO tensor; flags coordinates
+// outside the extents
+template <typename Key, typename KeyFunction>
+std::vector<std::pair<Key, uint32_t>> sorted_keys(const CooTensor &coo,
+                                                   KeyFunction key_of) {
+    const size_t nnz = coo.nnz();
+    const size_t num_dimensions = coo.extents.size();
+    to_int(nnz, "non-zeros");
+    std::vector<std::pair<Key, uint32_t>> keys(nnz);
+    bool out_of_range = false;
+#pragma omp parallel for schedule(static) reduction(|| : out_of_range)
+    for (size_t k = 0; k < nnz; ++k) {
+        const int *coordinates = coo.coordinates.data() + k * num_dimensions;
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            out_of_range = out_of_range || coordinates[d] < 0 ||
+                           coordinates[d] >= coo.extents[d];
+        }
+        keys[k] = {key_of(coordinates), static_cast<uint32_t>(k)};
+    }
+    if (out_of_range) {
+        throw std::runtime_error("dalotia: COO coordinates outside the extents");
+    }
+    parallel_sort(keys);
+    return keys;
+}
+
+inline uint64_t deposit_bits(uint64_t value, uint64_t mask) {
+#if defined(__BMI2__)
+    return _pdep_u64(value, mask);
+#else
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask != 0; bit <<= 1) {
+        if (value & bit) {
+            result |= mask & (~mask + 1);  // the lowest bit of the mask
+        }
+        mask &= mask - 1;
+    }
+    return result;
+#endif
+}
+
+inline uint64_t extract_bits(uint64_t value, uint64_t mask) {
+#if defined(__BMI2__)
+    return _pext_u64(value, mask);
+#else
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask != 0; bit <<= 1) {
+        if (value & mask & (~mask + 1)) {
+            result |= bit;
+        }
+        mask &= mask - 1;
+    }
+    return result;
+#endif
+}
+
+// HiCOO sorts by the Z-order of the blocks, then inside the blocks
+struct HicooKeys {
+    HicooKeys(const std::vector<int> &extents, int block_bits)
+        : block_bits(block_bits) {
+        if (block_bits <= 0 || block_bits > 16) {
+            throw std::runtime_error("dalotia: HiCOO block bits must be in [1, 16]");
+        }
+        std::vector<int> block_extents, element_extents;
+        for (const int extent : extents) {
+            block_extents.push_back(((extent - 1) >> block_bits) + 1);
+            element_extents.push_back(std::min(extent, 1 << block_bits));
+        }
+        block_masks = alto_masks(block_extents);
+        element_masks = alto_masks(element_extents);
+    }
+
+    std::pair<uint64_t, uint64_t> operator()(const int *coordinates) const {
+        uint64_t block_key = 0, element_key = 0;
+        for (size_t d = 0; d < block_masks.size(); ++d) {
+            block_key |= deposit_bits(coordinates[d] >> block_bits, block_masks[d]);
+            element_key |= deposit_bits(coordinates[d] & ((1 << block_bits) - 1),
+                                        element_masks[d]);
+        }
+        return {block_key, element_key};
+    }
+
+    int block_bits;
+    std::vector<uint64_t> block_masks;
+    std::vector<uint64_t> element_masks;
+};
+
+// the graph that RCM orders, as adjacency lists without self-loops or
+// duplicates; columns are nodes of their own unless the matrix is square
+struct AdjacencyGraph {
+    std::vector<size_t> offsets;
+    std::vector<int> neighbors;
+
+    [[nodiscard]] size_t num_nodes() const { return offsets.size() - 1; }
+    [[nodiscard]] size_t degree(int node) const {
+        return offsets[node + 1] - offsets[node];
+    }
+};
+
+AdjacencyGraph rcm_graph(const CsrMatrix &csr) {
+    const bool square = csr.num_rows == csr.num_columns;
+    const size_t num_nodes =
+        square ? csr.num_rows : csr.num_rows + csr.num_columns;
+    to_int(num_nodes, "rows and columns");
+    const int first_column_node = square ? 0 : static_cast<int>(csr.num_rows);
+    std::vector<size_t> counts(num_nodes + 1, 0);
+    for (size_t r = 0; r < csr.num_rows; ++r) {
+        for (int k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; ++k) {
+            const size_t c = csr.col_idx[k] + first_column_node;
+            if (c != r) {
+                ++counts[r + 1];
+                ++counts[c + 1];
+            }
+        }
+    }
+    std::partial_sum(counts.begin(), counts.end(), counts.begin());
+    std::vector<int> neighbors(counts.back());
+    std::vector<size_t> positions(counts.begin(), counts.end() - 1);
+    for (size_t r = 0; r < csr.num_rows; ++r) {
+        for (int k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; ++k) {
+            const size_t c = csr.col_idx[k] + first_column_node;
+            if (c != r) {
+                neighbors[positions[r]++] = static_cast<int>(c);
+                neighbors[positions[c]++] = static_cast<int>(r);
+            }
+        }
+    }
+    // A + A^T has each off-diagonal pair twice if both entries are stored
+    AdjacencyGraph graph;
+    graph.offsets.assign(num_nodes + 1, 0);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t n = 0; n < num_nodes; ++n) {
+        auto begin = neighbors.begin() + counts[n];
+        auto end = neighbors.begin() + counts[n + 1];
+        std::sort(begin, end);
+        graph.offsets[n + 1] = std::unique(begin, end) - begin;
+    }
+    std::partial_sum(graph.offsets.begin(), graph.offsets.end(),
+                     graph.offsets.begin());
+    graph.neighbors.resize(graph.offsets.back());
+#pragma omp parallel for schedule(static)
+    for (size_t n = 0; n < num_nodes; ++n) {
+        std::copy(neighbors.begin() + counts[n],
+                  neighbors.begin() + counts[n] + graph.degree(n),
+                  graph.neighbors.begin() + graph.offsets[n]);
+    }
+    return graph;
+}
+
+// appends the nodes reachable from root to order, level by level, and with
+// the new neighbors of every node by increasing degree if sorted; nodes
+// are visited once per stamp; returns the number of levels and the
+// position in order where the last level starts
+std::pair<size_t, size_t> breadth_first(const AdjacencyGraph &graph, int root,
+                                        bool sorted, size_t stamp,
+                                        std::vector<size_t> &visited,
+                                        std::vector<int> &order) {
+    size_t level_begin = order.size(), num_levels = 1;
+    visited[root] = stamp;
+    order.push_back(root);
+    while (true) {
+        const size_t level_end = order.size();
+        for (size_t i = level_begin; i < level_end; ++i) {
+            const size_t first_new = order.size();
+            const int node = order[i];
+            for (size_t k = graph.offsets[node]; k < graph.offsets[node + 1];
+                 ++k) {
+                const int neighbor = graph.neighbors[k];
+                if (visited[neighbor] != stamp) {
+                    visited[neighbor] = stamp;
+                    order.push_back(neighbor);
+                }
+            }
+            if (sorted) {
+                std::stable_sort(order.begin() + first_new, order.end(),
+                                 [&graph](int a, int b) {
+                                     return graph.degree(a) < graph.degree(b);
+                                 });
+            }
+        }
+        if (order.size() == level_end) {
+            return {num_levels, level_begin};
+        }
+        ++num_levels;
+        level_begin = level_end;
+    }
+}
+}  // namespace
+
+size_t bitmask_popcount(const uint8_t *bitmask, size_t num_rows,
+                        size_t num_columns) {
+    const size_t row_bytes = bitmask_row_bytes(num_columns);
+    size_t count = 0;
+#pragma omp parallel for schedule(static) reduction(+ : count)
+    for (size_t r = 0; r < num_rows; ++r) {
+        count += row_popcount(bitmask + r * row_bytes, num_columns);
+    }
+    return count;
+}
+
+void bitmask_to_csr(const uint8_t *bitmask, size_t num_rows,
+                    size_t num_columns, int *row_ptr, int *col_idx) {
+    if (num_columns > static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("bitmask_to_csr: too many columns for int");
+    }
+    std::vector<size_t> offsets(num_rows + 1);
+    row_offsets(bitmask, num_rows, num_columns, offsets.data());
+    if (offsets[num_rows] > static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("bitmask_to_csr: too many non-zeros for int");
+    }
+    const size_t row_bytes = bitmask_row_bytes(num_columns);
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        row_ptr[r] = static_cast<int>(offsets[r]);
+        const uint8_t *row = bitmask + r * row_bytes;
+        int *column = col_idx + offsets[r];
+        for (size_t byte = 0; byte < row_bytes; byte += 8) {
+            uint64_t word = bitmask_word(row, row_bytes, byte, num_columns);
+            while (word != 0) {
+                *column++ = static_cast<int>(8 * byte + __builtin_ctzll(word));
+                word &= word - 1;  // clear the lowest set bit
+            }
+        }
+    }
+    row_ptr[num_rows] = static_cast<int>(offsets[num_rows]);
+}
+
+void bitmask_to_dense(const uint8_t *bitmask, size_t num_rows,
+                      size_t num_columns, const dalotia_byte *values,
+                      dalotia_WeightFormat values_format, dalotia_byte *dense,
+                      dalotia_WeightFormat dense_format) {
+    std::vector<size_t> offsets(num_rows + 1);
+    row_offsets(bitmask, num_rows, num_columns, offsets.data());
+    const size_t row_bytes = bitmask_row_bytes(num_columns);
+    const size_t load_item_bytes = sizeof_weight_format(values_format);
+    const size_t store_item_bytes = sizeof_weight_format(dense_format);
+    auto assign_function = get_assignment_function(dense_format, values_format);
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        dalotia_byte *dense_row = dense + r * num_columns * store_item_bytes;
+        std::memset(dense_row, 0, num_columns * store_item_bytes);
+        const uint8_t *row = bitmask + r * row_bytes;
+        const dalotia_byte *value = values + offsets[r] * load_item_bytes;
+        for (size_t byte = 0; byte < row_bytes; byte += 8) {
+            uint64_t word = bitmask_word(row, row_bytes, byte, num_columns);
+            while (word != 0) {
+                const size_t column = 8 * byte + __builtin_ctzll(word);
+                assign_function(dense_row + column * store_item_bytes, value);
+                value += load_item_bytes;
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+size_t sparse_num_rows(const std::vector<int> &extents) {
+    if (extents.empty()) {
+        return 1;
+    }
+    return std::accumulate(extents.begin(), extents.end() - 1, size_t(1),
+                           std::multiplies<size_t>());
+}
+
+std::vector<int> sparse_extents(dalotia_SparseFormat format, size_t nnz,
+                                size_t num_rows) {
+    if (nnz > static_cast<size_t>(INT_MAX) ||
+        num_rows >= static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("dalotia: sparse extents too large for int");
+    }
+    const int nnz_int = static_cast<int>(nnz);
+    if (format == dalotia_CSR) {
+        return {nnz_int, static_cast<int>(num_rows) + 1, nnz_int};
+    } else if (format == dalotia_COO) {
+        return {nnz_int, nnz_int, nnz_int};
+    }
+    throw std::runtime_error("dalotia: unknown sparse format " +
+                             std::to_string(format));
+}
+
+std::vector<size_t> dense_strides(const std::vector<int> &extents,
+                                  const std::vector<int> &storage_order) {
+    const size_t num_dimensions = extents.size();
+    std::vector<size_t> strides(num_dimensions);
+    size_t stride = 1;
+    for (size_t d = num_dimensions; d-- > 0;) {
+        const size_t logical_dimension =
+            storage_order.empty() ? d : storage_order[d];
+        strides[logical_dimension] = stride;
+        stride *= extents[logical_dimension];
+    }
+    return strides;
+}
+
+size_t dense_nnz(const dalotia_byte *data, dalotia_WeightFormat format,
+                 const std::vector<int> &extents,
+                 const std::vector<size_t> &strides, double threshold) {
+    const StridedMatrix matrix(data, format, extents, strides);
+    size_t count = 0;
+    visit_magnitude(format, [&](auto magnitude) {
+        using Magnitude = decltype(magnitude);
+        size_t sum = 0;
+#pragma omp parallel for schedule(static) reduction(+ : sum)
+        for (size_t r = 0; r < matrix.num_rows; ++r) {
+            sum += row_nnz<Magnitude>(matrix, r, threshold);
+        }
+        count = sum;
+    });
+    return count;
+}
+
+void dense_to_sparse(const dalotia_byte *data, dalotia_WeightFormat format,
+                     const std::vector<int> &extents,
+                     const std::vector<size_t> &strides, double threshold,
+                     dalotia_SparseFormat sparse_format,
+                     dalotia_WeightFormat values_format, dalotia_byte *values,
+                     int *first_indices, int *second_indices) {
+    if (sparse_format != dalotia_CSR && sparse_format != dalotia_COO) {
+        throw std::runtime_error("dense_to_sparse: unknown sparse format");
+    }
+    const StridedMatrix matrix(data, format, extents, strides);
+    if (matrix.num_columns > static_cast<size_t>(INT_MAX) ||
+        matrix.num_rows >= static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("dense_to_sparse: too many rows or columns for int");
+    }
+    const size_t store_item_bytes = sizeof_weight_format(values_format);
+    auto assign_function = get_assignment_function(values_format, format);
+    visit_magnitude(format, [&](auto magnitude) {
+        using Magnitude = decltype(magnitude);
+        std::vector<size_t> offsets(matrix.num_rows + 1);
+        offsets[0] = 0;
+#pragma omp parallel for schedule(static)
+        for (size_t r = 0; r < matrix.num_rows; ++r) {
+            offsets[r + 1] = row_nnz<Magnitude>(matrix, r, threshold);
+        }
+        for (size_t r = 0; r < matrix.num_rows; ++r) {
+            offsets[r + 1] += offsets[r];
+        }
+        if (offsets[matrix.num_rows] > static_cast<size_t>(INT_MAX)) {
+            throw std::runtime_error(
+                "dense_to_sparse: too many non-zeros for int");
+        }
+        const size_t step = matrix.column_stride * matrix.item_bytes;
+#pragma omp parallel for schedule(static)
+        for (size_t r = 0; r < matrix.num_rows; ++r) {
+            size_t k = offsets[r];
+            const dalotia_byte *element = matrix.row(r);
+            for (size_t c = 0; c < matrix.num_columns; ++c, element += step) {
+                if (survives<Magnitude>(element, threshold)) {
+                    assign_function(values + k * store_item_bytes, element);
+                    if (sparse_format == dalotia_COO) {
+                        first_indices[k] = static_cast<int>(r);
+                    }
+                    second_indices[k] = static_cast<int>(c);
+                    ++k;
+                }
+            }
+            if (sparse_format == dalotia_CSR) {
+                first_indices[r] = static_cast<int>(offsets[r]);
+            }
+        }
+        if (sparse_format == dalotia_CSR) {
+            first_indices[matrix.num_rows] =
+                static_cast<int>(offsets[matrix.num_rows]);
+        }
+    });
+}
+
+CsrMatrix allocate_csr_matrix(const std::vector<int> &extents, size_t nnz,
+                              dalotia_WeightFormat weight_format) {
+    CsrMatrix csr;
+    csr.extents = extents;
+    csr.num_rows = sparse_num_rows(extents);
+    csr.num_columns = extents.empty() ? 1 : extents.back();
+    csr.weight_format = weight_format;
+    csr.row_ptr.resize(csr.num_rows + 1);
+    csr.col_idx.resize(nnz);
+    csr.values.resize(nnz * sizeof_weight_format(weight_format));
+    return csr;
+}
+
+std::vector<int> derived_sparse_extents(const CsrMatrix &csr,
+                                        dalotia_SparseFormat format,
+                                        const SparseLayout &layout) {
+    check_layout(layout);
+    if (format == dalotia_COO_ND || format == dalotia_ALTO ||
+        format == dalotia_HiCOO) {
+        return coo_tensor_extents(csr_to_coo_tensor(csr), format, layout);
+    } else if (format == dalotia_BSR) {
+        const auto offsets = block_offsets(csr, layout);
+        const size_t num_blocks = offsets.back();
+        return {to_int(num_blocks * layout.block_rows * layout.block_columns,
+                       "BSR values"),
+                to_int(offsets.size(), "block rows"),
+                to_int(num_blocks, "blocks")};
+    } else if (format == dalotia_SELL) {
+        const auto offsets =
+            chunk_offsets(csr, layout, sell_permutation(csr, layout));
+        const int num_values = to_int(offsets.back(), "SELL values");
+        return {num_values, to_int(offsets.size() + csr.num_rows, "chunks"),
+                num_values};
+    }
+    throw std::runtime_error("derived_sparse_extents: not a derived format");
+}
+
+void csr_to_derived(const CsrMatrix &csr, dalotia_SparseFormat format,
+                    const SparseLayout &layout, dalotia_byte *values,
+                    int *first_indices, int *second_indices) {
+    check_layout(layout);
+    if (format == dalotia_BSR) {
+        csr_to_bsr(csr, layout, values, first_indices, second_indices);
+    } else if (format == dalotia_SELL) {
+        csr_to_sell(csr, layout, values, first_indices, second_indices);
+    } else if (format == dalotia_COO_ND || format == dalotia_ALTO ||
+               format == dalotia_HiCOO) {
+        coo_tensor_to(csr_to_coo_tensor(csr), format, layout,
+                      csr.weight_format, values, first_indices, second_indices);
+    } else {
+        throw std::runtime_error("csr_to_derived: not a derived format");
+    }
+}
+
+void csr_to_sparse(const CsrMatrix &csr, dalotia_SparseFormat format,
+                   const SparseLayout &layout, dalotia_byte *values,
+                   int *first_indices, int *second_indices) {
+    if (format != dalotia_CSR && format != dalotia_COO) {
+        csr_to_derived(csr, format, layout, values, first_indices,
+                       second_indices);
+        return;
+    }
+    std::copy(csr.values.begin(), csr.values.end(), values);
+    std::copy(csr.col_idx.begin(), csr.col_idx.end(), second_indices);
+    if (format == dalotia_CSR) {
+        std::copy(csr.row_ptr.begin(), csr.row_ptr.end(), first_indices);
+        return;
+    }
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < csr.num_rows; ++r) {
+        std::fill(first_indices + csr.row_ptr[r],
+                  first_indices + csr.row_ptr[r + 1], static_cast<int>(r));
+    }
+}
+
+SparsePermutation identity_permutation(const std::vector<int> &extents) {
+    SparsePermutation permutation;
+    permutation.rows.resize(sparse_num_rows(extents));
+    permutation.columns.resize(extents.empty() ? 1 : extents.back());
+    std::iota(permutation.rows.begin(), permutation.rows.end(), 0);
+    std::iota(permutation.columns.begin(), permutation.columns.end(), 0);
+    return permutation;
+}
+
+SparsePermutation rcm_permutation(const CsrMatrix &csr) {
+    const AdjacencyGraph graph = rcm_graph(csr);
+    const size_t num_nodes = graph.num_nodes();
+    // components are started from their node of least degree
+    std::vector<int> by_degree(num_nodes);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+                     [&graph](int a, int b) {
+                         return graph.degree(a) < graph.degree(b);
+                     });
+    std::vector<size_t> visited(num_nodes, 0);
+    size_t stamp = 0;
+    std::vector<int> order, levels;
+    order.reserve(num_nodes);
+    for (const int start : by_degree) {
+        if (visited[start] != 0) {
+            continue;  // in a component that is already ordered
+        }
+        // pseudo-peripheral root (George and Liu): restart from a node of
+        // least degree in the last level while the depth grows
+        int root = start;
+        levels.clear();
+        auto [depth, last_level] =
+            breadth_first(graph, root, false, ++stamp, visited, levels);
+        while (true) {
+            const int candidate = *std::min_element(
+                levels.begin() + last_level, levels.end(),
+                [&graph](int a, int b) {
+                    return graph.degree(a) < graph.degree(b);
+                });
+            std::vector<int> candidate_levels;
+            const auto [candidate_depth, candidate_last_level] = breadth_first(
+                graph, candidate, false, ++stamp, visited, candidate_levels);
+            if (candidate_depth <= depth) {
+                break;
+            }
+            root = candidate;
+            depth = candidate_depth;
+            last_level = candidate_last_level;
+            levels.swap(candidate_levels);
+        }
+        breadth_first(graph, root, true, ++stamp, visited, order);
+    }
+    std::reverse(order.begin(), order.end());
+
+    SparsePermutation permutation;
+    if (csr.num_rows == csr.num_columns) {
+        permutation.rows = order;
+        permutation.columns = std::move(order);
+        return permutation;
+    }
+    permutation.rows.reserve(csr.num_rows);
+    permutation.columns.reserve(csr.num_columns);
+    for (const int node : order) {
+        if (static_cast<size_t>(node) < csr.num_rows) {
+            permutation.rows.push_back(node);
+        } else {
+            permutation.columns.push_back(node - static_cast<int>(csr.num_rows));
+        }
+    }
+    return permutation;
+}
+
+void permute_csr_to_sparse(const CsrMatrix &csr,
+                           const SparsePermutation &permutation,
+                           dalotia_SparseFormat format, dalotia_byte *values,
+                           int *first_indices, int *second_indices) {
+    if (format != dalotia_CSR && format != dalotia_COO) {
+        throw std::runtime_error("permute_csr: CSR or COO only");
+    }
+    auto inverse = [](const std::vector<int> &permutation, size_t size) {
+        std::vector<int> inverse(size, -1);
+        if (permutation.size() != size) {
+            throw std::runtime_error("permute_csr: wrong permutation size");
+        }
+        for (size_t i = 0; i < size; ++i) {
+            const int original = permutation[i];
+            if (original < 0 || static_cast<size_t>(original) >= size ||
+                inverse[original] != -1) {
+                throw std::runtime_error("permute_csr: not a permutation");
+            }
+            inverse[original] = static_cast<int>(i);
+        }
+        return inverse;
+    };
+    inverse(permutation.rows, csr.num_rows);
+    const auto new_columns = inverse(permutation.columns, csr.num_columns);
+
+    // the row offsets are the output for CSR, a temporary for COO
+    std::vector<int> coo_row_ptr(format == dalotia_COO ? csr.num_rows + 1 : 0);
+    int *row_ptr = format == dalotia_CSR ? first_indices : coo_row_ptr.data();
+    row_ptr[0] = 0;
+    for (size_t i = 0; i < csr.num_rows; ++i) {
+        row_ptr[i + 1] = row_ptr[i] +
+                         static_cast<int>(row_length(csr, permutation.rows[i]));
+    }
+    const size_t item_bytes = sizeof_weight_format(csr.weight_format);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (size_t i = 0; i < csr.num_rows; ++i) {
+        const int row = permutation.rows[i];
+        std::vector<std::pair<int, int>> entries;  // (new column, position)
+        entries.reserve(row_length(csr, row));
+        for (int k = csr.row_ptr[row]; k < csr.row_ptr[row + 1]; ++k) {
+            entries.emplace_back(new_columns[csr.col_idx[k]], k);
+        }
+        std::sort(entries.begin(), entries.end());
+        for (size_t e = 0; e < entries.size(); ++e) {
+            const size_t position = row_ptr[i] + e;
+            second_indices[position] = entries[e].first;
+            std::memcpy(values + position * item_bytes,
+                        csr.values.data() + entries[e].second * item_bytes,
+                        item_bytes);
+            if (format == dalotia_COO) {
+                first_indices[position] = static_cast<int>(i);
+            }
+        }
+    }
+}
+
+CsrMatrix permute_csr(const CsrMatrix &csr,
+                      const SparsePermutation &permutation) {
+    CsrMatrix permuted =
+        allocate_csr_matrix(csr.extents, csr.col_idx.size(), csr.weight_format);
+    permute_csr_to_sparse(csr, permutation, dalotia_CSR, permuted.values.data(),
+                          permuted.row_ptr.data(), permuted.col_idx.data());
+    return permuted;
+}
+
+size_t csr_bandwidth(const CsrMatrix &csr) {
+    size_t bandwidth = 0;
+#pragma omp parallel for schedule(static) reduction(max : bandwidth)
+    for (size_t r = 0; r < csr.num_rows; ++r) {
+        for (int k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; ++k) {
+            const size_t c = csr.col_idx[k];
+            bandwidth = std::max(bandwidth, c > r ? c - r : r - c);
+        }
+    }
+    return bandwidth;
+}
+
+CooTensor csr_to_coo_tensor(const CsrMatrix &csr) {
+    CooTensor coo;
+    coo.extents = csr.extents;
+    coo.weight_format = csr.weight_format;
+    coo.values = csr.values;
+    const size_t num_dimensions = csr.extents.size();
+    coo.coordinates.resize(csr.col_idx.size() * num_dimensions);
+    if (num_dimensions == 0) {
+        return coo;
+    }
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < csr.num_rows; ++r) {
+        // the leading coordinates of the row, then the column
+        std::vector<int> coordinates(num_dimensions);
+        size_t remainder = r;
+        for (size_t d = num_dimensions - 1; d > 0; --d) {
+            coordinates[d - 1] = remainder % csr.extents[d - 1];
+            remainder /= csr.extents[d - 1];
+        }
+        for (int k = csr.row_ptr[r]; k < csr.row_ptr[r + 1]; ++k) {
+            coordinates[num_dimensions - 1] = csr.col_idx[k];
+            std::copy(coordinates.begin(), coordinates.end(),
+                      coo.coordinates.begin() + k * num_dimensions);
+        }
+    }
+    return coo;
+}
+
+std::vector<uint64_t> alto_masks(const std::vector<int> &extents) {
+    std::vector<int> num_bits(extents.size(), 0);
+    for (size_t d = 0; d < extents.size(); ++d) {
+        while (num_bits[d] < 31 && (1 << num_bits[d]) < extents[d]) {
+            ++num_bits[d];
+        }
+    }
+    std::vector<uint64_t> masks(extents.size(), 0);
+    int position = 0;
+    for (int level = 0; level < 31; ++level) {
+        for (size_t d = 0; d < extents.size(); ++d) {
+            if (level < num_bits[d]) {
+                if (position == 64) {
+                    throw std::runtime_error(
+                        "dalotia: the ALTO index needs more than 64 bits");
+                }
+                masks[d] |= uint64_t(1) << position++;
+            }
+        }
+    }
+    return masks;
+}
+
+uint64_t alto_index(const int *coordinates, const std::vector<uint64_t> &masks) {
+    uint64_t index = 0;
+    for (size_t d = 0; d < masks.size(); ++d) {
+        index |= deposit_bits(static_cast<uint64_t>(coordinates[d]), masks[d]);
+    }
+    return index;
+}
+
+int alto_coordinate(uint64_t index, uint64_t mask) {
+    return static_cast<int>(extract_bits(index, mask));
+}
+
+size_t hicoo_num_blocks(const CooTensor &coo, int block_bits) {
+    const HicooKeys key_of(coo.extents, block_bits);
+    const auto keys = sorted_keys<std::pair<uint64_t, uint64_t>>(coo, key_of);
+    size_t num_blocks = 0;
+#pragma omp parallel for schedule(static) reduction(+ : num_blocks)
+    for (size_t i = 0; i < keys.size(); ++i) {
+        num_blocks += i == 0 || keys[i].first.first != keys[i - 1].first.first;
+    }
+    return num_blocks;
+}
+
+std::vector<int> coo_tensor_extents(const CooTensor &coo,
+                                    dalotia_SparseFormat format,
+                                    const SparseLayout &layout) {
+    const size_t nnz = coo.nnz();
+    const size_t num_dimensions = coo.extents.size();
+    const int nnz_int = to_int(nnz, "non-zeros");
+    if (format == dalotia_COO_ND) {
+        return {nnz_int, to_int(nnz * num_dimensions, "coordinates"), 0};
+    } else if (format == dalotia_ALTO) {
+        alto_masks(coo.extents);  // throws if the index does not fit
+        return {nnz_int, to_int(2 * nnz, "ALTO indices"),
+                static_cast<int>(2 * num_dimensions)};
+    } else if (format == dalotia_HiCOO) {
+        const size_t num_blocks = hicoo_num_blocks(coo, layout.hicoo_block_bits);
+        return {nnz_int,
+                to_int(num_blocks + 1 + num_blocks * num_dimensions,
+                       "HiCOO blocks"),
+                to_int(nnz * num_dimensions, "coordinates")};
+    }
+    throw std::runtime_error("coo_tensor_extents: not an N-d sparse format");
+}
+
+void coo_tensor_to(const CooTensor &coo, dalotia_SparseFormat format,
+                   const SparseLayout &layout,
+                   dalotia_WeightFormat values_format, dalotia_byte *values,
+                   int *first_indices, int *second_indices) {
+    const size_t num_dimensions = coo.extents.size();
+    const size_t load_item_bytes = sizeof_weight_format(coo.weight_format);
+    const size_t store_item_bytes = sizeof_weight_format(values_format);
+    auto assign_function =
+        get_assignment_function(values_format, coo.weight_format);
+    // the k-th output value is the input value keys[k].second
+    auto scatter_values = [&](const auto &keys) {
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < keys.size(); ++k) {
+            assign_function(values + k * store_item_bytes,
+                            coo.values.data() + keys[k].second * load_item_bytes);
+        }
+    };
+
+    if (format == dalotia_COO_ND) {
+        // C order of the coordinates is the order of the linear index
+        std::vector<size_t> strides(num_dimensions, 1);
+        for (size_t d = num_dimensions; d > 1; --d) {
+            if (__builtin_mul_overflow(strides[d - 1], size_t(coo.extents[d - 1]),
+                                       &strides[d - 2])) {
+                throw std::runtime_error("coo_tensor_to: tensor too large");
+            }
+        }
+        const auto keys = sorted_keys<size_t>(coo, [&](const int *coordinates) {
+            size_t index = 0;
+            for (size_t d = 0; d < num_dimensions; ++d) {
+                index += coordinates[d] * strides[d];
+            }
+            return index;
+        });
+        scatter_values(keys);
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < keys.size(); ++k) {
+            std::copy_n(coo.coordinates.begin() + keys[k].second * num_dimensions,
+                        num_dimensions, first_indices + k * num_dimensions);
+        }
+    } else if (format == dalotia_ALTO) {
+        const auto masks = alto_masks(coo.extents);
+        const auto keys = sorted_keys<uint64_t>(coo, [&](const int *coordinates) {
+            return alto_index(coordinates, masks);
+        });
+        scatter_values(keys);
+        // the caller's buffers hold uint64_t, possibly not 8-byte aligned
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < keys.size(); ++k) {
+            std::memcpy(first_indices + 2 * k, &keys[k].first, 8);
+        }
+        std::memcpy(second_indices, masks.data(), 8 * num_dimensions);
+    } else if (format == dalotia_HiCOO) {
+        const HicooKeys key_of(coo.extents, layout.hicoo_block_bits);
+        const auto keys = sorted_keys<std::pair<uint64_t, uint64_t>>(coo, key_of);
+        scatter_values(keys);
+        // the blocks start where the block key changes
+        std::vector<size_t> block_starts;
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (k == 0 || keys[k].first.first != keys[k - 1].first.first) {
+                block_starts.push_back(k);
+            }
+        }
+        const size_t num_blocks = block_starts.size();
+        int *block_coordinates = first_indices + num_blocks + 1;
+        const int block_mask = (1 << layout.hicoo_block_bits) - 1;
+#pragma omp parallel for schedule(static)
+        for (size_t b = 0; b < num_blocks; ++b) {
+            first_indices[b] = static_cast<int>(block_starts[b]);
+            const int *coordinates =
+                coo.coordinates.data() + keys[block_starts[b]].second * num_dimensions;
+            for (size_t d = 0; d < num_dimensions; ++d) {
+                block_coordinates[b * num_dimensions + d] =
+                    coordinates[d] >> layout.hicoo_block_bits;
+            }
+        }
+        first_indices[num_blocks] = static_cast<int>(keys.size());
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < keys.size(); ++k) {
+            const int *coordinates =
+                coo.coordinates.data() + keys[k].second * num_dimensions;
+            for (size_t d = 0; d < num_dimensions; ++d) {
+                second_indices[k * num_dimensions + d] = coordinates[d] & block_mask;
+            }
+        }
+    } else {
+        throw std::runtime_error("coo_tensor_to: not an N-d sparse format");
+    }
+}
+
+}  // namespace dalotia
@@ -0,0 +1,201 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+// kernels for the bitmask compression of compressed-tensors, cf.
+// https://github.com/neuralmagic/compressed-tensors: a 2d tensor is
+// stored as its non-zero values in row-major order plus a bitmask with
+// one bit per element, packed little-endian along each row (numpy.packbits
+// with bitorder="little"), so every row starts at a byte boundary
+
+// bytes of one row of the bitmask
+inline size_t bitmask_row_bytes(size_t num_columns) {
+    return (num_columns + 7) / 8;
+}
+
+// number of set bits in the bitmask, i.e. the number of non-zeros
+size_t bitmask_popcount(const uint8_t *bitmask, size_t num_rows,
+                        size_t num_columns);
+
+// CSR structure of the bitmask: row_ptr (num_rows + 1 entries) and col_idx
+// (one entry per non-zero); the rows are counted and filled in parallel,
+// with a prefix sum in between
+void bitmask_to_csr(const uint8_t *bitmask, size_t num_rows,
+                    size_t num_columns, int *row_ptr, int *col_idx);
+
+// zeroes the C-ordered dense tensor and scatters the values into it
+void bitmask_to_dense(const uint8_t *bitmask, size_t num_rows,
+                      size_t num_columns, const dalotia_byte *values,
+                      dalotia_WeightFormat values_format, dalotia_byte *dense,
+                      dalotia_WeightFormat dense_format);
+
+// kernels that prune a dense tensor on load: every element whose magnitude
+// is at most the threshold is dropped (0: only exact zeros, negative: none),
+// without materializing the dense tensor; as for the bitmask, a tensor is
+// seen as the matrix of its last dimension by all leading dimensions
+
+// number of rows of that matrix, i.e. the product of the leading extents
+size_t sparse_num_rows(const std::vector<int> &extents);
+
+// lengths of the values, first and second indices of a sparse matrix:
+// {nnz, num_rows + 1, nnz} for CSR, {nnz, nnz, nnz} for COO
+std::vector<int> sparse_extents(dalotia_SparseFormat format, size_t nnz,
+                                size_t num_rows);
+
+// strides (in elements) of the logical dimensions of a payload that is a
+// C-ordered tensor whose dimension d is the logical dimension
+// storage_order[d] (empty: C order), cf. MappedTensor
+std::vector<size_t> dense_strides(const std::vector<int> &extents,
+                                  const std::vector<int> &storage_order = {});
+
+// number of elements that survive the pruning, counted in parallel
+size_t dense_nnz(const dalotia_byte *data, dalotia_WeightFormat format,
+                 const std::vector<int> &extents,
+                 const std::vector<size_t> &strides, double threshold);
+
+// CSR (row_ptr, col_idx) or COO (row and column index per value) of the
+// surviving elements, values converted to values_format; rows are counted
+// in parallel, prefix-summed and then filled in parallel
+void dense_to_sparse(const dalotia_byte *data, dalotia_WeightFormat format,
+                     const std::vector<int> &extents,
+                     const std::vector<size_t> &strides, double threshold,
+                     dalotia_SparseFormat sparse_format,
+                     dalotia_WeightFormat values_format, dalotia_byte *values,
+                     int *first_indices, int *second_indices);
+
+// BSR and SELL-C-sigma are derived from CSR, with these parameters
+struct SparseLayout {
+    int block_rows = 4;  // BSR block shape
+    int block_columns = 4;
+    int chunk_size = 8;     // C: rows per SELL chunk, e.g. the SIMD width
+    int sorting_scope = 1;  // sigma: rows sorted within windows of that many
+    int hicoo_block_bits = 7;  // HiCOO blocks of 128 per mode
+    bool reorder_rcm = false;  // reverse Cuthill-McKee reordering on load
+};
+
+// the formats that are not produced directly by the backends, but from CSR
+inline bool is_derived_sparse_format(dalotia_SparseFormat format) {
+    return format == dalotia_BSR || format == dalotia_SELL ||
+           format == dalotia_COO_ND || format == dalotia_ALTO ||
+           format == dalotia_HiCOO;
+}
+
+// a CSR matrix held in buffers, with values in weight_format; extents are
+// those of the tensor it was built from
+struct CsrMatrix {
+    std::vector<int> extents;
+    size_t num_rows = 0;
+    size_t num_columns = 0;
+    dalotia_WeightFormat weight_format = dalotia_float_32;
+    std::vector<int> row_ptr;
+    std::vector<int> col_idx;
+    std::vector<dalotia_byte> values;
+};
+
+// a CSR matrix with buffers sized for a tensor of these extents
+CsrMatrix allocate_csr_matrix(const std::vector<int> &extents, size_t nnz,
+                              dalotia_WeightFormat weight_format);
+
+// lengths of the values, first and second indices in the derived format:
+// {num_blocks * block size, num_block_rows + 1, num_blocks} for BSR,
+// {num_padded_values, num_chunks + 1 + num_rows, num_padded_values} for SELL,
+// and those of coo_tensor_extents for the N-d formats
+std::vector<int> derived_sparse_extents(const CsrMatrix &csr,
+                                        dalotia_SparseFormat format,
+                                        const SparseLayout &layout);
+
+// converts to BSR or SELL-C-sigma, in parallel over block rows / chunks, or
+// to an N-d format through an N-d COO tensor; the values keep the weight
+// format of the CSR matrix
+void csr_to_derived(const CsrMatrix &csr, dalotia_SparseFormat format,
+                    const SparseLayout &layout, dalotia_byte *values,
+                    int *first_indices, int *second_indices);
+
+// writes CSR or COO from the buffers, or any derived format
+void csr_to_sparse(const CsrMatrix &csr, dalotia_SparseFormat format,
+                   const SparseLayout &layout, dalotia_byte *values,
+                   int *first_indices, int *second_indices);
+
+// a reordering of the matrix view: row i of the reordered matrix is row
+// rows[i] of the original one, column j is column columns[j]; so
+// x_reordered[j] = x[columns[j]] and y[rows[i]] = y_reordered[i]
+struct SparsePermutation {
+    std::vector<int> rows;
+    std::vector<int> columns;
+};
+
+// the identity, for a tensor of these extents
+SparsePermutation identity_permutation(const std::vector<int> &extents);
+
+// reverse Cuthill-McKee, cf. https://doi.org/10.1145/800195.805928: a
+// breadth-first search from a pseudo-peripheral node of every connected
+// component, neighbors by increasing degree, reversed; square matrices are
+// reordered symmetrically on the pattern of A + A^T (rows == columns),
+// rectangular ones on the bipartite graph of rows and columns
+SparsePermutation rcm_permutation(const CsrMatrix &csr);
+
+// the reordered matrix, with sorted column indices; in parallel over rows
+CsrMatrix permute_csr(const CsrMatrix &csr,
+                      const SparsePermutation &permutation);
+
+// the same, written as CSR or COO straight into the output buffers
+void permute_csr_to_sparse(const CsrMatrix &csr,
+                           const SparsePermutation &permutation,
+                           dalotia_SparseFormat format, dalotia_byte *values,
+                           int *first_indices, int *second_indices);
+
+// the largest |row - column| of any non-zero
+size_t csr_bandwidth(const CsrMatrix &csr);
+
+// an N-d COO tensor: the N coordinates of every value, one after another
+struct CooTensor {
+    std::vector<int> extents;
+    dalotia_WeightFormat weight_format = dalotia_float_32;
+    std::vector<int> coordinates;
+    std::vector<dalotia_byte> values;
+
+    [[nodiscard]] size_t nnz() const {
+        return extents.empty() ? values.size() / sizeof_weight_format(weight_format)
+                               : coordinates.size() / extents.size();
+    }
+};
+
+// the N-d coordinates of a CSR matrix, in parallel over rows
+CooTensor csr_to_coo_tensor(const CsrMatrix &csr);
+
+// ALTO bit masks: the bits of all modes are interleaved round-robin from
+// the least significant one, each mode getting as many bits as its extent
+// needs; throws if they do not fit into 64 bits
+std::vector<uint64_t> alto_masks(const std::vector<int> &extents);
+
+// the linearized index of a coordinate tuple (a parallel bit deposit)
+uint64_t alto_index(const int *coordinates, const std::vector<uint64_t> &masks);
+
+// the coordinate of one mode from a linearized index (a parallel bit extract)
+int alto_coordinate(uint64_t index, uint64_t mask);
+
+// number of non-empty HiCOO blocks
+size_t hicoo_num_blocks(const CooTensor &coo, int block_bits);
+
+// lengths of the values, first and second indices: {nnz, nnz * N, 0} for
+// COO_ND, {nnz, 2 * nnz, 2 * N} for ALTO and
+// {nnz, num_blocks + 1 + num_blocks * N, nnz * N} for HiCOO
+std::vector<int> coo_tensor_extents(const CooTensor &coo,
+                                    dalotia_SparseFormat format,
+                                    const SparseLayout &layout);
+
+// writes any N-d COO input as COO_ND (reordered to C order of the
+// coordinates), ALTO or HiCOO, with the values in values_format; the keys
+// are computed and the values scattered in parallel, the sort is a
+// parallel merge sort
+void coo_tensor_to(const CooTensor &coo, dalotia_SparseFormat format,
+                   const SparseLayout &layout,
+                   dalotia_WeightFormat values_format, dalotia_byte *values,
+                   int *first_indices, int *second_indices);
+
+}  // namespace dalotia
@@ -0,0 +1,257 @@
+#include "dalotia_stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "dalotia_assignment.hpp"
+#include "dalotia_instrumentation.hpp"
+#include "dalotia_sparse.hpp"
+
+namespace dalotia {
+
+namespace {
+int get_max_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+int get_thread_num() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+dalotia_TensorStats empty_stats() {
+    dalotia_TensorStats stats{};
+    stats.min = std::numeric_limits<double>::infinity();
+    stats.max = -std::numeric_limits<double>::infinity();
+    return stats;
+}
+
+struct Binning {
+    size_t num_bins;
+    double min;
+    double scale;  // bins per unit
+};
+
+// l2_norm holds the sum of squares until the partial stats are merged
+inline void add_value(dalotia_TensorStats &stats, long long *histogram,
+                      const Binning &binning, double value) {
+    ++stats.num_elements;
+    if (std::isnan(value)) {
+        ++stats.num_nan;
+        return;
+    }
+    if (std::isinf(value)) {
+        ++stats.num_inf;
+        return;
+    }
+    stats.min = std::min(stats.min, value);
+    stats.max = std::max(stats.max, value);
+    stats.absmax = std::max(stats.absmax, std::abs(value));
+    stats.l2_norm += value * value;
+    if (histogram != nullptr) {
+        // clamped before the conversion, which is undefined out of range
+        const double bin = (value - binning.min) * binning.scale;
+        const size_t last_bin = binning.num_bins - 1;
+        ++histogram[bin <= 0.                              ? 0
+                    : bin >= static_cast<double>(last_bin) ? last_bin
+                                                           : static_cast<size_t>(bin)];
+    }
+}
+
+// the partial stats of one thread, allocated separately for each thread
+struct PartialStats {
+    std::vector<dalotia_TensorStats> channels;
+    std::vector<long long> histogram;
+};
+
+template <typename value_type>
+TensorStatistics load_with_stats(TensorFile &file,
+                                 const std::string &tensor_name,
+                                 dalotia_Ordering ordering,
+                                 dalotia_byte *tensor,
+                                 const StatsOptions &options,
+                                 const std::vector<int> &permutation) {
+    constexpr dalotia_WeightFormat weight_format =
+        weight_format_of<value_type>();
+    const auto extents = file.get_tensor_extents(tensor_name);
+    const size_t num_elements = file.get_num_tensor_elements(tensor_name);
+    const int num_dimensions = static_cast<int>(extents.size());
+    if (options.axis >= num_dimensions) {
+        throw std::runtime_error(
+            "dalotia tensor stats: " + tensor_name + " has " +
+            std::to_string(num_dimensions) + " dimensions, no axis " +
+            std::to_string(options.axis));
+    }
+    if (options.num_bins > 0 &&
+        !(options.histogram_max > options.histogram_min)) {
+        throw std::runtime_error(
+            "dalotia tensor stats: the histogram range of " + tensor_name +
+            " is empty");
+    }
+    const size_t num_channels =
+        options.axis < 0 ? 1 : static_cast<size_t>(extents[options.axis]);
+    const size_t num_bins = options.num_bins;
+    const Binning binning{
+        num_bins, options.histogram_min,
+        static_cast<double>(num_bins) /
+            (options.histogram_max - options.histogram_min)};
+
+    // rows along which the channel does not change, or the channels are the
+    // columns; for two dimensions always the matrix, to transpose it
+    const bool channel_is_column =
+        options.axis >= 0 && options.axis == num_dimensions - 1;
+    const int row_dimensions =
+        options.axis < 0    ? (num_dimensions < 2 ? 0 : 1)
+        : channel_is_column ? num_dimensions - 1
+                            : options.axis + 1;
+    const size_t num_rows =
+        std::accumulate(extents.begin(), extents.begin() + row_dimensions,
+                        size_t(1), std::multiplies<size_t>());
+    const size_t num_columns = num_rows == 0 ? 0 : num_elements / num_rows;
+
+    LoadTimer timer(file.get_instrumentation(), tensor_name);
+    const auto final_permutation_in_c_order =
+        final_c_permutation_from_permutation_and_order(permutation, ordering,
+                                                       extents.size());
+    // straight from the mapping if it is C-ordered there, else loaded
+    TensorView view = file.get_tensor_view(tensor_name);
+    std::vector<value_type> loaded;
+    if (view.data == nullptr || view.strides != dense_strides(view.extents)) {
+        timer.phase(dalotia_io_phase);
+        loaded.resize(num_elements);
+        file.load_tensor_dense(tensor_name, weight_format, dalotia_C_ordering,
+                               reinterpret_cast<dalotia_byte *>(loaded.data()));
+        view.data = reinterpret_cast<const dalotia_byte *>(loaded.data());
+        view.weight_format = weight_format;
+    } else {
+        timer.fault_in(view.data,
+                       num_elements * sizeof_weight_format(view.weight_format));
+    }
+    timer.add_bytes(num_elements * sizeof_weight_format(view.weight_format),
+                    tensor == nullptr ? 0 : num_elements * sizeof(value_type));
+
+    std::vector<PartialStats> partials(get_max_threads());
+    for (auto &partial : partials) {
+        partial.channels.assign(num_channels, empty_stats());
+        partial.histogram.assign(num_channels * num_bins, 0);
+    }
+    const auto inspect_row = [&](size_t row, size_t column_begin,
+                                 value_type *__restrict__ values,
+                                 size_t num_values) {
+        PartialStats &partial = partials[get_thread_num()];
+        long long *histogram =
+            num_bins == 0 ? nullptr : partial.histogram.data();
+        if (channel_is_column) {
+            for (size_t j = 0; j < num_values; ++j) {
+                const size_t channel = column_begin + j;
+                add_value(partial.channels[channel],
+                          histogram == nullptr
+                              ? nullptr
+                              : histogram + channel * num_bins,
+                          binning, values[j]);
+            }
+            return;
+        }
+        const size_t channel = options.axis < 0 ? 0 : row % num_channels;
+        // accumulated locally, for the thread's stats to stay in registers
+        dalotia_TensorStats stats = partial.channels[channel];
+        if (histogram != nullptr) {
+            histogram += channel * num_bins;
+        }
+        for (size_t j = 0; j < num_values; ++j) {
+            add_value(stats, histogram, binning, values[j]);
+        }
+        partial.channels[channel] = stats;
+    };
+
+    const bool transposed =
+        num_dimensions == 2 && !final_permutation_in_c_order.empty();
+    if (final_permutation_in_c_order.empty() || transposed ||
+        tensor == nullptr) {
+        timer.phase(transposed ? dalotia_permute_phase : dalotia_convert_phase);
+        assign_rows_tiled(reinterpret_cast<value_type *>(tensor), num_rows,
+                          num_columns, view.data, view.weight_format,
+                          transposed, inspect_row);
+    } else {
+        timer.phase(dalotia_convert_phase);
+        std::vector<value_type> converted(num_elements);
+        assign_rows_tiled(converted.data(), num_rows, num_columns, view.data,
+                          view.weight_format, false, inspect_row);
+        timer.phase(dalotia_permute_phase);
+        assign_permuted(static_cast<uint8_t>(num_dimensions), tensor,
+                        weight_format, extents.data(),
+                        reinterpret_cast<const dalotia_byte *>(converted.data()),
+                        weight_format, final_permutation_in_c_order.data());
+    }
+
+    TensorStatistics statistics;
+    statistics.channels.assign(num_channels, empty_stats());
+    statistics.histogram.assign(num_channels * num_bins, 0);
+    for (const auto &partial : partials) {
+        for (size_t c = 0; c < num_channels; ++c) {
+            dalotia_TensorStats &stats = statistics.channels[c];
+            const dalotia_TensorStats &part = partial.channels[c];
+            stats.num_elements += part.num_elements;
+            stats.num_nan += part.num_nan;
+            stats.num_inf += part.num_inf;
+            stats.min = std::min(stats.min, part.min);
+            stats.max = std::max(stats.max, part.max);
+            stats.absmax = std::max(stats.absmax, part.absmax);
+            stats.l2_norm += part.l2_norm;
+        }
+        for (size_t b = 0; b < partial.histogram.size(); ++b) {
+            statistics.histogram[b] += partial.histogram[b];
+        }
+    }
+    for (auto &stats : statistics.channels) {
+        stats.l2_norm = std::sqrt(stats.l2_norm);
+    }
+    return statistics;
+}
+}  // namespace
+
+TensorStatistics load_tensor_dense_with_stats(
+    TensorFile &file, const std::string &tensor_name,
+    dalotia_WeightFormat weight_format, dalotia_Ordering ordering,
+    dalotia_byte *tensor, const StatsOptions &options,
+    const std::vector<int> &permutation) {
+    if (weight_format == dalotia_float_32) {
+        return load_with_stats<float>(file, tensor_name, ordering, tensor,
+                                      options, permutation);
+    } else if (weight_format == dalotia_float_64) {
+        return load_with_stats<double>(file, tensor_name, ordering, tensor,
+                                       options, permutation);
+    }
+    throw std::runtime_error(
+        "dalotia load_tensor_dense_with_stats: tensors are loaded with stats "
+        "as float or double, " + tensor_name +
+        " was requested in another format");
+}
+
+TensorStatistics compute_tensor_stats(TensorFile &file,
+                                      const std::string &tensor_name,
+                                      const StatsOptions &options) {
+    if (file.get_weight_format(tensor_name) == dalotia_float_64) {
+        return load_with_stats<double>(file, tensor_name, dalotia_C_ordering,
+                                       nullptr, options, {});
+    }
+    return load_with_stats<float>(file, tensor_name, dalotia_C_ordering,
+                                  nullptr, options, {});
+}
+
+}  // namespace dalotia
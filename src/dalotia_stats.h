@@ -0,0 +1,14 @@
+#pragma once
+
+// statistics of a tensor, or of one channel of it, computed while it is
+// loaded; min, max, absmax and l2_norm are of the finite values, min and
+// max are +inf and -inf if there are none
+typedef struct {
+    long long num_elements;
+    long long num_nan;
+    long long num_inf;
+    double min;
+    double max;
+    double absmax;
+    double l2_norm;
+} dalotia_TensorStats;
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_stats.h"
+#include "dalotia_tensor_file.hpp"
+
+namespace dalotia {
+
+// what to compute: per tensor (axis < 0) or per channel along an axis of
+// the tensor as stored, i.e. in C order and before any permutation (e.g. 0
+// for the output channels of a PyTorch weight), and optionally a histogram
+// of num_bins equal bins over [histogram_min, histogram_max] per channel;
+// finite values outside of the range count in the first or last bin
+struct StatsOptions {
+    int axis = -1;
+    size_t num_bins = 0;
+    double histogram_min = 0.;
+    double histogram_max = 0.;
+};
+
+// one entry per channel, and num_bins counts per channel, one channel
+// after the other
+struct TensorStatistics {
+    std::vector<dalotia_TensorStats> channels;
+    std::vector<long long> histogram;
+};
+
+// loads the tensor like TensorFile::load_tensor_dense (as float or
+// double) and computes its statistics in the same pass, on the converted
+// values while they are in cache; the tensor is read from the mapping if it
+// is stored there in C order, else loaded first, and permutations of more
+// than two dimensions go through a temporary, as for load_folded
+TensorStatistics load_tensor_dense_with_stats(
+    TensorFile &file, const std::string &tensor_name,
+    dalotia_WeightFormat weight_format, dalotia_Ordering ordering,
+    dalotia_byte *tensor, const StatsOptions &options = {},
+    const std::vector<int> &permutation = {});
+
+// the statistics only, straight from the mapping without an output buffer
+// (for tensors that are not mapped, through a temporary); the values are
+// converted to float, or to double if they are stored as double
+TensorStatistics compute_tensor_stats(TensorFile &file,
+                                      const std::string &tensor_name,
+                                      const StatsOptions &options = {});
+
+}  // namespace dalotia
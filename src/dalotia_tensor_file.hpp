@@ -5,17 +5,39 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "dalotia_formats.hpp"
 #include "dalotia_assignment.hpp"
+#include "dalotia_instrumentation.hpp"
+#include "dalotia_sparse.hpp"
 
 namespace dalotia {
+// a dense tensor where it lies in the file: read-only, and valid as long as
+// the file is open; strides are in elements, per logical dimension
+struct TensorView {
+    const dalotia_byte *data = nullptr;  // nullptr if not available in place
+    dalotia_WeightFormat weight_format = dalotia_float_32;
+    std::vector<int> extents;
+    std::vector<size_t> strides;
+};
+
+// thread safety: once a file is opened, the queries and the loads (dense,
+// sparse, batched and the pointer getters) may be called concurrently from
+// any number of threads, e.g. from an OpenMP parallel region; backends that
+// fill caches lazily guard them. The setters (set_prune_threshold,
+// set_sparse_layout, ...) are not synchronized and must not overlap with
+// loads, and a TensorFile must not be destroyed while it is in use
 class TensorFile {
    public:
     explicit TensorFile(const std::string &/* filename */) {
@@ -59,6 +81,14 @@ class TensorFile {
         return {};
     }
 
+    [[nodiscard]] virtual dalotia_WeightFormat get_weight_format(
+        const std::string &/*tensor_name*/) const {
+        // the format the tensor is stored in, i.e. the one that can be loaded
+        // without conversion
+        throw std::runtime_error(
+            "get_weight_format not implemented for this tensor type");
+    }
+
     [[nodiscard]] virtual size_t get_num_tensor_elements(const std::string &tensor_name) const {
         // ?
         auto extents = this->get_tensor_extents(tensor_name);
@@ -67,7 +97,7 @@ class TensorFile {
 
     [[nodiscard]] virtual size_t get_nnz(const std::string &/* tensor_name*/) const {
         // This function will read the file and return the number of non-zero
-        // elements ? may take a while for dense tensors, only allow for sparse?
+        // elements; for dense-stored tensors, the ones that survive pruning
         throw std::runtime_error(
             "get_nnz not implemented for this tensor type");
         return 0;
@@ -93,6 +123,27 @@ class TensorFile {
             "load_tensor_dense not implemented for this tensor type");
     }
 
+    virtual void load_tensors_dense(
+        const std::vector<std::string> &tensor_names,
+        dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+        const std::vector<dalotia_byte *> &tensors,
+        const std::vector<std::vector<int>> &permutations = {}) {
+        // loads several tensors, each into its own buffer; permutations is
+        // either empty or has one (possibly empty) entry per tensor; backends
+        // that can overlap the loads (e.g. from several files) override this
+        if (tensors.size() != tensor_names.size() ||
+            (!permutations.empty() &&
+             permutations.size() != tensor_names.size())) {
+            throw std::runtime_error(
+                "load_tensors_dense: one buffer (and permutation) per tensor");
+        }
+        for (size_t i = 0; i < tensor_names.size(); ++i) {
+            this->load_tensor_dense(
+                tensor_names[i], weightFormat, ordering, tensors[i],
+                permutations.empty() ? std::vector<int>() : permutations[i]);
+        }
+    }
+
     template <typename value_type = dalotia_byte>  //? or have no defaults?
     [[nodiscard]] std::pair<std::vector<int>, dalotia::vector<value_type>>
     load_tensor_dense(const std::string &tensor_name,
@@ -126,7 +177,7 @@ class TensorFile {
         }
         this->load_tensor_dense(tensor_name, weight_format, ordering,
             reinterpret_cast<dalotia_byte *>(tensor.data()), permutation);
-        return std::make_pair(extents, tensor);
+        return std::make_pair(std::move(extents), std::move(tensor));
     }
 
     template <typename value_type>
@@ -163,6 +214,41 @@ class TensorFile {
 
     }
 
+    template <typename value_type>
+    void load_into(const std::string &tensor_name,
+                   dalotia_WeightFormat weight_format, value_type *tensor,
+                   size_t size, dalotia_Ordering ordering = dalotia_C_ordering,
+                   const std::vector<int> &permutation = {}) {
+        // reloads into storage the caller already holds, e.g. to refresh
+        // weights periodically without allocating; size is in value_type
+        // elements and has to fit the tensor exactly
+        const size_t num_bytes = this->get_num_tensor_elements(tensor_name) *
+                                 sizeof_weight_format(weight_format);
+        if (size * sizeof(value_type) != num_bytes) {
+            throw std::runtime_error("load_into: the buffer for " +
+                                     tensor_name + " has " +
+                                     std::to_string(size * sizeof(value_type)) +
+                                     " bytes, the tensor " +
+                                     std::to_string(num_bytes));
+        }
+        this->load_tensor_dense(tensor_name, weight_format, ordering,
+                                reinterpret_cast<dalotia_byte *>(tensor),
+                                permutation);
+    }
+
+    template <typename Range>
+    void load_into(const std::string &tensor_name, Range &&tensor,
+                   dalotia_Ordering ordering = dalotia_C_ordering,
+                   const std::vector<int> &permutation = {}) {
+        // for contiguous ranges of float or double, e.g. std::vector,
+        // dalotia::vector, std::array or std::span
+        using value_type =
+            std::remove_cv_t<std::remove_reference_t<decltype(*std::data(tensor))>>;
+        this->load_into(tensor_name, weight_format_of<value_type>(),
+                        std::data(tensor), std::size(tensor), ordering,
+                        permutation);
+    }
+
     virtual void load_tensor_sparse(const std::string &/*tensor_name */,
                                     dalotia_SparseFormat /*sparseFormat */,
                                     dalotia_WeightFormat /* weightFormat*/,
@@ -176,6 +262,39 @@ class TensorFile {
             "load_tensor_sparse not implemented for this tensor type");
     }
 
+    virtual void set_prune_threshold(double threshold) {
+        // get_nnz and load_tensor_sparse on dense-stored tensors drop every
+        // value whose magnitude is at most the threshold; 0 (the default)
+        // drops exact zeros only, a negative threshold keeps all values
+        prune_threshold_ = threshold;
+        rcm_permutations_.clear();  // the pattern may change
+    }
+
+    [[nodiscard]] double get_prune_threshold() const {
+        return prune_threshold_;
+    }
+
+    virtual void set_sparse_layout(const SparseLayout &layout) {
+        // block shape of dalotia_BSR, chunk size and sorting scope of
+        // dalotia_SELL, block size of dalotia_HiCOO, for loads and extents;
+        // with reorder_rcm, all sparse loads return the reordered matrix
+        sparse_layout_ = layout;
+    }
+
+    [[nodiscard]] const SparseLayout &get_sparse_layout() const {
+        return sparse_layout_;
+    }
+
+    [[nodiscard]] virtual SparsePermutation get_sparse_permutation(
+        const std::string &tensor_name) const {
+        // the row and column permutation that sparse loads apply to the
+        // tensor, for permuting inputs and outputs to match
+        if (!sparse_layout_.reorder_rcm) {
+            return identity_permutation(this->get_tensor_extents(tensor_name));
+        }
+        return this->get_rcm_permutation(tensor_name, nullptr);
+    }
+
     virtual std::vector<const dalotia_byte*> get_mmap_tensor_pointers(
         const std::string &/*tensor_name*/) const {
         // This function will return the pointer(s) to the mmaped tensor
@@ -184,8 +303,152 @@ class TensorFile {
         return std::vector<const dalotia_byte*>();
     }
 
+    [[nodiscard]] virtual TensorView get_tensor_view(
+        const std::string &tensor_name) const {
+        // zero-copy access to a tensor stored uncompressed in a memory-mapped
+        // file; otherwise, data is nullptr and the tensor has to be loaded
+        TensorView view;
+        const auto pointers = this->get_mmap_tensor_pointers(tensor_name);
+        if (pointers.size() != 1) {
+            return view;  // e.g. sparse, with values and indices
+        }
+        view.data = pointers.front();
+        view.weight_format = this->get_weight_format(tensor_name);
+        view.extents = this->get_tensor_extents(tensor_name);
+        view.strides = dense_strides(view.extents);
+        return view;
+    }
+
+    [[nodiscard]] virtual int get_tensor_index(
+        const std::string &tensor_name) const {
+        // the position of the tensor in get_tensor_names(), or -1; by
+        // default, the table is built on the first call, afterwards a
+        // lookup is a hash
+        std::call_once(tensor_indices_built_, [this]() {
+            const auto &tensor_names = this->get_tensor_names();
+            tensor_indices_.reserve(tensor_names.size());
+            for (size_t i = 0; i < tensor_names.size(); ++i) {
+                tensor_indices_.emplace(tensor_names[i], static_cast<int>(i));
+            }
+        });
+        const auto found = tensor_indices_.find(tensor_name);
+        return found == tensor_indices_.end() ? -1 : found->second;
+    }
+
+    [[nodiscard]] virtual std::vector<int> get_tensor_extents_by_index(
+        int index) const {
+        // queries and loads by that position, e.g. for handles resolved
+        // once; by default through the name, backends that hold their
+        // tensors in that order skip the name lookup
+        return this->get_tensor_extents(this->get_tensor_name_at(index));
+    }
+
+    [[nodiscard]] virtual dalotia_WeightFormat get_weight_format_by_index(
+        int index) const {
+        return this->get_weight_format(this->get_tensor_name_at(index));
+    }
+
+    virtual void load_tensor_dense_by_index(
+        int index, dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+        dalotia_byte *__restrict__ tensor,
+        const std::vector<int> &permutation = {}) {
+        this->load_tensor_dense(this->get_tensor_name_at(index), weightFormat,
+                                ordering, tensor, permutation);
+    }
+
+    [[nodiscard]] LoadInstrumentation &get_instrumentation() const {
+        // timings of the loads by phase, their stats, a trace file and
+        // hooks; off by default, and shared with the shards of a sharded file
+        return *instrumentation_;
+    }
+
     // no private section to allow visibility from C
     // FILE *file_ = nullptr;
+   protected:
+    [[nodiscard]] const std::string &get_tensor_name_at(int index) const {
+        const auto &tensor_names = this->get_tensor_names();
+        if (index < 0 || static_cast<size_t>(index) >= tensor_names.size()) {
+            throw std::runtime_error("dalotia: no tensor at index " +
+                                     std::to_string(index));
+        }
+        return tensor_names[index];
+    }
+
+    static void share_instrumentation(const TensorFile &from, TensorFile &to) {
+        // for backends that open other files, e.g. the shards, so that their
+        // loads are recorded together
+        to.instrumentation_ = from.instrumentation_;
+    }
+
+    [[nodiscard]] virtual CsrMatrix load_csr_matrix(
+        const std::string & /*tensor_name*/,
+        dalotia_WeightFormat /*weightFormat*/) const {
+        // the tensor as a CSR matrix in buffers, without reordering
+        throw std::runtime_error(
+            "load_csr_matrix not implemented for this tensor type");
+    }
+
+    [[nodiscard]] const SparsePermutation &get_rcm_permutation(
+        const std::string &tensor_name, const CsrMatrix *csr) const {
+        // computed once per tensor, from csr if given; a concurrent first
+        // call may compute it twice, but only one result is kept
+        {
+            std::lock_guard<std::mutex> lock(rcm_permutations_mutex_);
+            const auto found = rcm_permutations_.find(tensor_name);
+            if (found != rcm_permutations_.end()) {
+                return found->second;
+            }
+        }
+        SparsePermutation permutation =
+            csr != nullptr
+                ? rcm_permutation(*csr)
+                : rcm_permutation(this->load_csr_matrix(
+                      tensor_name, this->get_weight_format(tensor_name)));
+        std::lock_guard<std::mutex> lock(rcm_permutations_mutex_);
+        return rcm_permutations_.emplace(tensor_name, std::move(permutation))
+            .first->second;
+    }
+
+    [[nodiscard]] CsrMatrix load_reordered_csr_matrix(
+        const std::string &tensor_name, dalotia_WeightFormat weightFormat) const {
+        CsrMatrix csr = this->load_csr_matrix(tensor_name, weightFormat);
+        if (sparse_layout_.reorder_rcm) {
+            return permute_csr(csr, this->get_rcm_permutation(tensor_name, &csr));
+        }
+        return csr;
+    }
+
+    void load_sparse_from_csr(const std::string &tensor_name,
+                              dalotia_SparseFormat sparseFormat,
+                              dalotia_WeightFormat weightFormat,
+                              dalotia_byte *__restrict__ values,
+                              int *__restrict__ first_indices,
+                              int *__restrict__ second_indices) const {
+        // derived formats from the (reordered) CSR matrix; reordered CSR and
+        // COO are scattered into the buffers without an intermediate matrix
+        if (is_derived_sparse_format(sparseFormat) ||
+            !sparse_layout_.reorder_rcm) {
+            csr_to_sparse(this->load_reordered_csr_matrix(tensor_name, weightFormat),
+                          sparseFormat, sparse_layout_, values, first_indices,
+                          second_indices);
+            return;
+        }
+        const CsrMatrix csr = this->load_csr_matrix(tensor_name, weightFormat);
+        permute_csr_to_sparse(csr, this->get_rcm_permutation(tensor_name, &csr),
+                              sparseFormat, values, first_indices,
+                              second_indices);
+    }
+
+    double prune_threshold_ = 0.;
+    SparseLayout sparse_layout_;
+    std::shared_ptr<LoadInstrumentation> instrumentation_ =
+        std::make_shared<LoadInstrumentation>();
+    // views into get_tensor_names()
+    mutable std::once_flag tensor_indices_built_;
+    mutable std::unordered_map<std::string_view, int> tensor_indices_;
+    // by tensor name; std::map, for the references to stay valid
+    mutable std::mutex rcm_permutations_mutex_;
+    mutable std::map<std::string, SparsePermutation> rcm_permutations_;
 };
 
 // helper function to output iterables
@@ -205,4 +468,11 @@ inline std::string to_string(const Iterable &iterable) {
     return result;
 }
 
+// whether the string ends with the suffix and has something in front of it
+inline bool ends_with(std::string_view string, std::string_view suffix) {
+    return string.size() > suffix.size() &&
+           string.compare(string.size() - suffix.size(), suffix.size(),
+                          suffix) == 0;
+}
+
 }  // namespace dalotia
@@ -0,0 +1,228 @@
+#include "dalotia_tensor_file_writer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+#include "dalotia_assignment.hpp"
+
+namespace dalotia {
+
+namespace {
+void pwrite_all(int file_descriptor, const dalotia_byte *data, size_t num_bytes,
+                size_t offset, const std::string &filename) {
+    while (num_bytes > 0) {
+        const ssize_t written =
+            pwrite(file_descriptor, data, num_bytes, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("dalotia TensorFileWriter: could not write " +
+                                     filename + ": " + std::strerror(errno));
+        }
+        data += written;
+        num_bytes -= written;
+        offset += written;
+    }
+}
+
+// linear tensors are written in chunks of this size, such that a few large
+// tensors still keep all threads busy
+constexpr size_t chunk_bytes = size_t(16) << 20;
+}  // namespace
+
+TensorFileWriter::TensorFileWriter(const std::string &filename)
+    : filename_(filename) {}
+
+TensorFileWriter::~TensorFileWriter() {
+    if (pending_write_.valid()) {
+        try {
+            pending_write_.get();
+        } catch (const std::exception &e) {
+            std::cerr << "dalotia TensorFileWriter: " << e.what() << std::endl;
+        }
+    }
+}
+
+void TensorFileWriter::add_tensor_dense(const std::string &tensor_name,
+                                        dalotia_WeightFormat input_format,
+                                        dalotia_Ordering ordering,
+                                        const std::vector<int> &extents,
+                                        const dalotia_byte *tensor,
+                                        dalotia_WeightFormat output_format,
+                                        const std::vector<int> &permutation) {
+    if (pending_write_.valid()) {
+        throw std::runtime_error(
+            "dalotia TensorFileWriter: cannot add tensors during a write");
+    }
+    if (tensor_names_.count(tensor_name) != 0) {
+        throw std::runtime_error("dalotia TensorFileWriter: duplicate tensor " +
+                                 tensor_name);
+    }
+    const size_t num_dimensions = extents.size();
+    PendingTensor pending_tensor;
+    pending_tensor.name = tensor_name;
+    pending_tensor.input_format = input_format;
+    pending_tensor.output_format = output_format;
+    pending_tensor.data = tensor;
+    pending_tensor.input_shape = extents;
+    if (ordering == dalotia_F_ordering) {
+        std::reverse(pending_tensor.input_shape.begin(),
+                     pending_tensor.input_shape.end());
+    }
+    pending_tensor.num_elements =
+        std::accumulate(extents.begin(), extents.end(), size_t(1),
+                        std::multiplies<size_t>());
+
+    // loading applies the permutation from the stored tensor to the memory
+    // layout, so writing has to apply its inverse
+    const auto load_permutation = final_c_permutation_from_permutation_and_order(
+        permutation, ordering, num_dimensions);
+    pending_tensor.extents = pending_tensor.input_shape;
+    if (!load_permutation.empty()) {
+        pending_tensor.permutation.resize(num_dimensions);
+        for (size_t d = 0; d < num_dimensions; ++d) {
+            pending_tensor.permutation[load_permutation[d]] = d;
+            pending_tensor.extents[load_permutation[d]] =
+                pending_tensor.input_shape[d];
+        }
+    }
+    tensor_names_.insert(tensor_name);
+    tensors_.push_back(std::move(pending_tensor));
+}
+
+void TensorFileWriter::write() {
+    if (pending_write_.valid()) {
+        throw std::runtime_error(
+            "dalotia TensorFileWriter: a write is already pending");
+    }
+    this->write_laid_out(this->lay_out());
+}
+
+void TensorFileWriter::write_async() {
+    if (pending_write_.valid()) {
+        throw std::runtime_error(
+            "dalotia TensorFileWriter: a write is already pending");
+    }
+    // lay out right away, the background thread must not call into the
+    // derived class
+    pending_write_ = std::async(
+        std::launch::async,
+        [this](std::vector<dalotia_byte> header) {
+            this->write_laid_out(header);
+        },
+        this->lay_out());
+}
+
+void TensorFileWriter::wait() {
+    if (pending_write_.valid()) {
+        pending_write_.get();
+    }
+}
+
+void TensorFileWriter::write_laid_out(const std::vector<dalotia_byte> &header) {
+    struct WorkItem {
+        size_t tensor_index;
+        size_t begin;  // elements
+        size_t end;
+    };
+    std::vector<WorkItem> work_items;
+    size_t file_size = header.size();
+    for (size_t t = 0; t < tensors_.size(); ++t) {
+        const auto &tensor = tensors_[t];
+        const size_t output_bytes = sizeof_weight_format(tensor.output_format);
+        file_size = std::max(file_size,
+                             tensor.offset + tensor.num_elements * output_bytes);
+        if (!tensor.permutation.empty()) {
+            work_items.push_back({t, 0, tensor.num_elements});
+            continue;
+        }
+        const size_t chunk_elements = std::max(chunk_bytes / output_bytes, size_t(1));
+        for (size_t begin = 0; begin < tensor.num_elements;
+             begin += chunk_elements) {
+            work_items.push_back(
+                {t, begin, std::min(begin + chunk_elements, tensor.num_elements)});
+        }
+    }
+
+    // written next to the file and renamed over it once complete, such that
+    // readers that still map an older version keep it intact
+    const std::string temporary = filename_ + ".tmp";
+    const int file_descriptor =
+        open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("dalotia TensorFileWriter: could not open " +
+                                 temporary + ": " + std::strerror(errno));
+    }
+    std::string error;
+    try {
+        if (ftruncate(file_descriptor, static_cast<off_t>(file_size)) != 0) {
+            throw std::runtime_error("dalotia TensorFileWriter: could not resize " +
+                                     temporary + ": " + std::strerror(errno));
+        }
+        pwrite_all(file_descriptor, header.data(), header.size(), 0, temporary);
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+
+    if (error.empty()) {
+#pragma omp parallel
+        {
+            std::vector<dalotia_byte> buffer;
+#pragma omp for schedule(dynamic)
+            for (size_t i = 0; i < work_items.size(); ++i) {
+                const auto &item = work_items[i];
+                const auto &tensor = tensors_[item.tensor_index];
+                const size_t input_bytes = sizeof_weight_format(tensor.input_format);
+                const size_t output_bytes =
+                    sizeof_weight_format(tensor.output_format);
+                const size_t num_elements = item.end - item.begin;
+                const dalotia_byte *source = tensor.data + item.begin * input_bytes;
+                try {
+                    if (!tensor.permutation.empty()) {
+                        buffer.resize(num_elements * output_bytes);
+                        assign_permuted(tensor.input_shape.size(), buffer.data(),
+                                        tensor.output_format,
+                                        tensor.input_shape.data(), source,
+                                        tensor.input_format,
+                                        tensor.permutation.data());
+                        source = buffer.data();
+                    } else if (tensor.input_format != tensor.output_format) {
+                        buffer.resize(num_elements * output_bytes);
+                        assign_linearly(buffer.data(), tensor.output_format,
+                                        num_elements, source, tensor.input_format);
+                        source = buffer.data();
+                    }
+                    pwrite_all(file_descriptor, source, num_elements * output_bytes,
+                               tensor.offset + item.begin * output_bytes,
+                               temporary);
+                } catch (const std::exception &e) {
+#pragma omp critical
+                    error = e.what();
+                }
+            }
+        }
+    }
+    if (close(file_descriptor) != 0 && error.empty()) {
+        error = "dalotia TensorFileWriter: could not close " + temporary + ": " +
+                std::strerror(errno);
+    }
+    if (error.empty() && std::rename(temporary.c_str(), filename_.c_str()) != 0) {
+        error = "dalotia TensorFileWriter: could not rename " + temporary +
+                " to " + filename_ + ": " + std::strerror(errno);
+    }
+    if (!error.empty()) {
+        unlink(temporary.c_str());
+        throw std::runtime_error(error);
+    }
+}
+
+}  // namespace dalotia
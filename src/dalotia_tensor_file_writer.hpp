@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <future>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+// collects dense tensors and writes them to a new file in one go: the
+// derived class lays out the header and the data offsets, then all tensors
+// are converted / permuted and written in parallel with pwrite; the write
+// can also run in the background, such that the caller only has to wait
+// for it before touching the tensors again; the file is written as
+// <filename>.tmp and renamed into place, so an existing file is replaced
+// at once and its readers keep their mappings
+class TensorFileWriter {
+   public:
+    explicit TensorFileWriter(const std::string &filename);
+
+    TensorFileWriter(const TensorFileWriter &) = delete;
+    TensorFileWriter &operator=(const TensorFileWriter &) = delete;
+    TensorFileWriter(TensorFileWriter &&) = delete;
+    TensorFileWriter &operator=(TensorFileWriter &&) = delete;
+
+    // waits for a pending asynchronous write (but does not start one)
+    virtual ~TensorFileWriter();
+
+    // registers the tensor for writing, nothing is copied yet; ordering and
+    // permutation mean the same as for TensorFile::load_tensor_dense, i.e.
+    // the tensor is stored such that loading it with the same ordering and
+    // permutation gives back this memory layout; the extents are those of
+    // the memory layout (for dalotia_F_ordering, the Fortran shape)
+    void add_tensor_dense(const std::string &tensor_name,
+                          dalotia_WeightFormat input_format,
+                          dalotia_Ordering ordering,
+                          const std::vector<int> &extents,
+                          const dalotia_byte *tensor,
+                          dalotia_WeightFormat output_format,
+                          const std::vector<int> &permutation = {});
+
+    template <typename value_type>
+    void add_tensor_dense(const std::string &tensor_name,
+                          const std::vector<int> &extents,
+                          const value_type *tensor,
+                          dalotia_Ordering ordering = dalotia_C_ordering,
+                          const std::vector<int> &permutation = {}) {
+        dalotia_WeightFormat format;
+        if constexpr (std::is_same_v<value_type, float>) {
+            format = dalotia_float_32;
+        } else if constexpr (std::is_same_v<value_type, double>) {
+            format = dalotia_float_64;
+        } else {
+            static_assert(sizeof(value_type) == 0,
+                          "add_tensor_dense cannot derive the weight format "
+                          "from the value type");
+        }
+        this->add_tensor_dense(tensor_name, format, ordering, extents,
+                               reinterpret_cast<const dalotia_byte *>(tensor),
+                               format, permutation);
+    }
+
+    // writes the file and returns once all data is handed to the OS; not
+    // while a write_async is pending
+    void write();
+
+    // starts write() in the background; the tensors must not be modified
+    // or freed until wait() returns
+    void write_async();
+
+    // waits for write_async and rethrows its errors
+    void wait();
+
+   protected:
+    struct PendingTensor {
+        std::string name;
+        dalotia_WeightFormat input_format;
+        dalotia_WeightFormat output_format;
+        std::vector<int> input_shape;  // C-ordered view of the input
+        std::vector<int> permutation;  // empty if linear
+        std::vector<int> extents;      // as stored
+        const dalotia_byte *data;
+        size_t num_elements;
+        size_t offset = 0;  // in the file, set by lay_out
+    };
+
+    // sets the offset of every tensor and returns the header, which is
+    // written at the start of the file; the file size is the end of the
+    // last tensor
+    virtual std::vector<dalotia_byte> lay_out() = 0;
+
+    std::vector<PendingTensor> tensors_;
+
+   private:
+    void write_laid_out(const std::vector<dalotia_byte> &header);
+
+    std::string filename_;
+    std::unordered_set<std::string> tensor_names_;  // to reject duplicates
+    std::future<void> pending_write_;
+};
+
+}  // namespace dalotia
@@ -0,0 +1,238 @@
+#include "dalotia_tensorflow_bundle_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_protobuf.hpp"
+
+namespace dalotia {
+
+// field numbers, cf.
+// https://github.com/tensorflow/tensorflow/blob/master/tensorflow/core/protobuf/tensor_bundle.proto
+namespace bundle_field {
+constexpr uint32_t header_num_shards = 1;
+constexpr uint32_t header_endianness = 2;
+constexpr uint32_t entry_dtype = 1;
+constexpr uint32_t entry_shape = 2;
+constexpr uint32_t entry_shard_id = 3;
+constexpr uint32_t entry_offset = 4;
+constexpr uint32_t entry_size = 5;
+constexpr uint32_t entry_slices = 7;
+constexpr uint32_t shape_dim = 2;
+constexpr uint32_t dim_size = 1;
+constexpr uint64_t big_endian = 1;
+}  // namespace bundle_field
+
+namespace {
+// cf. https://github.com/google/leveldb/blob/main/doc/table_format.md
+constexpr size_t table_footer_bytes = 48;
+constexpr uint64_t table_magic = 0xdb4775248b80fb57ull;
+constexpr size_t block_trailer_bytes = 5;  // compression type and crc32c
+
+const std::string variable_suffix = "/.ATTRIBUTES/VARIABLE_VALUE";
+
+uint32_t load_fixed32(const dalotia_byte *bytes) {
+    uint32_t value = 0;
+    std::memcpy(&value, bytes, 4);  // little endian
+    return value;
+}
+
+// calls function(key, value) for every entry of the block at the handle;
+// keys are prefix-compressed against their predecessor
+template <typename Function>
+void for_each_block_entry(const MappedFile &table, ProtobufReader &handle,
+                          Function &&function) {
+    const uint64_t offset = handle.read_varint();
+    const uint64_t size = handle.read_varint();
+    if (offset + size + block_trailer_bytes > table.size() || size < 4) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: block exceeds " +
+                                 table.filename());
+    }
+    const dalotia_byte *block = table.data() + offset;
+    if (block[size] != 0) {
+        // bundles are written without compression
+        throw std::runtime_error(
+            "dalotia TensorflowBundleFile: compressed blocks are not supported");
+    }
+    const uint64_t num_restarts = load_fixed32(block + size - 4);
+    if (4 * (num_restarts + 1) > size) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: corrupt block in " +
+                                 table.filename());
+    }
+    ProtobufReader entries(block, block + size - 4 * (num_restarts + 1));
+    std::string key;
+    while (!entries.at_end()) {
+        const uint64_t shared = entries.read_varint();
+        const uint64_t non_shared = entries.read_varint();
+        const uint64_t value_length = entries.read_varint();
+        if (shared > key.size() || non_shared + value_length > entries.size()) {
+            throw std::runtime_error(
+                "dalotia TensorflowBundleFile: corrupt block in " +
+                table.filename());
+        }
+        key.resize(shared);
+        key.append(reinterpret_cast<const char *>(entries.begin()), non_shared);
+        const dalotia_byte *value = entries.begin() + non_shared;
+        function(key, ProtobufReader(value, value + value_length));
+        entries = ProtobufReader(value + value_length, entries.end());
+    }
+}
+
+// the path prefix of variables.index and variables.data-*
+std::string bundle_prefix(const std::string &filename) {
+    if (ends_with(filename, ".index")) {
+        return filename.substr(0, filename.size() - 6);
+    }
+    std::string directory = filename;
+    if (ends_with(filename, ".pb")) {
+        const auto last_slash = filename.find_last_of('/');
+        directory =
+            last_slash == std::string::npos ? "." : filename.substr(0, last_slash);
+    }
+    return directory + "/variables/variables";
+}
+}  // namespace
+
+TensorflowBundleFile::TensorflowBundleFile(const std::string &filename)
+    : MappedTensorFile(filename), prefix_(bundle_prefix(filename)) {
+    const MappedFile &index = this->map_file(prefix_ + ".index");
+    if (index.size() < table_footer_bytes) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: " +
+                                 index.filename() + " is too short");
+    }
+    const dalotia_byte *footer = index.data() + index.size() - table_footer_bytes;
+    uint64_t magic = 0;
+    std::memcpy(&magic, footer + table_footer_bytes - 8, 8);
+    if (magic != table_magic) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: " +
+                                 index.filename() + " is not a table");
+    }
+    // the metaindex handle comes first, then the one of the index block
+    ProtobufReader handles(footer, footer + table_footer_bytes - 8);
+    handles.read_varint();
+    handles.read_varint();
+    // the index block maps the last key of each data block to its handle
+    for_each_block_entry(index, handles,
+                         [this, &index](const std::string &, ProtobufReader handle) {
+                             for_each_block_entry(
+                                 index, handle,
+                                 [this](const std::string &key,
+                                        ProtobufReader entry) {
+                                     this->parse_entry(key, entry);
+                                 });
+                         });
+}
+
+TensorflowBundleFile::~TensorflowBundleFile() = default;
+
+void TensorflowBundleFile::parse_entry(const std::string &key,
+                                       ProtobufReader entry) {
+    if (key.empty()) {
+        // the header sorts first, so the shards are known for all entries
+        while (entry.next_field()) {
+            if (entry.field_number() == bundle_field::header_num_shards) {
+                num_shards_ = static_cast<int>(entry.read_varint());
+            } else if (entry.field_number() == bundle_field::header_endianness) {
+                if (entry.read_varint() == bundle_field::big_endian) {
+                    throw std::runtime_error(
+                        "dalotia TensorflowBundleFile: big-endian bundles "
+                        "are not supported");
+                }
+            } else {
+                entry.skip_field();
+            }
+        }
+        return;
+    }
+
+    int dtype = 0, shard_id = 0;
+    uint64_t offset = 0, size = 0;
+    std::vector<int> extents;
+    bool is_sliced = false;
+    while (entry.next_field()) {
+        switch (entry.field_number()) {
+            case bundle_field::entry_dtype:
+                dtype = static_cast<int>(entry.read_varint());
+                break;
+            case bundle_field::entry_shape: {
+                auto shape = entry.read_length_delimited();
+                while (shape.next_field()) {
+                    if (shape.field_number() != bundle_field::shape_dim) {
+                        shape.skip_field();
+                        continue;
+                    }
+                    auto dim = shape.read_length_delimited();
+                    int extent = 0;
+                    while (dim.next_field()) {
+                        if (dim.field_number() == bundle_field::dim_size) {
+                            extent = static_cast<int>(dim.read_varint());
+                        } else {
+                            dim.skip_field();
+                        }
+                    }
+                    extents.push_back(extent);
+                }
+                break;
+            }
+            case bundle_field::entry_shard_id:
+                shard_id = static_cast<int>(entry.read_varint());
+                break;
+            case bundle_field::entry_offset:
+                offset = entry.read_varint();
+                break;
+            case bundle_field::entry_size:
+                size = entry.read_varint();
+                break;
+            case bundle_field::entry_slices:
+                is_sliced = true;
+                entry.skip_field();
+                break;
+            default:
+                entry.skip_field();
+        }
+    }
+
+    auto type_iterator = tensorflow_dtype_map.find(dtype);
+    if (is_sliced || type_iterator == tensorflow_dtype_map.end()) {
+        // e.g. the serialized object graph (a string) or the optimizer's
+        // int64 iteration counter
+        return;
+    }
+    std::string tensor_name = key;
+    if (tensor_name.size() > variable_suffix.size() &&
+        tensor_name.compare(tensor_name.size() - variable_suffix.size(),
+                            variable_suffix.size(), variable_suffix) == 0) {
+        tensor_name.resize(tensor_name.size() - variable_suffix.size());
+    }
+    MappedTensor tensor;
+    tensor.weight_format = type_iterator->second;
+    tensor.extents = extents;
+    const size_t num_bytes =
+        std::accumulate(extents.begin(), extents.end(), size_t(1),
+                        std::multiplies<size_t>()) *
+        sizeof_weight_format(tensor.weight_format);
+    if (size != num_bytes) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: tensor " +
+                                 tensor_name + " has unexpected size");
+    }
+    if (shard_id < 0 || shard_id >= num_shards_) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: tensor " +
+                                 tensor_name + " is in a missing shard");
+    }
+    char shard_suffix[32];
+    std::snprintf(shard_suffix, sizeof(shard_suffix), ".data-%05d-of-%05d",
+                  shard_id, num_shards_);
+    const MappedFile &shard = this->map_file(prefix_ + shard_suffix);
+    if (offset + num_bytes > shard.size()) {
+        throw std::runtime_error("dalotia TensorflowBundleFile: tensor " +
+                                 tensor_name + " exceeds " + shard.filename());
+    }
+    tensor.data = shard.data() + offset;
+    this->add_tensor(tensor_name, std::move(tensor));
+}
+
+}  // namespace dalotia
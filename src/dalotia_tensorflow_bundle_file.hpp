@@ -0,0 +1,51 @@
+#pragma once
+#include <map>
+#include <string>
+
+#include "dalotia_formats.hpp"
+#include "dalotia_mapped_file.hpp"
+#include "dalotia_protobuf.hpp"
+
+namespace dalotia {
+
+// DataType, cf.
+// https://github.com/tensorflow/tensorflow/blob/master/tensorflow/core/framework/types.proto
+const std::map<int, dalotia_WeightFormat> tensorflow_dtype_map{
+    {1, dalotia_WeightFormat::dalotia_float_32},    // DT_FLOAT
+    {2, dalotia_WeightFormat::dalotia_float_64},    // DT_DOUBLE
+    {3, dalotia_WeightFormat::dalotia_int_32},      // DT_INT32
+    {4, dalotia_WeightFormat::dalotia_uint_8},      // DT_UINT8
+    {5, dalotia_WeightFormat::dalotia_int_16},      // DT_INT16
+    {6, dalotia_WeightFormat::dalotia_int_8},       // DT_INT8
+    // {9, dalotia_WeightFormat::dalotia_int_64},   // DT_INT64
+    // {10, dalotia_WeightFormat::dalotia_bool},    // DT_BOOL
+    {14, dalotia_WeightFormat::dalotia_bfloat_16},  // DT_BFLOAT16
+    {17, dalotia_WeightFormat::dalotia_uint_16},    // DT_UINT16
+    {19, dalotia_WeightFormat::dalotia_float_16},   // DT_HALF
+    {22, dalotia_WeightFormat::dalotia_uint_32},    // DT_UINT32
+};
+
+// reads the variables of a TensorFlow checkpoint (a tensor bundle, as in
+// SavedModel/variables/variables.{index,data-*}) without libtensorflow:
+// the index is a LevelDB-style table of BundleEntryProto per tensor, cf.
+// https://github.com/tensorflow/tensorflow/blob/master/tensorflow/core/util/tensor_bundle/tensor_bundle.h
+// and the data shards are mapped, so all tensors are served zero-copy;
+// accepts a SavedModel directory, its saved_model.pb or an .index file;
+// the object-graph suffix "/.ATTRIBUTES/VARIABLE_VALUE" is dropped from the
+// names, tensors of other types (strings, int64) and partitioned variables
+// are not listed, and checksums are not verified
+class TensorflowBundleFile : public MappedTensorFile {
+   public:
+    explicit TensorflowBundleFile(const std::string &filename);
+
+    ~TensorflowBundleFile() override;
+
+   private:
+    // the header (empty key) or the BundleEntryProto of one tensor
+    void parse_entry(const std::string &key, ProtobufReader entry);
+
+    std::string prefix_;
+    int num_shards_ = 1;
+};
+
+}  // namespace dalotia
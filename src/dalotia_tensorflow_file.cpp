@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <optional>
 
 #include "dalotia_assignment.hpp"
 #include "dalotia_formats.hpp"
@@ -14,6 +15,20 @@ TF_Output get_operation_from_name(const std::string &tensor_name,
     return {oper, 0};
 }
 
+// the operations whose output is a variable's value: the read that is
+// created along with every resource variable, and TF1 reference variables
+bool is_variable_operation(TF_Operation *oper) {
+    const std::string op_type = TF_OperationOpType(oper);
+    if (op_type == "VariableV2" || op_type == "Variable") {
+        return true;
+    }
+    const std::string op_name = TF_OperationName(oper);
+    const std::string read_suffix = "/Read/ReadVariableOp";
+    return op_type == "ReadVariableOp" && op_name.size() > read_suffix.size() &&
+           op_name.compare(op_name.size() - read_suffix.size(),
+                           read_suffix.size(), read_suffix) == 0;
+}
+
 // parts of this code are intensely based on cppflow, esp. tf_status_check and the
 // constructor -- so here goes their license for the respective parts:
 
@@ -39,22 +54,61 @@ TF_Output get_operation_from_name(const std::string &tensor_name,
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
-inline bool tf_status_check(std::shared_ptr<TF_Status> status) {
+inline bool tf_status_check(const TF_Status *status) {
     // cf. https://github.com/serizba/cppflow/blob/master/include/cppflow/context.h#L45
-    if (TF_GetCode(status.get()) != TF_OK) {
-        throw std::runtime_error(TF_Message(status.get()));
+    if (TF_GetCode(status) != TF_OK) {
+        throw std::runtime_error(TF_Message(status));
     }
     return true;
 }
 
+inline bool tf_status_check(const std::shared_ptr<TF_Status> &status) {
+    return tf_status_check(status.get());
+}
+
+// a status per call, so that concurrent calls do not overwrite each other's
+using TfStatusPointer = std::unique_ptr<TF_Status, decltype(&TF_DeleteStatus)>;
+
+TfStatusPointer tf_new_status() { return {TF_NewStatus(), &TF_DeleteStatus}; }
+
 int tf_get_num_dimensions(TF_Output output, std::shared_ptr<TF_Graph> graph,
-                          std::shared_ptr<TF_Status> status) {
+                          TF_Status *status) {
     // TF_DataType dtype = TF_OperationOutputType(output);
-    int num_dimensions = TF_GraphGetTensorNumDims(graph.get(), output, status.get());
+    int num_dimensions = TF_GraphGetTensorNumDims(graph.get(), output, status);
     tf_status_check(status);
     return num_dimensions;
 }
 
+// empty if the output has no fully known shape or a type dalotia cannot
+// represent
+std::optional<TensorflowSavedModel::TensorInfo> tf_describe_output(
+    TF_Operation *oper, std::shared_ptr<TF_Graph> graph) {
+    TfStatusPointer status = tf_new_status();
+    if (TF_OperationNumOutputs(oper) < 1) {
+        return std::nullopt;
+    }
+    TF_Output output = {oper, 0};
+    auto type_iterator = tensorflow_type_map.find(TF_OperationOutputType(output));
+    if (type_iterator == tensorflow_type_map.end()) {
+        return std::nullopt;
+    }
+    const int num_dimensions = tf_get_num_dimensions(output, graph, status.get());
+    if (num_dimensions < 0) {
+        return std::nullopt;
+    }
+    std::vector<int64_t> extents_read(num_dimensions);
+    TF_GraphGetTensorShape(graph.get(), output, extents_read.data(),
+                           num_dimensions, status.get());
+    tf_status_check(status.get());
+    if (std::any_of(extents_read.begin(), extents_read.end(),
+                    [](int64_t extent) { return extent < 0; })) {
+        return std::nullopt;
+    }
+    return TensorflowSavedModel::TensorInfo{
+        output, type_iterator->second,
+        std::vector<int>(extents_read.begin(), extents_read.end())};
+}
+
 TensorflowSavedModel::TensorflowSavedModel(const std::string &filename)
     : TensorFile(filename) {
     // cf.
@@ -85,12 +139,18 @@ TensorflowSavedModel::TensorflowSavedModel(const std::string &filename)
                       session_deleter};
     tf_status_check(this->status_);
 
-    {  // create and fill the tensor names vector
+    {  // find the variables and their metadata, once
         size_t pos = 0;
         TF_Operation *oper;
         while ((oper = TF_GraphNextOperation(graph_.get(), &pos)) != nullptr) {
-            const char *op_name = TF_OperationName(oper);
-            tensor_names_.emplace_back(op_name);
+            if (!is_variable_operation(oper)) {
+                continue;
+            }
+            auto info = tf_describe_output(oper, this->graph_);
+            if (info.has_value()) {
+                tensor_names_.emplace_back(TF_OperationName(oper));
+                tensor_infos_.emplace(tensor_names_.back(), std::move(*info));
+            }
         }
     }
 }
@@ -106,70 +166,46 @@ bool TensorflowSavedModel::is_sparse(const std::string & /*tensor_name*/) const
 }
 
 size_t TensorflowSavedModel::get_num_dimensions(const std::string &tensor_name) const {
-    TF_Output output = get_operation_from_name(tensor_name, this->graph_);
-    if (output.oper == nullptr) {
-        throw std::runtime_error(
-            "Tensor not found: " + tensor_name +
-            ". Tensor names in the file: " + to_string(tensor_names_));
-    }
-    if (tensor_name == "NoOp") {
-        // NoOp is a special operation in TensorFlow, it has no dimensions
-        // (weird vector error otherwise)
-        return 0;
-    }
-    int num_dimensions = tf_get_num_dimensions(output, this->graph_, this->status_);
-    if (num_dimensions < 0) {
-        throw std::runtime_error("Failed to get number of dimensions for tensor: " +
-                                 tensor_name);
-    }
-    return num_dimensions;
+    return this->get_tensor_info(tensor_name).extents.size();
 }
 
 std::vector<int>
 TensorflowSavedModel::get_tensor_extents(const std::string &tensor_name,
                                          const std::vector<int> &permutation) const {
-    TF_Output output = get_operation_from_name(tensor_name, this->graph_);
-    if (output.oper == nullptr) {
-        throw std::runtime_error(
-            "Tensor not found: " + tensor_name +
-            ". Tensor names in the file: " + to_string(tensor_names_));
+    const std::vector<int> &extents_read = this->get_tensor_info(tensor_name).extents;
+    if (permutation.empty()) {
+        return extents_read;
     }
-
-    int num_dimensions = tf_get_num_dimensions(output, this->graph_, this->status_);
-    std::vector<int64_t> extents_read(num_dimensions);
-    TF_GraphGetTensorShape(this->graph_.get(), output, extents_read.data(),
-                           extents_read.size(), this->status_.get());
-    tf_status_check(this->status_);
-
-    std::vector<int> extents(extents_read.size());
-
-    if (!permutation.empty()) {
-        auto final_permutation_in_c_order =
-            final_c_permutation_from_permutation_and_order(
-                permutation, dalotia_Ordering::dalotia_C_ordering, extents.size());
-        if (!final_permutation_in_c_order.empty()) {
-            for (size_t i = 0; i < extents.size(); i++) {
-                extents[i] = extents_read[final_permutation_in_c_order[i]];
-            }
+    std::vector<int> extents(extents_read);
+    auto final_permutation_in_c_order = final_c_permutation_from_permutation_and_order(
+        permutation, dalotia_Ordering::dalotia_C_ordering, extents.size());
+    if (!final_permutation_in_c_order.empty()) {
+        for (size_t i = 0; i < extents.size(); i++) {
+            extents[i] = extents_read[final_permutation_in_c_order[i]];
         }
-    } else {
-        extents.assign(extents_read.begin(), extents_read.end());
     }
     return extents;
 }
 
+dalotia_WeightFormat TensorflowSavedModel::get_weight_format(
+    const std::string &tensor_name) const {
+    return this->get_tensor_info(tensor_name).weight_format;
+}
+
 void TensorflowSavedModel::load_tensor_dense(const std::string &tensor_name,
                                              dalotia_WeightFormat weightFormat,
                                              dalotia_Ordering ordering,
                                              dalotia_byte *__restrict__ tensor,
                                              const std::vector<int> &permutation) {
+    LoadTimer timer(*instrumentation_, tensor_name);
+    // fetched from the session unless prefetched
+    timer.phase(dalotia_io_phase);
     const TF_Tensor *tf_tensor = this->get_tensor_pointer_from_name(tensor_name);
     void *databuffer = TF_TensorData(tf_tensor);
     int num_dimensions = TF_NumDims(tf_tensor);
     const int64_t num_tensor_elements = TF_TensorElementCount(tf_tensor);
 
-    TF_DataType tf_type = TF_TensorType(tf_tensor);
-    const dalotia_WeightFormat input_weight_format = tensorflow_type_map.at(tf_type);
+    const dalotia_WeightFormat input_weight_format = this->get_weight_format(tensor_name);
 #ifndef NDEBUG
     assert(databuffer != nullptr);
     assert(tf_tensor != nullptr);
@@ -187,17 +223,84 @@ void TensorflowSavedModel::load_tensor_dense(const std::string &tensor_name,
 
     auto final_permutation_in_c_order = final_c_permutation_from_permutation_and_order(
         permutation, ordering, num_dimensions);
+    timer.add_bytes(num_tensor_elements * sizeof_weight_format(input_weight_format),
+                    num_tensor_elements * sizeof_weight_format(weightFormat));
     if (!final_permutation_in_c_order.empty()) {
-        std::vector<int> input_shape = this->get_tensor_extents(tensor_name);
+        timer.phase(dalotia_permute_phase);
+        const std::vector<int> &input_shape = this->get_tensor_info(tensor_name).extents;
         dalotia::assign_permuted(num_dimensions, tensor, weightFormat, input_shape.data(),
                                  tensor_start, input_weight_format,
                                  final_permutation_in_c_order.data());
     } else {
+        timer.phase(dalotia_convert_phase);
         dalotia::assign_linearly(tensor, weightFormat, num_tensor_elements, tensor_start,
                                  input_weight_format);
     }
 }
 
+void TensorflowSavedModel::load_tensors_dense(
+    const std::vector<std::string> &tensor_names, dalotia_WeightFormat weightFormat,
+    dalotia_Ordering ordering, const std::vector<dalotia_byte *> &tensors,
+    const std::vector<std::vector<int>> &permutations) {
+    this->prefetch_tensors(tensor_names);
+    TensorFile::load_tensors_dense(tensor_names, weightFormat, ordering, tensors,
+                                   permutations);
+}
+
+void TensorflowSavedModel::prefetch_tensors(
+    const std::vector<std::string> &tensor_names) {
+    const std::vector<std::string> &requested =
+        tensor_names.empty() ? tensor_names_ : tensor_names;
+    // the outputs are looked up before taking the lock on the tensors
+    std::vector<TF_Output> requested_outputs;
+    requested_outputs.reserve(requested.size());
+    for (const auto &tensor_name : requested) {
+        requested_outputs.push_back(this->get_tensor_info(tensor_name).output);
+    }
+    std::vector<std::string> missing_names;
+    std::vector<TF_Output> outputs;
+    {
+        std::lock_guard<std::mutex> lock(tensors_mutex_);
+        for (size_t i = 0; i < requested.size(); ++i) {
+            if (tensors_.count(requested[i]) == 0 &&
+                std::find(missing_names.begin(), missing_names.end(),
+                          requested[i]) == missing_names.end()) {
+                outputs.push_back(requested_outputs[i]);
+                missing_names.push_back(requested[i]);
+            }
+        }
+    }
+    if (outputs.empty()) {
+        return;
+    }
+    // one run with all outputs instead of one run per tensor; sessions may
+    // be run concurrently, so the lock is not held meanwhile -- if two
+    // threads fetch the same tensor, the first one inserted is kept
+    std::vector<TF_Tensor *> tf_tensors(outputs.size(), nullptr);
+    TfStatusPointer status = tf_new_status();
+    TF_SessionRun(this->session_.get(), nullptr, nullptr, nullptr, 0, outputs.data(),
+                  tf_tensors.data(), static_cast<int>(outputs.size()), nullptr, 0,
+                  nullptr, status.get());
+    {
+        // own whatever was returned before checking, so nothing leaks
+        std::lock_guard<std::mutex> lock(tensors_mutex_);
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            if (tf_tensors[i] != nullptr) {
+                this->tensors_.emplace(
+                    missing_names[i],
+                    std::unique_ptr<TF_Tensor, decltype(&TF_DeleteTensor)>(
+                        tf_tensors[i], &TF_DeleteTensor));
+            }
+        }
+    }
+    tf_status_check(status.get());
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        if (tf_tensors[i] == nullptr) {
+            throw std::runtime_error("Failed to load tensor: " + missing_names[i]);
+        }
+    }
+}
+
 std::vector<const dalotia_byte *>
 TensorflowSavedModel::get_tensor_pointers(const std::string &tensor_name) {
     const TF_Tensor *tf_tensor = this->get_tensor_pointer_from_name(tensor_name);
@@ -205,33 +308,40 @@ TensorflowSavedModel::get_tensor_pointers(const std::string &tensor_name) {
         1, reinterpret_cast<const dalotia_byte *>(TF_TensorData(tf_tensor)));
 }
 
+const TensorflowSavedModel::TensorInfo &
+TensorflowSavedModel::get_tensor_info(const std::string &tensor_name) const {
+    std::lock_guard<std::mutex> lock(tensor_infos_mutex_);
+    auto it = tensor_infos_.find(tensor_name);
+    if (it != tensor_infos_.end()) {
+        return it->second;
+    }
+    // not a variable, but any other operation can be loaded as well
+    TF_Output output = get_operation_from_name(tensor_name, this->graph_);
+    if (output.oper == nullptr) {
+        throw std::runtime_error(
+            "Tensor not found: " + tensor_name +
+            ". Tensor names in the file: " + to_string(tensor_names_));
+    }
+    auto info = tf_describe_output(output.oper, this->graph_);
+    if (!info.has_value()) {
+        throw std::runtime_error("Tensor " + tensor_name +
+                                 " has no output of known shape and supported type");
+    }
+    return tensor_infos_.emplace(tensor_name, std::move(*info)).first->second;
+}
+
 const TF_Tensor *
 TensorflowSavedModel::get_tensor_pointer_from_name(const std::string &tensor_name) {
-    // check if it is already in the cache
-    auto it = tensors_.find(tensor_name);
-    if (it != tensors_.end()) {
-        return it->second.get();
-    } else {
-        // if not, load it from the graph
-        TF_Output output = get_operation_from_name(tensor_name, this->graph_);
-        if (output.oper == nullptr) {
-            throw std::runtime_error(
-                "Tensor not found: " + tensor_name +
-                ". Tensor names in the file: " + to_string(tensor_names_));
-        }
-
-        TF_Tensor *tf_tensor = nullptr;
-        TF_SessionRun(this->session_.get(), nullptr, nullptr, nullptr, 0, &output,
-                      &tf_tensor, 1, nullptr, 0, nullptr, this->status_.get());
-        if (tf_tensor == nullptr) {
-            throw std::runtime_error("Failed to load tensor: " + tensor_name);
+    // check if it is already in the cache, if not, load it from the graph
+    {
+        std::lock_guard<std::mutex> lock(tensors_mutex_);
+        auto it = tensors_.find(tensor_name);
+        if (it != tensors_.end()) {
+            return it->second.get();
         }
-        tf_status_check(this->status_);
-        auto [position, inserted] = this->tensors_.emplace(
-            tensor_name, std::unique_ptr<TF_Tensor, decltype(&TF_DeleteTensor)>(
-                             tf_tensor, &TF_DeleteTensor));
-        assert(inserted);  // should not already exist
-        return position->second.get();
     }
+    this->prefetch_tensors({tensor_name});
+    std::lock_guard<std::mutex> lock(tensors_mutex_);
+    return tensors_.at(tensor_name).get();
 }
-}  // namespace dalotia
+}  // namespace dalotia
\ No newline at end of file
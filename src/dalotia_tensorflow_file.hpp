@@ -2,7 +2,11 @@
 #include <tensorflow/c/c_api.h>
 
 #include <array>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "dalotia_formats.hpp"
 #include "dalotia_tensor_file.hpp"
@@ -27,12 +31,17 @@ static const std::map<TF_DataType, dalotia_WeightFormat> tensorflow_type_map{
     // {TF_INT2,   dalotia_WeightFormat::dalotia_int_2},
 };
 
+// loads from several threads are safe: the caches below are guarded, every
+// session run and graph query has its own TF_Status, and cached entries are
+// never erased, so the returned pointers and references stay valid
 class TensorflowSavedModel : public TensorFile {
   public:
     explicit TensorflowSavedModel(const std::string &filename);
 
     ~TensorflowSavedModel() override;
 
+    // the variables of the graph, i.e. the read operations of resource
+    // variables (.../Read/ReadVariableOp) and TF1 reference variables
     const std::vector<std::string> &get_tensor_names() const override;
 
     bool is_sparse(const std::string &tensor_name) const override;
@@ -43,22 +52,50 @@ class TensorflowSavedModel : public TensorFile {
     get_tensor_extents(const std::string &tensor_name = "",
                        const std::vector<int> &permutation = {}) const override;
 
+    dalotia_WeightFormat get_weight_format(
+        const std::string &tensor_name) const override;
+
     void load_tensor_dense(const std::string &tensor_name,
                            dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
                            dalotia_byte *__restrict__ tensor,
                            const std::vector<int> &permutation = {}) override;
 
+    // fetches the whole batch in one session run
+    void load_tensors_dense(
+        const std::vector<std::string> &tensor_names,
+        dalotia_WeightFormat weightFormat, dalotia_Ordering ordering,
+        const std::vector<dalotia_byte *> &tensors,
+        const std::vector<std::vector<int>> &permutations = {}) override;
+
+    // runs the session once for all tensors (empty: all variables) that
+    // have not been fetched yet
+    void prefetch_tensors(const std::vector<std::string> &tensor_names = {});
+
     std::vector<const dalotia_byte *> get_tensor_pointers(const std::string &tensor_name);
 
+    // output, format and extents of an operation, read from the graph once
+    struct TensorInfo {
+        TF_Output output;
+        dalotia_WeightFormat weight_format;
+        std::vector<int> extents;
+    };
+
     // cf. https://github.com/serizba/cppflow/blob/master/include/cppflow/model.h
-    std::shared_ptr<TF_Status> status_;
+    std::shared_ptr<TF_Status> status_;  // only for opening and closing
     std::shared_ptr<TF_Graph> graph_;
     std::shared_ptr<TF_Session> session_;
     std::vector<std::string> tensor_names_;
     std::map<std::string, std::unique_ptr<TF_Tensor, decltype(&TF_DeleteTensor)>>
         tensors_;  // cache for loaded tensor pointers
+    // the variables, and other operations once they were asked for
+    mutable std::map<std::string, TensorInfo> tensor_infos_;
 
   private:
+    std::mutex tensors_mutex_;
+    mutable std::mutex tensor_infos_mutex_;
+
+    const TensorInfo &get_tensor_info(const std::string &tensor_name) const;
+
     const TF_Tensor *get_tensor_pointer_from_name(const std::string &tensor_name);
 };
 
@@ -0,0 +1,222 @@
+#include "dalotia_zip.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#ifdef DALOTIA_WITH_ZLIB
+#include <zlib.h>
+#endif  // DALOTIA_WITH_ZLIB
+
+namespace dalotia {
+
+namespace {
+constexpr uint32_t local_header_signature = 0x04034b50;
+constexpr uint32_t central_header_signature = 0x02014b50;
+constexpr uint32_t end_of_central_directory_signature = 0x06054b50;
+constexpr uint32_t zip64_end_of_central_directory_signature = 0x06064b50;
+constexpr uint32_t zip64_locator_signature = 0x07064b50;
+constexpr uint16_t zip64_extra_field_id = 0x0001;
+constexpr size_t end_of_central_directory_size = 22;
+constexpr size_t zip64_locator_size = 20;
+constexpr size_t local_header_size = 30;
+
+// little-endian field access with bounds check against the archive
+class ZipCursor {
+   public:
+    ZipCursor(const dalotia_byte *archive, size_t archive_size, size_t offset)
+        : archive_(archive), archive_size_(archive_size), offset_(offset) {}
+
+    template <typename T>
+    T read() {
+        if (offset_ + sizeof(T) > archive_size_) {
+            throw std::runtime_error("dalotia zip: truncated archive");
+        }
+        T value;
+        std::memcpy(&value, archive_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    void skip(size_t num_bytes) {
+        if (offset_ + num_bytes > archive_size_) {
+            throw std::runtime_error("dalotia zip: truncated archive");
+        }
+        offset_ += num_bytes;
+    }
+
+    [[nodiscard]] size_t offset() const { return offset_; }
+
+   private:
+    const dalotia_byte *archive_;
+    size_t archive_size_;
+    size_t offset_;
+};
+}  // namespace
+
+ZipArchive::ZipArchive(const dalotia_byte *archive, size_t archive_size) {
+    if (archive_size < end_of_central_directory_size) {
+        throw std::runtime_error("dalotia zip: file too small for a zip archive");
+    }
+    // the end of central directory record is followed by a comment of at
+    // most 64 KiB, so search backwards for its signature
+    size_t eocd_offset = archive_size - end_of_central_directory_size;
+    const size_t search_limit =
+        eocd_offset > 0xffff ? eocd_offset - 0xffff : 0;
+    while (true) {
+        uint32_t signature;
+        std::memcpy(&signature, archive + eocd_offset, 4);
+        if (signature == end_of_central_directory_signature) {
+            break;
+        }
+        if (eocd_offset == search_limit) {
+            throw std::runtime_error("dalotia zip: no end of central directory");
+        }
+        --eocd_offset;
+    }
+    ZipCursor eocd(archive, archive_size, eocd_offset + 4);
+    eocd.skip(6);  // disk numbers, entries on this disk
+    uint64_t num_entries = eocd.read<uint16_t>();
+    eocd.skip(4);  // central directory size
+    uint64_t central_directory_offset = eocd.read<uint32_t>();
+
+    if ((num_entries == 0xffff ||
+         central_directory_offset == 0xffffffff) &&
+        eocd_offset >= zip64_locator_size) {
+        ZipCursor locator(archive, archive_size,
+                          eocd_offset - zip64_locator_size);
+        if (locator.read<uint32_t>() == zip64_locator_signature) {
+            locator.skip(4);
+            ZipCursor eocd64(archive, archive_size, locator.read<uint64_t>());
+            if (eocd64.read<uint32_t>() !=
+                zip64_end_of_central_directory_signature) {
+                throw std::runtime_error("dalotia zip: invalid ZIP64 record");
+            }
+            eocd64.skip(8 + 2 + 2 + 4 + 4 + 8);
+            num_entries = eocd64.read<uint64_t>();
+            eocd64.skip(8);  // central directory size
+            central_directory_offset = eocd64.read<uint64_t>();
+        }
+    }
+
+    entries_.reserve(num_entries);
+    ZipCursor central(archive, archive_size, central_directory_offset);
+    for (uint64_t i = 0; i < num_entries; ++i) {
+        if (central.read<uint32_t>() != central_header_signature) {
+            throw std::runtime_error("dalotia zip: invalid central directory");
+        }
+        central.skip(4);  // versions
+        const auto flags = central.read<uint16_t>();
+        Entry entry;
+        entry.compression_method = central.read<uint16_t>();
+        central.skip(8);  // time, date, crc
+        entry.compressed_size = central.read<uint32_t>();
+        entry.uncompressed_size = central.read<uint32_t>();
+        const auto name_length = central.read<uint16_t>();
+        const auto extra_length = central.read<uint16_t>();
+        const auto comment_length = central.read<uint16_t>();
+        central.skip(8);  // disk, attributes
+        uint64_t local_header_offset = central.read<uint32_t>();
+        if (central.offset() + name_length > archive_size) {
+            throw std::runtime_error("dalotia zip: truncated archive");
+        }
+        entry.name.assign(
+            reinterpret_cast<const char *>(archive + central.offset()),
+            name_length);
+        central.skip(name_length);
+
+        // ZIP64 extra field: only the saturated values are present
+        ZipCursor extra(archive, archive_size, central.offset());
+        const size_t extra_end = central.offset() + extra_length;
+        while (extra.offset() + 4 <= extra_end) {
+            const auto id = extra.read<uint16_t>();
+            const auto size = extra.read<uint16_t>();
+            const size_t field_end = extra.offset() + size;
+            if (id == zip64_extra_field_id) {
+                if (entry.uncompressed_size == 0xffffffff) {
+                    entry.uncompressed_size = extra.read<uint64_t>();
+                }
+                if (entry.compressed_size == 0xffffffff) {
+                    entry.compressed_size = extra.read<uint64_t>();
+                }
+                if (local_header_offset == 0xffffffff) {
+                    local_header_offset = extra.read<uint64_t>();
+                }
+            }
+            extra.skip(field_end - extra.offset());
+        }
+        central.skip(extra_length + comment_length);
+
+        if (flags & 0x1) {
+            throw std::runtime_error("dalotia zip: encrypted member " +
+                                     entry.name + " not supported");
+        }
+        // the local header may have a different extra field than the
+        // central one, so it has to be read to find the data
+        ZipCursor local(archive, archive_size, local_header_offset);
+        if (local.read<uint32_t>() != local_header_signature) {
+            throw std::runtime_error("dalotia zip: invalid local header for " +
+                                     entry.name);
+        }
+        local.skip(local_header_size - 4 - 4);
+        const auto local_name_length = local.read<uint16_t>();
+        const auto local_extra_length = local.read<uint16_t>();
+        local.skip(local_name_length + local_extra_length);
+        if (local.offset() + entry.compressed_size > archive_size) {
+            throw std::runtime_error("dalotia zip: member " + entry.name +
+                                     " exceeds archive");
+        }
+        entry.data = archive + local.offset();
+        entries_.push_back(std::move(entry));
+    }
+}
+
+void inflate_zip_entry(const ZipArchive::Entry &entry,
+                       dalotia_byte *destination) {
+    if (entry.compression_method == ZipArchive::stored) {
+        std::memcpy(destination, entry.data, entry.uncompressed_size);
+        return;
+    }
+    if (entry.compression_method != ZipArchive::deflated) {
+        throw std::runtime_error("dalotia zip: unsupported compression method " +
+                                 std::to_string(entry.compression_method) +
+                                 " for " + entry.name);
+    }
+#ifdef DALOTIA_WITH_ZLIB
+    z_stream stream{};
+    // negative window bits: raw deflate stream without zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        throw std::runtime_error("dalotia zip: could not initialize zlib");
+    }
+    // avail_in / avail_out are 32 bit, so feed large members in chunks
+    constexpr uint64_t max_chunk = std::numeric_limits<uInt>::max();
+    uint64_t remaining_in = entry.compressed_size;
+    uint64_t remaining_out = entry.uncompressed_size;
+    stream.next_in = const_cast<Bytef *>(entry.data);
+    stream.next_out = destination;
+    int status = Z_OK;
+    while (status == Z_OK) {
+        if (stream.avail_in == 0) {
+            stream.avail_in = static_cast<uInt>(std::min(remaining_in, max_chunk));
+            remaining_in -= stream.avail_in;
+        }
+        if (stream.avail_out == 0) {
+            stream.avail_out = static_cast<uInt>(std::min(remaining_out, max_chunk));
+            remaining_out -= stream.avail_out;
+        }
+        status = inflate(&stream, Z_NO_FLUSH);
+    }
+    const uint64_t produced =
+        static_cast<uint64_t>(stream.next_out - destination);
+    inflateEnd(&stream);
+    if (status != Z_STREAM_END || produced != entry.uncompressed_size) {
+        throw std::runtime_error("dalotia zip: could not inflate " + entry.name);
+    }
+#else   // DALOTIA_WITH_ZLIB
+    throw std::runtime_error("dalotia zip: " + entry.name +
+                             " is compressed, but dalotia was built without zlib");
+#endif  // DALOTIA_WITH_ZLIB
+}
+
+}  // namespace dalotia
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "dalotia_formats.hpp"
+
+namespace dalotia {
+
+// reads the central directory of a (possibly ZIP64) zip archive that is
+// already in memory, cf.
+// https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
+// -- used for .npz and torch.save archives, which store their members
+// either uncompressed (served in place) or deflated
+class ZipArchive {
+   public:
+    static constexpr uint16_t stored = 0;
+    static constexpr uint16_t deflated = 8;
+
+    struct Entry {
+        std::string name;
+        uint16_t compression_method;
+        uint64_t compressed_size;
+        uint64_t uncompressed_size;
+        // start of the (possibly compressed) member data in the archive
+        const dalotia_byte *data;
+    };
+
+    ZipArchive(const dalotia_byte *archive, size_t archive_size);
+
+    [[nodiscard]] const std::vector<Entry> &entries() const { return entries_; }
+
+   private:
+    std::vector<Entry> entries_;
+};
+
+// decompresses a deflated entry into destination, which has to hold
+// entry.uncompressed_size bytes; throws if dalotia was built without zlib
+void inflate_zip_entry(const ZipArchive::Entry &entry,
+                       dalotia_byte *destination);
+
+}  // namespace dalotia
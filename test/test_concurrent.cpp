@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "dalotia.hpp"
+
+// many threads load from one shared file at once, as from an OpenMP parallel
+// region, and compare with the tensors loaded by a single thread from a
+// separately opened file; meant to be run under ThreadSanitizer as well:
+// cmake -DCMAKE_CXX_FLAGS=-fsanitize=thread ... && ctest -R concurrent
+
+const int num_threads = 8;
+const int num_repetitions = 20;
+
+struct LoadedTensor {
+    // in the format the tensor is stored in, which can always be loaded
+    std::vector<dalotia_byte> dense;
+    std::vector<dalotia_byte> values;  // CSR, if the tensor is stored sparse
+    std::vector<int> row_ptr;
+    std::vector<int> col_idx;
+
+    bool operator==(const LoadedTensor &other) const {
+        return dense == other.dense && values == other.values &&
+               row_ptr == other.row_ptr && col_idx == other.col_idx;
+    }
+};
+
+LoadedTensor load(dalotia::TensorFile &dalotia_file,
+                  const std::string &tensor_name) {
+    LoadedTensor loaded;
+    const dalotia_WeightFormat weight_format =
+        dalotia_file.get_weight_format(tensor_name);
+    const size_t element_size = dalotia::sizeof_weight_format(weight_format);
+    // reversed dimensions, to go through the permuting assignment as well
+    std::vector<int> permutation(dalotia_file.get_num_dimensions(tensor_name));
+    for (size_t d = 0; d < permutation.size(); ++d) {
+        permutation[d] = static_cast<int>(permutation.size() - 1 - d);
+    }
+    loaded.dense.resize(dalotia_file.get_num_tensor_elements(tensor_name) *
+                        element_size);
+    dalotia_file.load_tensor_dense(tensor_name, weight_format,
+                                   dalotia_C_ordering, loaded.dense.data(),
+                                   permutation);
+    if (dalotia_file.is_sparse(tensor_name)) {
+        const auto extents =
+            dalotia_file.get_sparse_tensor_extents(tensor_name, dalotia_CSR);
+        loaded.values.resize(extents[0] * element_size);
+        loaded.row_ptr.resize(extents[1]);
+        loaded.col_idx.resize(extents[2]);
+        dalotia_file.load_tensor_sparse(
+            tensor_name, dalotia_CSR, weight_format, dalotia_C_ordering,
+            loaded.values.data(), loaded.row_ptr.data(), loaded.col_idx.data());
+    }
+    return loaded;
+}
+
+void test_concurrent_loads(const std::string &filename) {
+    std::vector<std::string> tensor_names;
+    std::vector<LoadedTensor> expected;
+    {
+        std::unique_ptr<dalotia::TensorFile> reference_file(
+            dalotia::make_tensor_file(filename));
+        tensor_names = reference_file->get_tensor_names();
+        for (const auto &tensor_name : tensor_names) {
+            expected.push_back(load(*reference_file, tensor_name));
+        }
+    }
+    assert(!tensor_names.empty());
+
+    // freshly opened, so that lazily filled caches are filled concurrently
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    std::atomic<int> num_mismatches{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            const size_t num_tensors = tensor_names.size();
+            for (int r = 0; r < num_repetitions; ++r) {
+                // every thread starts at a different tensor
+                for (size_t i = 0; i < num_tensors; ++i) {
+                    const size_t index = (i + t + r) % num_tensors;
+                    if (!(load(*dalotia_file, tensor_names[index]) ==
+                          expected[index])) {
+                        ++num_mismatches;
+                    }
+                }
+                // a batch of two tensors of the same format
+                const size_t first = (t + r) % num_tensors;
+                const size_t second = (first + 1) % num_tensors;
+                if (dalotia_file->get_weight_format(tensor_names[first]) !=
+                    dalotia_file->get_weight_format(tensor_names[second])) {
+                    continue;
+                }
+                std::vector<dalotia_byte> first_tensor(expected[first].dense.size());
+                std::vector<dalotia_byte> second_tensor(expected[second].dense.size());
+                dalotia_file->load_tensors_dense(
+                    {tensor_names[first], tensor_names[second]},
+                    dalotia_file->get_weight_format(tensor_names[first]),
+                    dalotia_F_ordering,
+                    {first_tensor.data(), second_tensor.data()});
+                // F ordering without permutation == reversed C ordering
+                if (first_tensor != expected[first].dense ||
+                    second_tensor != expected[second].dense) {
+                    ++num_mismatches;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    assert(num_mismatches == 0);
+}
+
+int main(int, char *[]) {
+    test_concurrent_loads("../data/model.safetensors");
+    test_concurrent_loads("../data/model-bitmask.safetensors");
+    test_concurrent_loads("../data/sharded/model.safetensors.index.json");
+#ifdef DALOTIA_WITH_ONNX
+    test_concurrent_loads("../data/model.onnx");
+#endif  // DALOTIA_WITH_ONNX
+#ifdef DALOTIA_WITH_NUMPY
+    test_concurrent_loads("../data/model.npz");
+#endif  // DALOTIA_WITH_NUMPY
+#ifdef DALOTIA_WITH_PYTORCH
+    test_concurrent_loads("../data/pytorch_model.bin");
+#endif  // DALOTIA_WITH_PYTORCH
+#if defined(DALOTIA_WITH_TENSORFLOW) || defined(DALOTIA_WITH_TF_BUNDLE)
+    test_concurrent_loads("../data/tensorflow_model");
+#endif  // DALOTIA_WITH_TENSORFLOW || DALOTIA_WITH_TF_BUNDLE
+    std::cout << "test_concurrent succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+
+// a convolution followed by a BatchNorm, as PyTorch names them, and a
+// linear layer followed by an affine transform only; written to the build
+// directory
+const std::string filename = "test_folding.safetensors";
+constexpr double epsilon = 1e-5;
+
+constexpr int num_kernels = 4, kernel_size = 2 * 3 * 3;
+constexpr int num_outputs = 40, num_inputs = 300;
+
+std::vector<float> make_values(size_t size, float step, float offset) {
+    std::vector<float> values(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = step * static_cast<float>(i % 13) + offset;
+    }
+    return values;
+}
+
+const auto conv = make_values(num_kernels * kernel_size, 0.125f, -0.75f);
+const auto conv_bias = make_values(num_kernels, 0.5f, -1.f);
+const auto bn_gamma = make_values(num_kernels, 0.25f, 0.5f);
+const auto bn_beta = make_values(num_kernels, -0.5f, 0.25f);
+const auto bn_mean = make_values(num_kernels, 0.125f, -0.25f);
+const auto bn_variance = make_values(num_kernels, 0.5f, 0.125f);
+const auto fc = make_values(num_outputs * num_inputs, 0.0625f, -0.5f);
+const auto fc_gamma = make_values(num_outputs, 0.5f, -1.f);
+const auto fc_beta = make_values(num_outputs, 0.25f, 0.f);
+
+void write_file() {
+    std::unique_ptr<dalotia::TensorFileWriter> writer(
+        dalotia::make_tensor_file_writer(filename));
+    writer->add_tensor_dense("conv.weight", {num_kernels, 2, 3, 3},
+                             conv.data());
+    writer->add_tensor_dense("conv.bias", {num_kernels}, conv_bias.data());
+    writer->add_tensor_dense("bn.weight", {num_kernels}, bn_gamma.data());
+    writer->add_tensor_dense("bn.bias", {num_kernels}, bn_beta.data());
+    writer->add_tensor_dense("bn.running_mean", {num_kernels}, bn_mean.data());
+    writer->add_tensor_dense("bn.running_var", {num_kernels},
+                             bn_variance.data());
+    writer->add_tensor_dense("fc.weight", {num_outputs, num_inputs},
+                             fc.data());
+    writer->add_tensor_dense("fc_norm.weight", {num_outputs}, fc_gamma.data());
+    writer->add_tensor_dense("fc_norm.bias", {num_outputs}, fc_beta.data());
+    writer->write();
+}
+
+bool is_close(double value, double expected) {
+    return std::abs(value - expected) <= 1e-5 * (1. + std::abs(expected));
+}
+
+double conv_scale(int o) {
+    return bn_gamma[o] /
+           std::sqrt(static_cast<double>(bn_variance[o]) + epsilon);
+}
+
+void test_batch_norm() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    std::vector<float> weight(num_kernels * kernel_size);
+    std::vector<float> bias(num_kernels);
+    dalotia::load_folded(*dalotia_file, "conv.weight", "conv.bias",
+                         dalotia::batch_norm_names("bn.", epsilon),
+                         dalotia_float_32, dalotia_C_ordering,
+                         reinterpret_cast<dalotia_byte *>(weight.data()),
+                         reinterpret_cast<dalotia_byte *>(bias.data()));
+    for (int o = 0; o < num_kernels; ++o) {
+        for (int i = 0; i < kernel_size; ++i) {
+            assert(is_close(weight[o * kernel_size + i],
+                            conv[o * kernel_size + i] * conv_scale(o)));
+        }
+        assert(is_close(bias[o], (conv_bias[o] - bn_mean[o]) * conv_scale(o) +
+                                     bn_beta[o]));
+    }
+
+    // permuted to [kh][kw][in][out], without the bias
+    std::vector<double> permuted(num_kernels * kernel_size);
+    dalotia::load_folded(*dalotia_file, "conv.weight", "conv.bias",
+                         dalotia::batch_norm_names("bn.", epsilon),
+                         dalotia_float_64, dalotia_C_ordering,
+                         reinterpret_cast<dalotia_byte *>(permuted.data()),
+                         nullptr, {2, 3, 1, 0});
+    // [kh=1][kw=2][in=1][out=3] is [out=3][in=1][kh=1][kw=2]
+    assert(is_close(permuted[((1 * 3 + 2) * 2 + 1) * num_kernels + 3],
+                    conv[3 * kernel_size + (1 * 3 + 1) * 3 + 2] *
+                        conv_scale(3)));
+}
+
+void test_affine() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    // gamma and beta only, folded into a linear layer without bias, and
+    // transposed for Fortran in the same pass
+    dalotia::BatchNormNames affine;
+    affine.gamma = "fc_norm.weight";
+    affine.beta = "fc_norm.bias";
+    std::vector<double> weight(num_outputs * num_inputs);
+    std::vector<double> bias(num_outputs);
+    dalotia::load_folded(*dalotia_file, "fc.weight", "", affine,
+                         dalotia_float_64, dalotia_F_ordering,
+                         reinterpret_cast<dalotia_byte *>(weight.data()),
+                         reinterpret_cast<dalotia_byte *>(bias.data()));
+    for (int o = 0; o < num_outputs; ++o) {
+        for (int i = 0; i < num_inputs; ++i) {
+            assert(is_close(weight[i * num_outputs + o],
+                            static_cast<double>(fc[o * num_inputs + i]) *
+                                fc_gamma[o]));
+        }
+        assert(bias[o] == fc_beta[o]);
+    }
+
+    // the norm does not fit the weight
+    bool threw = false;
+    try {
+        dalotia::load_folded(*dalotia_file, "conv.weight", "", affine,
+                             dalotia_float_64, dalotia_C_ordering,
+                             reinterpret_cast<dalotia_byte *>(weight.data()),
+                             nullptr);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    std::vector<float> weight(num_kernels * kernel_size);
+    std::vector<float> bias(num_kernels);
+    assert(dalotia_load_tensor_folded(
+               file, "conv.weight", "conv.bias", "bn.weight", "bn.bias",
+               "bn.running_mean", "bn.running_var", epsilon,
+               reinterpret_cast<char *>(weight.data()),
+               reinterpret_cast<char *>(bias.data()), dalotia_float_32,
+               dalotia_C_ordering, nullptr) == 0);
+    assert(is_close(weight.back(), conv.back() * conv_scale(num_kernels - 1)));
+    // without a norm, this is a plain load
+    assert(dalotia_load_tensor_folded(
+               file, "conv.weight", nullptr, nullptr, nullptr, nullptr,
+               nullptr, epsilon, reinterpret_cast<char *>(weight.data()),
+               reinterpret_cast<char *>(bias.data()), dalotia_float_32,
+               dalotia_C_ordering, nullptr) == 0);
+    assert(weight == conv);
+    assert(bias == std::vector<float>(num_kernels, 0.f));
+    assert(dalotia_load_tensor_folded(
+               file, "conv.weight", nullptr, "fc_norm.weight", nullptr,
+               nullptr, nullptr, epsilon,
+               reinterpret_cast<char *>(weight.data()), nullptr,
+               dalotia_float_32, dalotia_C_ordering, nullptr) == -1);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    write_file();
+    test_batch_norm();
+    test_affine();
+    test_c_interface();
+    std::cout << "test_folding succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_json.hpp"
+
+// generated by data/generate_safetensors.py
+const std::string filename = "../data/model.safetensors";
+
+struct HookCounts {
+    int begins = 0;
+    int ends = 0;
+    int permute_begins = 0;
+};
+
+void count_begin(const char *tensor_name, dalotia_LoadPhase phase,
+                 void *user_data) {
+    assert(std::string(tensor_name) == "embedding");
+    auto *counts = static_cast<HookCounts *>(user_data);
+    ++counts->begins;
+    if (phase == dalotia_permute_phase) {
+        ++counts->permute_begins;
+    }
+}
+
+void count_end(const char * /*tensor_name*/, dalotia_LoadPhase /*phase*/,
+               void *user_data) {
+    ++static_cast<HookCounts *>(user_data)->ends;
+}
+
+void test_disabled() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    assert(!dalotia_file->get_instrumentation().enabled());
+    auto [extents, tensor] =
+        dalotia_file->load_tensor_dense<double>("embedding", dalotia_float_64);
+    assert(tensor.size() == 60);
+    const auto stats = dalotia_file->get_instrumentation().get_stats();
+    assert(stats.num_loads == 0);
+    assert(stats.bytes_read == 0);
+    assert(dalotia_file->get_instrumentation().get_records().empty());
+}
+
+void test_stats_and_hooks() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    auto &instrumentation = dalotia_file->get_instrumentation();
+    HookCounts counts;
+    instrumentation.set_hooks(count_begin, count_end, &counts);
+    assert(instrumentation.enabled());
+
+    auto [extents, tensor] = dalotia_file->load_tensor_dense<double>(
+        "embedding", dalotia_float_64, dalotia_C_ordering, {1, 0, 2});
+    assert(extents == std::vector<int>({4, 3, 5}));
+    auto [converted_extents, converted] =
+        dalotia_file->load_tensor_dense<float>("embedding", dalotia_float_32);
+    assert(converted[59] == 59.f);
+
+    const auto stats = instrumentation.get_stats();
+    assert(stats.num_loads == 2);
+    assert(stats.bytes_read == 2 * 60 * 8);
+    assert(stats.bytes_written == 60 * 8 + 60 * 4);
+    assert(stats.seconds[dalotia_permute_phase] > 0.);
+    assert(stats.seconds[dalotia_convert_phase] > 0.);
+    assert(stats.max_threads >= 1);
+    // the file is mapped, and was just read by test_disabled
+    assert(stats.bytes_mapped == stats.bytes_read);
+    assert(stats.bytes_resident == stats.bytes_mapped);
+    assert(stats.minor_faults >= 0 && stats.major_faults >= 0);
+    assert(counts.begins == counts.ends);
+    assert(counts.begins >= 4);
+    assert(counts.permute_begins == 1);
+
+    const auto records = instrumentation.get_records();
+    assert(records.size() == 2);
+    for (const auto &record : records) {
+        assert(record.tensor_name == "embedding");
+        assert(record.spans.front().phase == dalotia_lookup_phase);
+        double phases = 0.;
+        for (const auto &span : record.spans) {
+            assert(span.start >= record.start);
+            phases += span.seconds;
+        }
+        assert(phases <= record.seconds * (1. + 1e-9));
+    }
+
+    // failed loads are not recorded
+    bool threw = false;
+    try {
+        auto not_there = dalotia_file->load_tensor_dense<float>(
+            "not_there", dalotia_float_32);
+    } catch (const std::exception &) {
+        threw = true;
+    }
+    assert(threw);
+    assert(instrumentation.get_stats().num_loads == 2);
+
+    instrumentation.reset();
+    assert(instrumentation.get_stats().num_loads == 0);
+    instrumentation.set_enabled(false);
+    auto more = dalotia_file->load_tensor_dense<double>("embedding",
+                                                        dalotia_float_64);
+    assert(instrumentation.get_stats().num_loads == 0);
+}
+
+void test_trace() {
+    const std::string trace_filename = "test_instrumentation_trace.json";
+    std::remove(trace_filename.c_str());
+    {
+        std::unique_ptr<dalotia::TensorFile> dalotia_file(
+            dalotia::make_tensor_file(filename));
+        dalotia_file->get_instrumentation().set_trace_file(trace_filename);
+        auto embedding = dalotia_file->load_tensor_dense<double>(
+            "embedding", dalotia_float_64, dalotia_F_ordering);
+        auto attention = dalotia_file->load_tensor_dense<float>(
+            "attention", dalotia_float_32);
+    }  // the trace is written on closing
+
+    std::ifstream trace_file(trace_filename);
+    assert(trace_file);
+    std::stringstream buffer;
+    buffer << trace_file.rdbuf();
+    const std::string trace = buffer.str();
+    dalotia::JsonReader reader(trace, "trace");
+    assert(reader.skip_value().size() + 1 == trace.size());
+    assert(trace.find("\"traceEvents\"") != std::string::npos);
+    assert(trace.find("\"name\":\"attention\"") != std::string::npos);
+    assert(trace.find("\"name\":\"permute\"") != std::string::npos);
+}
+
+void test_sharded() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(
+            "../data/sharded/model.safetensors.index.json"));
+    dalotia_file->get_instrumentation().set_enabled(true);
+    auto bias =
+        dalotia_file->load_tensor_dense<float>("layers.0.bias", dalotia_float_32);
+    auto head = dalotia_file->load_tensor_dense<float>("lm_head.weight",
+                                                       dalotia_float_32);
+    // the shards record into their file's instrumentation
+    const auto stats = dalotia_file->get_instrumentation().get_stats();
+    assert(stats.num_loads == 2);
+    assert(stats.bytes_written == (3 + 12) * 4);
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    dalotia_LoadStats stats;
+    assert(dalotia_get_load_stats(file, &stats) == 0);
+    assert(stats.num_loads == 0);
+    assert(dalotia_write_trace(file) == -1);  // no trace file
+
+    dalotia_set_instrumentation(file, true);
+    double tensor[60];
+    int permutation[3] = {2, 1, 0};
+    dalotia_load_tensor_dense_with_permutation(
+        file, "embedding", reinterpret_cast<char *>(tensor),
+        dalotia_float_64, dalotia_C_ordering, permutation);
+    assert(dalotia_get_load_stats(file, &stats) == 0);
+    assert(stats.num_loads == 1);
+    assert(stats.bytes_read == 60 * 8);
+    assert(stats.seconds[dalotia_permute_phase] > 0.);
+    assert(std::string(dalotia_load_phase_name(dalotia_io_phase)) == "io");
+
+    dalotia_reset_load_stats(file);
+    assert(dalotia_get_load_stats(file, &stats) == 0);
+    assert(stats.num_loads == 0);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_disabled();
+    test_stats_and_hooks();
+    test_trace();
+    test_sharded();
+    test_c_interface();
+    std::cout << "test_instrumentation succeded" << std::endl;
+    return 0;
+}
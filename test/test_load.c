@@ -124,6 +124,89 @@ void test_load(const char* filename, const char* tensor_name) {
     dalotia_close_file(dalotia_file);
 }
 
+void test_handles(const char* filename) {
+    DalotiaTensorFile* dalotia_file = dalotia_open_file(filename);
+    const int handle = dalotia_get_tensor_handle(dalotia_file, "conv2.weight");
+    assert(handle == 3);
+    assert(dalotia_get_tensor_handle(dalotia_file, "conv3.weight") == -1);
+    assert(dalotia_get_num_dimensions_by_handle(dalotia_file, handle) == 4);
+    assert(dalotia_get_num_tensor_elements_by_handle(dalotia_file, handle) ==
+           1152);
+    assert(dalotia_get_weight_format_by_handle(dalotia_file, handle) ==
+           dalotia_float_32);
+    int extents[4];
+    const int num_dimensions_returned =
+        dalotia_get_tensor_extents_by_handle(dalotia_file, handle, extents);
+    assert(num_dimensions_returned == 4);
+    assert(extents[0] == 16 && extents[1] == 8 && extents[2] == 3 &&
+           extents[3] == 3);
+    assert(dalotia_get_num_dimensions_by_handle(dalotia_file, 6) == -1);
+
+    float* tensor = (float*)malloc(1152 * sizeof(float));
+    int status = dalotia_load_tensor_dense_by_handle(
+        dalotia_file, handle, (char*)tensor, dalotia_float_32,
+        dalotia_C_ordering, NULL);
+    assert(status == 0);
+    assert_close(tensor[0], -0.79839);
+    assert_close(tensor[1151], 0.32985);
+    // transposed, the last element stays in place
+    const int permutation[4] = {3, 2, 1, 0};
+    status = dalotia_load_tensor_dense_by_handle(
+        dalotia_file, handle, (char*)tensor, dalotia_float_32,
+        dalotia_C_ordering, permutation);
+    assert(status == 0);
+    assert_close(tensor[0], -0.79839);
+    assert_close(tensor[1151], 0.32985);
+    free(tensor);
+
+    // all metadata at once, first only to size the extents
+    int num_dimensions[6], weight_formats[6], num_elements[6];
+    const int num_extents = dalotia_describe_tensors(
+        dalotia_file, num_dimensions, NULL, NULL, NULL);
+    assert(num_extents == 1 + 4 + 1 + 4 + 1 + 2);
+    int* all_extents = (int*)malloc(num_extents * sizeof(int));
+    const int num_extents_returned = dalotia_describe_tensors(
+        dalotia_file, num_dimensions, all_extents,
+        (dalotia_WeightFormat*)weight_formats, num_elements);
+    assert(num_extents_returned == num_extents);
+    assert(num_dimensions[5] == 2 && num_elements[5] == 7840);
+    assert(all_extents[num_extents - 2] == 10);
+    assert(all_extents[num_extents - 1] == 784);
+    assert(weight_formats[0] == dalotia_float_32);
+    free(all_extents);
+    dalotia_close_file(dalotia_file);
+}
+
+void test_view(const char* filename) {
+    DalotiaTensorFile* dalotia_file = dalotia_open_file(filename);
+    const char* data = NULL;
+    dalotia_WeightFormat format;
+    int extents[4];
+    long long strides[4];
+    const int num_dimensions = dalotia_get_tensor_view(
+        dalotia_file, "conv1.weight", &data, &format, extents, strides);
+    assert(num_dimensions == 4);
+    assert(format == dalotia_float_32);
+    assert(extents[0] == 8 && extents[3] == 3);
+    assert(strides[0] == 9 && strides[1] == 9 && strides[2] == 3 &&
+           strides[3] == 1);
+    assert_close(((const float*)data)[0], 0.944823);
+    assert_close(((const float*)data)[71], 0.211111);
+
+    DLManagedTensor* exported =
+        dalotia_export_dlpack(dalotia_file, "conv1.weight");
+    assert(exported != NULL);
+    assert(exported->dl_tensor.data == data);
+    assert(exported->dl_tensor.ndim == 4);
+    assert(exported->dl_tensor.dtype.code == kDLFloat);
+    assert(exported->dl_tensor.dtype.bits == 32);
+    assert(exported->dl_tensor.dtype.lanes == 1);
+    assert(exported->dl_tensor.shape[0] == 8);
+    assert(exported->dl_tensor.strides[0] == 9);
+    exported->deleter(exported);
+    dalotia_close_file(dalotia_file);
+}
+
 int main(int i, char** c) {
     char filename[] = "../data/model-mnist.safetensors";
 
@@ -131,6 +214,8 @@ int main(int i, char** c) {
     test_load(filename, "conv1");
     test_load(filename, "conv2");
     test_load(filename, "fc1");
+    test_handles(filename);
+    test_view(filename);
     fprintf(stdout, "test_load.c passed\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+
+// the base and the adapter are written to the build directory; the adapter
+// is named as PEFT saves it
+const std::string base_filename = "test_lora_base.safetensors";
+const std::string adapter_filename = "test_lora_adapter.safetensors";
+constexpr double scale = 0.5;
+
+// fc.weight is 70 x 300 (more than one tile in each direction), rank 3;
+// conv.weight is 4 x 2 x 3 x 3, rank 2, with B as 4 x 2 x 1 x 1
+constexpr int num_rows = 70, num_columns = 300, rank = 3;
+constexpr int num_kernels = 4, kernel_columns = 2 * 3 * 3, conv_rank = 2;
+
+std::vector<float> make_values(size_t size, float step) {
+    std::vector<float> values(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = step * static_cast<float>(i % 17) - 1.f;
+    }
+    return values;
+}
+
+const auto weight = make_values(num_rows * num_columns, 0.125f);
+const auto lora_a = make_values(rank * num_columns, 0.25f);
+const auto lora_b = make_values(num_rows * rank, 0.5f);
+const auto conv = make_values(num_kernels * kernel_columns, 0.0625f);
+const auto conv_a = make_values(conv_rank * kernel_columns, 0.5f);
+const auto conv_b = make_values(num_kernels * conv_rank, 0.25f);
+const std::vector<float> bias = {1.f, 2.f, 3.f, 4.f};
+
+// W + scale * B * A, C-ordered
+std::vector<double> merged(const std::vector<float> &w,
+                           const std::vector<float> &a,
+                           const std::vector<float> &b, int rows, int columns,
+                           int r) {
+    std::vector<double> result(w.begin(), w.end());
+    for (int i = 0; i < rows; ++i) {
+        for (int k = 0; k < r; ++k) {
+            for (int j = 0; j < columns; ++j) {
+                result[i * columns + j] +=
+                    scale * b[i * r + k] * a[k * columns + j];
+            }
+        }
+    }
+    return result;
+}
+
+void write_files() {
+    {
+        std::unique_ptr<dalotia::TensorFileWriter> writer(
+            dalotia::make_tensor_file_writer(base_filename));
+        writer->add_tensor_dense("fc.weight", {num_rows, num_columns},
+                                 weight.data());
+        writer->add_tensor_dense("conv.weight", {num_kernels, 2, 3, 3},
+                                 conv.data());
+        writer->add_tensor_dense("conv.bias", {num_kernels}, bias.data());
+        writer->write();
+    }
+    std::unique_ptr<dalotia::TensorFileWriter> writer(
+        dalotia::make_tensor_file_writer(adapter_filename));
+    writer->add_tensor_dense("base_model.model.fc.lora_A.weight",
+                             {rank, num_columns}, lora_a.data());
+    writer->add_tensor_dense("base_model.model.fc.lora_B.weight",
+                             {num_rows, rank}, lora_b.data());
+    writer->add_tensor_dense("base_model.model.conv.lora_A.weight",
+                             {conv_rank, 2, 3, 3}, conv_a.data());
+    writer->add_tensor_dense("base_model.model.conv.lora_B.weight",
+                             {num_kernels, conv_rank, 1, 1}, conv_b.data());
+    writer->write();
+}
+
+bool is_close(double value, double expected) {
+    return std::abs(value - expected) <= 1e-5 * (1. + std::abs(expected));
+}
+
+void test_merge() {
+    auto base = std::shared_ptr<dalotia::TensorFile>(
+        dalotia::make_tensor_file(base_filename));
+    auto adapter = std::shared_ptr<dalotia::TensorFile>(
+        dalotia::make_tensor_file(adapter_filename));
+    dalotia::LoraTensorFile lora_file(base, adapter, scale);
+    assert(lora_file.get_tensor_names() == base->get_tensor_names());
+    assert(lora_file.is_merged("fc.weight"));
+    assert(lora_file.is_merged("conv.weight"));
+    assert(!lora_file.is_merged("conv.bias"));
+    assert(lora_file.get_tensor_view("fc.weight").data == nullptr);
+    assert(lora_file.get_tensor_view("conv.bias").data != nullptr);
+    dalotia::TensorFile &file = lora_file;
+
+    const auto expected =
+        merged(weight, lora_a, lora_b, num_rows, num_columns, rank);
+    auto [extents, fc] = file.load_tensor_dense<float>("fc.weight");
+    assert(extents == std::vector<int>({num_rows, num_columns}));
+    for (size_t i = 0; i < expected.size(); ++i) {
+        assert(is_close(fc[i], expected[i]));
+    }
+    // converted from the stored floats, and transposed in the same pass
+    auto [extents_t, fc_t] =
+        file.load_tensor_dense<double>("fc.weight", dalotia_F_ordering);
+    assert(extents_t == extents);  // the Fortran shape is reversed
+    for (int i = 0; i < num_rows; ++i) {
+        for (int j = 0; j < num_columns; ++j) {
+            assert(is_close(fc_t[j * num_rows + i],
+                            expected[i * num_columns + j]));
+        }
+    }
+
+    // a kernel, merged as its (out x in * kh * kw) matrix, and permuted
+    const auto expected_conv =
+        merged(conv, conv_a, conv_b, num_kernels, kernel_columns, conv_rank);
+    auto [conv_extents, conv_merged] =
+        file.load_tensor_dense<float>("conv.weight");
+    for (size_t i = 0; i < expected_conv.size(); ++i) {
+        assert(is_close(conv_merged[i], expected_conv[i]));
+    }
+    auto [permuted_extents, conv_permuted] = file.load_tensor_dense<float>(
+        "conv.weight", dalotia_C_ordering, {2, 3, 1, 0});
+    assert(permuted_extents == std::vector<int>({3, 3, 2, num_kernels}));
+    // [kh][kw][in][out] = [out][in][kh][kw]
+    assert(is_close(conv_permuted[((1 * 3 + 2) * 2 + 1) * num_kernels + 3],
+                    expected_conv[3 * kernel_columns + (1 * 3 + 1) * 3 + 2]));
+
+    // other tensors are loaded from the base as they are
+    auto [bias_extents, bias_loaded] =
+        file.load_tensor_dense<float>("conv.bias");
+    assert(bias_loaded[3] == 4.f);
+
+    bool threw = false;
+    try {
+        std::vector<dalotia_byte> half(num_rows * num_columns * 2);
+        file.load_tensor_dense("fc.weight", dalotia_float_16,
+                               dalotia_C_ordering, half.data());
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // the base has none of the adapted weights
+    threw = false;
+    try {
+        dalotia::LoraTensorFile mismatched(adapter, adapter, scale);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file_with_adapter(
+        base_filename.c_str(), adapter_filename.c_str(), scale);
+    assert(file != nullptr);
+    std::vector<float> fc(num_rows * num_columns);
+    assert(dalotia_load_tensor_dense(file, "fc.weight",
+                                     reinterpret_cast<char *>(fc.data()),
+                                     dalotia_float_32, dalotia_C_ordering) == 0);
+    const auto expected =
+        merged(weight, lora_a, lora_b, num_rows, num_columns, rank);
+    assert(is_close(fc.back(), expected.back()));
+    dalotia_close_file(file);
+    assert(dalotia_open_file_with_adapter(adapter_filename.c_str(),
+                                          adapter_filename.c_str(),
+                                          scale) == nullptr);
+}
+
+int main(int, char **) {
+    write_files();
+    test_merge();
+    test_c_interface();
+    std::cout << "test_lora succeded" << std::endl;
+    return 0;
+}
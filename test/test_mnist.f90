@@ -4,13 +4,21 @@ program test_mnist
   implicit none
     real :: images(28, 28, 10000)
     character(100) :: filename
-    type(C_ptr) :: dalotia_file_pointer
-    real(C_float), dimension(:,:,:,:), allocatable :: tensor_weight_conv1, tensor_weight_conv2, tensor_weight_4d_unused
-    real(C_double), dimension(:,:), allocatable :: tensor_weight_fc1, tensor_weight_2d_unused
+    type(C_ptr) :: dalotia_file_pointer, dalotia_writer_pointer
+    real(C_float), dimension(:,:,:,:), allocatable, target :: tensor_weight_conv1, tensor_weight_conv2, tensor_weight_4d_unused
+    real(C_double), dimension(:,:), allocatable, target :: tensor_weight_fc1, tensor_weight_2d_unused
     real(C_float), dimension(:), allocatable :: tensor_bias_conv1, tensor_bias_conv2, tensor_bias_fc1
     real(C_float) :: tensor_fixed_weight_fc1_transposed(10, 784), tensor_fixed_weight_conv1_transposed(8, 3, 3, 1)
     real(C_float) :: tensor_fixed_bias_fc1(10)
     real(C_double) :: tensor_fixed_weight_fc1_transposed_double(10, 784)
+    type(dalotia_LoadStats) :: load_stats
+    type(dalotia_TensorStats), allocatable :: tensor_stats(:)
+    integer(C_long_long), allocatable :: histogram(:,:)
+    integer :: handle
+    integer(C_int), allocatable :: tensor_extents(:), num_dimensions(:), all_extents(:,:)
+    integer(C_int), allocatable :: weight_formats(:), num_elements(:)
+    real(C_float), dimension(:,:,:,:), pointer :: tensor_weight_conv1_pointer
+    real(C_double), dimension(:,:,:,:), pointer :: tensor_double_pointer
     filename = "../data/model-mnist.safetensors"
 
     call test_get_tensor_names(trim(filename))
@@ -20,6 +28,7 @@ program test_mnist
 
     ! test permutations
     dalotia_file_pointer = dalotia_open_file(filename)
+    call dalotia_set_instrumentation(dalotia_file_pointer, .true._C_bool)
     call dalotia_load_tensor_dense(dalotia_file_pointer, "conv1.weight", tensor_weight_4d_unused, permutation=[1, 2, 3, 4])
     call assert( all( tensor_weight_4d_unused .eq. tensor_weight_conv1))
 
@@ -45,6 +54,73 @@ program test_mnist
     call dalotia_load_tensor(dalotia_file_pointer, "fc1.bias", tensor_fixed_bias_fc1)
     call dalotia_load_tensor(dalotia_file_pointer, "fc1.weight", tensor_fixed_weight_fc1_transposed_double, permutation=[2, 1])
 
+    ! test tensor handles, loading into the caller's arrays
+    handle = dalotia_get_tensor_handle(dalotia_file_pointer, "conv1.weight")
+    call assert_equal_int(handle, 2)
+    call assert_equal_int(dalotia_get_tensor_handle(dalotia_file_pointer, "conv3.weight"), 0)
+    call dalotia_get_tensor_extents_by_handle(dalotia_file_pointer, handle, tensor_extents)
+    call assert( all( tensor_extents .eq. shape(tensor_weight_conv1)))
+    tensor_weight_4d_unused = 0.
+    call dalotia_load_tensor_by_handle(dalotia_file_pointer, handle, tensor_weight_4d_unused)
+    call assert( all( tensor_weight_4d_unused .eq. tensor_weight_conv1))
+    call dalotia_load_tensor_by_handle(dalotia_file_pointer, dalotia_get_tensor_handle(dalotia_file_pointer, &
+        "fc1.weight"), tensor_fixed_weight_fc1_transposed, permutation=[2, 1])
+    call assert_equal(tensor_fixed_weight_fc1_transposed(10, 784), real(tensor_weight_fc1(784, 10)))
+
+    call dalotia_describe_tensors(dalotia_file_pointer, num_dimensions, all_extents, weight_formats, num_elements)
+    call assert_equal_int(size(num_dimensions), 6)
+    call assert_equal_int(size(all_extents, 1), 4)
+    call assert( all( all_extents(:, handle) .eq. shape(tensor_weight_conv1)))
+    call assert( all( all_extents(:, 6) .eq. [784, 10, 0, 0]))
+    call assert_equal_int(num_elements(6), 7840)
+    call assert( all( weight_formats .eq. dalotia_float_32))
+
+    ! test zero-copy pointers into the file
+    call dalotia_get_tensor_pointer(dalotia_file_pointer, "conv1.weight", tensor_weight_conv1_pointer)
+    call assert(associated(tensor_weight_conv1_pointer))
+    call assert( all( shape(tensor_weight_conv1_pointer) .eq. shape(tensor_weight_conv1)))
+    call assert( all( tensor_weight_conv1_pointer .eq. tensor_weight_conv1))
+    ! stored in single precision, so not available as double
+    call dalotia_get_tensor_pointer(dalotia_file_pointer, "conv1.weight", tensor_double_pointer)
+    call assert(.not. associated(tensor_double_pointer))
+
+    call dalotia_get_load_stats(dalotia_file_pointer, load_stats)
+    call assert_equal_int(int(load_stats%num_loads), 9)
+    call assert(load_stats%bytes_read > 0)
+    call assert(load_stats%seconds(dalotia_permute_phase + 1) > 0.0d0)
+
+    ! test tensor stats, per output channel while loading and per tensor only
+    call dalotia_load_tensor_with_stats(dalotia_file_pointer, "conv1.weight", tensor_weight_4d_unused, &
+        tensor_stats, dim=4, num_bins=4, histogram_range=[-1.0d0, 1.0d0], histogram=histogram)
+    call assert( all( tensor_weight_4d_unused .eq. tensor_weight_conv1))
+    call assert_equal_int(size(tensor_stats), ubound(tensor_weight_conv1, 4))
+    call assert_equal(real(tensor_stats(2)%max), maxval(tensor_weight_conv1(:, :, :, 2)))
+    call assert( all( sum(histogram, dim=1) .eq. tensor_stats%num_elements))
+    call dalotia_get_tensor_stats(dalotia_file_pointer, "fc1.weight", tensor_stats)
+    call assert_equal_int(size(tensor_stats), 1)
+    call assert_equal(real(tensor_stats(1)%absmax), real(maxval(abs(tensor_weight_fc1))))
+    call assert_equal_int(int(tensor_stats(1)%num_nan), 0)
+    call dalotia_close_file(dalotia_file_pointer)
+
+    ! test writing, round trip through a new file
+    dalotia_writer_pointer = dalotia_open_file_writer("test_mnist_fortran.safetensors")
+    call dalotia_add_tensor_dense(dalotia_writer_pointer, "conv1.weight", tensor_weight_conv1)
+    call dalotia_add_tensor_dense(dalotia_writer_pointer, "conv1.weight_permuted", tensor_weight_conv1, &
+                                  permutation=[4, 2, 1, 3])
+    call dalotia_add_tensor_dense(dalotia_writer_pointer, "fc1.weight", tensor_weight_fc1, &
+                                  weight_format=dalotia_float_32)
+    call dalotia_write_file_async(dalotia_writer_pointer)
+    call dalotia_wait_for_write(dalotia_writer_pointer)
+    call dalotia_close_file_writer(dalotia_writer_pointer)
+
+    dalotia_file_pointer = dalotia_open_file("test_mnist_fortran.safetensors")
+    call dalotia_load_tensor_dense(dalotia_file_pointer, "conv1.weight", tensor_weight_4d_unused)
+    call assert( all( tensor_weight_4d_unused .eq. tensor_weight_conv1))
+    call dalotia_load_tensor_dense(dalotia_file_pointer, "conv1.weight_permuted", tensor_weight_4d_unused, &
+                                   permutation=[4, 2, 1, 3])
+    call assert( all( tensor_weight_4d_unused .eq. tensor_weight_conv1))
+    call dalotia_load_tensor_dense(dalotia_file_pointer, "fc1.weight", tensor_weight_2d_unused)
+    call assert( all( tensor_weight_2d_unused .eq. tensor_weight_fc1))
     call dalotia_close_file(dalotia_file_pointer)
 contains
 
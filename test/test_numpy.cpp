@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_numpy_file.hpp"
+
+// the files are generated by data/generate_numpy.py;
+// embedding[i, j, k] = 20 * i + 5 * j + k, with extents (3, 4, 5)
+double embedding_value(int i, int j, int k) { return 20 * i + 5 * j + k; }
+
+void check_c_order(const std::vector<double> &tensor) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 5; k++) {
+                assert(tensor[(i * 4 + j) * 5 + k] == embedding_value(i, j, k));
+            }
+        }
+    }
+}
+
+void check_f_order(const std::vector<double> &tensor) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 5; k++) {
+                assert(tensor[(k * 4 + j) * 3 + i] == embedding_value(i, j, k));
+            }
+        }
+    }
+}
+
+void test_npy(const std::string &filename, const std::string &tensor_name) {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    assert(dynamic_cast<dalotia::NumpyFile *>(dalotia_file.get()) != nullptr);
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    assert(tensor_names.size() == 1);
+    assert(tensor_names[0] == tensor_name);
+
+    // extents are always the logical ones, regardless of fortran_order
+    auto extents = dalotia_file->get_tensor_extents(tensor_name);
+    assert(extents.size() == 3);
+    assert(extents[0] == 3);
+    assert(extents[1] == 4);
+    assert(extents[2] == 5);
+
+    std::vector<double> tensor(60);
+    auto tensor_bytes = reinterpret_cast<dalotia_byte *>(tensor.data());
+    dalotia_file->load_tensor_dense(tensor_name, dalotia_float_64,
+                                    dalotia_C_ordering, tensor_bytes);
+    check_c_order(tensor);
+    dalotia_file->load_tensor_dense(tensor_name, dalotia_float_64,
+                                    dalotia_F_ordering, tensor_bytes);
+    check_f_order(tensor);
+
+    // permuted: (j, i, k)
+    dalotia_file->load_tensor_dense(tensor_name, dalotia_float_64,
+                                    dalotia_C_ordering, tensor_bytes, {1, 0, 2});
+    for (int j = 0; j < 4; j++) {
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 5; k++) {
+                assert(tensor[(j * 3 + i) * 5 + k] == embedding_value(i, j, k));
+            }
+        }
+    }
+}
+
+void test_fortran_order_is_linear() {
+    // F-ordered data loaded in F order is a plain copy of the payload
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file("../data/embedding_fortran.npy"));
+    auto pointers = dalotia_file->get_mmap_tensor_pointers("");
+    assert(pointers.size() == 1);
+    std::vector<double> tensor(60);
+    dalotia_file->load_tensor_dense(
+        "", dalotia_float_64, dalotia_F_ordering,
+        reinterpret_cast<dalotia_byte *>(tensor.data()));
+    assert(std::memcmp(tensor.data(), pointers[0], 60 * sizeof(double)) == 0);
+
+    // viewed in place, with the strides of the F order
+    const auto view = dalotia_file->get_tensor_view("");
+    assert(view.data == pointers[0]);
+    assert(view.weight_format == dalotia_float_64);
+    assert(view.extents == std::vector<int>({3, 4, 5}));
+    assert(view.strides == std::vector<size_t>({1, 3, 12}));
+    const auto *values = reinterpret_cast<const double *>(view.data);
+    assert(values[2 * view.strides[0] + 3 * view.strides[1] +
+                  4 * view.strides[2]] == embedding_value(2, 3, 4));
+
+    DLManagedTensor *exported = dalotia_export_dlpack(
+        reinterpret_cast<DalotiaTensorFile *>(dalotia_file.get()), "");
+    assert(exported != nullptr);
+    assert(exported->dl_tensor.data == view.data);
+    assert(exported->dl_tensor.device.device_type == kDLCPU);
+    assert(exported->dl_tensor.ndim == 3);
+    assert(exported->dl_tensor.dtype.code == kDLFloat);
+    assert(exported->dl_tensor.dtype.bits == 64);
+    assert(exported->dl_tensor.shape[2] == 5);
+    assert(exported->dl_tensor.strides[2] == 12);
+    exported->deleter(exported);
+}
+
+void test_npz(const std::string &filename, bool compressed) {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    // step.npy is int64 and not listed
+    assert(dalotia_get_num_tensors(file) == 3);
+    char name[256];
+    dalotia_get_tensor_name(file, 2, name);
+    assert(std::string(name) == "fc.weight");
+
+    std::vector<double> tensor(60);
+    dalotia_load_tensor_dense(file, "embedding_fortran",
+                              reinterpret_cast<char *>(tensor.data()),
+                              dalotia_float_64, dalotia_C_ordering);
+    check_c_order(tensor);
+    dalotia_load_tensor_dense(file, "embedding",
+                              reinterpret_cast<char *>(tensor.data()),
+                              dalotia_float_64, dalotia_F_ordering);
+    check_f_order(tensor);
+
+    std::vector<float> weight(6);
+    dalotia_load_tensor_dense(file, "fc.weight",
+                              reinterpret_cast<char *>(weight.data()),
+                              dalotia_float_32, dalotia_C_ordering);
+    for (int i = 0; i < 6; i++) {
+        assert(weight[i] == 0.5f * i);
+    }
+    // by handle, straight from the tensors in name order
+    const int handle = dalotia_get_tensor_handle(file, "fc.weight");
+    assert(handle == 2);
+    assert(dalotia_get_tensor_handle(file, "step") == -1);
+    assert(dalotia_get_num_dimensions_by_handle(file, handle) == 2);
+    assert(dalotia_get_weight_format_by_handle(file, handle) ==
+           dalotia_float_32);
+    std::fill(weight.begin(), weight.end(), 0.f);
+    const int status = dalotia_load_tensor_dense_by_handle(
+        file, handle, reinterpret_cast<char *>(weight.data()), dalotia_float_32,
+        dalotia_C_ordering, nullptr);
+    assert(status == 0);
+    assert(weight[5] == 2.5f);
+    assert(dalotia_get_num_dimensions_by_handle(file, 3) == -1);
+
+    auto dalotia_file = reinterpret_cast<dalotia::TensorFile *>(file);
+    // stored members are used in place, deflated ones are decompressed
+    assert(dalotia_file->get_mmap_tensor_pointers("fc.weight").empty() ==
+           compressed);
+    const char *data = nullptr;
+    dalotia_WeightFormat format;
+    int extents[2];
+    long long strides[2];
+    assert(dalotia_get_tensor_view(file, "fc.weight", &data, &format, extents,
+                                   strides) == (compressed ? -1 : 2));
+    DLManagedTensor *exported = dalotia_export_dlpack(file, "fc.weight");
+    assert((exported == nullptr) == compressed);
+    if (exported != nullptr) {
+        exported->deleter(exported);
+    }
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_npy("../data/embedding.npy", "embedding");
+    test_npy("../data/embedding_fortran.npy", "embedding_fortran");
+    test_fortran_order_is_linear();
+    test_npz("../data/model.npz", false);
+    test_npz("../data/model-compressed.npz", true);
+    std::cout << "test_numpy succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <cassert>
+#include <iostream>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_onnx_file.hpp"
+
+// the model is generated by data/generate_onnx.py
+const std::string filename = "../data/model.onnx";
+
+void test_names() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    assert(dynamic_cast<dalotia::OnnxFile *>(dalotia_file.get()) != nullptr);
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    // the int64 shape constant is not listed
+    assert(tensor_names.size() == 4);
+    assert(tensor_names[0] == "embedding");
+    assert(tensor_names[1] == "fc.weight");
+    assert(tensor_names[2] == "fc.bias");
+    assert(tensor_names[3] == "quantized");
+    for (const auto &name : tensor_names) {
+        assert(!dalotia_file->is_sparse(name));
+    }
+}
+
+void test_raw_data_load() {
+    // the C version
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    int extents[10];
+    int num_dimensions = dalotia_get_tensor_extents(file, "embedding", extents);
+    assert(num_dimensions == 3);
+    assert(extents[0] == 3);
+    assert(extents[1] == 4);
+    assert(extents[2] == 5);
+    assert(dalotia_get_num_tensor_elements(file, "embedding") == 60);
+
+    std::vector<double> tensor(60);
+    int result = dalotia_load_tensor_dense(
+        file, "embedding", reinterpret_cast<char *>(tensor.data()),
+        dalotia_float_64, dalotia_C_ordering);
+    assert(result == 0);
+    for (int i = 0; i < 60; i++) {
+        assert(tensor[i] == i);
+    }
+    dalotia_close_file(file);
+}
+
+void test_zero_copy_and_permuted_load() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    // raw_data and packed float_data are served from the mapping
+    auto pointers = dalotia_file->get_mmap_tensor_pointers("fc.weight");
+    assert(pointers.size() == 1);
+    auto mapped_weight = reinterpret_cast<const float *>(pointers[0]);
+    for (int i = 0; i < 6; i++) {
+        assert(mapped_weight[i] == 0.5f * i);
+    }
+#ifdef DALOTIA_WITH_CPP_PMR
+    auto [extents, weight] = dalotia_file->load_tensor_dense<double>(
+        "fc.weight", dalotia_float_64, dalotia_C_ordering, {1, 0});
+    assert(extents.size() == 2);
+    assert(extents[0] == 3);
+    assert(extents[1] == 2);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 2; j++) {
+            assert(weight[i * 2 + j] == 0.5 * (j * 3 + i));
+        }
+    }
+#endif  // DALOTIA_WITH_CPP_PMR
+}
+
+void test_external_and_int32_data() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    std::vector<float> bias(3);
+    dalotia_file->load_tensor_dense(
+        "fc.bias", dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bias.data()));
+    assert(bias[0] == 1.f);
+    assert(bias[1] == 2.f);
+    assert(bias[2] == 3.f);
+    assert(dalotia_file->get_mmap_tensor_pointers("fc.bias").size() == 1);
+
+    std::vector<int8_t> quantized(4);
+    dalotia_file->load_tensor_dense(
+        "quantized", dalotia_int_8, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(quantized.data()));
+    assert(quantized[0] == -2);
+    assert(quantized[1] == -1);
+    assert(quantized[2] == 1);
+    assert(quantized[3] == 2);
+    // decoded from varints, so not mapped
+    assert(dalotia_file->get_mmap_tensor_pointers("quantized").empty());
+}
+
+int main(int, char **) {
+    test_names();
+    test_raw_data_load();
+    test_zero_copy_and_permuted_load();
+    test_external_and_int32_data();
+    std::cout << "test_onnx succeded" << std::endl;
+    return 0;
+}
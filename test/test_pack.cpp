@@ -0,0 +1,175 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_pack_file.hpp"
+#include "dalotia_pack_writer.hpp"
+
+// the files are written to the build directory and read back
+const std::string filename = "test_pack.dalotia";
+
+// embedding[i, j, k] = 20 * i + 5 * j + k, with extents (3, 4, 5)
+double embedding_value(int i, int j, int k) { return 20 * i + 5 * j + k; }
+
+void test_write_and_read_back() {
+    std::vector<double> embedding(60), embedding_f(60);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 5; k++) {
+                embedding[(i * 4 + j) * 5 + k] = embedding_value(i, j, k);
+                embedding_f[i + 3 * j + 12 * k] = embedding_value(i, j, k);
+            }
+        }
+    }
+    std::vector<float> weight(6), weight_t(6);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 3; j++) {
+            weight[i * 3 + j] = 0.5f * (i * 3 + j);
+            weight_t[j * 2 + i] = weight[i * 3 + j];
+        }
+    }
+    {
+        std::unique_ptr<dalotia::TensorFileWriter> writer(
+            dalotia::make_tensor_file_writer(filename));
+        // the Fortran array embedding_f(3, 4, 5)
+        writer->add_tensor_dense("embedding_f", {3, 4, 5}, embedding_f.data(),
+                                 dalotia_F_ordering);
+        // the 2x3 weight, in memory as its transpose
+        writer->add_tensor_dense("fc.weight_t", {3, 2}, weight_t.data(),
+                                 dalotia_C_ordering, {1, 0});
+        writer->add_tensor_dense(
+            "embedding", dalotia_float_64, dalotia_C_ordering, {3, 4, 5},
+            reinterpret_cast<const dalotia_byte *>(embedding.data()),
+            dalotia_float_32);
+        writer->write();
+    }
+
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    auto *pack_file = dynamic_cast<dalotia::PackFile *>(dalotia_file.get());
+    assert(pack_file != nullptr);
+    assert(pack_file->get_alignment() == 4096);
+    // in the order they were added
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    assert(tensor_names ==
+           std::vector<std::string>({"embedding_f", "fc.weight_t", "embedding"}));
+
+    // the payloads are the memory layouts that were added
+    const auto *embedding_f_data =
+        dalotia_file->get_mmap_tensor_pointers("embedding_f").at(0);
+    assert(std::memcmp(embedding_f_data, embedding_f.data(), 60 * 8) == 0);
+    const auto *weight_t_data =
+        dalotia_file->get_mmap_tensor_pointers("fc.weight_t").at(0);
+    assert(std::memcmp(weight_t_data, weight_t.data(), 6 * 4) == 0);
+    for (const auto &name : tensor_names) {
+        const auto *pointer = dalotia_file->get_mmap_tensor_pointers(name).at(0);
+        assert(reinterpret_cast<uintptr_t>(pointer) % 4096 == 0);
+    }
+    assert(dalotia_file->get_weight_format("embedding") == dalotia_float_32);
+
+    // but the extents are the logical ones, so loading works as for any
+    // other file
+    assert(dalotia_file->get_tensor_extents("embedding_f") ==
+           std::vector<int>({3, 4, 5}));
+    assert(dalotia_file->get_tensor_extents("fc.weight_t") ==
+           std::vector<int>({2, 3}));
+    std::vector<double> tensor(60);
+    auto tensor_bytes = reinterpret_cast<dalotia_byte *>(tensor.data());
+    dalotia_file->load_tensor_dense("embedding_f", dalotia_float_64,
+                                    dalotia_F_ordering, tensor_bytes);
+    assert(tensor == embedding_f);
+    dalotia_file->load_tensor_dense("embedding_f", dalotia_float_64,
+                                    dalotia_C_ordering, tensor_bytes);
+    assert(tensor == embedding);
+
+    auto [weight_extents, weight_read] =
+        dalotia_file->load_tensor_dense<float>("fc.weight_t");
+    assert(weight_extents == std::vector<int>({2, 3}));
+    assert(std::vector<float>(weight_read.begin(), weight_read.end()) == weight);
+    auto [transposed_extents, transposed_read] =
+        dalotia_file->load_tensor_dense<float>("fc.weight_t", dalotia_C_ordering,
+                                               {1, 0});
+    assert(transposed_extents == std::vector<int>({3, 2}));
+    assert(std::vector<float>(transposed_read.begin(), transposed_read.end()) ==
+           weight_t);
+
+    auto [embedding_extents, embedding_read] =
+        dalotia_file->load_tensor_dense<double>("embedding");
+    assert(embedding_extents == std::vector<int>({3, 4, 5}));
+    for (int i = 0; i < 60; i++) {
+        assert(embedding_read[i] == embedding[i]);
+    }
+
+    // and through the C interface
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    assert(dalotia_get_num_tensors(file) == 3);
+    dalotia_load_tensor_dense(file, "embedding_f",
+                              reinterpret_cast<char *>(tensor.data()),
+                              dalotia_float_64, dalotia_F_ordering);
+    assert(tensor == embedding_f);
+    dalotia_close_file(file);
+}
+
+void test_huge_page_alignment() {
+    const std::string huge_filename = "test_pack_2m.dalotia";
+    std::vector<float> first(1000, 1.f), second(10, 2.f);
+    {
+        dalotia::PackFileWriter writer(
+            huge_filename, dalotia::PackFileWriter::huge_page_alignment);
+        writer.add_tensor_dense("first", {10, 100}, first.data());
+        writer.add_tensor_dense("second", {10}, second.data());
+        writer.write_async();
+        writer.wait();
+    }
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(huge_filename));
+    const auto *first_data =
+        dalotia_file->get_mmap_tensor_pointers("first").at(0);
+    const auto *second_data =
+        dalotia_file->get_mmap_tensor_pointers("second").at(0);
+    assert(second_data - first_data == 2 << 20);
+    auto [extents, second_read] =
+        dalotia_file->load_tensor_dense<float>("second");
+    assert(extents == std::vector<int>({10}));
+    assert(std::vector<float>(second_read.begin(), second_read.end()) == second);
+
+    bool threw = false;
+    try {
+        dalotia::PackFileWriter writer(huge_filename, 1000);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_invalid_file() {
+    const std::string broken_filename = "test_pack_broken.dalotia";
+    {
+        std::ofstream broken(broken_filename, std::ios::binary);
+        broken << "DALOTIA";
+        broken.put('\0');
+        broken << "not a header, but long enough for one";
+    }
+    bool threw = false;
+    try {
+        std::unique_ptr<dalotia::TensorFile> dalotia_file(
+            dalotia::make_tensor_file(broken_filename));
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+int main(int, char **) {
+    test_write_and_read_back();
+    test_huge_page_alignment();
+    test_invalid_file();
+    std::cout << "test_pack succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_pytorch_file.hpp"
+
+// the checkpoints are generated by data/generate_pytorch.py
+const std::string filename = "../data/pytorch_model.bin";
+
+void test_names() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    assert(dynamic_cast<dalotia::PytorchFile *>(dalotia_file.get()) != nullptr);
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    // the int64 num_batches_tracked is not listed
+    assert(tensor_names.size() == 4);
+    assert(tensor_names[0] == "embedding");
+    assert(tensor_names[1] == "fc.weight");
+    assert(tensor_names[2] == "fc.weight_t");
+    assert(tensor_names[3] == "fc.bias");
+}
+
+void test_contiguous_load() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    int extents[10];
+    assert(dalotia_get_tensor_extents(file, "embedding", extents) == 3);
+    assert(extents[0] == 3);
+    assert(extents[1] == 4);
+    assert(extents[2] == 5);
+    // embedding[i, j, k] = 20 * i + 5 * j + k
+    std::vector<float> embedding(60);
+    dalotia_load_tensor_dense(file, "embedding",
+                              reinterpret_cast<char *>(embedding.data()),
+                              dalotia_float_32, dalotia_F_ordering);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            for (int k = 0; k < 5; k++) {
+                assert(embedding[(k * 4 + j) * 3 + i] == 20 * i + 5 * j + k);
+            }
+        }
+    }
+    dalotia_close_file(file);
+}
+
+void test_strided_views() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    // the storages are mapped 64-byte aligned, as written by torch.save
+    auto weight_pointers = dalotia_file->get_mmap_tensor_pointers("fc.weight");
+    assert(weight_pointers.size() == 1);
+    assert(reinterpret_cast<uintptr_t>(weight_pointers[0]) % 64 == 0);
+
+    // the transposed view shares the storage of fc.weight
+    auto transposed_pointers =
+        dalotia_file->get_mmap_tensor_pointers("fc.weight_t");
+    assert(transposed_pointers.size() == 1);
+    assert(transposed_pointers[0] == weight_pointers[0]);
+    auto extents = dalotia_file->get_tensor_extents("fc.weight_t");
+    assert(extents.size() == 2);
+    assert(extents[0] == 3);
+    assert(extents[1] == 2);
+
+    // weight_t[i, j] = weight[j, i] = 0.5 * (3 * j + i)
+    std::vector<float> weight_t(6);
+    auto weight_t_bytes = reinterpret_cast<dalotia_byte *>(weight_t.data());
+    dalotia_file->load_tensor_dense("fc.weight_t", dalotia_float_32,
+                                    dalotia_C_ordering, weight_t_bytes);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 2; j++) {
+            assert(weight_t[i * 2 + j] == 0.5f * (3 * j + i));
+        }
+    }
+    // in F order, the transposed view is just the storage
+    dalotia_file->load_tensor_dense("fc.weight_t", dalotia_float_32,
+                                    dalotia_F_ordering, weight_t_bytes);
+    assert(std::memcmp(weight_t.data(), weight_pointers[0],
+                       6 * sizeof(float)) == 0);
+
+    // the slice bias[2:8:2] stays in place as a strided view, and is
+    // gathered on load
+    assert(dalotia_file->get_mmap_tensor_pointers("fc.bias").empty());
+    const auto bias_view = dalotia_file->get_tensor_view("fc.bias");
+    assert(bias_view.data != nullptr);
+    assert(bias_view.strides == std::vector<size_t>({2}));
+    std::vector<double> bias(3);
+    dalotia_file->load_tensor_dense(
+        "fc.bias", dalotia_float_64, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bias.data()));
+    assert(bias[0] == 2.);
+    assert(bias[1] == 4.);
+    assert(bias[2] == 6.);
+    std::vector<float> bias_float(3);
+    dalotia_file->load_tensor_dense(
+        "fc.bias", dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bias_float.data()));
+    assert(bias_float[2] == 6.f);
+    assert(dalotia_file->get_nnz("fc.bias") == 3);
+}
+
+void test_nested_checkpoint() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file("../data/checkpoint.pt"));
+    // nn.Parameter in a nested dict, next to non-tensor entries
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    assert(tensor_names.size() == 1);
+    assert(tensor_names[0] == "model.fc.weight");
+    auto [extents, weight] =
+        dalotia_file->load_tensor_dense<float>("model.fc.weight");
+    assert(extents.size() == 2);
+    for (int i = 0; i < 6; i++) {
+        assert(weight[i] == 0.5f * i);
+    }
+}
+
+int main(int, char **) {
+    test_names();
+    test_contiguous_load();
+    test_strided_views();
+    test_nested_checkpoint();
+    std::cout << "test_pytorch succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.hpp"
+
+// the checkpoints are written to the build directory, each version over
+// the last one (the writer replaces the file by a rename)
+const std::string filename = "test_reload.safetensors";
+
+void write_checkpoint(const std::vector<float> &weight,
+                      const std::vector<double> &bias,
+                      const std::vector<int> &weight_extents = {2, 3}) {
+    std::unique_ptr<dalotia::TensorFileWriter> writer(
+        dalotia::make_tensor_file_writer(filename));
+    writer->add_tensor_dense("fc.weight", weight_extents, weight.data());
+    writer->add_tensor_dense("fc.bias", {4}, bias.data());
+    writer->write();
+}
+
+void test_reload_changed() {
+    write_checkpoint({0.f, 1.f, 2.f, 3.f, 4.f, 5.f}, {1., 2., 3., 4.});
+    dalotia::TensorFileReloader reloader(filename);
+    std::vector<float> weight(6);
+    std::vector<double> bias(4);
+    std::vector<float> weight_t(6);
+    reloader.add_tensor("fc.weight", weight);
+    reloader.add_tensor("fc.bias", bias);
+    reloader.add_tensor("fc.weight", weight_t, dalotia_C_ordering, {1, 0});
+    assert(weight[5] == 5.f && bias[3] == 4.);
+    assert(weight_t[1] == 3.f);
+    assert(!reloader.has_changed());
+    const auto unchanged = reloader.reload();
+    assert(unchanged.empty());
+
+    // a reader holds on to the first version
+    const auto reader_file = reloader.get_file();
+    const auto view = reader_file->get_tensor_view("fc.weight");
+    assert(view.data != nullptr);
+
+    write_checkpoint({0.f, 10.f, 20.f, 30.f, 40.f, 50.f}, {1., 2., 3., 4.});
+    assert(reloader.has_changed());
+    const auto changed = reloader.reload();
+    assert(changed == std::vector<std::string>({"fc.weight", "fc.weight"}));
+    assert(weight[5] == 50.f && bias[3] == 4.);
+    assert(weight_t[1] == 30.f);
+    assert(!reloader.has_changed());
+    assert(reloader.get_file() != reader_file);
+    // the old mapping is still there, with the old values
+    assert(reinterpret_cast<const float *>(view.data)[5] == 5.f);
+}
+
+void test_reload_without_hashes() {
+    write_checkpoint({0.f, 1.f, 2.f, 3.f, 4.f, 5.f}, {1., 2., 3., 4.});
+    dalotia::TensorFileReloader reloader(filename, false);
+    std::vector<float> weight(6);
+    std::vector<double> bias(4);
+    reloader.add_tensor("fc.weight", weight);
+    reloader.add_tensor("fc.bias", bias);
+
+    write_checkpoint({0.f, 1.f, 2.f, 3.f, 4.f, 5.f}, {1., 2., 3., 5.});
+    const auto changed = reloader.reload();
+    assert(changed.size() == 2);
+    assert(bias[3] == 5.);
+}
+
+void test_reload_mismatch() {
+    write_checkpoint({0.f, 1.f, 2.f, 3.f, 4.f, 5.f}, {1., 2., 3., 4.});
+    dalotia::TensorFileReloader reloader(filename);
+    std::vector<float> weight(6);
+    std::vector<double> bias(4);
+    reloader.add_tensor("fc.weight", weight);
+    reloader.add_tensor("fc.bias", bias);
+
+    bool threw = false;
+    try {
+        std::vector<float> too_large(7);
+        reloader.add_tensor("fc.weight", too_large);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // the new version does not fit the buffers: nothing is written
+    write_checkpoint({9.f, 9.f, 9.f, 9.f, 9.f, 9.f}, {9., 9., 9., 9.}, {3, 2});
+    threw = false;
+    try {
+        reloader.reload();
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+    assert(weight[5] == 5.f && bias[0] == 1.);
+    assert(reloader.has_changed());
+}
+
+int main(int, char **) {
+    test_reload_changed();
+    test_reload_without_hashes();
+    test_reload_mismatch();
+    std::cout << "test_reload succeded" << std::endl;
+    return 0;
+}
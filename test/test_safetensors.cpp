@@ -1,8 +1,11 @@
+#include <array>
 #include <cassert>
 #include <iostream>
+#include <memory>
 
 #include "dalotia.h"
 #include "dalotia.hpp"
+#include "dalotia_safetensors_header.hpp"
 
 void test_simple_linear_load() {
     // the C version
@@ -157,11 +160,81 @@ void test_load_other_float_format() {
     }
 }
 
+void test_load_into() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file("../data/model.safetensors"));
+    // reloads reuse the buffer
+    std::vector<double> tensor(60, -1.);
+    const double *data = tensor.data();
+    for (int reload = 0; reload < 2; ++reload) {
+        dalotia_file->load_into("embedding", tensor);
+        assert(tensor.data() == data);
+        for (int i = 0; i < 60; i++) {
+            assert(tensor[i] == i);
+        }
+    }
+    // converted and permuted into a fixed-size array
+    std::array<float, 60> transposed;
+    dalotia_file->load_into("embedding", transposed, dalotia_C_ordering,
+                            {2, 1, 0});
+    assert(transposed[1] == 20.f);  // [0][0][1] is [1][0][0]
+    // or into raw memory
+    auto raw = std::make_unique<float[]>(60);
+    dalotia_file->load_into("embedding", dalotia_float_32, raw.get(), 60);
+    assert(raw[59] == 59.f);
+
+    bool threw = false;
+    try {
+        std::vector<float> too_small(59);
+        dalotia_file->load_into("embedding", too_small);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_header() {
+    const dalotia::SafetensorsHeader header(
+        R"({"__metadata__": {"format": "pt", "nested": {"a": [1, 2]}},
+            "b\u00e9\"t": {"dtype": "F32", "shape": [2, 3],
+                            "data_offsets": [0, 24], "extra": null},
+            "scalar": {"data_offsets": [24, 28], "shape": [], "dtype": "I32"}})");
+    assert(header.metadata() == R"({"format": "pt", "nested": {"a": [1, 2]}})");
+    assert(header.entries().size() == 2);
+    const auto *entry = header.find("b\xc3\xa9\"t");
+    assert(entry == &header.entries()[0]);
+    assert(entry->dtype == "F32" && entry->begin == 0 && entry->end == 24);
+    // the shape is kept as text until it is asked for
+    assert(entry->shape == "[2, 3]");
+    assert(dalotia::SafetensorsHeader::parse_shape(*entry) ==
+           std::vector<int>({2, 3}));
+    assert(dalotia::SafetensorsHeader::parse_shape(*header.find("scalar"))
+               .empty());
+    assert(header.find("missing") == nullptr);
+
+    for (const char *invalid :
+         {R"({"a": {"dtype": "F32", "shape": [1]}})",
+          R"({"a": {"dtype": "F32", "shape": [1], "data_offsets": [4, 0]}})",
+          R"({"a": {"dtype": "F32", "shape": [1], "data_offsets": [0, 4]},
+              "a": {"dtype": "F32", "shape": [1], "data_offsets": [4, 8]}})",
+          R"({"a": {"dtype": "F32", "shape": [1], "data_offsets": [0, 4]})"}) {
+        bool threw = false;
+        try {
+            dalotia::SafetensorsHeader{std::string_view(invalid)};
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        assert(threw);
+    }
+}
+
 int main(int, char **) {
     test_simple_linear_load();
     test_permutation();
     test_permuted_load();
     test_load_other_float_format();
+    test_load_into();
+    test_header();
     std::cout << "test_safetensors succeded" << std::endl;
     return 0;
 }
\ No newline at end of file
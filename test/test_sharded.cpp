@@ -0,0 +1,126 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+
+// the shards are generated by data/generate_sharded.py
+const std::string filename = "../data/sharded/model.safetensors.index.json";
+
+void test_parse_index() {
+    const auto weight_map = dalotia::parse_shard_index(
+        R"({"metadata": {"total_size": 12, "nested": [1, {"a": null}]},
+            "weight_map": {"a.weight": "a-00001.safetensors",
+                           "b\"é": "b-00002.safetensors"}})");
+    assert(weight_map.size() == 2);
+    assert(weight_map[0].first == "a.weight");
+    assert(weight_map[0].second == "a-00001.safetensors");
+    assert(weight_map[1].first == "b\"\xc3\xa9");
+
+    bool threw = false;
+    try {
+        dalotia::parse_shard_index(R"({"metadata": {}})");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_sharded_file() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    auto *sharded_file =
+        dynamic_cast<dalotia::ShardedTensorFile *>(dalotia_file.get());
+    assert(sharded_file != nullptr);
+    assert(sharded_file->get_num_shards() == 2);
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    assert(tensor_names ==
+           std::vector<std::string>({"embed.weight", "layers.0.bias",
+                                     "layers.0.weight", "lm_head.weight"}));
+
+    // metadata is routed to the tensor's shard
+    assert(dalotia_file->get_tensor_extents("layers.0.weight") ==
+           std::vector<int>({2, 3, 2}));
+    assert(dalotia_file->get_weight_format("layers.0.weight") == dalotia_float_64);
+    assert(dalotia_file->get_num_tensor_elements("lm_head.weight") == 12);
+    assert(!dalotia_file->get_mmap_tensor_pointers("embed.weight").empty());
+
+    auto [bias_extents, bias] =
+        dalotia_file->load_tensor_dense<float>("layers.0.bias");
+    assert(bias_extents == std::vector<int>({3}));
+    assert(bias[0] == 1.f && bias[1] == 2.f && bias[2] == 3.f);
+
+    // a batch over both shards, with a permutation for one of the tensors
+    std::vector<float> embed(12), head_t(12), weight(12);
+    dalotia_file->load_tensors_dense(
+        {"embed.weight", "lm_head.weight", "layers.0.weight"}, dalotia_float_32,
+        dalotia_C_ordering,
+        {reinterpret_cast<dalotia_byte *>(embed.data()),
+         reinterpret_cast<dalotia_byte *>(head_t.data()),
+         reinterpret_cast<dalotia_byte *>(weight.data())},
+        {{}, {1, 0}, {}});
+    for (int i = 0; i < 12; i++) {
+        assert(embed[i] == static_cast<float>(i));
+        assert(weight[i] == 0.5f * i);
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            assert(head_t[j * 3 + i] == 100.f + i * 4 + j);
+        }
+    }
+
+    bool threw = false;
+    try {
+        dalotia_file->get_tensor_extents("missing");
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_concurrent_open() {
+    // the shards are opened lazily, also from several threads at once
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&dalotia_file]() {
+            for (const auto &name : dalotia_file->get_tensor_names()) {
+                assert(dalotia_file->get_num_tensor_elements(name) > 0);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    dynamic_cast<dalotia::ShardedTensorFile &>(*dalotia_file).open_all_shards();
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    assert(dalotia_get_num_tensors(file) == 4);
+    std::vector<double> bias(3), weight(12);
+    const char *names[2] = {"layers.0.bias", "layers.0.weight"};
+    char *tensors[2] = {reinterpret_cast<char *>(bias.data()),
+                        reinterpret_cast<char *>(weight.data())};
+    assert(dalotia_load_tensors_dense(file, 2, names, tensors, dalotia_float_64,
+                                      dalotia_C_ordering) == 0);
+    assert(bias[2] == 3.);
+    assert(weight[11] == 5.5);
+    const char *missing[1] = {"missing"};
+    assert(dalotia_load_tensors_dense(file, 1, missing, tensors, dalotia_float_64,
+                                      dalotia_C_ordering) == -1);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_parse_index();
+    test_sharded_file();
+    test_concurrent_open();
+    test_c_interface();
+    std::cout << "test_sharded succeded" << std::endl;
+    return 0;
+}
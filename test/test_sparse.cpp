@@ -0,0 +1,606 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_sparse.hpp"
+
+// the file is generated by data/generate_bitmask.py
+const std::string filename = "../data/model-bitmask.safetensors";
+
+float fc_weight(int i, int j) {
+    return (10 * i + j) % 3 == 0 && i != 2 ? 10 * i + j + 1 : 0.f;
+}
+
+double conv_weight(int a, int b, int c) {
+    return (a + b + c) % 5 == 1 ? a + b + c / 100. : 0.;
+}
+
+void test_bitmask_kernels() {
+    // one row of 70 columns, bits 0, 8, 63, 64 and 69, and padding bits set
+    // that have to be ignored
+    std::vector<uint8_t> bitmask(9, 0);
+    bitmask[0] = 0x01;
+    bitmask[1] = 0x01;
+    bitmask[7] = 0x80;
+    bitmask[8] = 0x01 | 0x20 | 0xC0;
+    assert(dalotia::bitmask_popcount(bitmask.data(), 1, 70) == 5);
+    std::vector<int> row_ptr(2), col_idx(5);
+    dalotia::bitmask_to_csr(bitmask.data(), 1, 70, row_ptr.data(),
+                            col_idx.data());
+    assert(row_ptr == std::vector<int>({0, 5}));
+    assert(col_idx == std::vector<int>({0, 8, 63, 64, 69}));
+}
+
+void test_prune_kernels() {
+    // a 2x3x2 tensor stored in F order, i.e. with reversed storage order
+    const std::vector<int> extents{2, 3, 2};
+    const auto strides = dalotia::dense_strides(extents, {2, 1, 0});
+    assert(strides == std::vector<size_t>({1, 2, 6}));
+    assert(dalotia::dense_strides(extents) == std::vector<size_t>({6, 2, 1}));
+    std::vector<float> data(12);
+    for (int a = 0; a < 2; a++) {
+        for (int b = 0; b < 3; b++) {
+            for (int c = 0; c < 2; c++) {
+                data[a + 2 * b + 6 * c] = (a + b + c) % 2 ? 0.f : -0.5f * c;
+            }
+        }
+    }
+    data[1 + 2 * 1 + 6 * 1] = 3.f;
+    const auto *bytes = reinterpret_cast<const dalotia_byte *>(data.data());
+    // exact zeros (including -0) are dropped, everything else stays
+    assert(dalotia::dense_nnz(bytes, dalotia_float_32, extents, strides, 0.) == 4);
+    assert(dalotia::dense_nnz(bytes, dalotia_float_32, extents, strides, 1.) == 1);
+    assert(dalotia::dense_nnz(bytes, dalotia_float_32, extents, strides, -1.) == 12);
+
+    std::vector<double> values(4);
+    std::vector<int> row_ptr(7), col_idx(4);
+    dalotia::dense_to_sparse(bytes, dalotia_float_32, extents, strides, 0.,
+                             dalotia_CSR, dalotia_float_64,
+                             reinterpret_cast<dalotia_byte *>(values.data()),
+                             row_ptr.data(), col_idx.data());
+    assert(row_ptr == std::vector<int>({0, 0, 1, 1, 2, 3, 4}));
+    assert(col_idx == std::vector<int>({1, 1, 1, 1}));
+    assert(values == std::vector<double>({-0.5, -0.5, 3., -0.5}));
+
+    std::vector<int> rows(1), columns(1);
+    dalotia::dense_to_sparse(bytes, dalotia_float_32, extents, strides, 1.,
+                             dalotia_COO, dalotia_float_64,
+                             reinterpret_cast<dalotia_byte *>(values.data()),
+                             rows.data(), columns.data());
+    assert(rows[0] == 4 && columns[0] == 1 && values[0] == 3.);
+
+    assert(dalotia::sparse_extents(dalotia_CSR, 4, 6) ==
+           std::vector<int>({4, 7, 4}));
+    assert(dalotia::sparse_extents(dalotia_COO, 4, 6) ==
+           std::vector<int>({4, 4, 4}));
+
+    // half precision magnitudes: 1.0, -2.0, 2^-24 and -0
+    const std::vector<uint16_t> halves{0x3c00, 0xc000, 0x0001, 0x8000};
+    const auto *half_bytes = reinterpret_cast<const dalotia_byte *>(halves.data());
+    assert(dalotia::dense_nnz(half_bytes, dalotia_float_16, {4}, {1}, 0.) == 3);
+    assert(dalotia::dense_nnz(half_bytes, dalotia_float_16, {4}, {1}, 1.) == 1);
+    assert(dalotia::dense_nnz(half_bytes, dalotia_bfloat_16, {4}, {1}, 0.) == 3);
+}
+
+void test_bitmask_safetensors() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    // the components are hidden behind the compressed tensor
+    auto tensor_names = dalotia_file->get_tensor_names();
+    std::sort(tensor_names.begin(), tensor_names.end());
+    assert(tensor_names == std::vector<std::string>(
+                               {"conv.weight", "fc.bias", "fc.weight"}));
+    assert(dalotia_file->is_sparse("fc.weight"));
+    assert(dalotia_file->is_sparse("conv.weight"));
+    assert(!dalotia_file->is_sparse("fc.bias"));
+    assert(dalotia_file->get_tensor_extents("fc.weight") ==
+           std::vector<int>({4, 10}));
+    assert(dalotia_file->get_tensor_extents("conv.weight") ==
+           std::vector<int>({2, 2, 70}));
+    assert(dalotia_file->get_weight_format("conv.weight") == dalotia_float_64);
+
+    int nnz = 0;
+    std::vector<int> expected_row_ptr(1, 0), expected_col_idx;
+    std::vector<float> expected_values;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 10; j++) {
+            if (fc_weight(i, j) != 0.f) {
+                ++nnz;
+                expected_col_idx.push_back(j);
+                expected_values.push_back(fc_weight(i, j));
+            }
+        }
+        expected_row_ptr.push_back(nnz);
+    }
+    assert(dalotia_file->get_nnz("fc.weight") == static_cast<size_t>(nnz));
+    assert(dalotia_file->get_sparse_tensor_extents("fc.weight", dalotia_CSR) ==
+           std::vector<int>({nnz, 5, nnz}));
+
+    std::vector<float> values(nnz);
+    std::vector<int> row_ptr(5), col_idx(nnz);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_CSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()), row_ptr.data(),
+        col_idx.data());
+    assert(values == expected_values);
+    assert(row_ptr == expected_row_ptr);
+    assert(col_idx == expected_col_idx);
+
+    // rows of more than one word, converted to float
+    const size_t conv_nnz = dalotia_file->get_nnz("conv.weight");
+    std::vector<float> conv_values(conv_nnz);
+    std::vector<int> conv_row_ptr(5), conv_col_idx(conv_nnz);
+    dalotia_file->load_tensor_sparse(
+        "conv.weight", dalotia_CSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(conv_values.data()),
+        conv_row_ptr.data(), conv_col_idx.data());
+    for (int r = 0; r < 4; r++) {
+        for (int k = conv_row_ptr[r]; k < conv_row_ptr[r + 1]; k++) {
+            assert(conv_values[k] == static_cast<float>(conv_weight(
+                                         r / 2, r % 2, conv_col_idx[k])));
+        }
+    }
+    assert(conv_row_ptr[4] == static_cast<int>(conv_nnz));
+
+    // dense loads decompress
+    auto [extents, dense] = dalotia_file->load_tensor_dense<float>("fc.weight");
+    assert(extents == std::vector<int>({4, 10}));
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 10; j++) {
+            assert(dense[i * 10 + j] == fc_weight(i, j));
+        }
+    }
+    auto [transposed_extents, transposed] =
+        dalotia_file->load_tensor_dense<double>("conv.weight", dalotia_F_ordering);
+    assert(transposed_extents == std::vector<int>({2, 2, 70}));
+    for (int a = 0; a < 2; a++) {
+        for (int b = 0; b < 2; b++) {
+            for (int c = 0; c < 70; c++) {
+                assert(transposed[a + 2 * b + 4 * c] == conv_weight(a, b, c));
+            }
+        }
+    }
+    assert(dalotia_file->get_mmap_tensor_pointers("fc.weight").size() == 2);
+
+    // the same in COO
+    std::vector<int> rows(nnz), columns(nnz);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_COO, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()), rows.data(),
+        columns.data());
+    assert(values == expected_values);
+    assert(columns == expected_col_idx);
+    for (int r = 0; r < 4; r++) {
+        for (int k = expected_row_ptr[r]; k < expected_row_ptr[r + 1]; k++) {
+            assert(rows[k] == r);
+        }
+    }
+
+    // dense tensors are pruned on load
+    assert(dalotia_file->get_nnz("fc.bias") == 4);
+    dalotia_file->set_prune_threshold(2.5);
+    assert(dalotia_file->get_nnz("fc.bias") == 2);
+    assert(dalotia_file->get_sparse_tensor_extents("fc.bias", dalotia_CSR) ==
+           std::vector<int>({2, 2, 2}));
+    std::vector<float> bias_values(2);
+    std::vector<int> bias_row_ptr(2), bias_col_idx(2);
+    dalotia_file->load_tensor_sparse(
+        "fc.bias", dalotia_CSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bias_values.data()),
+        bias_row_ptr.data(), bias_col_idx.data());
+    assert(bias_values == std::vector<float>({3.f, 4.f}));
+    assert(bias_row_ptr == std::vector<int>({0, 2}));
+    assert(bias_col_idx == std::vector<int>({2, 3}));
+    // the stored zeros of compressed tensors are not affected
+    assert(dalotia_file->get_nnz("fc.weight") == static_cast<size_t>(nnz));
+}
+
+// rebuild the C-ordered dense matrix from BSR or SELL
+std::vector<float> dense_from_bsr(const std::vector<float> &values,
+                                  const std::vector<int> &block_row_ptr,
+                                  const std::vector<int> &block_col_idx,
+                                  int block_rows, int block_columns,
+                                  int num_rows, int num_columns) {
+    std::vector<float> dense(num_rows * num_columns, 0.f);
+    for (size_t br = 0; br + 1 < block_row_ptr.size(); br++) {
+        for (int b = block_row_ptr[br]; b < block_row_ptr[br + 1]; b++) {
+            for (int i = 0; i < block_rows; i++) {
+                for (int j = 0; j < block_columns; j++) {
+                    const int row = br * block_rows + i;
+                    const int column = block_col_idx[b] * block_columns + j;
+                    const float value =
+                        values[(b * block_rows + i) * block_columns + j];
+                    if (row < num_rows && column < num_columns) {
+                        dense[row * num_columns + column] = value;
+                    } else {
+                        assert(value == 0.f);  // padding
+                    }
+                }
+            }
+        }
+    }
+    return dense;
+}
+
+std::vector<float> dense_from_sell(const std::vector<float> &values,
+                                   const std::vector<int> &chunk_ptr_and_rows,
+                                   const std::vector<int> &col_idx,
+                                   int chunk_size, int num_rows,
+                                   int num_columns) {
+    const int num_chunks = (num_rows + chunk_size - 1) / chunk_size;
+    const int *rows = chunk_ptr_and_rows.data() + num_chunks + 1;
+    std::vector<float> dense(num_rows * num_columns, 0.f);
+    for (int c = 0; c < num_chunks; c++) {
+        for (int k = chunk_ptr_and_rows[c]; k < chunk_ptr_and_rows[c + 1]; k++) {
+            const int stored_row = c * chunk_size + (k - chunk_ptr_and_rows[c]) % chunk_size;
+            if (stored_row < num_rows) {
+                dense[rows[stored_row] * num_columns + col_idx[k]] += values[k];
+            }
+        }
+    }
+    return dense;
+}
+
+void test_derived_formats() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    std::vector<float> expected(40);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 10; j++) {
+            expected[i * 10 + j] = fc_weight(i, j);
+        }
+    }
+
+    // 3 x 4 blocks, with padding at both edges
+    dalotia::SparseLayout layout;
+    layout.block_rows = 3;
+    layout.block_columns = 4;
+    layout.chunk_size = 3;
+    layout.sorting_scope = 4;
+    dalotia_file->set_sparse_layout(layout);
+    const auto bsr_extents =
+        dalotia_file->get_sparse_tensor_extents("fc.weight", dalotia_BSR);
+    assert(bsr_extents[1] == 3);
+    assert(bsr_extents[0] == bsr_extents[2] * 12);
+    std::vector<float> bsr_values(bsr_extents[0]);
+    std::vector<int> block_row_ptr(bsr_extents[1]), block_col_idx(bsr_extents[2]);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_BSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bsr_values.data()),
+        block_row_ptr.data(), block_col_idx.data());
+    assert(block_row_ptr[0] == 0 && block_row_ptr[2] == bsr_extents[2]);
+    assert(std::is_sorted(block_col_idx.begin(),
+                          block_col_idx.begin() + block_row_ptr[1]));
+    assert(dense_from_bsr(bsr_values, block_row_ptr, block_col_idx, 3, 4, 4,
+                          10) == expected);
+
+    // chunks of 3 rows, sorted within 4 rows: the empty row 2 goes last
+    const auto sell_extents =
+        dalotia_file->get_sparse_tensor_extents("fc.weight", dalotia_SELL);
+    assert(sell_extents[1] == 3 + 4);
+    assert(sell_extents[0] == sell_extents[2]);
+    std::vector<float> sell_values(sell_extents[0]);
+    std::vector<int> chunk_ptr_and_rows(sell_extents[1]),
+        sell_col_idx(sell_extents[2]);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_SELL, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(sell_values.data()),
+        chunk_ptr_and_rows.data(), sell_col_idx.data());
+    assert(chunk_ptr_and_rows[6] == 2);
+    assert(chunk_ptr_and_rows[2] % 3 == 0);
+    assert(dense_from_sell(sell_values, chunk_ptr_and_rows, sell_col_idx, 3, 4,
+                           10) == expected);
+
+    // dense-stored input works the same, pruned on load
+    layout.block_rows = 1;
+    layout.block_columns = 2;
+    dalotia_file->set_sparse_layout(layout);
+    dalotia_file->set_prune_threshold(1.5);
+    assert(dalotia_file->get_sparse_tensor_extents("fc.bias", dalotia_BSR) ==
+           std::vector<int>({4, 2, 2}));
+    std::vector<float> bias_values(4);
+    std::vector<int> bias_row_ptr(2), bias_col_idx(2);
+    dalotia_file->load_tensor_sparse(
+        "fc.bias", dalotia_BSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(bias_values.data()),
+        bias_row_ptr.data(), bias_col_idx.data());
+    assert(bias_values == std::vector<float>({0.f, 2.f, 3.f, 4.f}));
+    assert(bias_col_idx == std::vector<int>({0, 1}));
+}
+
+void test_nd_formats() {
+    // bits 2, 2 and 3, interleaved from the least significant one
+    const auto masks = dalotia::alto_masks({4, 3, 5});
+    assert(masks == std::vector<uint64_t>({0b1001, 0b10010, 0b1100100}));
+    const int coordinates[3] = {3, 2, 4};
+    const uint64_t index = dalotia::alto_index(coordinates, masks);
+    for (int d = 0; d < 3; d++) {
+        assert(dalotia::alto_coordinate(index, masks[d]) == coordinates[d]);
+    }
+
+    // N-d COO in: unordered coordinates come out in C order
+    dalotia::CooTensor coo;
+    coo.extents = {2, 3, 4};
+    coo.weight_format = dalotia_float_64;
+    coo.coordinates = {1, 2, 3, 0, 1, 0, 1, 0, 2};
+    const std::vector<double> coo_values{3., 1., 2.};
+    coo.values.assign(reinterpret_cast<const dalotia_byte *>(coo_values.data()),
+                      reinterpret_cast<const dalotia_byte *>(coo_values.data() + 3));
+    std::vector<float> sorted_values(3);
+    std::vector<int> sorted_coordinates(9);
+    dalotia::coo_tensor_to(coo, dalotia_COO_ND, dalotia::SparseLayout(),
+                           dalotia_float_32,
+                           reinterpret_cast<dalotia_byte *>(sorted_values.data()),
+                           sorted_coordinates.data(), nullptr);
+    assert(sorted_values == std::vector<float>({1.f, 2.f, 3.f}));
+    assert(sorted_coordinates ==
+           std::vector<int>({0, 1, 0, 1, 0, 2, 1, 2, 3}));
+    coo.coordinates[0] = 2;
+    bool threw = false;
+    try {
+        dalotia::coo_tensor_to(coo, dalotia_COO_ND, dalotia::SparseLayout(),
+                               dalotia_float_32,
+                               reinterpret_cast<dalotia_byte *>(sorted_values.data()),
+                               sorted_coordinates.data(), nullptr);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // the 3-d compressed tensor, in all N-d formats
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    const int nnz = static_cast<int>(dalotia_file->get_nnz("conv.weight"));
+    const auto coo_extents =
+        dalotia_file->get_sparse_tensor_extents("conv.weight", dalotia_COO_ND);
+    assert(coo_extents == std::vector<int>({nnz, 3 * nnz, 0}));
+    std::vector<double> values(nnz);
+    std::vector<int> conv_coordinates(3 * nnz);
+    dalotia_file->load_tensor_sparse(
+        "conv.weight", dalotia_COO_ND, dalotia_float_64, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()),
+        conv_coordinates.data(), nullptr);
+    for (int k = 0; k < nnz; k++) {
+        const int *c = conv_coordinates.data() + 3 * k;
+        assert(values[k] == conv_weight(c[0], c[1], c[2]));
+        if (k > 0) {
+            assert(std::lexicographical_compare(c - 3, c, c, c + 3));
+        }
+    }
+
+    assert(dalotia_file->get_sparse_tensor_extents("conv.weight", dalotia_ALTO) ==
+           std::vector<int>({nnz, 2 * nnz, 6}));
+    std::vector<uint64_t> alto_indices(nnz), alto_masks(3);
+    dalotia_file->load_tensor_sparse(
+        "conv.weight", dalotia_ALTO, dalotia_float_64, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()),
+        reinterpret_cast<int *>(alto_indices.data()),
+        reinterpret_cast<int *>(alto_masks.data()));
+    assert(alto_masks == dalotia::alto_masks({2, 2, 70}));
+    assert(std::is_sorted(alto_indices.begin(), alto_indices.end()));
+    for (int k = 0; k < nnz; k++) {
+        assert(values[k] ==
+               conv_weight(dalotia::alto_coordinate(alto_indices[k], alto_masks[0]),
+                           dalotia::alto_coordinate(alto_indices[k], alto_masks[1]),
+                           dalotia::alto_coordinate(alto_indices[k], alto_masks[2])));
+    }
+
+    // blocks of 2 x 2 x 16
+    dalotia::SparseLayout layout;
+    layout.hicoo_block_bits = 4;
+    dalotia_file->set_sparse_layout(layout);
+    const auto hicoo_extents =
+        dalotia_file->get_sparse_tensor_extents("conv.weight", dalotia_HiCOO);
+    const int num_blocks = (hicoo_extents[1] - 1) / 4;
+    assert(num_blocks == 5);
+    assert(hicoo_extents[2] == 3 * nnz);
+    std::vector<int> block_ptr_and_coordinates(hicoo_extents[1]),
+        element_coordinates(hicoo_extents[2]);
+    dalotia_file->load_tensor_sparse(
+        "conv.weight", dalotia_HiCOO, dalotia_float_64, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()),
+        block_ptr_and_coordinates.data(), element_coordinates.data());
+    assert(block_ptr_and_coordinates[num_blocks] == nnz);
+    for (int b = 0; b < num_blocks; b++) {
+        const int *block = block_ptr_and_coordinates.data() + num_blocks + 1 + 3 * b;
+        for (int k = block_ptr_and_coordinates[b];
+             k < block_ptr_and_coordinates[b + 1]; k++) {
+            const int *element = element_coordinates.data() + 3 * k;
+            assert(values[k] == conv_weight((block[0] << 4) + element[0],
+                                            (block[1] << 4) + element[1],
+                                            (block[2] << 4) + element[2]));
+        }
+    }
+}
+
+bool is_permutation_of(const std::vector<int> &permutation, int size) {
+    std::vector<int> sorted = permutation;
+    std::sort(sorted.begin(), sorted.end());
+    for (int i = 0; i < size; i++) {
+        if (sorted.size() != static_cast<size_t>(size) || sorted[i] != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_reordering() {
+    // a path 0 - 1 - ... - 19 with its nodes relabeled by 7 * i % 20, plus
+    // the diagonal; RCM recovers bandwidth 1
+    const int n = 20;
+    std::vector<std::vector<int>> columns(n);
+    for (int i = 0; i < n; i++) {
+        columns[7 * i % n].push_back(7 * i % n);
+        if (i + 1 < n) {
+            columns[7 * i % n].push_back(7 * (i + 1) % n);
+            columns[7 * (i + 1) % n].push_back(7 * i % n);
+        }
+    }
+    std::vector<float> path_values;
+    std::vector<int> path_col_idx, path_row_ptr{0};
+    for (int r = 0; r < n; r++) {
+        std::sort(columns[r].begin(), columns[r].end());
+        for (const int c : columns[r]) {
+            path_col_idx.push_back(c);
+            path_values.push_back(100.f * r + c);
+        }
+        path_row_ptr.push_back(static_cast<int>(path_col_idx.size()));
+    }
+    auto csr = dalotia::allocate_csr_matrix({n, n}, path_values.size(),
+                                            dalotia_float_32);
+    csr.row_ptr = path_row_ptr;
+    csr.col_idx = path_col_idx;
+    std::copy(path_values.begin(), path_values.end(),
+              reinterpret_cast<float *>(csr.values.data()));
+    assert(dalotia::csr_bandwidth(csr) > 1);
+    const auto permutation = dalotia::rcm_permutation(csr);
+    assert(permutation.rows == permutation.columns);
+    assert(is_permutation_of(permutation.rows, n));
+    const auto reordered = dalotia::permute_csr(csr, permutation);
+    assert(dalotia::csr_bandwidth(reordered) == 1);
+    const auto *reordered_values =
+        reinterpret_cast<const float *>(reordered.values.data());
+    for (int i = 0; i < n; i++) {
+        assert(std::is_sorted(reordered.col_idx.begin() + reordered.row_ptr[i],
+                              reordered.col_idx.begin() + reordered.row_ptr[i + 1]));
+        for (int k = reordered.row_ptr[i]; k < reordered.row_ptr[i + 1]; k++) {
+            assert(reordered_values[k] ==
+                   100.f * permutation.rows[i] +
+                       permutation.columns[reordered.col_idx[k]]);
+        }
+    }
+    bool threw = false;
+    try {
+        dalotia::permute_csr(csr, {std::vector<int>(n, 0), permutation.columns});
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+
+    // the rectangular compressed tensor is reordered on the bipartite graph
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    auto identity = dalotia_file->get_sparse_permutation("fc.weight");
+    assert(identity.rows == std::vector<int>({0, 1, 2, 3}));
+    assert(identity.columns.size() == 10);
+    dalotia::SparseLayout layout;
+    layout.reorder_rcm = true;
+    layout.chunk_size = 3;
+    dalotia_file->set_sparse_layout(layout);
+    const auto fc_permutation = dalotia_file->get_sparse_permutation("fc.weight");
+    assert(is_permutation_of(fc_permutation.rows, 4));
+    assert(is_permutation_of(fc_permutation.columns, 10));
+    std::vector<float> expected(40);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 10; j++) {
+            expected[i * 10 + j] =
+                fc_weight(fc_permutation.rows[i], fc_permutation.columns[j]);
+        }
+    }
+    const int nnz = static_cast<int>(dalotia_file->get_nnz("fc.weight"));
+    assert(dalotia_file->get_sparse_tensor_extents("fc.weight", dalotia_CSR) ==
+           std::vector<int>({nnz, 5, nnz}));
+    std::vector<float> values(nnz);
+    std::vector<int> row_ptr(5), col_idx(nnz);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_CSR, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()), row_ptr.data(),
+        col_idx.data());
+    std::vector<float> dense(40, 0.f);
+    for (int i = 0; i < 4; i++) {
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; k++) {
+            dense[i * 10 + col_idx[k]] = values[k];
+        }
+    }
+    assert(dense == expected);
+    // COO is scattered with the same, cached permutation
+    std::vector<int> row_idx(nnz);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_COO, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(values.data()), row_idx.data(),
+        col_idx.data());
+    std::fill(dense.begin(), dense.end(), 0.f);
+    for (int k = 0; k < nnz; k++) {
+        dense[row_idx[k] * 10 + col_idx[k]] = values[k];
+    }
+    assert(dense == expected);
+    assert(std::is_sorted(row_idx.begin(), row_idx.end()));
+    // derived formats are built from the reordered matrix
+    const auto sell_extents =
+        dalotia_file->get_sparse_tensor_extents("fc.weight", dalotia_SELL);
+    std::vector<float> sell_values(sell_extents[0]);
+    std::vector<int> chunk_ptr_and_rows(sell_extents[1]),
+        sell_col_idx(sell_extents[2]);
+    dalotia_file->load_tensor_sparse(
+        "fc.weight", dalotia_SELL, dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(sell_values.data()),
+        chunk_ptr_and_rows.data(), sell_col_idx.data());
+    assert(dense_from_sell(sell_values, chunk_ptr_and_rows, sell_col_idx, 3, 4,
+                           10) == expected);
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    assert(dalotia_is_sparse(file, "fc.weight"));
+    const int nnz = dalotia_get_nnz(file, "fc.weight");
+    int sparse_extents[3];
+    assert(dalotia_get_sparse_tensor_extents(file, "fc.weight", sparse_extents,
+                                             dalotia_CSR) == 2);
+    assert(sparse_extents[0] == nnz);
+    assert(sparse_extents[1] == 5);
+    assert(sparse_extents[2] == nnz);
+    // the values can be loaded in any weight format
+    std::vector<double> values(nnz);
+    std::vector<int> row_ptr(5), col_idx(nnz);
+    assert(dalotia_load_tensor_sparse(
+               file, "fc.weight", reinterpret_cast<char *>(values.data()),
+               row_ptr.data(), col_idx.data(), dalotia_CSR, dalotia_float_64,
+               dalotia_C_ordering) == 0);
+    assert(values[0] == 1.);
+    assert(row_ptr[3] == row_ptr[2]);  // the empty row
+    assert(dalotia_get_nnz(file, "fc.bias") == 4);
+    dalotia_set_prune_threshold(file, 1.);
+    assert(dalotia_get_nnz(file, "fc.bias") == 3);
+    assert(dalotia_load_tensor_sparse(
+               file, "fc.weight", reinterpret_cast<char *>(values.data()),
+               row_ptr.data(), col_idx.data(), dalotia_CSR, dalotia_float_64,
+               dalotia_F_ordering) == -1);
+
+    dalotia_set_sell_parameters(file, 4, 1);
+    assert(dalotia_get_sparse_tensor_extents(file, "fc.weight", sparse_extents,
+                                             dalotia_SELL) == 2);
+    assert(sparse_extents[1] == 2 + 4);
+    dalotia_set_hicoo_block_bits(file, 2);
+    assert(dalotia_get_sparse_tensor_extents(file, "conv.weight", sparse_extents,
+                                             dalotia_HiCOO) == 3);
+    assert(sparse_extents[2] == 3 * sparse_extents[0]);
+    dalotia_set_rcm_reordering(file, true);
+    std::vector<int> row_permutation(4), column_permutation(10);
+    assert(dalotia_get_sparse_permutation(file, "fc.weight",
+                                          row_permutation.data(),
+                                          column_permutation.data()) == 0);
+    assert(is_permutation_of(row_permutation, 4));
+    assert(dalotia_get_sparse_permutation(file, "missing", row_permutation.data(),
+                                          column_permutation.data()) == -1);
+    dalotia_set_rcm_reordering(file, false);
+    dalotia_set_bsr_block_shape(file, 0, 2);
+    assert(dalotia_get_sparse_tensor_extents(file, "fc.weight", sparse_extents,
+                                             dalotia_BSR) == -1);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_bitmask_kernels();
+    test_prune_kernels();
+    test_bitmask_safetensors();
+    test_derived_formats();
+    test_nd_formats();
+    test_reordering();
+    test_c_interface();
+    std::cout << "test_sparse succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,247 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+
+// written to the build directory: a matrix of more than one tile in each
+// direction with a few NaNs and infinities, a kernel and a double vector
+const std::string filename = "test_stats.safetensors";
+
+constexpr int num_rows = 70, num_columns = 300;
+constexpr int num_kernels = 4, kernel_size = 2 * 3 * 3;
+constexpr size_t num_bins = 8;
+constexpr double histogram_min = -2., histogram_max = 2.;
+
+std::vector<float> make_values(size_t size, float step, float offset) {
+    std::vector<float> values(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = step * static_cast<float>(i % 29) + offset;
+    }
+    return values;
+}
+
+std::vector<float> make_matrix() {
+    auto values = make_values(num_rows * num_columns, 0.125f, -1.75f);
+    values[3 * num_columns + 7] = std::numeric_limits<float>::quiet_NaN();
+    values[41 * num_columns + 299] = std::numeric_limits<float>::infinity();
+    values[69 * num_columns + 0] = -std::numeric_limits<float>::infinity();
+    values[12 * num_columns + 100] = 7.5f;  // the largest, above the range
+    return values;
+}
+
+const auto matrix = make_matrix();
+const auto kernel = make_values(num_kernels * kernel_size, 0.25f, -3.f);
+const std::vector<double> vector = {0.5, -4., 1e300, -1e300};
+
+void write_file() {
+    std::unique_ptr<dalotia::TensorFileWriter> writer(
+        dalotia::make_tensor_file_writer(filename));
+    writer->add_tensor_dense("matrix", {num_rows, num_columns}, matrix.data());
+    writer->add_tensor_dense("kernel", {num_kernels, 2, 3, 3}, kernel.data());
+    writer->add_tensor_dense("vector", {4}, vector.data());
+    writer->write();
+}
+
+// the expected statistics, by brute force: values is C-ordered, and the
+// channel of an element its index along axis
+template <typename value_type>
+dalotia::TensorStatistics reference_stats(const std::vector<value_type> &values,
+                                          const std::vector<int> &extents,
+                                          int axis) {
+    size_t num_channels = 1, inner = 1;
+    if (axis >= 0) {
+        num_channels = extents[axis];
+        for (size_t d = axis + 1; d < extents.size(); ++d) {
+            inner *= extents[d];
+        }
+    }
+    dalotia::TensorStatistics statistics;
+    dalotia_TensorStats empty{};
+    empty.min = std::numeric_limits<double>::infinity();
+    empty.max = -std::numeric_limits<double>::infinity();
+    statistics.channels.assign(num_channels, empty);
+    statistics.histogram.assign(num_channels * num_bins, 0);
+    for (size_t i = 0; i < values.size(); ++i) {
+        const size_t channel = (i / inner) % num_channels;
+        auto &stats = statistics.channels[channel];
+        const double value = values[i];
+        ++stats.num_elements;
+        if (std::isnan(value)) {
+            ++stats.num_nan;
+        } else if (std::isinf(value)) {
+            ++stats.num_inf;
+        } else {
+            stats.min = std::min(stats.min, value);
+            stats.max = std::max(stats.max, value);
+            stats.absmax = std::max(stats.absmax, std::abs(value));
+            stats.l2_norm += value * value;
+            const double bin = (value - histogram_min) * num_bins /
+                               (histogram_max - histogram_min);
+            const size_t b = bin <= 0.         ? 0
+                             : bin >= num_bins ? num_bins - 1
+                                               : static_cast<size_t>(bin);
+            ++statistics.histogram[channel * num_bins + b];
+        }
+    }
+    for (auto &stats : statistics.channels) {
+        stats.l2_norm = std::sqrt(stats.l2_norm);
+    }
+    return statistics;
+}
+
+bool is_close(double value, double expected) {
+    return value == expected ||
+           std::abs(value - expected) <= 1e-6 * std::abs(expected);
+}
+
+void assert_equal(const dalotia::TensorStatistics &statistics,
+                  const dalotia::TensorStatistics &expected,
+                  bool with_histogram) {
+    assert(statistics.channels.size() == expected.channels.size());
+    for (size_t c = 0; c < expected.channels.size(); ++c) {
+        const auto &stats = statistics.channels[c];
+        const auto &expected_stats = expected.channels[c];
+        assert(stats.num_elements == expected_stats.num_elements);
+        assert(stats.num_nan == expected_stats.num_nan);
+        assert(stats.num_inf == expected_stats.num_inf);
+        assert(stats.min == expected_stats.min);
+        assert(stats.max == expected_stats.max);
+        assert(stats.absmax == expected_stats.absmax);
+        assert(is_close(stats.l2_norm, expected_stats.l2_norm));
+    }
+    if (with_histogram) {
+        assert(statistics.histogram == expected.histogram);
+    } else {
+        assert(statistics.histogram.empty());
+    }
+}
+
+void test_load_with_stats() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    const std::vector<int> extents = {num_rows, num_columns};
+
+    // per tensor, while loading as float
+    std::vector<float> loaded(num_rows * num_columns);
+    auto statistics = dalotia::load_tensor_dense_with_stats(
+        *dalotia_file, "matrix", dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(loaded.data()));
+    assert_equal(statistics, reference_stats(matrix, extents, -1), false);
+    assert(statistics.channels[0].num_nan == 1);
+    assert(statistics.channels[0].num_inf == 2);
+    assert(statistics.channels[0].absmax == 7.5);
+    for (size_t i = 0; i < matrix.size(); ++i) {
+        assert(loaded[i] == matrix[i] ||
+               (std::isnan(loaded[i]) && std::isnan(matrix[i])));
+    }
+
+    // per row and per column with histograms, transposed to double in the
+    // same pass
+    dalotia::StatsOptions options;
+    options.num_bins = num_bins;
+    options.histogram_min = histogram_min;
+    options.histogram_max = histogram_max;
+    std::vector<double> transposed(num_rows * num_columns);
+    for (int axis = 0; axis < 2; ++axis) {
+        options.axis = axis;
+        statistics = dalotia::load_tensor_dense_with_stats(
+            *dalotia_file, "matrix", dalotia_float_64, dalotia_F_ordering,
+            reinterpret_cast<dalotia_byte *>(transposed.data()), options);
+        assert_equal(statistics, reference_stats(matrix, extents, axis), true);
+    }
+    assert(transposed[7 * num_rows + 12] == matrix[12 * num_columns + 7]);
+
+    // per input channel of a kernel, permuted to [kh][kw][in][out]
+    std::vector<float> permuted(num_kernels * kernel_size);
+    options.axis = 1;
+    statistics = dalotia::load_tensor_dense_with_stats(
+        *dalotia_file, "kernel", dalotia_float_32, dalotia_C_ordering,
+        reinterpret_cast<dalotia_byte *>(permuted.data()), options,
+        {2, 3, 1, 0});
+    assert_equal(statistics, reference_stats(kernel, {num_kernels, 2, 3, 3}, 1),
+                 true);
+    assert(permuted[((1 * 3 + 2) * 2 + 1) * num_kernels + 3] ==
+           kernel[3 * kernel_size + (1 * 3 + 1) * 3 + 2]);
+
+    bool threw = false;
+    try {
+        options.axis = 2;
+        (void)dalotia::load_tensor_dense_with_stats(
+            *dalotia_file, "matrix", dalotia_float_32, dalotia_C_ordering,
+            reinterpret_cast<dalotia_byte *>(loaded.data()), options);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_stats_only() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    dalotia::StatsOptions options;
+    options.axis = 0;
+    options.num_bins = num_bins;
+    options.histogram_min = histogram_min;
+    options.histogram_max = histogram_max;
+    assert_equal(dalotia::compute_tensor_stats(*dalotia_file, "matrix", options),
+                 reference_stats(matrix, {num_rows, num_columns}, 0), true);
+    assert_equal(dalotia::compute_tensor_stats(*dalotia_file, "kernel"),
+                 reference_stats(kernel, {num_kernels, 2, 3, 3}, -1), false);
+    // doubles stay doubles
+    const auto statistics =
+        dalotia::compute_tensor_stats(*dalotia_file, "vector", options);
+    assert_equal(statistics, reference_stats(vector, {4}, 0), true);
+    assert(statistics.channels[2].max == 1e300);
+    // far outside of the range, in the last and the first bin
+    assert(statistics.histogram[2 * num_bins + num_bins - 1] == 1);
+    assert(statistics.histogram[3 * num_bins] == 1);
+
+    bool threw = false;
+    try {
+        options.histogram_max = histogram_min;
+        (void)dalotia::compute_tensor_stats(*dalotia_file, "vector", options);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    assert(threw);
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    const auto expected = reference_stats(kernel, {num_kernels, 2, 3, 3}, 0);
+    std::vector<float> loaded(num_kernels * kernel_size);
+    std::vector<dalotia_TensorStats> stats(num_kernels);
+    std::vector<long long> histogram(num_kernels * num_bins);
+    assert(dalotia_load_tensor_dense_with_stats(
+               file, "kernel", reinterpret_cast<char *>(loaded.data()),
+               dalotia_float_32, dalotia_C_ordering, nullptr, 0, stats.data(),
+               num_bins, histogram_min, histogram_max,
+               histogram.data()) == 0);
+    assert(loaded == kernel);
+    assert(stats[3].max == expected.channels[3].max);
+    assert(histogram == expected.histogram);
+
+    dalotia_TensorStats tensor_stats;
+    assert(dalotia_get_tensor_stats(file, "kernel", -1, &tensor_stats, 0, 0.,
+                                    0., nullptr) == 0);
+    assert(tensor_stats.num_elements == num_kernels * kernel_size);
+    assert(tensor_stats.min == -3.);
+    assert(dalotia_get_tensor_stats(file, "kernel", 4, &tensor_stats, 0, 0.,
+                                    0., nullptr) == -1);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    write_file();
+    test_load_with_stats();
+    test_stats_only();
+    test_c_interface();
+    std::cout << "test_stats succeded" << std::endl;
+    return 0;
+}
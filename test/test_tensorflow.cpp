@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -88,8 +89,42 @@ void test_names() {
 #endif  // DALOTIA_WITH_CPP_PMR
 }
 
+void test_variables_batch() {
+    std::string filename = "../data/tensorflow_model";
+    dalotia::TensorflowSavedModel dalotia_file(filename);
+    // only the variables are listed, with their metadata read at open time
+    const auto &tensor_names = dalotia_file.get_tensor_names();
+    assert(std::find(tensor_names.begin(), tensor_names.end(),
+                     "dense/kernel/Read/ReadVariableOp") != tensor_names.end());
+    assert(std::find(tensor_names.begin(), tensor_names.end(), "NoOp") ==
+           tensor_names.end());
+    assert(dalotia_file.tensor_infos_.size() == tensor_names.size());
+    assert(dalotia_file.tensors_.empty());
+
+    // one session run for the whole batch
+    std::vector<std::vector<float>> tensors;
+    std::vector<dalotia_byte *> pointers;
+    tensors.reserve(tensor_names.size());
+    for (const auto &name : tensor_names) {
+        assert(dalotia_file.get_weight_format(name) == dalotia_float_32);
+        tensors.emplace_back(dalotia_file.get_num_tensor_elements(name));
+        pointers.push_back(reinterpret_cast<dalotia_byte *>(tensors.back().data()));
+    }
+    dalotia_file.load_tensors_dense(tensor_names, dalotia_float_32,
+                                    dalotia_C_ordering, pointers);
+    assert(dalotia_file.tensors_.size() == tensor_names.size());
+    for (size_t t = 0; t < tensor_names.size(); ++t) {
+        const auto *fetched = reinterpret_cast<const float *>(
+            dalotia_file.get_tensor_pointers(tensor_names[t])[0]);
+        for (size_t i = 0; i < tensors[t].size(); ++i) {
+            assert_equal(tensors[t][i], fetched[i]);
+        }
+    }
+}
+
 int main(int, char **) {
     test_names();
+    test_variables_batch();
     std::cout << "test_tensorflow succeded" << std::endl;
     return 0;
 }
\ No newline at end of file
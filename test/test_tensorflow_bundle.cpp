@@ -0,0 +1,99 @@
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_tensorflow_bundle_file.hpp"
+#include "test_helper.h"
+
+// the SavedModel is generated by data/generate_tf.py
+const std::string filename = "../data/tensorflow_model";
+
+void test_names() {
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        new dalotia::TensorflowBundleFile(filename));
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    // 3 convolutions, 3 batch norms and the dense layer; the string-typed
+    // object graph is not listed
+    assert(tensor_names.size() == 3 * 2 + 3 * 4 + 2);
+    assert(tensor_names.front() == "layer_with_weights-0/bias");
+    assert(tensor_names.back() == "layer_with_weights-6/kernel");
+    for (const auto &name : tensor_names) {
+        assert(!dalotia_file->is_sparse(name));
+        assert(dalotia_file->get_weight_format(name) == dalotia_float_32);
+    }
+    assert(dalotia_file->get_tensor_extents("layer_with_weights-0/kernel") ==
+           std::vector<int>({3, 3, 3, 16}));
+    assert(dalotia_file->get_tensor_extents("layer_with_weights-1/moving_mean") ==
+           std::vector<int>({16}));
+}
+
+void test_load() {
+    // the index file works just as well as the directory
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(dalotia::make_tensor_file(
+        filename + "/variables/variables.index"));
+    assert(dynamic_cast<dalotia::TensorflowBundleFile *>(dalotia_file.get()) !=
+           nullptr);
+    const std::string tensor_name = "layer_with_weights-6/kernel";
+    assert(dalotia_file->get_tensor_extents(tensor_name) ==
+           std::vector<int>({16, 10}));
+    std::vector<double> kernel(160);
+    dalotia_file->load_tensor_dense(tensor_name, dalotia_float_64,
+                                    dalotia_C_ordering,
+                                    reinterpret_cast<dalotia_byte *>(kernel.data()));
+    const std::vector<double> true_values_begin = {
+        -0.25138268, -0.25613192, 0.16491315, -0.13381714, 0.35687172, -0.35824186,
+        0.3529436,   -0.55490106, 0.27651784, 0.30784482,  -0.2846631};
+    for (size_t i = 0; i < true_values_begin.size(); ++i) {
+        assert_close(kernel[i], true_values_begin[i]);
+    }
+    assert_close(kernel.back(), -0.21346514);
+
+    // served from the mapped data shard
+    const auto pointers = dalotia_file->get_mmap_tensor_pointers(tensor_name);
+    assert(pointers.size() == 1);
+    assert(reinterpret_cast<const float *>(pointers[0])[1] ==
+           static_cast<float>(kernel[1]));
+
+    std::vector<float> conv_kernel(3 * 3 * 3 * 16);
+    dalotia_file->load_tensor_dense(
+        "layer_with_weights-0/kernel", dalotia_float_32, dalotia_F_ordering,
+        reinterpret_cast<dalotia_byte *>(conv_kernel.data()));
+    for (const float value : conv_kernel) {
+        assert_close(value, 0.4f);
+    }
+    std::vector<float> variance(16);
+    dalotia_file->load_tensor_dense(
+        "layer_with_weights-1/moving_variance", dalotia_float_32,
+        dalotia_C_ordering, reinterpret_cast<dalotia_byte *>(variance.data()));
+    for (const float value : variance) {
+        assert(value == 1.f);
+    }
+}
+
+void test_c_interface() {
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    assert(dalotia_get_num_tensors(file) == 20);
+    int extents[4];
+    assert(dalotia_get_tensor_extents(file, "layer_with_weights-6/bias",
+                                      extents) == 1);
+    assert(extents[0] == 10);
+    std::vector<float> bias(10);
+    assert(dalotia_load_tensor_dense(file, "layer_with_weights-6/bias",
+                                     reinterpret_cast<char *>(bias.data()),
+                                     dalotia_float_32, dalotia_C_ordering) == 0);
+    for (const float value : bias) {
+        assert(value == 0.f);
+    }
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_names();
+    test_load();
+    test_c_interface();
+    std::cout << "test_tensorflow_bundle succeded" << std::endl;
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+
+// the files are written to the build directory and read back with the
+// safetensors reader
+const std::string filename = "test_writer.safetensors";
+
+// embedding[i, j, k] = 20 * i + 5 * j + k, with extents (3, 4, 5)
+std::vector<double> make_embedding() {
+    std::vector<double> embedding(60);
+    for (int i = 0; i < 60; i++) {
+        embedding[i] = i;
+    }
+    return embedding;
+}
+
+void test_write_and_read_back() {
+    const auto embedding = make_embedding();
+    std::vector<float> weight(6);
+    for (int i = 0; i < 6; i++) {
+        weight[i] = 0.5f * i;
+    }
+    // the same 2x3 weight, in memory as its 3x2 transpose
+    std::vector<float> weight_t(6);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 2; j++) {
+            weight_t[i * 2 + j] = weight[j * 3 + i];
+        }
+    }
+    {
+        std::unique_ptr<dalotia::TensorFileWriter> writer(
+            dalotia::make_tensor_file_writer(filename));
+        writer->add_tensor_dense("fc.weight", {2, 3}, weight.data());
+        // stored such that loading with permutation {1, 0} gives weight_t
+        writer->add_tensor_dense("fc.weight_t", {3, 2}, weight_t.data(),
+                                 dalotia_C_ordering, {1, 0});
+        // converted on write
+        writer->add_tensor_dense(
+            "embedding", dalotia_float_64, dalotia_C_ordering, {3, 4, 5},
+            reinterpret_cast<const dalotia_byte *>(embedding.data()),
+            dalotia_float_32);
+        writer->write_async();
+        bool threw = false;
+        try {
+            writer->write();  // not before the pending write is waited for
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        assert(threw);
+        writer->wait();
+    }
+
+    std::unique_ptr<dalotia::TensorFile> dalotia_file(
+        dalotia::make_tensor_file(filename));
+    const auto &tensor_names = dalotia_file->get_tensor_names();
+    assert(tensor_names.size() == 3);
+
+    auto [weight_extents, weight_read] =
+        dalotia_file->load_tensor_dense<float>("fc.weight");
+    assert(weight_extents == std::vector<int>({2, 3}));
+    for (int i = 0; i < 6; i++) {
+        assert(weight_read[i] == weight[i]);
+    }
+    // the transposed write stored the original weight
+    auto [transposed_extents, transposed_read] =
+        dalotia_file->load_tensor_dense<float>("fc.weight_t");
+    assert(transposed_extents == std::vector<int>({2, 3}));
+    for (int i = 0; i < 6; i++) {
+        assert(transposed_read[i] == weight[i]);
+    }
+
+    auto [embedding_extents, embedding_read] =
+        dalotia_file->load_tensor_dense<float>("embedding");
+    assert(embedding_extents == std::vector<int>({3, 4, 5}));
+    for (int i = 0; i < 60; i++) {
+        assert(embedding_read[i] == static_cast<float>(embedding[i]));
+    }
+    // data offsets are aligned to the element size
+    for (const auto &name : tensor_names) {
+        for (const auto *pointer : dalotia_file->get_mmap_tensor_pointers(name)) {
+            assert(reinterpret_cast<uintptr_t>(pointer) % 4 == 0);
+        }
+    }
+}
+
+void test_write_fortran_order() {
+    // the C version; the embedding's memory seen as an F-ordered (5, 4, 3)
+    // array
+    const auto embedding = make_embedding();
+    const auto embedding_f = embedding;
+    const int extents[3] = {5, 4, 3};
+    const int permutation[3] = {2, 1, 3};
+    DalotiaTensorFileWriter *writer = dalotia_open_file_writer(filename.c_str());
+    int status = dalotia_add_tensor_dense(
+        writer, "embedding", reinterpret_cast<const char *>(embedding_f.data()),
+        3, extents, dalotia_float_64, dalotia_F_ordering, dalotia_float_64);
+    assert(status == 0);
+    // the memory layout of loading with the 1-based permutation {2, 1, 3}
+    status = dalotia_add_tensor_dense_with_permutation(
+        writer, "embedding_permuted",
+        reinterpret_cast<const char *>(embedding_f.data()), 3, extents,
+        dalotia_float_64, dalotia_F_ordering, dalotia_float_64, permutation);
+    assert(status == 0);
+    assert(dalotia_add_tensor_dense(
+               writer, "embedding",
+               reinterpret_cast<const char *>(embedding_f.data()), 3, extents,
+               dalotia_float_64, dalotia_F_ordering, dalotia_float_64) == -1);
+    assert(dalotia_write_file(writer) == 0);
+    dalotia_close_file_writer(writer);
+
+    // as for loading, F ordering without permutation is a transposition
+    DalotiaTensorFile *file = dalotia_open_file(filename.c_str());
+    int read_extents[3];
+    assert(dalotia_get_tensor_extents(file, "embedding", read_extents) == 3);
+    assert(read_extents[0] == 5);
+    assert(read_extents[1] == 4);
+    assert(read_extents[2] == 3);
+    std::vector<double> tensor(60);
+    dalotia_load_tensor_dense(file, "embedding",
+                              reinterpret_cast<char *>(tensor.data()),
+                              dalotia_float_64, dalotia_C_ordering);
+    for (int a = 0; a < 5; a++) {
+        for (int b = 0; b < 4; b++) {
+            for (int c = 0; c < 3; c++) {
+                assert(tensor[(a * 4 + b) * 3 + c] ==
+                       embedding_f[a + 5 * b + 20 * c]);
+            }
+        }
+    }
+    dalotia_load_tensor_dense(file, "embedding",
+                              reinterpret_cast<char *>(tensor.data()),
+                              dalotia_float_64, dalotia_F_ordering);
+    assert(tensor == embedding_f);
+
+    assert(dalotia_get_tensor_extents(file, "embedding_permuted", read_extents) == 3);
+    assert(read_extents[0] == 3);
+    assert(read_extents[1] == 5);
+    assert(read_extents[2] == 4);
+    dalotia_load_tensor_dense_with_permutation(
+        file, "embedding_permuted", reinterpret_cast<char *>(tensor.data()),
+        dalotia_float_64, dalotia_F_ordering, permutation);
+    assert(tensor == embedding_f);
+    dalotia_close_file(file);
+}
+
+int main(int, char **) {
+    test_write_and_read_back();
+    test_write_fortran_order();
+    std::cout << "test_writer succeded" << std::endl;
+    return 0;
+}
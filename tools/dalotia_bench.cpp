@@ -0,0 +1,787 @@
+// dalotia-bench: load throughput on synthetic safetensors files -- every
+// pair of stored and loaded dtype, every permutation up to rank 5 in C and
+// F ordering, several thread counts, cold and warm page cache, and the
+// C++, C and Fortran interfaces; the results are written as JSON, each
+// with its bandwidth relative to a memcpy of the same number of bytes on
+// the same number of threads (STREAM copy and triad are reported, too),
+// and with the page faults it took and how much of the file was cached
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "dalotia.h"
+#include "dalotia.hpp"
+#include "dalotia_safetensors_header.hpp"
+#include "dalotia_safetensors_writer.hpp"
+
+#ifdef DALOTIA_BENCH_WITH_FORTRAN
+// tools/dalotia_bench.f90
+extern "C" void dalotia_bench_load_fortran(DalotiaTensorFile *file,
+                                           const char *tensor_name,
+                                           int name_length, int rank);
+#endif
+
+namespace {
+
+const std::vector<dalotia_WeightFormat> all_formats{
+    dalotia_float_64, dalotia_float_32, dalotia_float_16, dalotia_bfloat_16,
+    dalotia_uint_32,  dalotia_uint_16,  dalotia_uint_8,   dalotia_int_32,
+    dalotia_int_16,   dalotia_int_8};
+
+const std::vector<std::string> all_suites{"dtypes", "permutations", "threads",
+                                          "cache", "interfaces"};
+
+struct Options {
+    double size_mib = 16.;
+    int num_tensors = 1;
+    int max_rank = 5;
+    std::vector<dalotia_WeightFormat> formats = all_formats;
+    std::vector<int> thread_counts;
+    int repetitions = 5;
+    std::vector<std::string> suites = all_suites;
+    std::string directory = ".";
+    std::string output;
+    bool keep_files = false;
+};
+
+void print_usage(const char *program) {
+    std::cerr
+        << "usage: " << program << " [options]\n"
+        << "options:\n"
+        << "  --size <MiB>          size of every tensor as float32; all "
+           "dtypes use the same extents (default: 16)\n"
+        << "  --tensors <n>         tensors per file, all loaded in each "
+           "repetition (default: 1)\n"
+        << "  --rank <r>            highest rank, at most 5 (default: 5)\n"
+        << "  --dtypes <d,...>      dtypes of the dtypes suite (default: "
+           "all)\n"
+        << "  --threads <t,...>     thread counts of the threads suite "
+           "(default: powers of two up to the maximum)\n"
+        << "  --suites <s,...>      any of dtypes, permutations, threads, "
+           "cache, interfaces (default: all)\n"
+        << "  --repetitions <n>     repetitions per measurement (default: "
+           "5)\n"
+        << "  --directory <d>       where the files are written (default: .)\n"
+        << "  --output <file>       JSON output (default: stdout)\n"
+        << "  --keep-files          do not remove the generated files\n";
+}
+
+std::vector<std::string> split(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int max_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+void set_num_threads(int num_threads) {
+#ifdef _OPENMP
+    omp_set_num_threads(num_threads);
+#else
+    (void)num_threads;
+#endif
+}
+
+const std::string &dtype_name(dalotia_WeightFormat format) {
+    return dalotia::safetensors_dtype_names.at(format);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+// generator
+
+// (nearly) equal extents with a product of at most num_elements
+std::vector<int> extents_for(size_t num_elements, int rank) {
+    const auto extent = static_cast<int>(
+        std::floor(std::pow(static_cast<double>(num_elements), 1. / rank) +
+                   1e-9));
+    return std::vector<int>(rank, std::max(extent, 1));
+}
+
+// IEEE half precision bits of a normal float in the range of half
+uint16_t half_bits(float value) {
+    uint32_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFF) == 0) {
+        return static_cast<uint16_t>(bits >> 16);
+    }
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t exponent = ((bits >> 23) & 0xFF) - 127 + 15;
+    return static_cast<uint16_t>(sign | (exponent << 10) |
+                                 ((bits >> 13) & 0x3FF));
+}
+
+// small, finite, normal values, so that no conversion takes a slow path
+std::vector<dalotia_byte> synthetic_values(dalotia_WeightFormat format,
+                                           size_t num_elements) {
+    const size_t item_bytes = dalotia::sizeof_weight_format(format);
+    std::vector<dalotia_byte> bytes(num_elements * item_bytes);
+    for (size_t i = 0; i < num_elements; ++i) {
+        const int integer = static_cast<int>(i % 251) - 125;
+        const float value = integer / 128.f;
+        dalotia_byte *destination = bytes.data() + i * item_bytes;
+        auto store = [destination](auto item) {
+            std::memcpy(destination, &item, sizeof(item));
+        };
+        switch (format) {
+            case dalotia_float_64: store(static_cast<double>(value)); break;
+            case dalotia_float_32: store(value); break;
+            case dalotia_float_16: store(half_bits(value)); break;
+            case dalotia_bfloat_16: {
+                uint32_t bits = 0;
+                std::memcpy(&bits, &value, sizeof(bits));
+                store(static_cast<uint16_t>(bits >> 16));
+                break;
+            }
+            case dalotia_uint_32: store(static_cast<uint32_t>(integer + 125)); break;
+            case dalotia_uint_16: store(static_cast<uint16_t>(integer + 125)); break;
+            case dalotia_uint_8: store(static_cast<uint8_t>(integer + 125)); break;
+            case dalotia_int_32: store(static_cast<int32_t>(integer)); break;
+            case dalotia_int_16: store(static_cast<int16_t>(integer)); break;
+            case dalotia_int_8: store(static_cast<int8_t>(integer)); break;
+            default:
+                throw std::runtime_error("no synthetic values for this format");
+        }
+    }
+    return bytes;
+}
+
+std::string tensor_name(int index) { return "tensor_" + std::to_string(index); }
+
+// writes num_tensors tensors of the same extents and values, and syncs the
+// file, such that its pages in the page cache are clean and can be evicted
+void generate_file(const std::string &filename, dalotia_WeightFormat format,
+                   const std::vector<int> &extents, int num_tensors) {
+    const size_t num_elements = std::accumulate(
+        extents.begin(), extents.end(), size_t(1), std::multiplies<size_t>());
+    const auto values = synthetic_values(format, num_elements);
+    {
+        dalotia::SafetensorsFileWriter writer(filename);
+        for (int t = 0; t < num_tensors; ++t) {
+            writer.add_tensor_dense(tensor_name(t), format, dalotia_C_ordering,
+                                    extents, values.data(), format);
+        }
+        writer.write();
+    }
+    const int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0 || fsync(file_descriptor) != 0) {
+        throw std::runtime_error("could not sync " + filename);
+    }
+    close(file_descriptor);
+}
+
+// page cache
+
+double resident_fraction(int file_descriptor, size_t file_size) {
+    if (file_size == 0) {
+        return 0.;
+    }
+    void *address =
+        mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    if (address == MAP_FAILED) {
+        return -1.;
+    }
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> pages((file_size + page_size - 1) / page_size);
+    size_t num_resident = 0;
+    if (mincore(address, file_size, pages.data()) == 0) {
+        for (const unsigned char page : pages) {
+            num_resident += page & 1;
+        }
+    }
+    munmap(address, file_size);
+    return static_cast<double>(num_resident) / pages.size();
+}
+
+// the fraction of the file that is in the page cache, after dropping it
+// from there if evict is set; best effort, the kernel only drops clean
+// pages that no process maps
+double resident_fraction(const std::string &filename, bool evict) {
+    const int file_descriptor = open(filename.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("could not open " + filename);
+    }
+    struct stat file_stat;
+    fstat(file_descriptor, &file_stat);
+    if (evict) {
+        posix_fadvise(file_descriptor, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    const double fraction = resident_fraction(
+        file_descriptor, static_cast<size_t>(file_stat.st_size));
+    close(file_descriptor);
+    return fraction;
+}
+
+// minor and major page faults of the process so far
+std::pair<long, long> page_faults() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return {usage.ru_minflt, usage.ru_majflt};
+}
+
+// baselines
+
+struct Baseline {
+    int threads;
+    double memcpy_gbps;
+    double stream_copy_gbps;
+    double stream_triad_gbps;
+};
+
+double fastest(int repetitions, const std::function<void()> &function) {
+    double best = 0.;
+    for (int r = 0; r < repetitions; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const double seconds = seconds_since(start);
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// memcpy in the blocks that assign_linearly copies, and STREAM copy and
+// triad (cf. https://www.cs.virginia.edu/stream/) on num_bytes per array
+Baseline measure_baseline(int num_threads, size_t num_bytes, int repetitions) {
+    set_num_threads(num_threads);
+    const size_t n = num_bytes / sizeof(double);
+    std::unique_ptr<double[]> a(new double[n]), b(new double[n]),
+        c(new double[n]);
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = 0.;
+        b[i] = 1.;
+        c[i] = 2.;
+    }
+    const size_t copy_bytes = n * sizeof(double);
+    constexpr size_t block_bytes = size_t(1) << 16;
+    const size_t num_blocks = (copy_bytes + block_bytes - 1) / block_bytes;
+    auto *destination = reinterpret_cast<char *>(a.get());
+    const auto *source = reinterpret_cast<const char *>(b.get());
+    const double memcpy_time = fastest(repetitions + 1, [&]() {
+#pragma omp parallel for schedule(static)
+        for (size_t k = 0; k < num_blocks; ++k) {
+            const size_t begin = k * block_bytes;
+            std::memcpy(destination + begin, source + begin,
+                        std::min(block_bytes, copy_bytes - begin));
+        }
+    });
+    const double copy_time = fastest(repetitions + 1, [&]() {
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = b[i];
+        }
+    });
+    const double scalar = 3.;
+    const double triad_time = fastest(repetitions + 1, [&]() {
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i) {
+            a[i] = b[i] + scalar * c[i];
+        }
+    });
+    if (a[n / 2] != 7.) {
+        std::abort();  // keeps the loops from being optimized away
+    }
+    return {num_threads, 2. * copy_bytes / memcpy_time * 1e-9,
+            2. * copy_bytes / copy_time * 1e-9,
+            3. * copy_bytes / triad_time * 1e-9};
+}
+
+// load measurements
+
+struct Case {
+    std::string suite;
+    std::string interface_name;  // cpp, cpp-vector, c or fortran
+    dalotia_WeightFormat stored;
+    dalotia_WeightFormat loaded;
+    std::vector<int> extents;
+    std::vector<int> permutation;
+    dalotia_Ordering ordering;
+    int threads;
+    bool cold;
+};
+
+struct Result {
+    Case measured;
+    bool supported = true;
+    size_t num_bytes = 0;  // read and written, all tensors
+    double min_seconds = 0.;
+    double median_seconds = 0.;
+    // means over the repetitions: the fraction of the file in the page
+    // cache before the load, and the page faults taken by it
+    double resident_before_load = 0.;
+    double minor_faults = 0.;
+    double major_faults = 0.;
+};
+
+// times loading all tensors of the file; the cpp and c interfaces load
+// into a buffer allocated up front, cpp-vector and fortran allocate their
+// result like a user of these interfaces would; with a cold page cache,
+// the file is evicted and reopened before every repetition, otherwise the
+// first load is a warm-up
+Result measure(const Case &measured, const std::string &filename,
+               int num_tensors, int repetitions) {
+    Result result;
+    result.measured = measured;
+    const size_t num_elements =
+        std::accumulate(measured.extents.begin(), measured.extents.end(),
+                        size_t(1), std::multiplies<size_t>());
+    result.num_bytes = num_tensors * num_elements *
+                       (dalotia::sizeof_weight_format(measured.stored) +
+                        dalotia::sizeof_weight_format(measured.loaded));
+    set_num_threads(measured.threads);
+
+    const std::string &interface_name = measured.interface_name;
+    const bool uses_c_file =
+        interface_name == "c" || interface_name == "fortran";
+    std::unique_ptr<dalotia::TensorFile> file;
+    std::unique_ptr<DalotiaTensorFile, decltype(&dalotia_close_file)> c_file(
+        nullptr, &dalotia_close_file);
+    auto open_file = [&]() {
+        if (uses_c_file) {
+            c_file.reset(dalotia_open_file(filename.c_str()));
+        } else {
+            file.reset(dalotia::make_tensor_file(filename));
+        }
+    };
+    auto close_file = [&]() {
+        file.reset();
+        c_file.reset();
+    };
+
+    std::vector<std::string> names;
+    for (int t = 0; t < num_tensors; ++t) {
+        names.push_back(tensor_name(t));
+    }
+    std::vector<dalotia_byte> buffer;
+    if (interface_name == "cpp" || interface_name == "c") {
+        buffer.assign(num_elements *
+                          dalotia::sizeof_weight_format(measured.loaded),
+                      dalotia_byte(0));
+    }
+    std::function<void()> load_all;
+    if (interface_name == "cpp") {
+        load_all = [&]() {
+            for (const auto &name : names) {
+                file->load_tensor_dense(name, measured.loaded,
+                                        measured.ordering, buffer.data(),
+                                        measured.permutation);
+            }
+        };
+    } else if (interface_name == "cpp-vector") {
+        load_all = [&]() {
+            for (const auto &name : names) {
+                const auto tensor = file->load_tensor_dense<float>(
+                    name, measured.ordering, measured.permutation);
+                if (tensor.second.size() != num_elements) {
+                    std::abort();
+                }
+            }
+        };
+    } else if (interface_name == "c") {
+        load_all = [&]() {
+            for (const auto &name : names) {
+                auto *tensor = reinterpret_cast<char *>(buffer.data());
+                const int status =
+                    measured.permutation.empty()
+                        ? dalotia_load_tensor_dense(c_file.get(), name.c_str(),
+                                                    tensor, measured.loaded,
+                                                    measured.ordering)
+                        : dalotia_load_tensor_dense_with_permutation(
+                              c_file.get(), name.c_str(), tensor,
+                              measured.loaded, measured.ordering,
+                              measured.permutation.data());
+                if (status != 0) {
+                    throw std::runtime_error("dalotia_load_tensor_dense failed");
+                }
+            }
+        };
+#ifdef DALOTIA_BENCH_WITH_FORTRAN
+    } else if (interface_name == "fortran") {
+        load_all = [&]() {
+            for (const auto &name : names) {
+                dalotia_bench_load_fortran(
+                    c_file.get(), name.c_str(), static_cast<int>(name.size()),
+                    static_cast<int>(measured.extents.size()));
+            }
+        };
+#endif
+    } else {
+        throw std::runtime_error("unknown interface " + interface_name);
+    }
+
+    open_file();
+    if (!measured.cold) {
+        try {
+            load_all();
+        } catch (const std::runtime_error &) {
+            // e.g. a format combination that dalotia cannot convert
+            result.supported = false;
+            return result;
+        }
+    }
+    std::vector<double> seconds;
+    for (int r = 0; r < repetitions; ++r) {
+        if (measured.cold) {
+            close_file();
+        }
+        result.resident_before_load +=
+            resident_fraction(filename, measured.cold) / repetitions;
+        if (measured.cold) {
+            open_file();
+        }
+        const auto faults_before = page_faults();
+        const auto start = std::chrono::steady_clock::now();
+        load_all();
+        seconds.push_back(seconds_since(start));
+        const auto faults_after = page_faults();
+        result.minor_faults +=
+            static_cast<double>(faults_after.first - faults_before.first) /
+            repetitions;
+        result.major_faults +=
+            static_cast<double>(faults_after.second - faults_before.second) /
+            repetitions;
+    }
+    std::sort(seconds.begin(), seconds.end());
+    result.min_seconds = seconds.front();
+    result.median_seconds = seconds[seconds.size() / 2];
+    return result;
+}
+
+// output
+
+void write_array(std::ostream &stream, const std::vector<int> &values) {
+    stream << "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        stream << (i > 0 ? "," : "") << values[i];
+    }
+    stream << "]";
+}
+
+void write_json(std::ostream &stream, const Options &options,
+                const std::vector<Baseline> &baselines,
+                const std::vector<Result> &results) {
+    std::map<int, double> memcpy_gbps;
+    stream << "{\n  \"parameters\": {\"size_MiB\": " << options.size_mib
+           << ", \"tensors\": " << options.num_tensors
+           << ", \"repetitions\": " << options.repetitions
+           << ", \"max_threads\": " << max_threads() << ", \"openmp\": "
+#ifdef _OPENMP
+           << "true"
+#else
+           << "false"
+#endif
+           << "},\n  \"baselines\": [";
+    for (size_t b = 0; b < baselines.size(); ++b) {
+        const auto &baseline = baselines[b];
+        memcpy_gbps[baseline.threads] = baseline.memcpy_gbps;
+        stream << (b > 0 ? "," : "") << "\n    {\"threads\": "
+               << baseline.threads
+               << ", \"memcpy_GBps\": " << baseline.memcpy_gbps
+               << ", \"stream_copy_GBps\": " << baseline.stream_copy_gbps
+               << ", \"stream_triad_GBps\": " << baseline.stream_triad_gbps
+               << "}";
+    }
+    stream << "\n  ],\n  \"results\": [";
+    for (size_t r = 0; r < results.size(); ++r) {
+        const auto &result = results[r];
+        const auto &measured = result.measured;
+        stream << (r > 0 ? "," : "") << "\n    {\"suite\": \""
+               << measured.suite << "\", \"interface\": \""
+               << measured.interface_name << "\", \"stored\": \""
+               << dtype_name(measured.stored) << "\", \"loaded\": \""
+               << dtype_name(measured.loaded) << "\", \"extents\": ";
+        write_array(stream, measured.extents);
+        stream << ", \"permutation\": ";
+        write_array(stream, measured.permutation);
+        stream << ", \"ordering\": \""
+               << (measured.ordering == dalotia_C_ordering ? "C" : "F")
+               << "\", \"threads\": " << measured.threads
+               << ", \"cache\": \"" << (measured.cold ? "cold" : "warm")
+               << "\", \"supported\": "
+               << (result.supported ? "true" : "false");
+        if (result.supported) {
+            const double gbps = result.num_bytes / result.min_seconds * 1e-9;
+            stream << ", \"bytes\": " << result.num_bytes
+                   << ", \"min_seconds\": " << result.min_seconds
+                   << ", \"median_seconds\": " << result.median_seconds
+                   << ", \"GBps\": " << gbps << ", \"relative_to_memcpy\": "
+                   << gbps / memcpy_gbps.at(measured.threads)
+                   << ", \"resident_before_load\": "
+                   << result.resident_before_load
+                   << ", \"minor_faults\": " << result.minor_faults
+                   << ", \"major_faults\": " << result.major_faults;
+        }
+        stream << "}";
+    }
+    stream << "\n  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(argument + " needs a value");
+                }
+                return argv[++i];
+            };
+            if (argument == "--help" || argument == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (argument == "--size") {
+                options.size_mib = std::stod(value());
+            } else if (argument == "--tensors") {
+                options.num_tensors = std::max(std::stoi(value()), 1);
+            } else if (argument == "--rank") {
+                options.max_rank = std::stoi(value());
+                if (options.max_rank < 1 || options.max_rank > 5) {
+                    throw std::runtime_error("the rank has to be 1 to 5");
+                }
+            } else if (argument == "--dtypes") {
+                options.formats.clear();
+                for (const auto &dtype : split(value())) {
+                    auto format = dalotia::safetensors_dtype_map.find(dtype);
+                    if (format == dalotia::safetensors_dtype_map.end()) {
+                        throw std::runtime_error("unknown dtype " + dtype);
+                    }
+                    options.formats.push_back(format->second);
+                }
+            } else if (argument == "--threads") {
+                for (const auto &count : split(value())) {
+                    options.thread_counts.push_back(
+                        std::max(std::stoi(count), 1));
+                }
+            } else if (argument == "--suites") {
+                options.suites = split(value());
+                for (const auto &suite : options.suites) {
+                    if (std::find(all_suites.begin(), all_suites.end(),
+                                  suite) == all_suites.end()) {
+                        throw std::runtime_error("unknown suite " + suite);
+                    }
+                }
+            } else if (argument == "--repetitions") {
+                options.repetitions = std::max(std::stoi(value()), 1);
+            } else if (argument == "--directory") {
+                options.directory = value();
+            } else if (argument == "--output") {
+                options.output = value();
+            } else if (argument == "--keep-files") {
+                options.keep_files = true;
+            } else {
+                throw std::runtime_error("unknown option " + argument);
+            }
+        }
+        if (options.size_mib <= 0.) {
+            throw std::runtime_error("the size has to be positive");
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-bench: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const int all_threads = max_threads();
+#ifndef _OPENMP
+    if (!options.thread_counts.empty()) {
+        std::cerr << "dalotia-bench: built without OpenMP, using one thread"
+                  << std::endl;
+        options.thread_counts.clear();
+    }
+#endif
+    if (options.thread_counts.empty()) {
+        for (int t = 1; t < all_threads; t *= 2) {
+            options.thread_counts.push_back(t);
+        }
+        options.thread_counts.push_back(all_threads);
+    }
+    auto runs = [&options](const std::string &suite) {
+        return std::find(options.suites.begin(), options.suites.end(),
+                         suite) != options.suites.end();
+    };
+    const auto num_elements =
+        static_cast<size_t>(options.size_mib * 1024. * 1024. / sizeof(float));
+
+    std::vector<Case> cases;
+    if (runs("dtypes")) {
+        for (const auto stored : options.formats) {
+            for (const auto loaded : options.formats) {
+                cases.push_back({"dtypes", "cpp", stored, loaded,
+                                 extents_for(num_elements, 2), {},
+                                 dalotia_C_ordering, all_threads, false});
+            }
+        }
+    }
+    if (runs("permutations")) {
+        for (int rank = 1; rank <= options.max_rank; ++rank) {
+            std::vector<int> permutation(rank);
+            std::iota(permutation.begin(), permutation.end(), 0);
+            do {
+                for (const auto ordering :
+                     {dalotia_C_ordering, dalotia_F_ordering}) {
+                    cases.push_back({"permutations", "cpp", dalotia_float_32,
+                                     dalotia_float_32,
+                                     extents_for(num_elements, rank),
+                                     permutation, ordering, all_threads,
+                                     false});
+                }
+            } while (std::next_permutation(permutation.begin(),
+                                           permutation.end()));
+        }
+    }
+    if (runs("threads")) {
+        // a plain copy, a conversion and a transposition
+        const int rank = std::min(options.max_rank, 3);
+        std::vector<int> reversed(rank);
+        std::iota(reversed.rbegin(), reversed.rend(), 0);
+        for (const int threads : options.thread_counts) {
+            const auto extents = extents_for(num_elements, rank);
+            cases.push_back({"threads", "cpp", dalotia_float_32,
+                             dalotia_float_32, extents, {}, dalotia_C_ordering,
+                             threads, false});
+            cases.push_back({"threads", "cpp", dalotia_float_32,
+                             dalotia_float_64, extents, {}, dalotia_C_ordering,
+                             threads, false});
+            cases.push_back({"threads", "cpp", dalotia_float_32,
+                             dalotia_float_32, extents, reversed,
+                             dalotia_C_ordering, threads, false});
+        }
+    }
+    if (runs("cache")) {
+        for (const bool cold : {false, true}) {
+            cases.push_back({"cache", "cpp", dalotia_float_32,
+                             dalotia_float_32, extents_for(num_elements, 2),
+                             {}, dalotia_C_ordering, all_threads, cold});
+        }
+    }
+    if (runs("interfaces")) {
+        std::vector<std::string> interfaces{"cpp", "cpp-vector", "c"};
+#ifdef DALOTIA_BENCH_WITH_FORTRAN
+        interfaces.push_back("fortran");
+#endif
+        // the Fortran interface loads single precision without permutation
+        for (int rank = 1; rank <= options.max_rank; ++rank) {
+            for (const auto &interface_name : interfaces) {
+                cases.push_back({"interfaces", interface_name,
+                                 dalotia_float_32, dalotia_float_32,
+                                 extents_for(num_elements, rank), {},
+                                 dalotia_C_ordering, all_threads, false});
+            }
+        }
+    }
+
+    std::map<std::pair<dalotia_WeightFormat, std::vector<int>>, std::string>
+        files;
+    std::vector<Baseline> baselines;
+    std::vector<Result> results;
+    try {
+        std::vector<int> baseline_threads = options.thread_counts;
+        baseline_threads.push_back(all_threads);
+        std::sort(baseline_threads.begin(), baseline_threads.end());
+        baseline_threads.erase(
+            std::unique(baseline_threads.begin(), baseline_threads.end()),
+            baseline_threads.end());
+        for (const int threads : baseline_threads) {
+            baselines.push_back(measure_baseline(
+                threads, num_elements * sizeof(float) * options.num_tensors,
+                options.repetitions));
+        }
+
+        for (const auto &measured : cases) {
+            auto &filename = files[{measured.stored, measured.extents}];
+            if (filename.empty()) {
+                filename = options.directory + "/dalotia-bench-" +
+                           dtype_name(measured.stored) + "-rank" +
+                           std::to_string(measured.extents.size()) +
+                           ".safetensors";
+                generate_file(filename, measured.stored, measured.extents,
+                              options.num_tensors);
+            }
+            results.push_back(measure(measured, filename, options.num_tensors,
+                                      options.repetitions));
+            const auto &result = results.back();
+            std::cerr << measured.suite << " " << measured.interface_name
+                      << " " << dtype_name(measured.stored) << "->"
+                      << dtype_name(measured.loaded) << " rank "
+                      << measured.extents.size() << " "
+                      << (measured.ordering == dalotia_C_ordering ? "C" : "F")
+                      << " " << measured.threads << " threads "
+                      << (measured.cold ? "cold" : "warm") << ": ";
+            if (result.supported) {
+                std::cerr << result.num_bytes / result.min_seconds * 1e-9
+                          << " GB/s, " << result.minor_faults << " minor / "
+                          << result.major_faults << " major faults, "
+                          << 100. * result.resident_before_load
+                          << "% cached" << std::endl;
+            } else {
+                std::cerr << "unsupported" << std::endl;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-bench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!options.keep_files) {
+        for (const auto &file : files) {
+            std::remove(file.second.c_str());
+        }
+    }
+
+    if (options.output.empty()) {
+        write_json(std::cout, options, baselines, results);
+    } else {
+        std::ofstream stream(options.output);
+        write_json(stream, options, baselines, results);
+        if (!stream) {
+            std::cerr << "dalotia-bench: could not write " << options.output
+                      << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
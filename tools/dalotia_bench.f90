@@ -0,0 +1,39 @@
+! the Fortran side of dalotia-bench: loads a single-precision tensor
+! through the generic dalotia_load_tensor_dense of the Fortran module,
+! i.e. with the allocation and reshape a Fortran user pays for; called
+! (and timed) by the C++ driver, with the file opened there
+subroutine dalotia_bench_load_fortran(dalotia_file_pointer, tensor_name_c, &
+                                      name_length, tensor_rank) &
+        bind(C, name="dalotia_bench_load_fortran")
+    use, intrinsic :: ISO_C_binding, only: C_ptr, C_char, C_int, C_float
+    use dalotia_c_interface
+    implicit none
+    type(C_ptr), intent(in), value :: dalotia_file_pointer
+    character(kind=C_char), dimension(*), intent(in) :: tensor_name_c
+    integer(C_int), intent(in), value :: name_length, tensor_rank
+    character(kind=C_char, len=name_length) :: tensor_name
+    real(C_float), dimension(:), allocatable :: tensor_1
+    real(C_float), dimension(:,:), allocatable :: tensor_2
+    real(C_float), dimension(:,:,:), allocatable :: tensor_3
+    real(C_float), dimension(:,:,:,:), allocatable :: tensor_4
+    real(C_float), dimension(:,:,:,:,:), allocatable :: tensor_5
+    integer :: i
+
+    do i = 1, name_length
+        tensor_name(i:i) = tensor_name_c(i)
+    end do
+    select case (tensor_rank)
+    case (1)
+        call dalotia_load_tensor_dense(dalotia_file_pointer, tensor_name, tensor_1)
+    case (2)
+        call dalotia_load_tensor_dense(dalotia_file_pointer, tensor_name, tensor_2)
+    case (3)
+        call dalotia_load_tensor_dense(dalotia_file_pointer, tensor_name, tensor_3)
+    case (4)
+        call dalotia_load_tensor_dense(dalotia_file_pointer, tensor_name, tensor_4)
+    case (5)
+        call dalotia_load_tensor_dense(dalotia_file_pointer, tensor_name, tensor_5)
+    case default
+        error stop "dalotia-bench: unsupported rank"
+    end select
+end subroutine dalotia_bench_load_fortran
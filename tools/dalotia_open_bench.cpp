@@ -0,0 +1,181 @@
+// dalotia-open-bench: writes synthetic safetensors files with 10^3 up to
+// 10^6 small tensors and times opening them, listing the tensor names and
+// looking tensors up by name, i.e. the cost of the header rather than of
+// the data
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.hpp"
+#include "dalotia_safetensors_writer.hpp"
+
+namespace {
+
+void print_usage(const char *program) {
+    std::cerr
+        << "usage: " << program << " [options]\n"
+        << "options:\n"
+        << "  --min <n>             fewest tensors (default: 1000)\n"
+        << "  --max <n>             most tensors, in steps of 10x (default: "
+           "1000000)\n"
+        << "  --directory <d>       where the files are written (default: .)\n"
+        << "  --lookups <n>         tensors looked up by name (default: "
+           "10000)\n"
+        << "  --repetitions <n>     the fastest repetition counts (default: "
+           "5)\n";
+}
+
+// fastest of the repetitions, in seconds
+double time_fastest(int repetitions, const std::function<void()> &function) {
+    double fastest = 0.;
+    for (int r = 0; r < repetitions; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start;
+        if (r == 0 || duration.count() < fastest) {
+            fastest = duration.count();
+        }
+    }
+    return fastest;
+}
+
+// names as in a transformer checkpoint, so the keys have realistic lengths
+std::string tensor_name(size_t index) {
+    static const char *const parameters[] = {
+        "self_attn.q_proj.weight", "self_attn.k_proj.weight",
+        "self_attn.v_proj.weight", "self_attn.o_proj.weight",
+        "mlp.gate_proj.weight",    "mlp.up_proj.weight",
+        "mlp.down_proj.weight",    "input_layernorm.weight"};
+    return "model.layers." + std::to_string(index / 8) + "." +
+           parameters[index % 8];
+}
+
+void write_file(const std::string &filename, size_t num_tensors) {
+    static const float tensor[4] = {1.f, 2.f, 3.f, 4.f};
+    dalotia::SafetensorsFileWriter writer(filename);
+    for (size_t i = 0; i < num_tensors; ++i) {
+        writer.add_tensor_dense(tensor_name(i), {2, 2}, tensor);
+    }
+    writer.write();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    size_t min_tensors = 1000;
+    size_t max_tensors = 1000000;
+    std::string directory = ".";
+    size_t num_lookups = 10000;
+    int repetitions = 5;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(argument + " needs a value");
+                }
+                return argv[++i];
+            };
+            if (argument == "--help" || argument == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (argument == "--min") {
+                min_tensors = std::max<size_t>(std::stoul(value()), 1);
+            } else if (argument == "--max") {
+                max_tensors = std::stoul(value());
+            } else if (argument == "--directory") {
+                directory = value();
+            } else if (argument == "--lookups") {
+                num_lookups = std::max<size_t>(std::stoul(value()), 1);
+            } else if (argument == "--repetitions") {
+                repetitions = std::max(std::stoi(value()), 1);
+            } else {
+                throw std::runtime_error("unknown option " + argument);
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-open-bench: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::setw(10) << "tensors" << std::setw(14) << "header [MiB]"
+              << std::setw(12) << "open [ms]" << std::setw(18)
+              << "open+names [ms]" << std::setw(16) << "per tensor [ns]"
+              << std::setw(14) << "lookup [ns]" << "\n";
+    try {
+        for (size_t num_tensors = min_tensors; num_tensors <= max_tensors;
+             num_tensors *= 10) {
+            const std::string filename = directory + "/dalotia-open-bench-" +
+                                         std::to_string(num_tensors) +
+                                         ".safetensors";
+            write_file(filename, num_tensors);
+            uint64_t header_size = 0;
+            {
+                std::ifstream stream(filename, std::ios::binary);
+                stream.read(reinterpret_cast<char *>(&header_size),
+                            sizeof(header_size));
+                std::unique_ptr<dalotia::TensorFile> file(
+                    dalotia::make_tensor_file(filename));
+                if (file->get_tensor_names().size() != num_tensors) {
+                    throw std::runtime_error("wrong number of tensors in " +
+                                             filename);
+                }
+            }
+            const double open_time = time_fastest(repetitions, [&]() {
+                std::unique_ptr<dalotia::TensorFile> file(
+                    dalotia::make_tensor_file(filename));
+            });
+            const double names_time = time_fastest(repetitions, [&]() {
+                std::unique_ptr<dalotia::TensorFile> file(
+                    dalotia::make_tensor_file(filename));
+                if (file->get_tensor_names().empty()) {
+                    std::abort();
+                }
+            });
+
+            // extents and a load of tensors spread over the whole header
+            std::unique_ptr<dalotia::TensorFile> file(
+                dalotia::make_tensor_file(filename));
+            std::vector<std::string> names;
+            for (size_t l = 0; l < num_lookups; ++l) {
+                names.push_back(tensor_name(l * 7919 % num_tensors));
+            }
+            float tensor[4];
+            const double lookup_time = time_fastest(repetitions, [&]() {
+                for (const auto &name : names) {
+                    if (file->get_tensor_extents(name).size() != 2) {
+                        std::abort();
+                    }
+                    file->load_tensor_dense(
+                        name, dalotia_float_32, dalotia_C_ordering,
+                        reinterpret_cast<dalotia_byte *>(tensor));
+                }
+            });
+            std::remove(filename.c_str());
+
+            std::cout << std::setw(10) << num_tensors << std::fixed
+                      << std::setprecision(2) << std::setw(14)
+                      << header_size / (1024. * 1024.) << std::setw(12)
+                      << open_time * 1e3 << std::setw(18) << names_time * 1e3
+                      << std::setprecision(0) << std::setw(16)
+                      << names_time * 1e9 / num_tensors << std::setw(14)
+                      << lookup_time * 1e9 / names.size() << std::endl;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-open-bench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
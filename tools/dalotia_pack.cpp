@@ -0,0 +1,327 @@
+// dalotia-pack: converts any file dalotia can read into the dalotia pack
+// format, with every tensor already in the weight format, ordering and
+// permutation the application is going to load it in
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "dalotia.hpp"
+
+namespace {
+
+struct TensorLayout {
+    bool keep_format = true;
+    dalotia_WeightFormat format = dalotia_float_32;
+    dalotia_Ordering ordering = dalotia_C_ordering;
+    std::vector<int> permutation;
+};
+
+void print_usage(const char *program) {
+    std::cerr
+        << "usage: " << program << " [options] <input> <output.dalotia>\n"
+        << "options:\n"
+        << "  --format <F64|F32|F16|BF16|U32|U16|U8|I32|I16|I8>\n"
+        << "                        weight format of all tensors (default: as "
+           "in the input)\n"
+        << "  --ordering <C|F>      ordering of all tensors (default: C)\n"
+        << "  --tensor <name>[:format=<format>][:ordering=<C|F>]"
+           "[:permutation=<p0,p1,...>]\n"
+        << "                        layout of a single tensor, can be repeated\n"
+        << "  --order <file>        tensor names, one per line, in the order "
+           "the\n"
+        << "                        application reads them; they are placed "
+           "first\n"
+        << "  --alignment <4k|2m|bytes>\n"
+        << "                        alignment of the payloads (default: 4k)\n"
+        << "  --benchmark           time loading from the input and from the "
+           "output\n"
+        << "  --repetitions <n>     repetitions for --benchmark, the fastest "
+           "counts\n"
+        << "                        (default: 5)\n";
+}
+
+dalotia_WeightFormat parse_format(std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    for (const auto &[format, format_name] : dalotia::safetensors_dtype_names) {
+        if (format_name == name) {
+            return format;
+        }
+    }
+    throw std::runtime_error("unknown weight format " + name);
+}
+
+dalotia_Ordering parse_ordering(const std::string &name) {
+    if (name == "C" || name == "c") {
+        return dalotia_C_ordering;
+    } else if (name == "F" || name == "f") {
+        return dalotia_F_ordering;
+    }
+    throw std::runtime_error("unknown ordering " + name);
+}
+
+std::vector<std::string> split(const std::string &string, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(string);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+size_t parse_alignment(const std::string &alignment) {
+    if (alignment == "4k" || alignment == "4K") {
+        return dalotia::PackFileWriter::default_alignment;
+    } else if (alignment == "2m" || alignment == "2M") {
+        return dalotia::PackFileWriter::huge_page_alignment;
+    }
+    return std::stoull(alignment);
+}
+
+// the tensors in --order first, then all others in file order
+std::vector<std::string> access_order(const dalotia::TensorFile &file,
+                                      const std::string &order_filename) {
+    const auto &tensor_names = file.get_tensor_names();
+    std::vector<std::string> order;
+    if (!order_filename.empty()) {
+        std::ifstream order_file(order_filename);
+        if (!order_file) {
+            throw std::runtime_error("could not open " + order_filename);
+        }
+        std::string name;
+        while (std::getline(order_file, name)) {
+            if (name.empty()) {
+                continue;
+            }
+            if (std::find(tensor_names.begin(), tensor_names.end(), name) ==
+                tensor_names.end()) {
+                throw std::runtime_error("tensor " + name + " from " +
+                                         order_filename + " not in the input");
+            }
+            if (std::find(order.begin(), order.end(), name) == order.end()) {
+                order.push_back(name);
+            }
+        }
+    }
+    for (const auto &name : tensor_names) {
+        if (std::find(order.begin(), order.end(), name) == order.end()) {
+            order.push_back(name);
+        }
+    }
+    return order;
+}
+
+// fastest of the repetitions, in seconds
+double time_fastest(int repetitions, const std::function<void()> &function) {
+    double fastest = 0.;
+    for (int r = 0; r < repetitions; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start;
+        if (r == 0 || duration.count() < fastest) {
+            fastest = duration.count();
+        }
+    }
+    return fastest;
+}
+
+void report(const std::string &what, double seconds, size_t num_bytes) {
+    std::cout << what << ": " << seconds * 1e3 << " ms";
+    if (num_bytes > 0) {
+        std::cout << " (" << num_bytes / seconds * 1e-9 << " GB/s)";
+    }
+    std::cout << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> positional;
+    TensorLayout default_layout;
+    std::map<std::string, TensorLayout> tensor_layouts;
+    std::vector<std::string> tensor_specs;
+    std::string order_filename;
+    size_t alignment = dalotia::PackFileWriter::default_alignment;
+    bool benchmark = false;
+    int repetitions = 5;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(argument + " needs a value");
+                }
+                return argv[++i];
+            };
+            if (argument == "--help" || argument == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (argument == "--format") {
+                default_layout.format = parse_format(value());
+                default_layout.keep_format = false;
+            } else if (argument == "--ordering") {
+                default_layout.ordering = parse_ordering(value());
+            } else if (argument == "--tensor") {
+                tensor_specs.push_back(value());
+            } else if (argument == "--order") {
+                order_filename = value();
+            } else if (argument == "--alignment") {
+                alignment = parse_alignment(value());
+            } else if (argument == "--benchmark") {
+                benchmark = true;
+            } else if (argument == "--repetitions") {
+                repetitions = std::max(std::stoi(value()), 1);
+            } else if (argument.rfind("--", 0) == 0) {
+                throw std::runtime_error("unknown option " + argument);
+            } else {
+                positional.push_back(argument);
+            }
+        }
+        if (positional.size() != 2) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        // per-tensor layouts start from the global one
+        for (const auto &spec : tensor_specs) {
+            const auto parts = split(spec, ':');
+            TensorLayout layout = default_layout;
+            for (size_t p = 1; p < parts.size(); ++p) {
+                const auto equals = parts[p].find('=');
+                const std::string key = parts[p].substr(0, equals);
+                const std::string setting =
+                    equals == std::string::npos ? "" : parts[p].substr(equals + 1);
+                if (key == "format") {
+                    layout.format = parse_format(setting);
+                    layout.keep_format = false;
+                } else if (key == "ordering") {
+                    layout.ordering = parse_ordering(setting);
+                } else if (key == "permutation") {
+                    layout.permutation.clear();
+                    for (const auto &dimension : split(setting, ',')) {
+                        layout.permutation.push_back(std::stoi(dimension));
+                    }
+                } else {
+                    throw std::runtime_error("unknown tensor setting " + key);
+                }
+            }
+            tensor_layouts[parts.at(0)] = layout;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-pack: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const std::string &input_filename = positional[0];
+    const std::string &output_filename = positional[1];
+
+    try {
+        std::unique_ptr<dalotia::TensorFile> input(
+            dalotia::make_tensor_file(input_filename));
+        const auto order = access_order(*input, order_filename);
+        for (const auto &[name, layout] : tensor_layouts) {
+            if (std::find(order.begin(), order.end(), name) == order.end()) {
+                throw std::runtime_error("tensor " + name + " not in the input");
+            }
+        }
+
+        // the final layout of each tensor, such that the benchmark can
+        // repeat the exact same loads
+        std::vector<TensorLayout> layouts;
+        std::vector<std::vector<dalotia_byte>> tensors;
+        size_t total_bytes = 0;
+        for (const auto &name : order) {
+            auto layout_iterator = tensor_layouts.find(name);
+            TensorLayout layout = layout_iterator == tensor_layouts.end()
+                                      ? default_layout
+                                      : layout_iterator->second;
+            if (layout.keep_format) {
+                layout.format = input->get_weight_format(name);
+            }
+            tensors.emplace_back(input->get_num_tensor_elements(name) *
+                                 dalotia::sizeof_weight_format(layout.format));
+            total_bytes += tensors.back().size();
+            layouts.push_back(layout);
+        }
+
+        dalotia::PackFileWriter writer(output_filename, alignment);
+        for (size_t t = 0; t < order.size(); ++t) {
+            const auto &layout = layouts[t];
+            input->load_tensor_dense(order[t], layout.format, layout.ordering,
+                                     tensors[t].data(), layout.permutation);
+            // the loaded memory is the C-ordered tensor with the dimensions
+            // in load order; that is what gets stored, with its storage order
+            const auto extents = input->get_tensor_extents(order[t]);
+            const auto load_permutation =
+                dalotia::final_c_permutation_from_permutation_and_order(
+                    layout.permutation, layout.ordering, extents.size());
+            std::vector<int> memory_extents = extents;
+            for (size_t d = 0; d < load_permutation.size(); ++d) {
+                memory_extents[d] = extents[load_permutation[d]];
+            }
+            writer.add_tensor_dense(order[t], layout.format, dalotia_C_ordering,
+                                    memory_extents, tensors[t].data(),
+                                    layout.format, load_permutation);
+        }
+        writer.write();
+        std::cout << "packed " << order.size() << " tensors (" << total_bytes
+                  << " bytes) from " << input_filename << " into "
+                  << output_filename << std::endl;
+
+        if (benchmark) {
+            input.reset();
+            // both sides open the file and produce every tensor in its
+            // target layout; the file contents are in the page cache after
+            // the first repetition
+            auto load_all = [&](const std::string &filename) {
+                std::unique_ptr<dalotia::TensorFile> file(
+                    dalotia::make_tensor_file(filename));
+                for (size_t t = 0; t < order.size(); ++t) {
+                    file->load_tensor_dense(order[t], layouts[t].format,
+                                            layouts[t].ordering,
+                                            tensors[t].data(),
+                                            layouts[t].permutation);
+                }
+            };
+            report("load from " + input_filename,
+                   time_fastest(repetitions, [&]() { load_all(input_filename); }),
+                   total_bytes);
+            report("load from " + output_filename,
+                   time_fastest(repetitions, [&]() { load_all(output_filename); }),
+                   total_bytes);
+            // zero-copy: open and touch every page of every payload
+            volatile dalotia_byte checksum = 0;
+            report("zero-copy from " + output_filename,
+                   time_fastest(repetitions,
+                                [&]() {
+                                    std::unique_ptr<dalotia::TensorFile> file(
+                                        dalotia::make_tensor_file(output_filename));
+                                    dalotia_byte sum = 0;
+                                    for (size_t t = 0; t < order.size(); ++t) {
+                                        const auto *data =
+                                            file->get_mmap_tensor_pointers(order[t])
+                                                .at(0);
+                                        for (size_t b = 0; b < tensors[t].size();
+                                             b += 4096) {
+                                            sum ^= data[b];
+                                        }
+                                    }
+                                    checksum = sum;
+                                }),
+                   total_bytes);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-pack: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
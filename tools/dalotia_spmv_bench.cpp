@@ -0,0 +1,326 @@
+// dalotia-spmv-bench: loads weight matrices in every sparse format dalotia
+// can produce and times y = A x with each of them, to pick the layout that
+// suits the machine (e.g. SELL-C-sigma with C = SIMD width on wide-vector
+// CPUs); all formats are checked against CSR, optionally after a
+// bandwidth-reducing reordering
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dalotia.hpp"
+
+namespace {
+
+void print_usage(const char *program) {
+    std::cerr
+        << "usage: " << program << " [options] <file> [tensor ...]\n"
+        << "  all tensors with at least two dimensions if none are given;\n"
+        << "  a tensor is the matrix of its last dimension by all others\n"
+        << "options:\n"
+        << "  --threshold <t>       prune values of at most this magnitude "
+           "(default: 0)\n"
+        << "  --block <r>x<c>       BSR block shape (default: 4x4)\n"
+        << "  --chunk <C>           SELL chunk size (default: 8)\n"
+        << "  --sigma <s>           SELL sorting scope (default: 1)\n"
+        << "  --rcm                 reverse Cuthill-McKee reordering of the "
+           "sparse formats\n"
+        << "  --repetitions <n>     the fastest repetition counts (default: "
+           "10)\n";
+}
+
+// fastest of the repetitions, in seconds
+double time_fastest(int repetitions, const std::function<void()> &function) {
+    double fastest = 0.;
+    for (int r = 0; r < repetitions; ++r) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> duration =
+            std::chrono::steady_clock::now() - start;
+        if (r == 0 || duration.count() < fastest) {
+            fastest = duration.count();
+        }
+    }
+    return fastest;
+}
+
+struct SparseMatrix {
+    std::vector<float> values;
+    std::vector<int> first_indices;
+    std::vector<int> second_indices;
+};
+
+SparseMatrix load(dalotia::TensorFile &file, const std::string &name,
+                  dalotia_SparseFormat format) {
+    const auto extents = file.get_sparse_tensor_extents(name, format);
+    SparseMatrix matrix{std::vector<float>(extents[0]),
+                        std::vector<int>(extents[1]),
+                        std::vector<int>(extents[2])};
+    file.load_tensor_sparse(name, format, dalotia_float_32, dalotia_C_ordering,
+                            reinterpret_cast<dalotia_byte *>(matrix.values.data()),
+                            matrix.first_indices.data(),
+                            matrix.second_indices.data());
+    return matrix;
+}
+
+size_t num_bytes(const SparseMatrix &matrix) {
+    return matrix.values.size() * sizeof(float) +
+           (matrix.first_indices.size() + matrix.second_indices.size()) *
+               sizeof(int);
+}
+
+void spmv_dense(const dalotia::vector<float> &a, const std::vector<float> &x,
+                std::vector<float> &y) {
+    const size_t num_rows = y.size(), num_columns = x.size();
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        float sum = 0.f;
+        for (size_t c = 0; c < num_columns; ++c) {
+            sum += a[r * num_columns + c] * x[c];
+        }
+        y[r] = sum;
+    }
+}
+
+void spmv_csr(const SparseMatrix &a, const std::vector<float> &x,
+              std::vector<float> &y) {
+    const size_t num_rows = y.size();
+#pragma omp parallel for schedule(static)
+    for (size_t r = 0; r < num_rows; ++r) {
+        float sum = 0.f;
+        for (int k = a.first_indices[r]; k < a.first_indices[r + 1]; ++k) {
+            sum += a.values[k] * x[a.second_indices[k]];
+        }
+        y[r] = sum;
+    }
+}
+
+// scatters into y, so it stays sequential
+void spmv_coo(const SparseMatrix &a, const std::vector<float> &x,
+              std::vector<float> &y) {
+    std::fill(y.begin(), y.end(), 0.f);
+    for (size_t k = 0; k < a.values.size(); ++k) {
+        y[a.first_indices[k]] += a.values[k] * x[a.second_indices[k]];
+    }
+}
+
+void spmv_bsr(const SparseMatrix &a, int block_rows, int block_columns,
+              const std::vector<float> &x, std::vector<float> &y) {
+    const size_t num_rows = y.size(), num_columns = x.size();
+    const size_t num_block_rows = a.first_indices.size() - 1;
+    const size_t block_size = static_cast<size_t>(block_rows) * block_columns;
+#pragma omp parallel for schedule(static)
+    for (size_t br = 0; br < num_block_rows; ++br) {
+        std::vector<float> sums(block_rows, 0.f);
+        for (int b = a.first_indices[br]; b < a.first_indices[br + 1]; ++b) {
+            const float *block = a.values.data() + b * block_size;
+            const size_t first_column =
+                static_cast<size_t>(a.second_indices[b]) * block_columns;
+            const size_t width =
+                std::min<size_t>(block_columns, num_columns - first_column);
+            for (int i = 0; i < block_rows; ++i) {
+                for (size_t j = 0; j < width; ++j) {
+                    sums[i] += block[i * block_columns + j] * x[first_column + j];
+                }
+            }
+        }
+        for (int i = 0; i < block_rows && br * block_rows + i < num_rows; ++i) {
+            y[br * block_rows + i] = sums[i];
+        }
+    }
+}
+
+void spmv_sell(const SparseMatrix &a, int chunk_size,
+               const std::vector<float> &x, std::vector<float> &y) {
+    const size_t num_rows = y.size();
+    const size_t num_chunks = (num_rows + chunk_size - 1) / chunk_size;
+    const int *rows = a.first_indices.data() + num_chunks + 1;
+#pragma omp parallel for schedule(static)
+    for (size_t c = 0; c < num_chunks; ++c) {
+        std::vector<float> sums(chunk_size, 0.f);
+        for (int k = a.first_indices[c]; k < a.first_indices[c + 1];
+             k += chunk_size) {
+            // one value of each row of the chunk: contiguous, vectorizable
+#pragma omp simd
+            for (int i = 0; i < chunk_size; ++i) {
+                sums[i] += a.values[k + i] * x[a.second_indices[k + i]];
+            }
+        }
+        for (int i = 0; i < chunk_size && c * chunk_size + i < num_rows; ++i) {
+            y[rows[c * chunk_size + i]] = sums[i];
+        }
+    }
+}
+
+// the largest distance of a non-zero from the diagonal
+size_t bandwidth(const SparseMatrix &csr) {
+    size_t bandwidth = 0;
+    for (size_t r = 0; r + 1 < csr.first_indices.size(); ++r) {
+        for (int k = csr.first_indices[r]; k < csr.first_indices[r + 1]; ++k) {
+            const size_t c = csr.second_indices[k];
+            bandwidth = std::max(bandwidth, c > r ? c - r : r - c);
+        }
+    }
+    return bandwidth;
+}
+
+double max_difference(const std::vector<float> &y,
+                      const std::vector<float> &reference) {
+    double difference = 0.;
+    for (size_t r = 0; r < y.size(); ++r) {
+        difference = std::max(
+            difference, std::fabs(static_cast<double>(y[r]) - reference[r]) /
+                            std::max(1., std::fabs(static_cast<double>(reference[r]))));
+    }
+    return difference;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> positional;
+    double threshold = 0.;
+    dalotia::SparseLayout layout;
+    int repetitions = 10;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string argument = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::runtime_error(argument + " needs a value");
+                }
+                return argv[++i];
+            };
+            if (argument == "--help" || argument == "-h") {
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            } else if (argument == "--threshold") {
+                threshold = std::stod(value());
+            } else if (argument == "--block") {
+                const std::string shape = value();
+                const auto x = shape.find('x');
+                if (x == std::string::npos) {
+                    throw std::runtime_error("block shape must be <r>x<c>");
+                }
+                layout.block_rows = std::stoi(shape.substr(0, x));
+                layout.block_columns = std::stoi(shape.substr(x + 1));
+            } else if (argument == "--chunk") {
+                layout.chunk_size = std::stoi(value());
+            } else if (argument == "--sigma") {
+                layout.sorting_scope = std::stoi(value());
+            } else if (argument == "--rcm") {
+                layout.reorder_rcm = true;
+            } else if (argument == "--repetitions") {
+                repetitions = std::max(std::stoi(value()), 1);
+            } else if (argument.rfind("--", 0) == 0) {
+                throw std::runtime_error("unknown option " + argument);
+            } else {
+                positional.push_back(argument);
+            }
+        }
+        if (positional.empty()) {
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-spmv-bench: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        std::unique_ptr<dalotia::TensorFile> file(
+            dalotia::make_tensor_file(positional[0]));
+        file->set_prune_threshold(threshold);
+        file->set_sparse_layout(layout);
+        std::vector<std::string> names(positional.begin() + 1, positional.end());
+        if (names.empty()) {
+            for (const auto &name : file->get_tensor_names()) {
+                if (file->get_num_dimensions(name) >= 2) {
+                    names.push_back(name);
+                }
+            }
+        }
+
+        bool correct = true;
+        std::cout << std::setprecision(3);
+        for (const auto &name : names) {
+            const auto extents = file->get_tensor_extents(name);
+            const size_t num_columns = extents.empty() ? 1 : extents.back();
+            const size_t num_rows = file->get_num_tensor_elements(name) /
+                                    std::max<size_t>(num_columns, 1);
+            const size_t nnz = file->get_nnz(name);
+            std::cout << name << ": " << num_rows << " x " << num_columns
+                      << ", " << nnz << " non-zeros" << std::endl;
+
+            // the sparse formats work on the reordered x and y, if any
+            const auto permutation = file->get_sparse_permutation(name);
+            std::vector<float> x_dense(num_columns), y_dense(num_rows);
+            std::vector<float> x(num_columns), y(num_rows), reference(num_rows);
+            for (size_t c = 0; c < num_columns; ++c) {
+                x_dense[c] = 1.f + static_cast<float>(c % 7) / 7.f;
+            }
+            for (size_t c = 0; c < num_columns; ++c) {
+                x[c] = x_dense[permutation.columns[c]];
+            }
+            // CSR is the reference, as the dense baseline includes the
+            // values that pruning drops
+            const auto dense = file->load_tensor_dense<float>(name).second;
+            const auto csr = load(*file, name, dalotia_CSR);
+            spmv_csr(csr, x, reference);
+            std::cout << "  bandwidth " << bandwidth(csr) << std::endl;
+
+            auto run = [&](const std::string &format, size_t bytes,
+                           const std::function<void()> &spmv) {
+                spmv();
+                const double difference = max_difference(y, reference);
+                // the dense product still has the pruned values
+                if (difference > 1e-4 && (format != "dense" || threshold <= 0.)) {
+                    correct = false;
+                }
+                const double seconds = time_fastest(repetitions, spmv);
+                std::cout << "  " << std::left << std::setw(6) << format
+                          << std::right << std::setw(12) << bytes << " B "
+                          << std::setw(10) << seconds * 1e6 << " us "
+                          << std::setw(8) << 2. * nnz / seconds * 1e-9
+                          << " GFLOP/s";
+                if (difference > 1e-4) {
+                    std::cout << "  (max. relative difference " << difference
+                              << ")";
+                }
+                std::cout << std::endl;
+            };
+            run("dense", dense.size() * sizeof(float), [&]() {
+                spmv_dense(dense, x_dense, y_dense);
+                for (size_t r = 0; r < num_rows; ++r) {
+                    y[r] = y_dense[permutation.rows[r]];
+                }
+            });
+            run("CSR", num_bytes(csr), [&]() { spmv_csr(csr, x, y); });
+            const auto coo = load(*file, name, dalotia_COO);
+            run("COO", num_bytes(coo), [&]() { spmv_coo(coo, x, y); });
+            const auto bsr = load(*file, name, dalotia_BSR);
+            run("BSR", num_bytes(bsr), [&]() {
+                spmv_bsr(bsr, layout.block_rows, layout.block_columns, x, y);
+            });
+            const auto sell = load(*file, name, dalotia_SELL);
+            run("SELL", num_bytes(sell),
+                [&]() { spmv_sell(sell, layout.chunk_size, x, y); });
+        }
+        if (!correct) {
+            std::cerr << "dalotia-spmv-bench: formats disagree" << std::endl;
+            return EXIT_FAILURE;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "dalotia-spmv-bench: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}